@@ -0,0 +1,107 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_BENCHMARKS_BENCH_H_
+#define STLC_BENCHMARKS_BENCH_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Width of every generated key including the `NULL` terminator.
+#define BENCH_KEY_WIDTH 0x18
+
+// Returns a monotonic timestamp in nanoseconds.
+static inline double BenchNow(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// Returns the `i`-th key of a buffer created by `BenchMakeKeys()`.
+#define BENCH_KEY(keys, i) ((keys) + (size_t)(i)*BENCH_KEY_WIDTH)
+
+// Allocates `count` distinct `NULL` terminated string keys laid out every
+// `BENCH_KEY_WIDTH` bytes.  Keys generated with different `prefix` values
+// never collide with each other, which makes them useful as misses.
+static inline char* BenchMakeKeys(const size_t count, const char* prefix) {
+  char* keys = (char*)malloc(count * BENCH_KEY_WIDTH);
+  if (keys == NULL) {
+    fprintf(stderr, "BenchMakeKeys: failed to allocate %zu keys\n", count);
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < count; ++i) {
+    snprintf(BENCH_KEY(keys, i), BENCH_KEY_WIDTH, "%s-%zu", prefix, i);
+  }
+  return keys;
+}
+
+// Shuffles `count` indices in `order` so lookups do not follow insertion order.
+static inline void BenchShuffle(size_t* const order, const size_t count) {
+  unsigned long long state = 0x9E3779B97F4A7C15ULL;
+  for (size_t i = 0; i < count; ++i) order[i] = i;
+  for (size_t i = count; i > 1; --i) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    const size_t j = (size_t)(state % i);
+    const size_t tmp = order[i - 1];
+    order[i - 1] = order[j];
+    order[j] = tmp;
+  }
+}
+
+// Parses the key counts to benchmark from the command line, falling back to
+// `defaults` when none were given.  Returns the number of counts in `*counts`,
+// a copy the caller must release with `free()`.
+static inline size_t BenchParseCounts(int argc, char** argv,
+                                      const size_t* const defaults,
+                                      const size_t ndefaults,
+                                      size_t** const counts) {
+  const size_t ncounts = argc <= 1 ? ndefaults : (size_t)(argc - 1);
+  if ((*counts = (size_t*)malloc(ncounts * sizeof(size_t))) == NULL) {
+    fprintf(stderr, "BenchParseCounts: failed to allocate %zu counts\n",
+            ncounts);
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < ncounts; ++i) {
+    (*counts)[i] =
+        argc <= 1 ? defaults[i] : (size_t)strtoull(argv[i + 1], NULL, 0);
+  }
+  return ncounts;
+}
+
+// Prints one result row in nanoseconds per operation.
+static inline void BenchReport(const char* container, const char* operation,
+                               const size_t count, const double elapsed) {
+  printf("%-12s %-12s %12zu %10.2f ns/op\n", container, operation, count,
+         elapsed / (double)count);
+}
+
+#endif  // STLC_BENCHMARKS_BENCH_H_
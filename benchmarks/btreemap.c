@@ -0,0 +1,207 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Compares `BTreeMap` against a sorted `Vector` searched with binary search on
+// 8-byte keys, like the timestamps of a time series: point lookups, range
+// scans of `BENCH_RANGE` consecutive keys, bulk loading and random inserts,
+// for several node sizes.
+//
+// Usage:
+//    bench_btreemap [count...]
+//
+// Without arguments the benchmark runs with 1K, 1M and 10M keys.
+
+#include "btreemap/btreemap.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "bool.h"
+#include "vector/vector.h"
+
+#define BENCH_RANGE 0x64
+#define BENCH_RANGE_QUERIES 0x10000
+
+static const size_t kDefaultCounts[] = {1000, 1000000, 10000000};
+static const size_t kNodeSizes[] = {0x100, 0x400, 0x1000};
+
+typedef struct BenchRecord {
+  uint64_t key;
+  uint64_t value;
+} BenchRecord;
+
+static uint64_t range_sum;
+
+static int BenchCompare(const void* key1, const void* key2) {
+  const uint64_t a = *(const uint64_t*)key1, b = *(const uint64_t*)key2;
+  return a < b ? -1 : a > b ? 1 : 0;
+}
+
+static bool_t BenchSumValue(const void* key, const void* value) {
+  (void)key;
+  range_sum += *(const uint64_t*)value;
+  return TRUE;
+}
+
+// Returns the position of the first record of `vector` whose key is not
+// below `key`.
+static size_t BenchLowerBound(const Vector* const vector, const uint64_t key) {
+  size_t low = 0, high = vector->size;
+  while (low < high) {
+    const size_t middle = low + ((high - low) >> 0x01);
+    if (((const BenchRecord*)VectorGet(vector, middle))->key < key) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+static void BenchVector(const BenchRecord* const records,
+                        const size_t* const order, const size_t count) {
+  Vector vector;
+  VectorInit(&vector, (ssize_t)count);
+  double start = BenchNow();
+  for (size_t i = 0; i < count; ++i) VectorPush(&vector, (void*)&records[i]);
+  BenchReport("Vector", "load", count, BenchNow() - start);
+
+  size_t found = 0;
+  start = BenchNow();
+  for (size_t i = 0; i < count; ++i) {
+    const uint64_t key = records[order[i]].key;
+    const size_t pos = BenchLowerBound(&vector, key);
+    found += pos < vector.size &&
+             ((const BenchRecord*)VectorGet(&vector, pos))->key == key;
+  }
+  BenchReport("Vector", "get-hit", count, BenchNow() - start);
+
+  range_sum = 0;
+  start = BenchNow();
+  for (size_t q = 0; q < BENCH_RANGE_QUERIES; ++q) {
+    const BenchRecord* const low = &records[order[q % count]];
+    const uint64_t high = low->key + BENCH_RANGE * 3;
+    for (size_t pos = BenchLowerBound(&vector, low->key); pos < vector.size;
+         ++pos) {
+      const BenchRecord* const record =
+          (const BenchRecord*)VectorGet(&vector, pos);
+      if (record->key >= high) break;
+      range_sum += record->value;
+    }
+  }
+  BenchReport("Vector", "range-100", BENCH_RANGE_QUERIES, BenchNow() - start);
+
+  if (found != count) {
+    fprintf(stderr, "Vector: found %zu of %zu\n", found, count);
+  }
+  VectorFree(&vector);
+}
+
+static void BenchBTreeMap(const BenchRecord* const records,
+                          const uint64_t* const keys,
+                          const uint64_t* const values,
+                          const size_t* const order, const size_t count,
+                          const size_t node_size) {
+  char name[0x20];
+  snprintf(name, sizeof(name), "BTree-%zu", node_size);
+  BTreeMapConfig config;
+  BTreeMapConfigInit(&config, sizeof(uint64_t), sizeof(uint64_t),
+                     BenchCompare);
+  config.node_size = node_size;
+
+  BTreeMap map;
+  BTreeMapInitWithConfig(&map, &config);
+  double start = BenchNow();
+  BTreeMapBulkLoad(&map, keys, values, count);
+  BenchReport(name, "bulk-load", count, BenchNow() - start);
+
+  size_t found = 0;
+  start = BenchNow();
+  for (size_t i = 0; i < count; ++i) {
+    found += BTreeMapGet(&map, &records[order[i]].key) != NULL;
+  }
+  BenchReport(name, "get-hit", count, BenchNow() - start);
+
+  range_sum = 0;
+  start = BenchNow();
+  for (size_t q = 0; q < BENCH_RANGE_QUERIES; ++q) {
+    const BenchRecord* const low = &records[order[q % count]];
+    const uint64_t high = low->key + BENCH_RANGE * 3;
+    BTreeMapRange(&map, &low->key, &high, BenchSumValue);
+  }
+  BenchReport(name, "range-100", BENCH_RANGE_QUERIES, BenchNow() - start);
+  BTreeMapFree(&map);
+
+  BTreeMapInitWithConfig(&map, &config);
+  start = BenchNow();
+  for (size_t i = 0; i < count; ++i) {
+    BTreeMapInsert(&map, &records[order[i]].key, &records[order[i]].value);
+  }
+  BenchReport(name, "insert", count, BenchNow() - start);
+  found += BTreeMapSize(&map);
+
+  if (found != count << 0x01) {
+    fprintf(stderr, "%s: found %zu of %zu\n", name, found, count << 0x01);
+  }
+  BTreeMapFree(&map);
+}
+
+int main(int argc, char** argv) {
+  size_t* counts;
+  const size_t ncounts =
+      BenchParseCounts(argc, argv, kDefaultCounts,
+                       sizeof(kDefaultCounts) / sizeof(kDefaultCounts[0]),
+                       &counts);
+
+  for (size_t c = 0; c < ncounts; ++c) {
+    const size_t count = counts[c];
+    BenchRecord* records = (BenchRecord*)malloc(count * sizeof(BenchRecord));
+    uint64_t* keys = (uint64_t*)malloc(count * sizeof(uint64_t));
+    uint64_t* values = (uint64_t*)malloc(count * sizeof(uint64_t));
+    for (size_t i = 0; i < count; ++i) {
+      records[i].key = keys[i] = (uint64_t)i * 3;
+      records[i].value = values[i] = i;
+    }
+    size_t* order = (size_t*)malloc(count * sizeof(size_t));
+    BenchShuffle(order, count);
+
+    BenchVector(records, order, count);
+    for (size_t s = 0; s < sizeof(kNodeSizes) / sizeof(kNodeSizes[0]); ++s)
+      BenchBTreeMap(records, keys, values, order, count, kNodeSizes[s]);
+
+    free(order);
+    free(values);
+    free(keys);
+    free(records);
+  }
+  free(counts);
+  return EXIT_SUCCESS;
+}
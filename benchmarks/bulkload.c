@@ -0,0 +1,112 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Measures bulk loading a `Map` with a loop of `MapInsertN` calls against a
+// single `MapInsertMany` call, with and without `use_slab`.
+//
+// Usage:
+//    bench_bulkload [count...]
+//
+// Without arguments the benchmark loads 100K, 1M and 10M keys into a map
+// created with `MAP_MIN_CAPACITY` buckets.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "bool.h"
+#include "map/hash.h"
+#include "map/map.h"
+#include "map/ops.h"
+
+static const size_t kDefaultCounts[] = {100000, 1000000, 10000000};
+
+static void BenchLoad(const char* const name, const bool_t use_slab,
+                      const bool_t bulk, const void** keys,
+                      const size_t* key_sizes, const size_t count) {
+  MapConfig config;
+  MapConfigInit(&config, MAP_MIN_CAPACITY, NULL, NULL);
+  config.hash_seeded_func = HashBytes;
+  config.key_eq_n_func = KeyCmpN;
+  config.use_slab = use_slab;
+  Map map;
+  MapInitWithConfig(&map, &config);
+
+  const double start = BenchNow();
+  if (bulk == TRUE) {
+    MapInsertMany(&map, keys, key_sizes, keys, key_sizes, count);
+  } else {
+    for (size_t i = 0; i < count; ++i) {
+      MapInsertN(&map, keys[i], key_sizes[i], keys[i], key_sizes[i]);
+    }
+  }
+  const double elapsed = BenchNow() - start;
+  BenchReport(name, bulk == TRUE ? "insert-many" : "insert-loop", count,
+              elapsed);
+  printf("%-12s %-12s %12zu %10.2f ms total\n", name, "", count,
+         elapsed / 1e6);
+
+  if (map.size != count) {
+    fprintf(stderr, "bench_bulkload: loaded %zu of %zu keys\n", map.size,
+            count);
+    exit(EXIT_FAILURE);
+  }
+  MapFree(&map);
+}
+
+int main(int argc, char** argv) {
+  size_t* counts;
+  const size_t ncounts =
+      BenchParseCounts(argc, argv, kDefaultCounts,
+                       sizeof(kDefaultCounts) / sizeof(kDefaultCounts[0]),
+                       &counts);
+
+  for (size_t c = 0; c < ncounts; ++c) {
+    const size_t count = counts[c];
+    char* buffer = BenchMakeKeys(count, "key");
+    const void** keys = (const void**)malloc(count * sizeof(void*));
+    size_t* key_sizes = (size_t*)malloc(count * sizeof(size_t));
+    for (size_t i = 0; i < count; ++i) {
+      keys[i] = BENCH_KEY(buffer, i);
+      key_sizes[i] = strlen(BENCH_KEY(buffer, i));
+    }
+
+    BenchLoad("malloc", FALSE, FALSE, keys, key_sizes, count);
+    BenchLoad("malloc", FALSE, TRUE, keys, key_sizes, count);
+    BenchLoad("slab", TRUE, FALSE, keys, key_sizes, count);
+    BenchLoad("slab", TRUE, TRUE, keys, key_sizes, count);
+
+    free(key_sizes);
+    free(keys);
+    free(buffer);
+  }
+  free(counts);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,146 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Measures how `MapGet` scales with the number of threads on a read-heavy
+// workload, against the same map behind one global mutex, which is what
+// callers had to do before lookups took the read lock.
+//
+// Usage:
+//    bench_concurrent [threads...]
+//
+// Without arguments the benchmark runs with 1, 2, 4, 8, 16, 32 and 64 threads.
+// Every thread performs `BENCH_OPS_PER_THREAD` operations on a map holding
+// `BENCH_MAP_KEYS` keys; one operation in `BENCH_WRITE_EVERY` overwrites a
+// value, the others are lookups.
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "bool.h"
+#include "map/hash.h"
+#include "map/map.h"
+#include "map/ops.h"
+
+#define BENCH_MAP_KEYS 0x100000
+#define BENCH_OPS_PER_THREAD 0x100000
+#define BENCH_WRITE_EVERY 0x64
+
+static const size_t kDefaultThreads[] = {1, 2, 4, 8, 16, 32, 64};
+
+typedef struct BenchThread {
+  Map* map;
+  pthread_mutex_t* global;
+  const char* keys;
+  size_t seed;
+  size_t hits;
+} BenchThread;
+
+static void* BenchWorker(void* arg) {
+  BenchThread* const thread = (BenchThread*)arg;
+  unsigned long long state = 0x9E3779B97F4A7C15ULL ^ thread->seed;
+  size_t hits = 0;
+  for (size_t i = 0; i < BENCH_OPS_PER_THREAD; ++i) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    const char* key = BENCH_KEY(thread->keys, state % BENCH_MAP_KEYS);
+    const size_t key_size = strlen(key);
+
+    if (thread->global != NULL) pthread_mutex_lock(thread->global);
+    if (i % BENCH_WRITE_EVERY == 0) {
+      MapInsertN(thread->map, key, key_size, &i, sizeof(i));
+    } else {
+      hits += MapGetN(thread->map, key, key_size) != NULL;
+    }
+    if (thread->global != NULL) pthread_mutex_unlock(thread->global);
+  }
+  thread->hits = hits;
+  return NULL;
+}
+
+static void BenchRun(const char* name, Map* const map,
+                     pthread_mutex_t* const global, const char* keys,
+                     const size_t nthreads) {
+  pthread_t* threads = (pthread_t*)malloc(nthreads * sizeof(pthread_t));
+  BenchThread* args = (BenchThread*)malloc(nthreads * sizeof(BenchThread));
+
+  const double start = BenchNow();
+  for (size_t t = 0; t < nthreads; ++t) {
+    args[t].map = map;
+    args[t].global = global;
+    args[t].keys = keys;
+    args[t].seed = t + 1;
+    args[t].hits = 0;
+    pthread_create(&threads[t], NULL, BenchWorker, &args[t]);
+  }
+  size_t hits = 0;
+  for (size_t t = 0; t < nthreads; ++t) {
+    pthread_join(threads[t], NULL);
+    hits += args[t].hits;
+  }
+  const double elapsed = BenchNow() - start;
+
+  const double ops = (double)nthreads * BENCH_OPS_PER_THREAD;
+  printf("%-14s %8zu %12.2f Mops/s %12zu hits\n", name, nthreads,
+         ops / elapsed * 1e3, hits);
+  free(threads);
+  free(args);
+}
+
+int main(int argc, char** argv) {
+  size_t* threads;
+  const size_t nthreads =
+      BenchParseCounts(argc, argv, kDefaultThreads,
+                       sizeof(kDefaultThreads) / sizeof(kDefaultThreads[0]),
+                       &threads);
+
+  char* keys = BenchMakeKeys(BENCH_MAP_KEYS, "key");
+  Map map;
+  MapInitSeeded(&map, BENCH_MAP_KEYS, HashBytes, KeyCmpN);
+  for (size_t i = 0; i < BENCH_MAP_KEYS; ++i) {
+    const char* key = BENCH_KEY(keys, i);
+    MapInsertN(&map, key, strlen(key), &i, sizeof(i));
+  }
+
+  pthread_mutex_t global;
+  pthread_mutex_init(&global, NULL);
+  for (size_t t = 0; t < nthreads; ++t) {
+    BenchRun("global-mutex", &map, &global, keys, threads[t]);
+    BenchRun("rwlock", &map, NULL, keys, threads[t]);
+  }
+  pthread_mutex_destroy(&global);
+
+  MapFree(&map);
+  free(keys);
+  free(threads);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,128 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Compares expiring entries with an `ExpiringMap` against the periodic full
+// `MapTraverse()` sweep callers used on a plain `Map`.  Every entry gets a
+// deadline spread over `BENCH_HORIZON` ticks; the wheel is advanced on every
+// tick while the sweep runs every `BENCH_SWEEP_EVERY` ticks.
+//
+// Usage:
+//    bench_expiringmap [count...]
+//
+// Without arguments the benchmark runs with 1K, 100K and 1M entries.
+
+#include "expiringmap/expiringmap.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "bool.h"
+#include "map/map.h"
+
+#define BENCH_HORIZON 0x4000
+#define BENCH_SWEEP_EVERY 0x40
+
+static const size_t kDefaultCounts[] = {1000, 100000, 1000000};
+
+// Returns the deadline of entry `i`, spread over the horizon.
+static uint64_t BenchDeadline(const size_t i) {
+  return 1 + (uint64_t)(MapMixHash((hash_t)i) % BENCH_HORIZON);
+}
+
+static uint64_t sweep_now;
+static size_t sweep_expired;
+
+static bool_t SweepEntry(const void* key, const void* value) {
+  (void)key;
+  sweep_expired += *(const uint64_t*)value <= sweep_now;
+  return TRUE;
+}
+
+static void BenchMapSweep(const char* const keys, const size_t count) {
+  Map map;
+  MapInit(&map, count < MAP_MIN_CAPACITY ? MAP_MIN_CAPACITY : count, Hash,
+          KeyCmp);
+  for (size_t i = 0; i < count; ++i) {
+    const uint64_t deadline = BenchDeadline(i);
+    MapInsert(&map, BENCH_KEY(keys, i), BENCH_KEY_WIDTH, &deadline,
+              sizeof(deadline));
+  }
+
+  // Only the scans are timed; removing what they find would come on top.
+  const double start = BenchNow();
+  for (sweep_now = BENCH_SWEEP_EVERY; sweep_now <= BENCH_HORIZON;
+       sweep_now += BENCH_SWEEP_EVERY) {
+    MapTraverse(&map, SweepEntry);
+  }
+  BenchReport("Map", "sweep", count, BenchNow() - start);
+  MapFree(&map);
+}
+
+static void BenchExpiringMap(const char* const keys, const size_t count) {
+  ExpiringMap map;
+  ExpiringMapInit(&map, 0, Hash, KeyCmp);
+  double start = BenchNow();
+  for (size_t i = 0; i < count; ++i) {
+    ExpiringMapPut(&map, BENCH_KEY(keys, i), BENCH_KEY_WIDTH, &i, sizeof(i),
+                   BenchDeadline(i));
+  }
+  BenchReport("ExpiringMap", "put", count, BenchNow() - start);
+
+  size_t expired = 0;
+  start = BenchNow();
+  for (uint64_t now = 1; now <= BENCH_HORIZON; ++now) {
+    expired += ExpiringMapAdvance(&map, now);
+  }
+  BenchReport("ExpiringMap", "advance", count, BenchNow() - start);
+
+  if (expired != count) {
+    fprintf(stderr, "ExpiringMap: expired %zu of %zu\n", expired, count);
+  }
+  ExpiringMapFree(&map);
+}
+
+int main(int argc, char** argv) {
+  size_t* counts;
+  const size_t ncounts =
+      BenchParseCounts(argc, argv, kDefaultCounts,
+                       sizeof(kDefaultCounts) / sizeof(kDefaultCounts[0]),
+                       &counts);
+
+  for (size_t c = 0; c < ncounts; ++c) {
+    const size_t count = counts[c];
+    char* keys = BenchMakeKeys(count, "key");
+    BenchMapSweep(keys, count);
+    BenchExpiringMap(keys, count);
+    free(keys);
+  }
+  free(counts);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,123 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Measures `MapGetMany` against a loop of `MapGetN` calls on tables from
+// cache-resident to far larger than the last level cache, where every lookup
+// misses on its bucket and again on its entry.
+//
+// Usage:
+//    bench_getmany [count...]
+//
+// Without arguments the benchmark uses tables of 10K, 1M and 4M keys.  The
+// keys are looked up in a shuffled order, `BENCH_BATCH` keys per call, half of
+// them hits and half of them misses.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "bool.h"
+#include "map/hash.h"
+#include "map/map.h"
+#include "map/ops.h"
+
+#define BENCH_BATCH 0x100
+
+static const size_t kDefaultCounts[] = {10000, 1000000, 4000000};
+
+int main(int argc, char** argv) {
+  size_t* counts;
+  const size_t ncounts =
+      BenchParseCounts(argc, argv, kDefaultCounts,
+                       sizeof(kDefaultCounts) / sizeof(kDefaultCounts[0]),
+                       &counts);
+
+  for (size_t c = 0; c < ncounts; ++c) {
+    const size_t count = counts[c];
+    char* keys = BenchMakeKeys(count, "key");
+    char* misses = BenchMakeKeys(count, "miss");
+    Map map;
+    MapInitSeeded(&map, count, HashBytes, KeyCmpN);
+    for (size_t i = 0; i < count; ++i) {
+      const char* key = BENCH_KEY(keys, i);
+      MapInsertN(&map, key, strlen(key), &i, sizeof(i));
+    }
+
+    size_t* order = (size_t*)malloc(count * sizeof(size_t));
+    const void** lookups = (const void**)malloc(count * sizeof(void*));
+    size_t* sizes = (size_t*)malloc(count * sizeof(size_t));
+    void** values = (void**)malloc(count * sizeof(void*));
+    BenchShuffle(order, count);
+    for (size_t i = 0; i < count; ++i) {
+      lookups[i] = i % 2 == 0 ? BENCH_KEY(keys, order[i])
+                              : BENCH_KEY(misses, order[i]);
+      sizes[i] = strlen((const char*)lookups[i]);
+    }
+
+    size_t hits = 0;
+    double start = BenchNow();
+    for (size_t i = 0; i < count; ++i) {
+      values[i] = MapGetN(&map, lookups[i], sizes[i]);
+      hits += values[i] != NULL;
+    }
+    BenchReport("map", "get-loop", count, BenchNow() - start);
+
+    start = BenchNow();
+    for (size_t i = 0; i < count; i += BENCH_BATCH) {
+      const size_t n = count - i < BENCH_BATCH ? count - i : BENCH_BATCH;
+      MapGetMany(&map, lookups + i, sizes + i, n, values + i);
+    }
+    BenchReport("map", "get-many", count, BenchNow() - start);
+    for (size_t i = 0; i < count; ++i) hits -= values[i] != NULL;
+
+    start = BenchNow();
+    size_t found = 0;
+    for (size_t i = 0; i < count; i += BENCH_BATCH) {
+      const size_t n = count - i < BENCH_BATCH ? count - i : BENCH_BATCH;
+      found += MapContainsMany(&map, lookups + i, sizes + i, n, NULL);
+    }
+    BenchReport("map", "contains", count, BenchNow() - start);
+
+    if (hits != 0 || found != (count + 1) / 2) {
+      fprintf(stderr, "bench_getmany: batched lookups disagree with MapGetN\n");
+      return EXIT_FAILURE;
+    }
+
+    free(values);
+    free(sizes);
+    free(lookups);
+    free(order);
+    MapFree(&map);
+    free(misses);
+    free(keys);
+  }
+  free(counts);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,299 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Compares the built-in djb2 `Hash` and `HashN` against the seeded
+// `HashBytes`: raw throughput per key length, and the chain lengths every hash
+// produces on a set of key corpora hashed into a `Map` sized bucket array.
+//
+// Usage:
+//    bench_hash [corpus-file...]
+//
+// Every corpus file holds one key per line.  Without arguments the benchmark
+// uses generated corpora: sequential strings, random 16 byte UUIDs, URL paths
+// and keys built to collide under djb2.
+
+#include "map/hash.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "map/map.h"
+
+// Number of keys of every generated corpus.
+#define BENCH_CORPUS_SIZE 0x40000
+
+// Number of bytes hashed per key length in the throughput run.
+#define BENCH_HASH_BYTES 0x10000000
+
+// Chains of at least this length share the last histogram column.
+#define BENCH_CHAIN_COLUMNS 0x08
+
+static const size_t kKeyLengths[] = {8, 16, 32, 64, 256, 1024, 4096};
+
+// A set of keys laid out back to back, each followed by a `NULL` terminator so
+// that `Hash` can be used on them as well.
+typedef struct BenchCorpus {
+  const char* name;
+  char* data;
+  size_t* offsets;
+  size_t* lengths;
+  size_t count;
+  size_t used;
+  size_t reserved;
+} BenchCorpus;
+
+static void BenchCorpusInit(BenchCorpus* const corpus, const char* name,
+                            const size_t count) {
+  corpus->name = name;
+  corpus->count = 0;
+  corpus->used = 0;
+  corpus->reserved = count * 0x20;
+  corpus->data = (char*)malloc(corpus->reserved);
+  corpus->offsets = (size_t*)malloc(count * sizeof(size_t));
+  corpus->lengths = (size_t*)malloc(count * sizeof(size_t));
+  if (corpus->data == NULL || corpus->offsets == NULL ||
+      corpus->lengths == NULL) {
+    fprintf(stderr, "BenchCorpusInit: failed to allocate %zu keys\n", count);
+    exit(EXIT_FAILURE);
+  }
+}
+
+static void BenchCorpusAdd(BenchCorpus* const corpus, const void* key,
+                           const size_t key_size) {
+  if (corpus->used + key_size + 1 > corpus->reserved) {
+    corpus->reserved = (corpus->used + key_size + 1) * 2;
+    if ((corpus->data = (char*)realloc(corpus->data, corpus->reserved)) ==
+        NULL) {
+      fprintf(stderr, "BenchCorpusAdd: failed to grow corpus %s\n",
+              corpus->name);
+      exit(EXIT_FAILURE);
+    }
+  }
+  memcpy(corpus->data + corpus->used, key, key_size);
+  corpus->data[corpus->used + key_size] = '\0';
+  corpus->offsets[corpus->count] = corpus->used;
+  corpus->lengths[corpus->count] = key_size;
+  corpus->used += key_size + 1;
+  ++(corpus->count);
+}
+
+static void BenchCorpusFree(BenchCorpus* const corpus) {
+  free(corpus->data);
+  free(corpus->offsets);
+  free(corpus->lengths);
+}
+
+static unsigned long long BenchRandom(unsigned long long* const state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+static void BenchMakeSequential(BenchCorpus* const corpus) {
+  BenchCorpusInit(corpus, "sequential", BENCH_CORPUS_SIZE);
+  char key[0x20];
+  for (size_t i = 0; i < BENCH_CORPUS_SIZE; ++i) {
+    BenchCorpusAdd(corpus, key,
+                   (size_t)snprintf(key, sizeof(key), "key-%zu", i));
+  }
+}
+
+static void BenchMakeUuids(BenchCorpus* const corpus) {
+  BenchCorpusInit(corpus, "uuid", BENCH_CORPUS_SIZE);
+  unsigned long long state = 0x9E3779B97F4A7C15ULL;
+  for (size_t i = 0; i < BENCH_CORPUS_SIZE; ++i) {
+    unsigned long long uuid[2] = {BenchRandom(&state), BenchRandom(&state)};
+    BenchCorpusAdd(corpus, uuid, sizeof(uuid));
+  }
+}
+
+static void BenchMakePaths(BenchCorpus* const corpus) {
+  BenchCorpusInit(corpus, "path", BENCH_CORPUS_SIZE);
+  char key[0x80];
+  for (size_t i = 0; i < BENCH_CORPUS_SIZE; ++i) {
+    BenchCorpusAdd(corpus, key,
+                   (size_t)snprintf(key, sizeof(key),
+                                    "/api/v2/tenants/%zu/users/%zu/orders",
+                                    i % 0x40, i / 0x40));
+  }
+}
+
+// Every key is a sequence of "az" and "bY" blocks, which djb2 can not tell
+// apart.
+static void BenchMakeDjbCollisions(BenchCorpus* const corpus) {
+  BenchCorpusInit(corpus, "djb2-attack", BENCH_CORPUS_SIZE);
+  char key[0x40];
+  size_t bits = 0;
+  while (((size_t)1 << bits) < BENCH_CORPUS_SIZE) ++bits;
+  for (size_t i = 0; i < BENCH_CORPUS_SIZE; ++i) {
+    for (size_t bit = 0; bit < bits; ++bit) {
+      memcpy(key + 2 * bit, (i >> bit) & 1 ? "bY" : "az", 2);
+    }
+    BenchCorpusAdd(corpus, key, 2 * bits);
+  }
+}
+
+static void BenchLoadCorpus(BenchCorpus* const corpus, const char* path) {
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    fprintf(stderr, "BenchLoadCorpus: failed to open %s\n", path);
+    exit(EXIT_FAILURE);
+  }
+  size_t lines = 0;
+  for (int c; (c = fgetc(file)) != EOF;) lines += c == '\n';
+  rewind(file);
+
+  BenchCorpusInit(corpus, path, lines + 1);
+  char* line = NULL;
+  size_t line_size = 0;
+  ssize_t read;
+  while ((read = getline(&line, &line_size, file)) != -1) {
+    if (read > 0 && line[read - 1] == '\n') --read;
+    BenchCorpusAdd(corpus, line, (size_t)read);
+  }
+  free(line);
+  fclose(file);
+}
+
+// Keeps the optimizer from discarding the hashes.
+static volatile hash_t kBenchSink;
+
+static void BenchThroughput(void) {
+  printf("%-12s %8s %12s %12s\n", "hash", "length", "ns/hash", "GB/s");
+  const hash_t seed = HashRandomSeed();
+  for (size_t l = 0; l < sizeof(kKeyLengths) / sizeof(kKeyLengths[0]); ++l) {
+    const size_t length = kKeyLengths[l];
+    const size_t rounds = BENCH_HASH_BYTES / length;
+    char* key = (char*)malloc(length + 1);
+    for (size_t i = 0; i < length; ++i) key[i] = (char)('a' + i % 26);
+    key[length] = '\0';
+
+    hash_t sink = 0;
+    double start = BenchNow();
+    for (size_t i = 0; i < rounds; ++i) {
+      key[0] = (char)('a' + (i & 0x0F));
+      sink ^= Hash(key);
+    }
+    double elapsed = BenchNow() - start;
+    printf("%-12s %8zu %12.2f %12.2f\n", "Hash", length, elapsed / rounds,
+           (double)BENCH_HASH_BYTES / elapsed);
+
+    start = BenchNow();
+    for (size_t i = 0; i < rounds; ++i) {
+      key[0] = (char)('a' + (i & 0x0F));
+      sink ^= HashN(key, length);
+    }
+    elapsed = BenchNow() - start;
+    printf("%-12s %8zu %12.2f %12.2f\n", "HashN", length, elapsed / rounds,
+           (double)BENCH_HASH_BYTES / elapsed);
+
+    start = BenchNow();
+    for (size_t i = 0; i < rounds; ++i) {
+      key[0] = (char)('a' + (i & 0x0F));
+      sink ^= HashBytes(key, length, seed);
+    }
+    elapsed = BenchNow() - start;
+    printf("%-12s %8zu %12.2f %12.2f\n", "HashBytes", length, elapsed / rounds,
+           (double)BENCH_HASH_BYTES / elapsed);
+
+    kBenchSink = sink;
+    free(key);
+  }
+}
+
+// Hashes every key of `corpus` into a bucket array sized the way a `Map` with
+// the default load factor would be and prints the chain length histogram, the
+// longest chain and the average number of entries visited by a hit.
+static void BenchChains(const char* hash_name, const BenchCorpus* const corpus,
+                        const bool_t seeded) {
+  size_t capacity = MAP_MIN_CAPACITY;
+  while (capacity < corpus->count) capacity <<= 1;
+  size_t* chains = (size_t*)calloc(capacity, sizeof(size_t));
+  if (chains == NULL) {
+    fprintf(stderr, "BenchChains: failed to allocate %zu buckets\n", capacity);
+    exit(EXIT_FAILURE);
+  }
+
+  const hash_t seed = HashRandomSeed();
+  for (size_t i = 0; i < corpus->count; ++i) {
+    const char* key = corpus->data + corpus->offsets[i];
+    const hash_t hash = seeded == TRUE
+                            ? HashBytes(key, corpus->lengths[i], seed)
+                            : Hash(key);
+    ++chains[_MAP_BUCKET_INDEX(hash, capacity)];
+  }
+
+  size_t histogram[BENCH_CHAIN_COLUMNS] = {0};
+  size_t longest = 0;
+  double visited = 0;
+  for (size_t i = 0; i < capacity; ++i) {
+    const size_t length = chains[i];
+    ++histogram[length < BENCH_CHAIN_COLUMNS ? length
+                                             : BENCH_CHAIN_COLUMNS - 1];
+    if (length > longest) longest = length;
+    visited += (double)length * (double)(length + 1) / 2;
+  }
+
+  printf("%-12s %-12s %8zu %8zu %8.2f ", corpus->name, hash_name, corpus->count,
+         longest, visited / (double)corpus->count);
+  for (size_t i = 0; i < BENCH_CHAIN_COLUMNS; ++i) {
+    printf(" %6.2f%%", 100.0 * (double)histogram[i] / (double)capacity);
+  }
+  printf("\n");
+  free(chains);
+}
+
+int main(int argc, char** argv) {
+  BenchThroughput();
+
+  const size_t ncorpora = argc > 1 ? (size_t)(argc - 1) : 4;
+  BenchCorpus* corpora = (BenchCorpus*)malloc(ncorpora * sizeof(BenchCorpus));
+  if (argc > 1) {
+    for (int i = 1; i < argc; ++i) BenchLoadCorpus(&corpora[i - 1], argv[i]);
+  } else {
+    BenchMakeSequential(&corpora[0]);
+    BenchMakeUuids(&corpora[1]);
+    BenchMakePaths(&corpora[2]);
+    BenchMakeDjbCollisions(&corpora[3]);
+  }
+
+  printf("\n%-12s %-12s %8s %8s %8s  buckets holding 0..%d+ entries\n",
+         "corpus", "hash", "keys", "longest", "visited",
+         BENCH_CHAIN_COLUMNS - 1);
+  for (size_t i = 0; i < ncorpora; ++i) {
+    BenchChains("Hash", &corpora[i], FALSE);
+    BenchChains("HashBytes", &corpora[i], TRUE);
+    BenchCorpusFree(&corpora[i]);
+  }
+  free(corpora);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,139 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Compares a `Map` used as a set, with a dummy one byte value per key, against
+// `HashSet`, and measures the set algebra of `HashSet`.
+//
+// Usage:
+//    bench_hashset [count...]
+//
+// Without arguments the benchmark runs with 1K, 1M and 4M keys.
+
+#include "hashset/hashset.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "map/map.h"
+
+static const size_t kDefaultCounts[] = {1000, 1000000, 4000000};
+
+static void BenchMapAsSet(const char* const keys, const size_t* const order,
+                          const size_t count) {
+  Map map;
+  MapInit(&map, MAP_MIN_CAPACITY, Hash, KeyCmp);
+
+  const char dummy = 0;
+  double start = BenchNow();
+  for (size_t i = 0; i < count; ++i) {
+    MapInsert(&map, BENCH_KEY(keys, i), BENCH_KEY_WIDTH, &dummy, 1);
+  }
+  BenchReport("Map", "add", count, BenchNow() - start);
+
+  size_t found = 0;
+  start = BenchNow();
+  for (size_t i = 0; i < count; ++i) {
+    found += MapGet(&map, BENCH_KEY(keys, order[i])) != NULL;
+  }
+  BenchReport("Map", "contains", count, BenchNow() - start);
+
+  if (found != count) fprintf(stderr, "Map: found %zu of %zu\n", found, count);
+  MapFree(&map);
+}
+
+static void BenchHashSet(const char* const keys, const size_t* const order,
+                         const size_t count) {
+  HashSet set;
+  HashSetInit(&set, MAP_MIN_CAPACITY, Hash, KeyCmp);
+
+  double start = BenchNow();
+  for (size_t i = 0; i < count; ++i) {
+    HashSetAdd(&set, BENCH_KEY(keys, i), BENCH_KEY_WIDTH);
+  }
+  BenchReport("HashSet", "add", count, BenchNow() - start);
+
+  size_t found = 0;
+  start = BenchNow();
+  for (size_t i = 0; i < count; ++i) {
+    found +=
+        HashSetContains(&set, BENCH_KEY(keys, order[i]), BENCH_KEY_WIDTH) ==
+        TRUE;
+  }
+  BenchReport("HashSet", "contains", count, BenchNow() - start);
+
+  // A set holding every 16th key: the intersection walks it, not `set`.
+  HashSet sparse;
+  HashSetInit(&sparse, MAP_MIN_CAPACITY, Hash, KeyCmp);
+  for (size_t i = 0; i < count; i += 0x10) {
+    HashSetAdd(&sparse, BENCH_KEY(keys, i), BENCH_KEY_WIDTH);
+  }
+
+  HashSet result;
+  HashSetInit(&result, MAP_MIN_CAPACITY, Hash, KeyCmp);
+  start = BenchNow();
+  HashSetIntersection(&result, &set, &sparse);
+  BenchReport("HashSet", "intersect", count, BenchNow() - start);
+  HashSetFree(&result);
+
+  HashSetInit(&result, MAP_MIN_CAPACITY, Hash, KeyCmp);
+  start = BenchNow();
+  HashSetUnion(&result, &set, &sparse);
+  BenchReport("HashSet", "union", count, BenchNow() - start);
+  HashSetFree(&result);
+
+  if (found != count) {
+    fprintf(stderr, "HashSet: found %zu of %zu\n", found, count);
+  }
+  HashSetFree(&sparse);
+  HashSetFree(&set);
+}
+
+int main(int argc, char** argv) {
+  size_t* counts;
+  const size_t ncounts =
+      BenchParseCounts(argc, argv, kDefaultCounts,
+                       sizeof(kDefaultCounts) / sizeof(kDefaultCounts[0]),
+                       &counts);
+
+  for (size_t c = 0; c < ncounts; ++c) {
+    const size_t count = counts[c];
+    char* keys = BenchMakeKeys(count, "key");
+    size_t* order = (size_t*)malloc(count * sizeof(size_t));
+    BenchShuffle(order, count);
+
+    BenchMapAsSet(keys, order, count);
+    BenchHashSet(keys, order, count);
+
+    free(order);
+    free(keys);
+  }
+  free(counts);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,163 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Compares a `Map` keyed by 8 byte integers hashed with the seeded `HashBytes`
+// against the `IntMap` specialization, including the batched
+// `IntMapGetMany()`.  The djb2 `HashN` is not used for the baseline: it sums
+// the bytes of small integers into colliding hashes, so the `Map` numbers
+// would measure chain lengths rather than the layout.
+//
+// Usage:
+//    bench_intmap [count...]
+//
+// Without arguments the benchmark runs with 1K, 1M and 10M keys.
+
+#include "intmap/intmap.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "map/hash.h"
+#include "map/map.h"
+
+static const size_t kDefaultCounts[] = {1000, 1000000, 10000000};
+
+static void BenchMap(const uint64_t* const keys, const size_t* const order,
+                     const size_t count) {
+  size_t capacity = count < MAP_MIN_CAPACITY ? MAP_MIN_CAPACITY : count;
+  if (capacity > MAP_MAX_CAPACITY) capacity = MAP_MAX_CAPACITY;
+  MapConfig config;
+  MapConfigInit(&config, capacity, NULL, NULL);
+  config.hash_seeded_func = HashBytes;
+  config.key_eq_n_func = KeyCmpN;
+  Map map;
+  MapInitWithConfig(&map, &config);
+
+  double start = BenchNow();
+  for (size_t i = 0; i < count; ++i) {
+    MapInsertN(&map, &keys[i], sizeof(uint64_t), &i, sizeof(i));
+  }
+  BenchReport("Map", "insert", count, BenchNow() - start);
+
+  size_t found = 0;
+  start = BenchNow();
+  for (size_t i = 0; i < count; ++i) {
+    found += MapGetN(&map, &keys[order[i]], sizeof(uint64_t)) != NULL;
+  }
+  BenchReport("Map", "get-hit", count, BenchNow() - start);
+
+  start = BenchNow();
+  for (size_t i = 0; i < count; ++i) {
+    const uint64_t miss = keys[order[i]] + 1;
+    found += MapGetN(&map, &miss, sizeof(uint64_t)) != NULL;
+  }
+  BenchReport("Map", "get-miss", count, BenchNow() - start);
+
+  start = BenchNow();
+  for (size_t i = 0; i < count; ++i) {
+    MapRemoveN(&map, &keys[order[i]], sizeof(uint64_t));
+  }
+  BenchReport("Map", "remove", count, BenchNow() - start);
+
+  if (found != count) fprintf(stderr, "Map: found %zu of %zu\n", found, count);
+  MapFree(&map);
+}
+
+static void BenchIntMap(const uint64_t* const keys, const size_t* const order,
+                        const size_t count) {
+  IntMap map;
+  IntMapInit(&map, 0);
+
+  double start = BenchNow();
+  for (size_t i = 0; i < count; ++i) IntMapInsert(&map, keys[i], i);
+  BenchReport("IntMap", "insert", count, BenchNow() - start);
+
+  uint64_t* const shuffled = (uint64_t*)malloc(count * sizeof(uint64_t));
+  uint64_t* const values = (uint64_t*)malloc(count * sizeof(uint64_t));
+  for (size_t i = 0; i < count; ++i) shuffled[i] = keys[order[i]];
+
+  size_t found = 0;
+  start = BenchNow();
+  for (size_t i = 0; i < count; ++i) {
+    found += IntMapGet(&map, shuffled[i], &values[i]) == TRUE;
+  }
+  BenchReport("IntMap", "get-hit", count, BenchNow() - start);
+
+  start = BenchNow();
+  found += IntMapGetMany(&map, shuffled, count, values, NULL);
+  BenchReport("IntMap", "get-many", count, BenchNow() - start);
+
+  start = BenchNow();
+  for (size_t i = 0; i < count; ++i) {
+    found += IntMapGet(&map, shuffled[i] + 1, NULL) == TRUE;
+  }
+  BenchReport("IntMap", "get-miss", count, BenchNow() - start);
+
+  start = BenchNow();
+  for (size_t i = 0; i < count; ++i) IntMapRemove(&map, shuffled[i]);
+  BenchReport("IntMap", "remove", count, BenchNow() - start);
+
+  start = BenchNow();
+  IntMapInsertMany(&map, keys, shuffled, count);
+  BenchReport("IntMap", "insert-many", count, BenchNow() - start);
+
+  if (found != count * 2) {
+    fprintf(stderr, "IntMap: found %zu of %zu\n", found, count * 2);
+  }
+  free(values);
+  free(shuffled);
+  IntMapFree(&map);
+}
+
+int main(int argc, char** argv) {
+  size_t* counts;
+  const size_t ncounts =
+      BenchParseCounts(argc, argv, kDefaultCounts,
+                       sizeof(kDefaultCounts) / sizeof(kDefaultCounts[0]),
+                       &counts);
+
+  for (size_t c = 0; c < ncounts; ++c) {
+    const size_t count = counts[c];
+    // Even keys so that `key + 1` is always a miss.
+    uint64_t* keys = (uint64_t*)malloc(count * sizeof(uint64_t));
+    for (size_t i = 0; i < count; ++i) keys[i] = (uint64_t)i << 1;
+    size_t* order = (size_t*)malloc(count * sizeof(size_t));
+    BenchShuffle(order, count);
+
+    BenchMap(keys, order, count);
+    BenchIntMap(keys, order, count);
+
+    free(order);
+    free(keys);
+  }
+  free(counts);
+  return EXIT_SUCCESS;
+}
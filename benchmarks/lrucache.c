@@ -0,0 +1,133 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Measures a read-through cache workload on an `LruCache` with the LRU and
+// the CLOCK policy as the number of threads grows.  Every operation looks a
+// key up and puts it on a miss; the keys are skewed so that a small set of
+// them is hot, like the lookups a cache usually sees.
+//
+// Usage:
+//    bench_lrucache [threads...]
+//
+// Without arguments the benchmark runs with 1, 2, 4, 8 and 16 threads.  Every
+// thread performs `BENCH_OPS_PER_THREAD` operations over `BENCH_KEYS` keys on
+// a cache holding `BENCH_CACHE_CAPACITY` of them.
+
+#include "lrucache/lrucache.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "bool.h"
+#include "map/map.h"
+
+#define BENCH_KEYS 0x40000
+#define BENCH_CACHE_CAPACITY 0x10000
+#define BENCH_OPS_PER_THREAD 0x100000
+
+static const size_t kDefaultThreads[] = {1, 2, 4, 8, 16};
+
+typedef struct BenchThread {
+  LruCache* cache;
+  const char* keys;
+  size_t seed;
+} BenchThread;
+
+static void* BenchWorker(void* arg) {
+  BenchThread* const thread = (BenchThread*)arg;
+  unsigned long long state = 0x9E3779B97F4A7C15ULL ^ thread->seed;
+  for (size_t i = 0; i < BENCH_OPS_PER_THREAD; ++i) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    // Squaring a uniform fraction skews the indices towards 0.
+    const double fraction = (double)(state >> 11) / (double)(1ULL << 53);
+    const size_t index = (size_t)(fraction * fraction * BENCH_KEYS);
+    const char* key = BENCH_KEY(thread->keys, index);
+
+    size_t value;
+    if (LruCacheGetCopy(thread->cache, key, BENCH_KEY_WIDTH, &value,
+                        sizeof(value), NULL) == FALSE) {
+      LruCachePut(thread->cache, key, BENCH_KEY_WIDTH, &index, sizeof(index));
+    }
+  }
+  return NULL;
+}
+
+static void BenchRun(const char* name, const LruCachePolicy policy,
+                     const char* keys, const size_t nthreads) {
+  LruCacheConfig config;
+  LruCacheConfigInit(&config, BENCH_CACHE_CAPACITY, Hash, KeyCmp);
+  config.policy = policy;
+  LruCache cache;
+  LruCacheInitWithConfig(&cache, &config);
+
+  pthread_t* threads = (pthread_t*)malloc(nthreads * sizeof(pthread_t));
+  BenchThread* args = (BenchThread*)malloc(nthreads * sizeof(BenchThread));
+  const double start = BenchNow();
+  for (size_t t = 0; t < nthreads; ++t) {
+    args[t].cache = &cache;
+    args[t].keys = keys;
+    args[t].seed = t + 1;
+    pthread_create(&threads[t], NULL, BenchWorker, &args[t]);
+  }
+  for (size_t t = 0; t < nthreads; ++t) pthread_join(threads[t], NULL);
+  const double elapsed = BenchNow() - start;
+
+  LruCacheStats stats;
+  LruCacheGetStats(&cache, &stats);
+  const double ops = (double)nthreads * BENCH_OPS_PER_THREAD;
+  printf("%-8s %8zu %12.2f Mops/s %10.2f%% hits %12zu evictions\n", name,
+         nthreads, ops / elapsed * 1e3,
+         100.0 * (double)stats.hits / (double)(stats.hits + stats.misses),
+         stats.evictions);
+  free(threads);
+  free(args);
+  LruCacheFree(&cache);
+}
+
+int main(int argc, char** argv) {
+  size_t* threads;
+  const size_t nthreads =
+      BenchParseCounts(argc, argv, kDefaultThreads,
+                       sizeof(kDefaultThreads) / sizeof(kDefaultThreads[0]),
+                       &threads);
+
+  char* keys = BenchMakeKeys(BENCH_KEYS, "key");
+  for (size_t t = 0; t < nthreads; ++t) {
+    BenchRun("lru", LRUCACHE_POLICY_LRU, keys, threads[t]);
+    BenchRun("clock", LRUCACHE_POLICY_CLOCK, keys, threads[t]);
+  }
+  free(keys);
+  free(threads);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,141 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Compares a warm start that rebuilds a `Map` by inserting every key against
+// one that maps a file written by `MapSave()`, and the lookups served by both.
+//
+// Usage:
+//    bench_mapped [count...]
+//
+// Without arguments the benchmark runs with 1K, 1M and 10M keys.  The file is
+// written to the directory named by `TMPDIR`, `/tmp` by default.
+
+#include "map/mapped.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "map/map.h"
+
+static const size_t kDefaultCounts[] = {1000, 1000000, 10000000};
+
+// Inserts the first `count` keys into `map`, each mapped to its index.
+static void FillMap(Map* const map, const char* const keys,
+                    const size_t count) {
+  size_t capacity = count < MAP_MIN_CAPACITY ? MAP_MIN_CAPACITY : count;
+  if (capacity > MAP_MAX_CAPACITY) capacity = MAP_MAX_CAPACITY;
+  MapInit(map, capacity, Hash, KeyCmp);
+  for (size_t i = 0; i < count; ++i) {
+    MapInsert(map, BENCH_KEY(keys, i), BENCH_KEY_WIDTH, &i, sizeof(i));
+  }
+}
+
+static void BenchMap(const char* const keys, const size_t* const order,
+                     const size_t count) {
+  Map map;
+  double start = BenchNow();
+  FillMap(&map, keys, count);
+  BenchReport("Map", "start", count, BenchNow() - start);
+
+  size_t found = 0;
+  start = BenchNow();
+  for (size_t i = 0; i < count; ++i) {
+    found += MapGet(&map, BENCH_KEY(keys, order[i])) != NULL;
+  }
+  BenchReport("Map", "get-hit", count, BenchNow() - start);
+
+  if (found != count) fprintf(stderr, "Map: found %zu of %zu\n", found, count);
+  MapFree(&map);
+}
+
+static void BenchMappedMap(const char* const keys, const char* const misses,
+                           const size_t* const order, const size_t count,
+                           const char* const path) {
+  Map map;
+  FillMap(&map, keys, count);
+  double start = BenchNow();
+  if (MapSave(&map, path) == FALSE) exit(EXIT_FAILURE);
+  BenchReport("MappedMap", "save", count, BenchNow() - start);
+  MapFree(&map);
+
+  MappedMap mapped;
+  start = BenchNow();
+  if (MapOpenMapped(&mapped, path, Hash, KeyCmp) == FALSE) exit(EXIT_FAILURE);
+  BenchReport("MappedMap", "start", count, BenchNow() - start);
+
+  size_t found = 0;
+  start = BenchNow();
+  for (size_t i = 0; i < count; ++i) {
+    found += MappedMapGet(&mapped, BENCH_KEY(keys, order[i])) != NULL;
+  }
+  BenchReport("MappedMap", "get-hit", count, BenchNow() - start);
+
+  start = BenchNow();
+  for (size_t i = 0; i < count; ++i) {
+    found += MappedMapGet(&mapped, BENCH_KEY(misses, order[i])) != NULL;
+  }
+  BenchReport("MappedMap", "get-miss", count, BenchNow() - start);
+
+  if (found != count) {
+    fprintf(stderr, "MappedMap: found %zu of %zu\n", found, count);
+  }
+  MappedMapClose(&mapped);
+  remove(path);
+}
+
+int main(int argc, char** argv) {
+  size_t* counts;
+  const size_t ncounts =
+      BenchParseCounts(argc, argv, kDefaultCounts,
+                       sizeof(kDefaultCounts) / sizeof(kDefaultCounts[0]),
+                       &counts);
+
+  const char* directory = getenv("TMPDIR");
+  char path[4096];
+  snprintf(path, sizeof(path), "%s/bench_mapped.map",
+           directory != NULL ? directory : "/tmp");
+
+  for (size_t c = 0; c < ncounts; ++c) {
+    const size_t count = counts[c];
+    char* keys = BenchMakeKeys(count, "key");
+    char* misses = BenchMakeKeys(count, "miss");
+    size_t* order = (size_t*)malloc(count * sizeof(size_t));
+    BenchShuffle(order, count);
+
+    BenchMap(keys, order, count);
+    BenchMappedMap(keys, misses, order, count, path);
+
+    free(order);
+    free(misses);
+    free(keys);
+  }
+  free(counts);
+  return EXIT_SUCCESS;
+}
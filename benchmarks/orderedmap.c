@@ -0,0 +1,181 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Compares the chained `Map` against the insertion-ordered `OrderedMap`:
+// inserts, lookups, full traversals and traversals of a table that lost most
+// of its keys, plus the bytes each map holds per entry.
+//
+// Usage:
+//    bench_orderedmap [count...]
+//
+// Without arguments the benchmark runs with 1K, 1M and 10M keys.
+
+#include "orderedmap/orderedmap.h"
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "bool.h"
+#include "map/map.h"
+
+static const size_t kDefaultCounts[] = {1000, 1000000, 10000000};
+
+static size_t visited;
+
+static bool_t CountVisit(const void* key, const void* value) {
+  (void)key;
+  (void)value;
+  ++visited;
+  return TRUE;
+}
+
+// Returns the bytes the allocator handed out, including its own headers.
+static size_t BenchHeapBytes(void) {
+  const struct mallinfo2 info = mallinfo2();
+  return info.uordblks + info.hblkhd;
+}
+
+// Prints the heap bytes a map holds per live entry.
+static void BenchReportBytes(const char* container, const size_t count,
+                             const size_t bytes) {
+  printf("%-12s %-12s %12zu %10.2f B/entry\n", container, "memory", count,
+         (double)bytes / (double)count);
+}
+
+static void BenchMap(const char* const keys, const size_t* const order,
+                     const size_t count) {
+  const size_t heap = BenchHeapBytes();
+  Map map;
+  MapInit(&map, MAP_MIN_CAPACITY, Hash, KeyCmp);
+
+  double start = BenchNow();
+  for (size_t i = 0; i < count; ++i) {
+    MapInsert(&map, BENCH_KEY(keys, i), BENCH_KEY_WIDTH, &i, sizeof(i));
+  }
+  BenchReport("Map", "insert", count, BenchNow() - start);
+  BenchReportBytes("Map", count, BenchHeapBytes() - heap);
+
+  size_t found = 0;
+  start = BenchNow();
+  for (size_t i = 0; i < count; ++i) {
+    found += MapGet(&map, BENCH_KEY(keys, order[i])) != NULL;
+  }
+  BenchReport("Map", "get-hit", count, BenchNow() - start);
+
+  visited = 0;
+  start = BenchNow();
+  MapTraverse(&map, CountVisit);
+  BenchReport("Map", "traverse", count, BenchNow() - start);
+
+  // Keep one key in ten; the table keeps its buckets.
+  for (size_t i = 0; i < count; ++i) {
+    if (order[i] % 10 != 0) {
+      MapRemove(&map, BENCH_KEY(keys, order[i]), BENCH_KEY_WIDTH);
+    }
+  }
+  const size_t remaining = map.size;
+  start = BenchNow();
+  MapTraverse(&map, CountVisit);
+  BenchReport("Map", "traverse-10%", remaining, BenchNow() - start);
+
+  if (found != count || visited != count + remaining) {
+    fprintf(stderr, "Map: found %zu, visited %zu of %zu\n", found, visited,
+            count);
+  }
+  MapFree(&map);
+}
+
+static void BenchOrderedMap(const char* const keys, const size_t* const order,
+                            const size_t count) {
+  const size_t heap = BenchHeapBytes();
+  OrderedMap map;
+  OrderedMapInit(&map, 0, Hash, KeyCmp);
+
+  double start = BenchNow();
+  for (size_t i = 0; i < count; ++i) {
+    OrderedMapInsert(&map, BENCH_KEY(keys, i), BENCH_KEY_WIDTH, &i,
+                     sizeof(i));
+  }
+  BenchReport("OrderedMap", "insert", count, BenchNow() - start);
+  BenchReportBytes("OrderedMap", count, BenchHeapBytes() - heap);
+
+  size_t found = 0;
+  start = BenchNow();
+  for (size_t i = 0; i < count; ++i) {
+    found += OrderedMapGet(&map, BENCH_KEY(keys, order[i]), BENCH_KEY_WIDTH,
+                           NULL) != NULL;
+  }
+  BenchReport("OrderedMap", "get-hit", count, BenchNow() - start);
+
+  visited = 0;
+  start = BenchNow();
+  OrderedMapTraverse(&map, CountVisit);
+  BenchReport("OrderedMap", "traverse", count, BenchNow() - start);
+
+  for (size_t i = 0; i < count; ++i) {
+    if (order[i] % 10 != 0) {
+      OrderedMapRemove(&map, BENCH_KEY(keys, order[i]), BENCH_KEY_WIDTH);
+    }
+  }
+  const size_t remaining = map.size;
+  start = BenchNow();
+  OrderedMapTraverse(&map, CountVisit);
+  BenchReport("OrderedMap", "traverse-10%", remaining, BenchNow() - start);
+
+  if (found != count || visited != count + remaining) {
+    fprintf(stderr, "OrderedMap: found %zu, visited %zu of %zu\n", found,
+            visited, count);
+  }
+  OrderedMapFree(&map);
+}
+
+int main(int argc, char** argv) {
+  size_t* counts;
+  const size_t ncounts =
+      BenchParseCounts(argc, argv, kDefaultCounts,
+                       sizeof(kDefaultCounts) / sizeof(kDefaultCounts[0]),
+                       &counts);
+
+  for (size_t c = 0; c < ncounts; ++c) {
+    const size_t count = counts[c];
+    char* keys = BenchMakeKeys(count, "key");
+    size_t* order = (size_t*)malloc(count * sizeof(size_t));
+    BenchShuffle(order, count);
+
+    BenchMap(keys, order, count);
+    BenchOrderedMap(keys, order, count);
+
+    free(order);
+    free(keys);
+  }
+  free(counts);
+  return EXIT_SUCCESS;
+}
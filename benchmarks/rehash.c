@@ -0,0 +1,96 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Measures the latency distribution of `MapInsert` while a `Map` grows from
+// `MAP_MIN_CAPACITY` buckets, with and without `incremental_rehash`.
+//
+// Usage:
+//    bench_rehash [count...]
+//
+// Without arguments the benchmark inserts 100K, 1M and 10M keys.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "bool.h"
+#include "map/map.h"
+
+static const size_t kDefaultCounts[] = {100000, 1000000, 10000000};
+
+static int CompareLatencies(const void* lhs, const void* rhs) {
+  const double a = *(const double*)lhs;
+  const double b = *(const double*)rhs;
+  return (a > b) - (a < b);
+}
+
+static void BenchInsertLatency(const char* const name, const bool_t incremental,
+                               const char* const keys, const size_t count) {
+  MapConfig config;
+  MapConfigInit(&config, MAP_MIN_CAPACITY, Hash, KeyCmp);
+  config.incremental_rehash = incremental;
+  Map map;
+  MapInitWithConfig(&map, &config);
+
+  double* latencies = (double*)malloc(count * sizeof(double));
+  const double start = BenchNow();
+  for (size_t i = 0; i < count; ++i) {
+    const double before = BenchNow();
+    MapInsert(&map, BENCH_KEY(keys, i), BENCH_KEY_WIDTH, &i, sizeof(i));
+    latencies[i] = BenchNow() - before;
+  }
+  const double elapsed = BenchNow() - start;
+
+  qsort(latencies, count, sizeof(double), CompareLatencies);
+  printf("%-12s %12zu %10.2f ns/op  p50 %8.0f  p99 %8.0f  p99.9 %10.0f  "
+         "max %12.0f ns\n",
+         name, count, elapsed / (double)count, latencies[count / 2],
+         latencies[count * 99 / 100], latencies[count * 999 / 1000],
+         latencies[count - 1]);
+
+  free(latencies);
+  MapFree(&map);
+}
+
+int main(int argc, char** argv) {
+  size_t* counts;
+  const size_t ncounts =
+      BenchParseCounts(argc, argv, kDefaultCounts,
+                       sizeof(kDefaultCounts) / sizeof(kDefaultCounts[0]),
+                       &counts);
+
+  for (size_t c = 0; c < ncounts; ++c) {
+    char* keys = BenchMakeKeys(counts[c], "key");
+    BenchInsertLatency("stop-world", FALSE, keys, counts[c]);
+    BenchInsertLatency("incremental", TRUE, keys, counts[c]);
+    free(keys);
+  }
+  free(counts);
+  return EXIT_SUCCESS;
+}
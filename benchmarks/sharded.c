@@ -0,0 +1,148 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Measures how inserts scale with the number of threads on a write-heavy
+// workload, on one `Map` whose writers all queue on its single write lock
+// against a `ShardedMap` whose writers only contend within a shard.
+//
+// Usage:
+//    bench_sharded [threads...]
+//
+// Without arguments the benchmark runs with 1, 2, 4, 8, 16, 32 and 64 threads.
+// Every thread performs `BENCH_OPS_PER_THREAD` operations over
+// `BENCH_MAP_KEYS` keys; one operation in `BENCH_REMOVE_EVERY` removes a key,
+// the others insert or overwrite one.
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "bool.h"
+#include "map/hash.h"
+#include "map/map.h"
+#include "map/ops.h"
+#include "shardedmap/ops.h"
+#include "shardedmap/shardedmap.h"
+
+#define BENCH_MAP_KEYS 0x100000
+#define BENCH_OPS_PER_THREAD 0x40000
+#define BENCH_REMOVE_EVERY 0x04
+#define BENCH_SHARDS 0x40
+
+static const size_t kDefaultThreads[] = {1, 2, 4, 8, 16, 32, 64};
+
+typedef struct BenchThread {
+  Map* map;
+  ShardedMap* sharded;
+  const char* keys;
+  size_t seed;
+} BenchThread;
+
+static void* BenchWorker(void* arg) {
+  BenchThread* const thread = (BenchThread*)arg;
+  unsigned long long state = 0x9E3779B97F4A7C15ULL ^ thread->seed;
+  for (size_t i = 0; i < BENCH_OPS_PER_THREAD; ++i) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    const char* key = BENCH_KEY(thread->keys, state % BENCH_MAP_KEYS);
+    const size_t key_size = strlen(key);
+    const bool_t remove = i % BENCH_REMOVE_EVERY == 0 ? TRUE : FALSE;
+
+    if (thread->sharded != NULL) {
+      if (remove == TRUE) {
+        ShardedMapRemove(thread->sharded, key, key_size);
+      } else {
+        ShardedMapInsert(thread->sharded, key, key_size, &i, sizeof(i));
+      }
+    } else {
+      if (remove == TRUE) {
+        MapRemoveN(thread->map, key, key_size);
+      } else {
+        MapInsertN(thread->map, key, key_size, &i, sizeof(i));
+      }
+    }
+  }
+  return NULL;
+}
+
+static void BenchRun(const char* name, Map* const map,
+                     ShardedMap* const sharded, const char* keys,
+                     const size_t nthreads) {
+  pthread_t* threads = (pthread_t*)malloc(nthreads * sizeof(pthread_t));
+  BenchThread* args = (BenchThread*)malloc(nthreads * sizeof(BenchThread));
+
+  const double start = BenchNow();
+  for (size_t t = 0; t < nthreads; ++t) {
+    args[t].map = map;
+    args[t].sharded = sharded;
+    args[t].keys = keys;
+    args[t].seed = t + 1;
+    pthread_create(&threads[t], NULL, BenchWorker, &args[t]);
+  }
+  for (size_t t = 0; t < nthreads; ++t) pthread_join(threads[t], NULL);
+  const double elapsed = BenchNow() - start;
+
+  const double ops = (double)nthreads * BENCH_OPS_PER_THREAD;
+  printf("%-14s %8zu %12.2f Mops/s\n", name, nthreads, ops / elapsed * 1e3);
+  free(threads);
+  free(args);
+}
+
+int main(int argc, char** argv) {
+  size_t* threads;
+  const size_t nthreads =
+      BenchParseCounts(argc, argv, kDefaultThreads,
+                       sizeof(kDefaultThreads) / sizeof(kDefaultThreads[0]),
+                       &threads);
+
+  char* keys = BenchMakeKeys(BENCH_MAP_KEYS, "key");
+  MapConfig config;
+  MapConfigInit(&config, BENCH_MAP_KEYS, NULL, NULL);
+  config.hash_seeded_func = HashBytes;
+  config.key_eq_n_func = KeyCmpN;
+
+  for (size_t t = 0; t < nthreads; ++t) {
+    Map map;
+    MapInitWithConfig(&map, &config);
+    BenchRun("map", &map, NULL, keys, threads[t]);
+    MapFree(&map);
+
+    ShardedMap sharded;
+    ShardedMapInitWithConfig(&sharded, BENCH_SHARDS, &config);
+    BenchRun("shardedmap", NULL, &sharded, keys, threads[t]);
+    ShardedMapFree(&sharded);
+  }
+
+  free(keys);
+  free(threads);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,143 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Compares many tiny `Map` instances against `SmallMap` instances holding the
+// same keys, as per-object attribute maps would: the heap bytes per map,
+// including the map structures themselves, and the cost of filling and
+// reading them.
+//
+// Usage:
+//    bench_smallmap [entries...]
+//
+// Without arguments the benchmark fills `BENCH_MAPS` maps with 1, 4, 8 and 16
+// entries each.
+
+#include "smallmap/smallmap.h"
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "map/map.h"
+
+#define BENCH_MAPS 0x20000
+
+static const size_t kDefaultCounts[] = {1, 4, 8, 16};
+
+// Returns the bytes the allocator handed out, including its own headers.
+static size_t BenchHeapBytes(void) {
+  const struct mallinfo2 info = mallinfo2();
+  return info.uordblks + info.hblkhd;
+}
+
+static void BenchReportBytes(const char* container, const size_t count,
+                             const size_t bytes) {
+  printf("%-12s %-12s %12zu %10.2f B/map\n", container, "memory", count,
+         (double)bytes / BENCH_MAPS);
+}
+
+static void BenchMap(const char* const keys, const size_t count) {
+  const size_t heap = BenchHeapBytes();
+  Map* maps = (Map*)malloc(BENCH_MAPS * sizeof(Map));
+
+  double start = BenchNow();
+  for (size_t m = 0; m < BENCH_MAPS; ++m) {
+    MapInit(&maps[m], MAP_MIN_CAPACITY, Hash, KeyCmp);
+    for (size_t i = 0; i < count; ++i) {
+      MapInsert(&maps[m], BENCH_KEY(keys, i), BENCH_KEY_WIDTH, &i, sizeof(i));
+    }
+  }
+  BenchReport("Map", "insert", BENCH_MAPS * count, BenchNow() - start);
+  BenchReportBytes("Map", count, BenchHeapBytes() - heap);
+
+  size_t found = 0;
+  start = BenchNow();
+  for (size_t m = 0; m < BENCH_MAPS; ++m) {
+    for (size_t i = 0; i < count; ++i) {
+      found += MapGet(&maps[m], BENCH_KEY(keys, i)) != NULL;
+    }
+  }
+  BenchReport("Map", "get-hit", BENCH_MAPS * count, BenchNow() - start);
+
+  if (found != BENCH_MAPS * count) {
+    fprintf(stderr, "Map: found %zu of %zu\n", found, BENCH_MAPS * count);
+  }
+  for (size_t m = 0; m < BENCH_MAPS; ++m) MapFree(&maps[m]);
+  free(maps);
+}
+
+static void BenchSmallMap(const char* const keys, const size_t count) {
+  const size_t heap = BenchHeapBytes();
+  SmallMap* maps = (SmallMap*)malloc(BENCH_MAPS * sizeof(SmallMap));
+
+  double start = BenchNow();
+  for (size_t m = 0; m < BENCH_MAPS; ++m) {
+    SmallMapInit(&maps[m], Hash, KeyCmp);
+    for (size_t i = 0; i < count; ++i) {
+      SmallMapInsert(&maps[m], BENCH_KEY(keys, i), BENCH_KEY_WIDTH, &i,
+                     sizeof(i));
+    }
+  }
+  BenchReport("SmallMap", "insert", BENCH_MAPS * count, BenchNow() - start);
+  BenchReportBytes("SmallMap", count, BenchHeapBytes() - heap);
+
+  size_t found = 0;
+  start = BenchNow();
+  for (size_t m = 0; m < BENCH_MAPS; ++m) {
+    for (size_t i = 0; i < count; ++i) {
+      found +=
+          SmallMapGet(&maps[m], BENCH_KEY(keys, i), BENCH_KEY_WIDTH) != NULL;
+    }
+  }
+  BenchReport("SmallMap", "get-hit", BENCH_MAPS * count, BenchNow() - start);
+
+  if (found != BENCH_MAPS * count) {
+    fprintf(stderr, "SmallMap: found %zu of %zu\n", found, BENCH_MAPS * count);
+  }
+  for (size_t m = 0; m < BENCH_MAPS; ++m) SmallMapFree(&maps[m]);
+  free(maps);
+}
+
+int main(int argc, char** argv) {
+  size_t* counts;
+  const size_t ncounts =
+      BenchParseCounts(argc, argv, kDefaultCounts,
+                       sizeof(kDefaultCounts) / sizeof(kDefaultCounts[0]),
+                       &counts);
+
+  for (size_t c = 0; c < ncounts; ++c) {
+    char* keys = BenchMakeKeys(counts[c], "attr");
+    BenchMap(keys, counts[c]);
+    BenchSmallMap(keys, counts[c]);
+    free(keys);
+  }
+  free(counts);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,147 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Compares lookups of a `Map` against a `StaticMap` built from the same keys,
+// and reports the time and the hash metadata the build takes.
+//
+// Usage:
+//    bench_staticmap [count...]
+//
+// Without arguments the benchmark runs with 1K, 1M and 10M keys.
+
+#include "staticmap/staticmap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "map/map.h"
+
+static const size_t kDefaultCounts[] = {1000, 1000000, 10000000};
+
+static void BenchMap(const char* const keys, const char* const misses,
+                     const size_t* const order, const size_t count) {
+  Map map;
+  size_t capacity = count < MAP_MIN_CAPACITY ? MAP_MIN_CAPACITY : count;
+  if (capacity > MAP_MAX_CAPACITY) capacity = MAP_MAX_CAPACITY;
+  MapInit(&map, capacity, Hash, KeyCmp);
+  for (size_t i = 0; i < count; ++i) {
+    MapInsert(&map, BENCH_KEY(keys, i), BENCH_KEY_WIDTH, &i, sizeof(i));
+  }
+
+  size_t found = 0;
+  double start = BenchNow();
+  for (size_t i = 0; i < count; ++i) {
+    found += MapGet(&map, BENCH_KEY(keys, order[i])) != NULL;
+  }
+  BenchReport("Map", "get-hit", count, BenchNow() - start);
+
+  start = BenchNow();
+  for (size_t i = 0; i < count; ++i) {
+    found += MapGet(&map, BENCH_KEY(misses, order[i])) != NULL;
+  }
+  BenchReport("Map", "get-miss", count, BenchNow() - start);
+
+  if (found != count) fprintf(stderr, "Map: found %zu of %zu\n", found, count);
+  MapFree(&map);
+}
+
+static void BenchStaticMap(const char* const keys, const char* const misses,
+                           const size_t* const order, const size_t count) {
+  const void** key_ptrs = (const void**)malloc(count * sizeof(void*));
+  const void** value_ptrs = (const void**)malloc(count * sizeof(void*));
+  size_t* sizes = (size_t*)malloc(count * sizeof(size_t));
+  for (size_t i = 0; i < count; ++i) {
+    key_ptrs[i] = BENCH_KEY(keys, i);
+    value_ptrs[i] = &order[i];
+    sizes[i] = BENCH_KEY_WIDTH;
+  }
+
+  StaticMap map;
+  size_t* value_sizes = (size_t*)malloc(count * sizeof(size_t));
+  for (size_t i = 0; i < count; ++i) value_sizes[i] = sizeof(size_t);
+  double start = BenchNow();
+  if (StaticMapBuild(&map, key_ptrs, sizes, value_ptrs, value_sizes, count) ==
+      FALSE) {
+    fprintf(stderr, "StaticMap: build failed for %zu keys\n", count);
+    exit(EXIT_FAILURE);
+  }
+  BenchReport("StaticMap", "build", count, BenchNow() - start);
+  printf("%-12s %-12s %12zu %10.2f bits/key\n", "StaticMap", "pilots", count,
+         (double)map.header->bucket_count * 16 / (double)count);
+  free(value_sizes);
+
+  size_t found = 0;
+  start = BenchNow();
+  for (size_t i = 0; i < count; ++i) {
+    found += StaticMapGet(&map, BENCH_KEY(keys, order[i]), BENCH_KEY_WIDTH,
+                          NULL) != NULL;
+  }
+  BenchReport("StaticMap", "get-hit", count, BenchNow() - start);
+
+  start = BenchNow();
+  for (size_t i = 0; i < count; ++i) {
+    found += StaticMapGet(&map, BENCH_KEY(misses, order[i]), BENCH_KEY_WIDTH,
+                          NULL) != NULL;
+  }
+  BenchReport("StaticMap", "get-miss", count, BenchNow() - start);
+
+  if (found != count) {
+    fprintf(stderr, "StaticMap: found %zu of %zu\n", found, count);
+  }
+  StaticMapFree(&map);
+  free(sizes);
+  free(value_ptrs);
+  free(key_ptrs);
+}
+
+int main(int argc, char** argv) {
+  size_t* counts;
+  const size_t ncounts =
+      BenchParseCounts(argc, argv, kDefaultCounts,
+                       sizeof(kDefaultCounts) / sizeof(kDefaultCounts[0]),
+                       &counts);
+
+  for (size_t c = 0; c < ncounts; ++c) {
+    const size_t count = counts[c];
+    char* keys = BenchMakeKeys(count, "key");
+    char* misses = BenchMakeKeys(count, "miss");
+    size_t* order = (size_t*)malloc(count * sizeof(size_t));
+    BenchShuffle(order, count);
+
+    BenchMap(keys, misses, order, count);
+    BenchStaticMap(keys, misses, order, count);
+
+    free(order);
+    free(misses);
+    free(keys);
+  }
+  free(counts);
+  return EXIT_SUCCESS;
+}
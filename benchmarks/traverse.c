@@ -0,0 +1,121 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Measures full-table scans of a `Map` with `MapTraverse`, a `MapIterator`
+// and `MapParallelTraverse` over 1, 2, 4 and all online processors.
+//
+// Usage:
+//    bench_traverse [count...]
+//
+// Without arguments the benchmark scans maps of 1M and 4M keys.  The
+// predicate sums the values so that every entry is actually read.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "bool.h"
+#include "map/hash.h"
+#include "map/iterators.h"
+#include "map/map.h"
+#include "map/ops.h"
+
+static const size_t kDefaultCounts[] = {1000000, 4000000};
+
+static size_t bench_sum = 0;
+
+static bool_t BenchSumValue(const void* key, const void* value) {
+  (void)key;
+  __atomic_fetch_add(&bench_sum, *(const size_t*)value, __ATOMIC_RELAXED);
+  return TRUE;
+}
+
+static void BenchParallel(const char* name, Map* const map,
+                          const size_t workers, const size_t expected) {
+  bench_sum = 0;
+  const double start = BenchNow();
+  MapParallelTraverse(map, workers, BenchSumValue);
+  BenchReport("map", name, map->size, BenchNow() - start);
+  if (bench_sum != expected) {
+    fprintf(stderr, "bench_traverse: %s summed %zu instead of %zu\n", name,
+            bench_sum, expected);
+    exit(EXIT_FAILURE);
+  }
+}
+
+int main(int argc, char** argv) {
+  size_t* counts;
+  const size_t ncounts =
+      BenchParseCounts(argc, argv, kDefaultCounts,
+                       sizeof(kDefaultCounts) / sizeof(kDefaultCounts[0]),
+                       &counts);
+
+  for (size_t c = 0; c < ncounts; ++c) {
+    const size_t count = counts[c];
+    char* keys = BenchMakeKeys(count, "key");
+    Map map;
+    MapInitSeeded(&map, MAP_MIN_CAPACITY, HashBytes, KeyCmpN);
+    size_t expected = 0;
+    for (size_t i = 0; i < count; ++i) {
+      const char* key = BENCH_KEY(keys, i);
+      MapInsertN(&map, key, strlen(key), &i, sizeof(i));
+      expected += i;
+    }
+
+    bench_sum = 0;
+    double start = BenchNow();
+    MapTraverse(&map, BenchSumValue);
+    BenchReport("map", "traverse", count, BenchNow() - start);
+
+    size_t sum = 0;
+    start = BenchNow();
+    MapIterator* iterator = MapIteratorNew(&map, 0);
+    for (const MapEntry* entry = MapIteratorNext(iterator); entry != NULL;
+         entry = MapIteratorNext(iterator)) {
+      sum += *(const size_t*)entry->value;
+    }
+    MapIteratorFree(iterator);
+    BenchReport("map", "iterator", count, BenchNow() - start);
+    if (bench_sum != expected || sum != expected) {
+      fprintf(stderr, "bench_traverse: sums disagree\n");
+      return EXIT_FAILURE;
+    }
+
+    BenchParallel("parallel-1", &map, 1, expected);
+    BenchParallel("parallel-2", &map, 2, expected);
+    BenchParallel("parallel-4", &map, 4, expected);
+    BenchParallel("parallel-all", &map, 0, expected);
+
+    MapFree(&map);
+    free(keys);
+  }
+  free(counts);
+  return EXIT_SUCCESS;
+}
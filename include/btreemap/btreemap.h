@@ -0,0 +1,244 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_INCLUDE_DATA_BTREEMAP_BTREEMAP_H_
+#define STLC_INCLUDE_DATA_BTREEMAP_BTREEMAP_H_
+
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "bool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Default size of a node in bytes: sixteen cache lines, enough for a few dozen
+// small keys per node while a binary search over them touches a handful of
+// lines.  Page-sized nodes suit scans, smaller ones point lookups.
+#define BTREEMAP_NODE_SIZE 0x400
+
+// Alignment of every node; node sizes are rounded up to a multiple of it.
+#define BTREEMAP_CACHE_LINE 0x40
+
+// Minimum number of keys a node holds; small nodes are enlarged to fit them.
+#define BTREEMAP_MIN_FANOUT 0x04
+
+// Maximum number of cache lines of a node prefetched before it is searched.
+#define BTREEMAP_PREFETCH_LINES 0x10
+
+// Maximum height of a tree.  Splits keep nodes at least half full, so a tree
+// of `BTREEMAP_MIN_FANOUT` keys per node never gets close to it.
+#define BTREEMAP_MAX_DEPTH 0x40
+
+// Function signature for the function defined to order two keys, mirroring
+// `key_eq_f`.
+//
+// Function defined with this signature returns a negative value if `key1`
+// orders before `key2`, zero if they are equal and a positive value
+// otherwise, like `memcmp()`.
+typedef int (*key_cmp_f)(const void* key1, const void* key2);
+
+// A node of a `BTreeMap`, allocated as one `BTreeMap::node_size` block
+// aligned to `BTREEMAP_CACHE_LINE`.
+//
+// A leaf stores `count` keys followed by their values; an inner node stores
+// `count` separator keys followed by `count + 1` children, where the keys of
+// child `i` order at or after separator `i - 1` and before separator `i`:
+//
+//    inner  [ count | - | - | key0 key1 ... | child0 child1 child2 ... ]
+//    leaf   [ count | prev | next | key0 key1 ... | value0 value1 ... ]
+//
+// Attributes:
+//  count - the number of keys of the node.
+//  leaf  - whether the node is a leaf.
+//  prev, next - the neighbouring leaves in key order, or NULL; unused in
+//          inner nodes.
+//  data  - the keys, then the values or the children.
+typedef struct BTreeMapNode {
+  uint32_t count;
+  bool_t leaf;
+  struct BTreeMapNode* prev;
+  struct BTreeMapNode* next;
+  unsigned char data[];
+} BTreeMapNode;
+
+// Returns the key `i` of `node`.
+//
+// This macro is meant to be protected inside `btreemap` module.
+#define _BTREEMAP_KEY(map, node, i) \
+  ((node)->data + (size_t)(i) * (map)->key_size)
+
+// Returns the value `i` of the leaf `node`.
+//
+// This macro is meant to be protected inside `btreemap` module.
+#define _BTREEMAP_VALUE(map, node, i)                \
+  ((unsigned char*)(node) + (map)->values_offset + \
+   (size_t)(i) * (map)->value_size)
+
+// Returns the array of children of the inner `node`.
+//
+// This macro is meant to be protected inside `btreemap` module.
+#define _BTREEMAP_CHILDREN(map, node) \
+  ((BTreeMapNode**)((unsigned char*)(node) + (map)->children_offset))
+
+// Prefetches the leading cache lines of `node` so that the misses of the
+// binary search over it overlap instead of following each other.
+//
+// This macro is meant to be protected inside `btreemap` module.
+#define _BTREEMAP_PREFETCH(map, node)                                      \
+  do {                                                                     \
+    const size_t _lines = (map)->node_size / BTREEMAP_CACHE_LINE;          \
+    for (size_t _line = 0;                                                 \
+         _line < _lines && _line < BTREEMAP_PREFETCH_LINES; ++_line)       \
+      __builtin_prefetch((const char*)(node) + _line * BTREEMAP_CACHE_LINE, \
+                         0, 0x03);                                         \
+  } while (0)
+
+// The `BTreeMap` structure is an ordered map laid out as a B+-tree.  The keys
+// and values have a fixed size and are stored inline in cache-line aligned
+// nodes, so a lookup touches one node per level and a range scan walks the
+// linked leaves sequentially.
+//
+// Attributes:
+//  key_cmp_func    - the function ordering the keys.
+//  key_size        - the size of every key in bytes.
+//  value_size      - the size of every value in bytes.
+//  node_size       - the size of every node in bytes.
+//  leaf_capacity   - the number of keys a leaf holds.
+//  inner_capacity  - the number of separator keys an inner node holds.
+//  values_offset   - the offset of the values inside a leaf.
+//  children_offset - the offset of the children inside an inner node.
+//  root            - the root node, a leaf while the tree has one level.
+//  first           - the leftmost leaf.
+//  height          - the number of levels of the tree.
+//  size            - the number of keys of the tree.
+//  scratch         - room for an inner node being split and a separator key.
+//  lock            - a read-write lock guarding the tree.
+typedef struct BTreeMap {
+  key_cmp_f key_cmp_func;
+  size_t key_size;
+  size_t value_size;
+  size_t node_size;
+  size_t leaf_capacity;
+  size_t inner_capacity;
+  size_t values_offset;
+  size_t children_offset;
+  BTreeMapNode* root;
+  BTreeMapNode* first;
+  size_t height;
+  size_t size;
+  unsigned char* scratch;
+  pthread_rwlock_t lock;
+} BTreeMap;
+
+// The `BTreeMapConfig` structure describes how `BTreeMapInitWithConfig()`
+// creates a tree.
+//
+// Attributes:
+//  key_size     - the size of every key in bytes, at least one.
+//  value_size   - the size of every value in bytes, possibly zero.
+//  node_size    - the size of every node in bytes, rounded up to a multiple of
+//                 `BTREEMAP_CACHE_LINE` and to hold `BTREEMAP_MIN_FANOUT` keys.
+//  key_cmp_func - the function ordering the keys.
+typedef struct BTreeMapConfig {
+  size_t key_size;
+  size_t value_size;
+  size_t node_size;
+  key_cmp_f key_cmp_func;
+} BTreeMapConfig;
+
+// Allocates a node of `map`, a leaf if `leaf` is TRUE, with no keys.
+//
+// This function is meant to be protected inside `btreemap` module.
+BTreeMapNode* _BTreeMapNodeNew(const BTreeMap* const map, const bool_t leaf);
+
+// Frees `node` and every node below it.
+//
+// This function is meant to be protected inside `btreemap` module.
+void _BTreeMapNodeFree(const BTreeMap* const map, BTreeMapNode* const node);
+
+// Returns the position of the first key of `node` not ordering before `key`,
+// setting `*found` if it is equal to `key`.
+//
+// This function is meant to be protected inside `btreemap` module.
+size_t _BTreeMapLowerBound(const BTreeMap* const map,
+                           const BTreeMapNode* const node, const void* key,
+                           bool_t* const found);
+
+// Returns the index of the child of the inner `node` that `key` belongs to.
+//
+// This function is meant to be protected inside `btreemap` module.
+size_t _BTreeMapChildIndex(const BTreeMap* const map,
+                           const BTreeMapNode* const node, const void* key);
+
+// Returns the leaf `key` belongs to.  The caller must hold the lock of `map`.
+//
+// This function is meant to be protected inside `btreemap` module.
+BTreeMapNode* _BTreeMapFindLeaf(const BTreeMap* const map, const void* key);
+
+// Fills `config` with the given sizes and comparator and the default node
+// size.
+void BTreeMapConfigInit(BTreeMapConfig* const config, const size_t key_size,
+                        const size_t value_size, key_cmp_f key_cmp_func);
+
+// Initializes a new, empty instance of the `BTreeMap` data structure.
+//
+// Params:
+//  map          - A pointer to the `BTreeMap` to be initialized.
+//  key_size     - The size of every key in bytes.
+//  value_size   - The size of every value in bytes.
+//  key_cmp_func - A pointer to the function used to order the keys.
+//
+// Remarks:
+//  If the pointer passed to `map` is NULL, this function returns immediately
+//  without doing anything.  On failure `map->root` is left NULL.
+void BTreeMapInit(BTreeMap* const map, const size_t key_size,
+                  const size_t value_size, key_cmp_f key_cmp_func);
+
+// Initializes a new, empty instance of the `BTreeMap` data structure as
+// described by `config`.
+void BTreeMapInitWithConfig(BTreeMap* const map,
+                            const BTreeMapConfig* const config);
+
+// Returns the number of keys of `map`.
+size_t BTreeMapSize(BTreeMap* const map);
+
+// Frees up a `BTreeMap` instance and the nodes associated with it.
+void BTreeMapFree(BTreeMap* const map);
+
+#ifdef __cplusplus
+}
+#endif
+
+#include "btreemap/iterators.h"
+#include "btreemap/ops.h"
+
+#endif  // STLC_INCLUDE_DATA_BTREEMAP_BTREEMAP_H_
@@ -0,0 +1,112 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_INCLUDE_DATA_BTREEMAP_OPS_H_
+#define STLC_INCLUDE_DATA_BTREEMAP_OPS_H_
+
+#include <sys/types.h>
+
+#include "bool.h"
+#include "btreemap/btreemap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Insert a new key-value pair into the tree.
+//
+// Params:
+//  map   - A pointer to the tree to insert the key-value pair into.
+//  key   - A pointer to the `key_size` bytes of the key.
+//  value - A pointer to the `value_size` bytes of the value; may be NULL if
+//          `value_size` is zero.
+//
+// Remarks:
+//  If the key already exists in the tree, its value is replaced.  A full leaf
+//  is split in two halves, except the rightmost leaf when the key goes past
+//  its end, which keeps its keys so that ascending inserts fill leaves up.
+//
+// Thread Safety:
+//  This function holds the write lock of the tree.
+void BTreeMapInsert(BTreeMap *const map, const void *const key,
+                    const void *const value);
+
+// Retrieve the value associated with `key`.
+//
+// Returns:
+//  A pointer to the value, or NULL if the key is not present.  Values live
+//  inside the leaves, so the pointer is only valid until the next insert or
+//  remove.
+//
+// Thread Safety:
+//  This function only holds the read lock of the tree.
+void *BTreeMapGet(BTreeMap *const map, const void *const key);
+
+// Remove the entry of `key` from the tree.
+//
+// Returns:
+//  TRUE if an entry was removed, FALSE if the key was not present.
+//
+// Remarks:
+//  Nodes are not rebalanced: a leaf is only freed once its last key is gone,
+//  as in many database B+-trees, so removes never move keys across nodes.
+//
+// Thread Safety:
+//  This function holds the write lock of the tree.
+bool_t BTreeMapRemove(BTreeMap *const map, const void *const key);
+
+// Loads `n` keys sorted in strictly ascending order into an empty tree in
+// O(n), building the leaves and then every inner level from left to right.
+//
+// Params:
+//  map    - A pointer to the empty tree to load.
+//  keys   - The `n` keys laid out back to back, `key_size` bytes each.
+//  values - The `n` values laid out back to back, `value_size` bytes each;
+//           may be NULL if `value_size` is zero.
+//  n      - The number of keys.
+//
+// Returns:
+//  TRUE on success, FALSE if the tree is not empty, the keys are not sorted
+//  or the nodes could not be allocated, in which case the tree is left as is.
+//
+// Remarks:
+//  The keys are spread evenly over as few nodes as possible, so the loaded
+//  tree is as short and dense as it can be with every node at least half
+//  full.
+//
+// Thread Safety:
+//  This function holds the write lock of the tree.
+bool_t BTreeMapBulkLoad(BTreeMap *const map, const void *const keys,
+                        const void *const values, const size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // STLC_INCLUDE_DATA_BTREEMAP_OPS_H_
@@ -0,0 +1,222 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_INCLUDE_DATA_EXPIRINGMAP_EXPIRINGMAP_H_
+#define STLC_INCLUDE_DATA_EXPIRINGMAP_EXPIRINGMAP_H_
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "bool.h"
+#include "map/map.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Number of levels of the timing wheel and the number of bits of time every
+// level covers.  Level `l` has `EXPIRINGMAP_WHEEL_SLOTS` slots spanning
+// `EXPIRINGMAP_WHEEL_SLOTS ^ l` ticks each, so the wheel covers `2 ^ 30`
+// ticks, about twelve days of milliseconds, before deadlines spill into the
+// overflow slot.
+#define EXPIRINGMAP_WHEEL_LEVELS 0x5
+#define EXPIRINGMAP_WHEEL_BITS 0x6
+#define EXPIRINGMAP_WHEEL_SLOTS ((size_t)0x01 << EXPIRINGMAP_WHEEL_BITS)
+
+// Index of the slot holding the deadlines beyond the span of the wheel.  They
+// are placed again each time the top level wraps around.
+#define EXPIRINGMAP_OVERFLOW_SLOT \
+  (EXPIRINGMAP_WHEEL_LEVELS * EXPIRINGMAP_WHEEL_SLOTS)
+
+// Function signature for the callback `ExpiringMapAdvance()` calls on every
+// entry it expires, before the entry is released.  It is not called for
+// entries that are overwritten or removed explicitly.
+typedef void (*expiringmap_expire_f)(const void* key, const size_t key_size,
+                                     const void* value,
+                                     const size_t value_size,
+                                     const uint64_t deadline, void* context);
+
+// The timer of an entry, stored at the start of its value bytes so that an
+// entry and its place in the timing wheel are one allocation:
+//
+//       +~~~~~~~~~~~~~~~~+~~~~~~~~~~~+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~+
+//       ! MapEntry header ! key bytes ! prev|next|deadline|slot ! value !
+//       +~~~~~~~~~~~~~~~~+~~~~~~~~~~~+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~+
+//
+// Attributes:
+//  prev, next - the neighbours of the entry in its wheel slot.
+//  deadline   - the tick the entry expires at.
+//  slot       - the index of the wheel slot holding the entry.
+typedef struct ExpiringMapNode {
+  MapEntry* prev;
+  MapEntry* next;
+  uint64_t deadline;
+  size_t slot;
+} ExpiringMapNode;
+
+// Offset of the stored value from the start of the value bytes of an entry,
+// keeping it aligned to `MAP_ENTRY_ALIGNMENT`.
+#define EXPIRINGMAP_VALUE_OFFSET                            \
+  ((sizeof(ExpiringMapNode) + MAP_ENTRY_ALIGNMENT - 0x01) & \
+   ~(size_t)(MAP_ENTRY_ALIGNMENT - 0x01))
+
+// Returns the timer of `entry`.
+//
+// This macro is meant to be protected inside `expiringmap` module.
+#define _EXPIRINGMAP_NODE(entry) ((ExpiringMapNode*)(entry)->value)
+
+// Returns the stored value of `entry`.
+//
+// This macro is meant to be protected inside `expiringmap` module.
+#define _EXPIRINGMAP_VALUE(entry) \
+  ((void*)((unsigned char*)(entry)->value + EXPIRINGMAP_VALUE_OFFSET))
+
+// Configuration of an `ExpiringMap`, initialized to the defaults by
+// `ExpiringMapConfigInit()`.
+//
+// Attributes:
+//  map            - the configuration of the underlying map.
+//  now            - the tick the wheel starts at.  Defaults to 0.
+//  on_expire      - called on every expired entry.  Defaults to NULL.
+//  expire_context - passed to `on_expire`.
+typedef struct ExpiringMapConfig {
+  MapConfig map;
+  uint64_t now;
+  expiringmap_expire_f on_expire;
+  void* expire_context;
+} ExpiringMapConfig;
+
+// The `ExpiringMap` structure is a `Map` whose entries carry a deadline.  The
+// entries are threaded through a hierarchical timing wheel: an entry sits in
+// the slot of the coarsest level that still tells its deadline apart from the
+// current tick and moves one level down each time the wheel reaches its slot.
+// Advancing the wheel thus only touches the entries that expire and the few
+// that cascade, and jumps over empty stretches of time using the occupancy
+// bitmap of every level.
+//
+// Time is counted in ticks of the caller's monotonic clock, milliseconds for
+// instance; the map never reads a clock itself.  An entry expires once the
+// current tick reaches its deadline: lookups hide it right away and
+// `ExpiringMapAdvance()` releases it.
+//
+// Attributes:
+//  map       - the map holding the entries.
+//  slots     - the heads of the lists of every wheel slot, level after level,
+//              followed by the overflow slot.
+//  occupied  - a bitmap of the non-empty slots of every level.
+//  current   - the next tick `ExpiringMapAdvance()` has to process.
+//  on_expire, expire_context - the expiry callback and its context.
+typedef struct ExpiringMap {
+  Map map;
+  MapEntry* slots[EXPIRINGMAP_OVERFLOW_SLOT + 0x01];
+  uint64_t occupied[EXPIRINGMAP_WHEEL_LEVELS];
+  uint64_t current;
+  expiringmap_expire_f on_expire;
+  void* expire_context;
+} ExpiringMap;
+
+// Links `entry` into the wheel slot its deadline falls into, given the
+// current tick of `map`.  A deadline already past goes into the slot of the
+// current tick.  The caller must hold the write lock of `map`.
+//
+// This function is meant to be protected inside `expiringmap` module.
+void _ExpiringMapSchedule(ExpiringMap* const map, MapEntry* const entry);
+
+// Unlinks `entry` from its wheel slot.  The caller must hold the write lock of
+// `map`.
+//
+// This function is meant to be protected inside `expiringmap` module.
+void _ExpiringMapUnschedule(ExpiringMap* const map, MapEntry* const entry);
+
+// Unlinks `entry` from the wheel and from the map of `map` and releases it,
+// calling the expiry callback first if `expired`.  The caller must hold the
+// write lock of `map`.
+//
+// This function is meant to be protected inside `expiringmap` module.
+void _ExpiringMapDropLocked(ExpiringMap* const map, MapEntry* const entry,
+                            const bool_t expired);
+
+// Returns the first tick from the current one on at which the wheel of `map`
+// has work to do, a slot to cascade or to expire, or `UINT64_MAX` if it holds
+// no entry.  The caller must hold the lock of `map`.
+//
+// This function is meant to be protected inside `expiringmap` module.
+uint64_t _ExpiringMapNextEvent(const ExpiringMap* const map);
+
+// Moves the entries of every slot the current tick of `map` starts down to
+// the lower levels, coarsest level first, so that the level 0 slot of the
+// current tick holds every entry expiring at it.  The caller must hold the
+// write lock of `map`.
+//
+// This function is meant to be protected inside `expiringmap` module.
+void _ExpiringMapCascadeLocked(ExpiringMap* const map);
+
+// Initializes `config` with the defaults: a wheel starting at tick 0 without
+// an expiry callback, whose map hashes with `hash_func` and compares keys with
+// `key_eq_func`.
+void ExpiringMapConfigInit(ExpiringMapConfig* const config, hash_f hash_func,
+                           key_eq_f key_eq_func);
+
+// Initializes a new instance of the `ExpiringMap` data structure.
+//
+// Params:
+//  map         - A pointer to the `ExpiringMap` to be initialized.
+//  now         - The tick the wheel starts at.
+//  hash_func   - A pointer to the hash function used to calculate hash codes
+//                for keys.
+//  key_eq_func - A pointer to the key comparison function used to compare keys
+//                for equality.
+//
+// Remarks:
+//  If the pointer passed to `map` is NULL, this function returns immediately
+//  without doing anything.
+void ExpiringMapInit(ExpiringMap* const map, const uint64_t now,
+                     hash_f hash_func, key_eq_f key_eq_func);
+
+// Initializes a new instance of the `ExpiringMap` data structure as described
+// by `config`.
+void ExpiringMapInitWithConfig(ExpiringMap* const map,
+                               const ExpiringMapConfig* const config);
+
+// Returns the number of entries of `map`, counting the expired entries
+// `ExpiringMapAdvance()` did not release yet.
+size_t ExpiringMapSize(ExpiringMap* const map);
+
+// Frees up an `ExpiringMap` instance and the entries associated with it
+// without calling the expiry callback.
+void ExpiringMapFree(ExpiringMap* const map);
+
+#ifdef __cplusplus
+}
+#endif
+
+#include "expiringmap/iterators.h"
+#include "expiringmap/ops.h"
+
+#endif  // STLC_INCLUDE_DATA_EXPIRINGMAP_EXPIRINGMAP_H_
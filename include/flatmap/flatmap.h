@@ -0,0 +1,165 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_INCLUDE_DATA_FLATMAP_FLATMAP_H_
+#define STLC_INCLUDE_DATA_FLATMAP_FLATMAP_H_
+
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "bool.h"
+#include "map/map.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLATMAP_MIN_CAPACITY 0x10
+
+// The table grows once it is more than `FLATMAP_MAX_LOAD_NUMERATOR /
+// FLATMAP_MAX_LOAD_DENOMINATOR` full.  Robin Hood hashing keeps the probe
+// sequence lengths short even at high load so we can afford 7/8.
+#define FLATMAP_MAX_LOAD_NUMERATOR 0x7
+#define FLATMAP_MAX_LOAD_DENOMINATOR 0x8
+
+// A single slot of the open-addressed `FlatMap` table.
+//
+// Slots are stored contiguously so a probe walks adjacent memory instead of
+// chasing `next` pointers.  The key and the value are copied into one block
+// pointed to by `data`; the key bytes are padded so the value is aligned to
+// `MAP_ENTRY_ALIGNMENT` like the value of a `MapEntry`:
+//
+//       +~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~+
+//       ! hash|psl|data|key_size        !
+//       +~~~~~~~~~~~~~+~~~~~~~~~~~~~~~~~+
+//                     |
+//                     +~~~~> [ key bytes | padding | value bytes ]
+//
+// `psl` is the probe sequence length plus one, i.e. the distance of the slot
+// from the entry's home slot counted from `1`.  A `psl` of `0` marks the slot
+// as empty.
+typedef struct FlatMapSlot {
+  hash_t hash;
+  size_t psl;
+  unsigned char* data;
+  size_t key_size;
+} FlatMapSlot;
+
+// The `FlatMap` structure is an open-addressing alternative to `Map` that uses
+// Robin Hood displacement on insert and backward-shift deletion on remove.  It
+// takes the same `hash_f` and `key_eq_f` callbacks as `Map`.
+//
+// Attributes:
+//  hash_func   - a function pointer to the hash function used to generate hash
+//                values for keys.
+//  key_eq_func - a function pointer to the key equality function used to
+//                compare keys for equality.
+//  slots       - a contiguous array of `capacity` slots.
+//  capacity    - the number of slots, always a power of two.
+//  size        - the number of occupied slots.
+//  mutex       - a mutex used to synchronize access to the table in a
+//                multi-threaded context.
+typedef struct FlatMap {
+  hash_f hash_func;
+  key_eq_f key_eq_func;
+  FlatMapSlot* slots;
+  size_t capacity;
+  size_t size;
+  pthread_mutex_t mutex;
+} FlatMap;
+
+// Computes the home slot index of `hash` inside `map`.
+//
+// This macro is meant to be protected inside `flatmap` module.
+#define _FLATMAP_HOME_SLOT(map, hash) \
+  (MapMixHash(hash) & ((map)->capacity - 1))
+
+// Offset of the value bytes inside the `data` block of a slot holding a key of
+// `key_size` bytes.
+//
+// This macro is meant to be protected inside `flatmap` module.
+#define _FLATMAP_VALUE_OFFSET(key_size)   \
+  (((key_size) + MAP_ENTRY_ALIGNMENT - 1) & \
+   ~(size_t)(MAP_ENTRY_ALIGNMENT - 1))
+
+// Places `slot` into the slot array of `map` using Robin Hood displacement.
+// The entry must not already be present in `map`.  `slot->psl` is ignored.
+//
+// This function is meant to be protected inside `flatmap` module.
+void _FlatMapPlace(FlatMap* const map, FlatMapSlot slot);
+
+// Re-allocates the slot array of `map` to hold `capacity` slots, rounded up to
+// a power of two, and re-inserts all the entries.  The caller must hold the
+// mutex of `map`.
+//
+// Returns:
+//  `FALSE` if `capacity` slots cannot hold the current entries under the
+//  maximum load factor or could not be allocated, in which case `map` is left
+//  unchanged.
+//
+// This function is meant to be protected inside `flatmap` module.
+bool_t _FlatMapReallocLocked(FlatMap* const map, const size_t capacity);
+
+// Initializes a new instance of the `FlatMap` data structure.
+//
+// Params:
+//  map         - A pointer to the `FlatMap` to be initialized.
+//  capacity    - The minimum number of slots to allocate; it is rounded up to
+//                the next power of two and to at least `FLATMAP_MIN_CAPACITY`.
+//  hash_func   - A pointer to the hash function used to calculate hash codes
+//                for keys.
+//  key_eq_func - A pointer to the key comparison function used to compare keys
+//                for equality.
+//
+// Remarks:
+//  If the pointer passed to `map` is NULL, this function returns immediately
+//  without doing anything.  On allocation failure `map->slots` is left NULL.
+void FlatMapInit(FlatMap* const map, const size_t capacity, hash_f hash_func,
+                 key_eq_f key_eq_func);
+
+// Re-allocates the slot array of a `FlatMap` to hold `new_capacity` slots
+// (rounded up to a power of two), re-inserting all the entries.
+//
+// Remarks:
+//  The request is ignored if `new_capacity` slots cannot hold the current
+//  entries under the maximum load factor.  This function acquires the map
+//  mutex.
+void FlatMapRealloc(FlatMap* const map, const size_t new_capacity);
+
+// Frees up a `FlatMap` instance and the entries associated with it.
+void FlatMapFree(FlatMap* const map);
+
+#ifdef __cplusplus
+}
+#endif
+
+#include "flatmap/iterators.h"
+#include "flatmap/ops.h"
+
+#endif  // STLC_INCLUDE_DATA_FLATMAP_FLATMAP_H_
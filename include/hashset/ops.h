@@ -0,0 +1,114 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_INCLUDE_DATA_HASHSET_OPS_H_
+#define STLC_INCLUDE_DATA_HASHSET_OPS_H_
+
+#include "bool.h"
+#include "hashset/hashset.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Adds a copy of the `key_size` bytes of `key` to the set.
+//
+// Returns:
+//  TRUE if the key was added, FALSE if it was already present or could not be
+//  allocated.
+//
+// Thread Safety:
+//  This function holds the write lock of the set.
+bool_t HashSetAdd(HashSet *const set, const void *const key,
+                  const size_t key_size);
+
+// Tests whether the `key_size` bytes of `key` are a member of the set.
+//
+// Thread Safety:
+//  This function only holds the read lock of the set.
+bool_t HashSetContains(HashSet *const set, const void *const key,
+                       const size_t key_size);
+
+// Removes the `key_size` bytes of `key` from the set.
+//
+// Returns:
+//  TRUE if the key was removed, FALSE if it was not present.
+//
+// Thread Safety:
+//  This function holds the write lock of the set.
+bool_t HashSetRemove(HashSet *const set, const void *const key,
+                     const size_t key_size);
+
+// Adds every key of `a` and of `b` to `out`.
+//
+// Returns:
+//  The number of keys added to `out`.
+//
+// Remarks:
+//  `out` is grown once for the keys of the larger set before they are added,
+//  then the keys of the smaller one are added or found by a single probe each.
+//  `out` must be a different set than `a` and `b`, which may be the same set.
+//  When the sets hash keys the same way the hashes stored in the entries are
+//  reused instead of hashing every key again.
+//
+// Thread Safety:
+//  The read locks of `a` and `b` and the write lock of `out` are held for the
+//  whole call.  They are taken in address order, so set operations running
+//  concurrently in any direction do not deadlock.
+size_t HashSetUnion(HashSet *const out, HashSet *const a, HashSet *const b);
+
+// Adds the keys present in both `a` and `b` to `out`.
+//
+// Returns:
+//  The number of keys added to `out`.
+//
+// Remarks:
+//  The smaller of `a` and `b` is walked and every one of its keys is probed in
+//  the larger one, so the cost is bounded by the size of the smaller set.  The
+//  other remarks of `HashSetUnion()` apply.
+size_t HashSetIntersection(HashSet *const out, HashSet *const a,
+                           HashSet *const b);
+
+// Adds the keys of `a` that are not present in `b` to `out`.
+//
+// Returns:
+//  The number of keys added to `out`.
+//
+// Remarks:
+//  Every key of the result comes from `a`, so `a` is walked and its keys are
+//  probed in `b`; the probes are skipped altogether when `b` is empty.  The
+//  other remarks of `HashSetUnion()` apply.
+size_t HashSetDifference(HashSet *const out, HashSet *const a,
+                         HashSet *const b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // STLC_INCLUDE_DATA_HASHSET_OPS_H_
@@ -0,0 +1,165 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_INCLUDE_DATA_INTMAP_INTMAP_H_
+#define STLC_INCLUDE_DATA_INTMAP_INTMAP_H_
+
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "bool.h"
+#include "map/map.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define INTMAP_MIN_CAPACITY 0x10
+
+// The table grows once it is more than `INTMAP_MAX_LOAD_NUMERATOR /
+// INTMAP_MAX_LOAD_DENOMINATOR` full.  Plain linear probing degrades faster
+// than Robin Hood hashing as the table fills up so we stop at 3/4.
+#define INTMAP_MAX_LOAD_NUMERATOR 0x3
+#define INTMAP_MAX_LOAD_DENOMINATOR 0x4
+
+// The key value reserved to mark a slot of the table as empty.
+//
+// The key itself can still be stored in an `IntMap`; its value lives outside
+// the slot array in `IntMap::empty_value`.
+#define INTMAP_EMPTY_KEY UINT64_MAX
+
+// Function signature for the callback `IntMapUpsert()` uses to fold `update`
+// into the `value` already stored for a key.  Returns the merged value.
+typedef uint64_t (*intmap_merge_f)(const uint64_t value, const uint64_t update);
+
+// A single slot of the open-addressed `IntMap` table.
+//
+// Both the key and the value are stored inline, so the table needs no
+// allocation per entry and a probe touches a single 16 byte slot:
+//
+//       +~~~~~~~~~~~~~+~~~~~~~~~~~~~+~~~~~~~~~~~~~+~~~~~~~~~~~~~+
+//       ! key | value ! key | value ! key | value ! key | value !
+//       +~~~~~~~~~~~~~+~~~~~~~~~~~~~+~~~~~~~~~~~~~+~~~~~~~~~~~~~+
+//
+// A slot whose `key` is `INTMAP_EMPTY_KEY` is empty.
+typedef struct IntMapSlot {
+  uint64_t key;
+  uint64_t value;
+} IntMapSlot;
+
+// The `IntMap` structure is a `uint64_t` to `uint64_t` hash table using linear
+// probing and backward-shift deletion.  Pointers can be stored as values by
+// casting them through `uintptr_t`.
+//
+// Attributes:
+//  slots         - a contiguous array of `capacity` slots.
+//  capacity      - the number of slots, always a power of two.
+//  size          - the number of entries, including the one stored under
+//                  `INTMAP_EMPTY_KEY`.
+//  has_empty_key - whether `INTMAP_EMPTY_KEY` is present in the map.
+//  empty_value   - the value associated with `INTMAP_EMPTY_KEY`.
+//  mutex         - a mutex used to synchronize access to the table in a
+//                  multi-threaded context.
+typedef struct IntMap {
+  IntMapSlot* slots;
+  size_t capacity;
+  size_t size;
+  bool_t has_empty_key;
+  uint64_t empty_value;
+  pthread_mutex_t mutex;
+} IntMap;
+
+// Computes the home slot index of `key` inside `map`.
+//
+// Integer keys are mixed with the 64-bit finalizer of MurmurHash3 so that
+// sequential or strided keys spread over the whole table.
+//
+// This macro is meant to be protected inside `intmap` module.
+#define _INTMAP_HOME_SLOT(map, key) \
+  (MapMixHash((hash_t)(key)) & ((map)->capacity - 1))
+
+// Places `key` and `value` into the slot array of `map`.  The key must not
+// already be present in `map` and must not be `INTMAP_EMPTY_KEY`.
+//
+// Returns:
+//  A pointer to the slot the entry was placed into.
+//
+// This function is meant to be protected inside `intmap` module.
+IntMapSlot* _IntMapPlace(IntMap* const map, const uint64_t key,
+                         const uint64_t value);
+
+// Grows the slot array of `map` so that `count` entries fit without exceeding
+// the maximum load factor.  The map mutex must be held.
+//
+// Returns:
+//  `FALSE` if the slot array had to grow but could not be allocated.
+//
+// This function is meant to be protected inside `intmap` module.
+bool_t _IntMapReserveLocked(IntMap* const map, const size_t count);
+
+// Initializes a new instance of the `IntMap` data structure.
+//
+// Params:
+//  map      - A pointer to the `IntMap` to be initialized.
+//  capacity - The minimum number of slots to allocate; it is rounded up to the
+//             next power of two and to at least `INTMAP_MIN_CAPACITY`.
+//
+// Remarks:
+//  If the pointer passed to `map` is NULL, this function returns immediately
+//  without doing anything.  On allocation failure `map->slots` is left NULL.
+void IntMapInit(IntMap* const map, const size_t capacity);
+
+// Re-allocates the slot array of an `IntMap` to hold `new_capacity` slots
+// (rounded up to a power of two), re-inserting all the entries.
+//
+// Remarks:
+//  The request is ignored if `new_capacity` slots cannot hold the current
+//  entries under the maximum load factor.  This function acquires the map
+//  mutex.
+void IntMapRealloc(IntMap* const map, const size_t new_capacity);
+
+// Grows the slot array of an `IntMap` so that `count` entries fit without
+// exceeding the maximum load factor.  The table never shrinks.
+//
+// Remarks:
+//  This function acquires the map mutex.
+void IntMapReserve(IntMap* const map, const size_t count);
+
+// Frees up an `IntMap` instance.
+void IntMapFree(IntMap* const map);
+
+#ifdef __cplusplus
+}
+#endif
+
+#include "intmap/iterators.h"
+#include "intmap/ops.h"
+
+#endif  // STLC_INCLUDE_DATA_INTMAP_INTMAP_H_
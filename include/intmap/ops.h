@@ -0,0 +1,176 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_INCLUDE_DATA_INTMAP_OPS_H_
+#define STLC_INCLUDE_DATA_INTMAP_OPS_H_
+
+#include <stdint.h>
+
+#include "bool.h"
+#include "intmap/intmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The number of keys the batched operations hash and prefetch ahead of
+// probing them.
+#define INTMAP_BATCH_WIDTH 0x10
+
+// Insert a new key-value pair into the integer map.
+//
+// Args:
+//  map   - A pointer to the map to insert the key-value pair into.
+//  key   - The key to insert.
+//  value - The value to insert.
+//
+// Remarks:
+//  If a key already exists in the map, its value will be replaced with the new
+//  value.  Nothing is allocated per entry; the slot array doubles once the
+//  maximum load factor would be exceeded.
+//
+// Thread Safety:
+//  This function locks the mutex associated with the map.
+void IntMapInsert(IntMap *const map, const uint64_t key, const uint64_t value);
+
+// Retrieve the value associated with the given key in the integer map.
+//
+// Args:
+//  map   - A pointer to the map.
+//  key   - The key to look up.
+//  value - Receives the value associated with `key` if it is found; may be
+//          NULL to only test for presence.
+//
+// Returns:
+//  TRUE if the key is present in the map, FALSE otherwise.
+//
+// Thread Safety:
+//  This function locks the mutex associated with the map.
+bool_t IntMapGet(IntMap *const map, const uint64_t key, uint64_t *const value);
+
+// Remove an entry from the integer map with the given key.
+//
+// Effects:
+//  * Removes an entry from the map with the given key, if it exists.
+//  * Shifts the following entries of the cluster back so no tombstones are
+//    left behind.
+void IntMapRemove(IntMap *const map, const uint64_t key);
+
+// Looks `n` keys up at once.
+//
+// Params:
+//  map        - A pointer to the map.
+//  keys       - An array of the `n` keys to look up.
+//  n          - The number of keys.
+//  out_values - An array of `n` values receiving the value of every key found;
+//               the entries of missing keys are left untouched.  May be NULL.
+//  out_found  - An array of `n` flags set to TRUE for the keys present in the
+//               map, or NULL if only the count is of interest.
+//
+// Returns:
+//  The number of keys present in the map.
+//
+// Remarks:
+//  The keys are processed in batches of `INTMAP_BATCH_WIDTH`: every key of a
+//  batch is hashed and its home slot prefetched before any of them is probed.
+//
+// Thread Safety:
+//  The mutex of the map is held for one batch at a time.
+size_t IntMapGetMany(IntMap *const map, const uint64_t *const keys,
+                     const size_t n, uint64_t *const out_values,
+                     bool_t *const out_found);
+
+// Tests the presence of `n` keys at once like `IntMapGetMany()`.
+//
+// Returns:
+//  The number of keys present in the map.
+size_t IntMapContainsMany(IntMap *const map, const uint64_t *const keys,
+                          const size_t n, bool_t *const out_found);
+
+// Inserts `n` key-value pairs at once, overwriting the values of the keys that
+// are already present like `IntMapInsert()`.
+//
+// Returns:
+//  The number of new entries added to the map.
+//
+// Remarks:
+//  The slot array is grown once, as by `IntMapReserve()`, for `n` more entries
+//  so the load never triggers an intermediate resize.  The home slots of every
+//  `INTMAP_BATCH_WIDTH` keys are prefetched before they are inserted.
+//
+// Thread Safety:
+//  This function locks the mutex of the map once for the whole call.
+size_t IntMapInsertMany(IntMap *const map, const uint64_t *const keys,
+                        const uint64_t *const values, const size_t n);
+
+// Returns the value of `key`, inserting `value` for it first if the key is not
+// present.  The key is hashed and probed only once.
+//
+// Params:
+//  map      - A pointer to the map.
+//  key      - The key.
+//  value    - The value to insert if the key is not present.
+//  inserted - Set to TRUE if the value was inserted, FALSE if the key was
+//             already present; may be NULL.
+//
+// Returns:
+//  A pointer to the value stored in the map, which may be written through in
+//  place, or NULL on failure.  It stays valid until the next insertion or
+//  removal, either of which may move the entry.
+//
+// Thread Safety:
+//  This function locks the mutex of the map while it looks the key up.
+//  Accesses through the returned pointer happen outside of it.
+uint64_t *IntMapGetOrInsert(IntMap *const map, const uint64_t key,
+                            const uint64_t value, bool_t *const inserted);
+
+// Inserts `value` for `key`, or folds it into the value already stored for it
+// with `merge`.  The key is hashed and probed only once.
+//
+// Params:
+//  map   - A pointer to the map.
+//  key   - The key.
+//  value - The value to insert or merge.
+//  merge - The callback folding `value` into the stored value.  When NULL the
+//          stored value is overwritten like `IntMapInsert()` does.
+//
+// Returns:
+//  The value stored for `key` once the call returns.
+//
+// Thread Safety:
+//  This function locks the mutex of the map, including while `merge` runs, so
+//  `merge` must not call back into the map.
+uint64_t IntMapUpsert(IntMap *const map, const uint64_t key,
+                      const uint64_t value, intmap_merge_f merge);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // STLC_INCLUDE_DATA_INTMAP_OPS_H_
@@ -0,0 +1,62 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_INCLUDE_DATA_LRUCACHE_ITERATORS_H_
+#define STLC_INCLUDE_DATA_LRUCACHE_ITERATORS_H_
+
+#include "bool.h"
+#include "lrucache/lrucache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Traverses the cache from the most recently used entry to the least recently
+// used one and calls the given predicate function on each entry.
+//
+// Params:
+//  cache     - A pointer to the cache to traverse.
+//  predicate - A function pointer to the predicate function to call on each
+//              key and value.  Traversal stops as soon as it returns `FALSE`.
+//
+// Remarks:
+//  The function holds the read lock of the cache for the whole traversal and
+//  does not count as a hit, so the recency order is left as is.  `predicate`
+//  must not put or remove any key.  For a CLOCK cache the order is the order
+//  of insertion, with the entries that were given a second chance moved to
+//  the front.
+void LruCacheTraverse(LruCache *const cache,
+                      bool_t (*predicate)(const void *key,
+                                          const void *value));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // STLC_INCLUDE_DATA_LRUCACHE_ITERATORS_H_
@@ -0,0 +1,266 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_INCLUDE_DATA_LRUCACHE_LRUCACHE_H_
+#define STLC_INCLUDE_DATA_LRUCACHE_LRUCACHE_H_
+
+#include <sys/types.h>
+
+#include "bool.h"
+#include "map/map.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// What the capacity of an `LruCache` counts.
+//
+//  LRUCACHE_LIMIT_COUNT - the number of entries.
+//  LRUCACHE_LIMIT_BYTES - the bytes of the keys and values, excluding the
+//                         entry headers.
+typedef enum LruCacheLimit {
+  LRUCACHE_LIMIT_COUNT,
+  LRUCACHE_LIMIT_BYTES
+} LruCacheLimit;
+
+// How an `LruCache` tracks recency.
+//
+//  LRUCACHE_POLICY_LRU   - every hit moves its entry to the front of the list
+//                          and so takes the write lock.
+//  LRUCACHE_POLICY_CLOCK - a hit only sets the reference bit of its entry
+//                          under the read lock; the bit gives the entry a
+//                          second chance when it reaches the end of the list.
+typedef enum LruCachePolicy {
+  LRUCACHE_POLICY_LRU,
+  LRUCACHE_POLICY_CLOCK
+} LruCachePolicy;
+
+// Function signature for the callback an `LruCache` calls on every entry it
+// evicts to make room, before the entry is released.  It is not called for
+// entries that are overwritten or removed explicitly.
+typedef void (*lrucache_evict_f)(const void* key, const size_t key_size,
+                                 const void* value, const size_t value_size,
+                                 void* context);
+
+// The recency links of an entry, stored at the start of its value bytes so
+// that the map entry and its place in the recency list are one allocation:
+//
+//       +~~~~~~~~~~~~~~~~+~~~~~~~~~~~+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~+
+//       ! MapEntry header ! key bytes ! prev|next|charge|referenced ! value !
+//       +~~~~~~~~~~~~~~~~+~~~~~~~~~~~+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~+
+//
+// Attributes:
+//  prev       - the more recently used entry, or NULL at the front.
+//  next       - the less recently used entry, or NULL at the back.
+//  charge     - what the entry counts against the capacity.
+//  referenced - whether the entry was hit since the CLOCK hand last passed.
+typedef struct LruCacheNode {
+  MapEntry* prev;
+  MapEntry* next;
+  size_t charge;
+  bool_t referenced;
+} LruCacheNode;
+
+// Offset of the cached value from the start of the value bytes of an entry,
+// keeping it aligned to `MAP_ENTRY_ALIGNMENT`.
+#define LRUCACHE_VALUE_OFFSET                            \
+  ((sizeof(LruCacheNode) + MAP_ENTRY_ALIGNMENT - 0x01) & \
+   ~(size_t)(MAP_ENTRY_ALIGNMENT - 0x01))
+
+// Returns the recency links of `entry`.
+//
+// This macro is meant to be protected inside `lrucache` module.
+#define _LRUCACHE_NODE(entry) ((LruCacheNode*)(entry)->value)
+
+// Returns the cached value of `entry`.
+//
+// This macro is meant to be protected inside `lrucache` module.
+#define _LRUCACHE_VALUE(entry) \
+  ((void*)((unsigned char*)(entry)->value + LRUCACHE_VALUE_OFFSET))
+
+// Configuration of an `LruCache`, initialized to the defaults by
+// `LruCacheConfigInit()`.
+//
+// Attributes:
+//  map           - the configuration of the underlying map.
+//  capacity      - the limit the entries are evicted down to.
+//  limit         - what `capacity` counts.  Defaults to
+//                  `LRUCACHE_LIMIT_COUNT`.
+//  policy        - how recency is tracked.  Defaults to `LRUCACHE_POLICY_LRU`.
+//  on_evict      - called on every evicted entry.  Defaults to NULL.
+//  evict_context - passed to `on_evict`.
+typedef struct LruCacheConfig {
+  MapConfig map;
+  size_t capacity;
+  LruCacheLimit limit;
+  LruCachePolicy policy;
+  lrucache_evict_f on_evict;
+  void* evict_context;
+} LruCacheConfig;
+
+// Counters of an `LruCache`.
+//
+// Attributes:
+//  size      - the number of entries.
+//  charge    - what the entries count against the capacity.
+//  capacity  - the capacity.
+//  hits      - the lookups that found their key.
+//  misses    - the lookups that did not.
+//  evictions - the entries evicted to make room.
+typedef struct LruCacheStats {
+  size_t size;
+  size_t charge;
+  size_t capacity;
+  size_t hits;
+  size_t misses;
+  size_t evictions;
+} LruCacheStats;
+
+// The `LruCache` structure is a bounded cache on top of a `Map`.  Every entry
+// carries its recency links inline, so a hit finds the entry and reorders it
+// with a single lookup, and evicting the least recently used entry unlinks it
+// from the list and from its bucket in constant time.  The read-write lock of
+// the map guards the list as well, so the two can never disagree.
+//
+// Attributes:
+//  map       - the map holding the entries.
+//  head      - the most recently used entry.
+//  tail      - the least recently used entry, the next candidate for
+//              eviction.
+//  capacity  - the limit the entries are evicted down to.
+//  charge    - what the entries count against `capacity`.
+//  limit     - what `capacity` counts.
+//  policy    - how recency is tracked.
+//  on_evict, evict_context - the eviction callback and its context.
+//  hits, misses, evictions - counters updated atomically, since hits of a
+//              CLOCK cache only hold the read lock.
+typedef struct LruCache {
+  Map map;
+  MapEntry* head;
+  MapEntry* tail;
+  size_t capacity;
+  size_t charge;
+  LruCacheLimit limit;
+  LruCachePolicy policy;
+  lrucache_evict_f on_evict;
+  void* evict_context;
+  size_t hits;
+  size_t misses;
+  size_t evictions;
+} LruCache;
+
+// Computes what an entry of `key_size` key bytes and `value_size` value bytes
+// counts against the capacity of `cache`.
+//
+// This macro is meant to be protected inside `lrucache` module.
+#define _LRUCACHE_CHARGE(cache, key_size, value_size) \
+  ((cache)->limit == LRUCACHE_LIMIT_BYTES             \
+       ? (size_t)(key_size) + (size_t)(value_size)    \
+       : (size_t)0x01)
+
+// Links `entry` at the front of the recency list of `cache`.  The caller must
+// hold the write lock of `cache`.
+//
+// This function is meant to be protected inside `lrucache` module.
+void _LruCachePushFront(LruCache* const cache, MapEntry* const entry);
+
+// Unlinks `entry` from the recency list of `cache`.  The caller must hold the
+// write lock of `cache`.
+//
+// This function is meant to be protected inside `lrucache` module.
+void _LruCacheUnlink(LruCache* const cache, MapEntry* const entry);
+
+// Unlinks `entry` from the recency list and from the map of `cache` and
+// releases it, calling the eviction callback first if `evicted`.  The caller
+// must hold the write lock of `cache`.
+//
+// This function is meant to be protected inside `lrucache` module.
+void _LruCacheDropLocked(LruCache* const cache, MapEntry* const entry,
+                         const bool_t evicted);
+
+// Evicts entries from the back of the recency list until `incoming` more fits
+// in the capacity of `cache`.  A CLOCK cache moves the referenced entries it
+// meets back to the front, clearing their bit, instead of evicting them.  The
+// caller must hold the write lock of `cache`.
+//
+// This function is meant to be protected inside `lrucache` module.
+void _LruCacheEvictLocked(LruCache* const cache, const size_t incoming);
+
+// Initializes `config` with the defaults: a count-limited LRU cache of
+// `capacity` entries without an eviction callback, whose map hashes with
+// `hash_func` and compares keys with `key_eq_func`.
+void LruCacheConfigInit(LruCacheConfig* const config, const size_t capacity,
+                        hash_f hash_func, key_eq_f key_eq_func);
+
+// Initializes a count-limited LRU cache of `capacity` entries.
+//
+// Params:
+//  cache       - A pointer to the `LruCache` to be initialized.
+//  capacity    - The maximum number of entries.
+//  hash_func   - A pointer to the hash function used to calculate hash codes
+//                for keys.
+//  key_eq_func - A pointer to the key comparison function used to compare keys
+//                for equality.
+//
+// Remarks:
+//  If the pointer passed to `cache` is NULL, this function returns immediately
+//  without doing anything.
+void LruCacheInit(LruCache* const cache, const size_t capacity,
+                  hash_f hash_func, key_eq_f key_eq_func);
+
+// Initializes a new instance of the `LruCache` data structure as described by
+// `config`.  A count-limited cache reserves buckets for `capacity` entries up
+// front so that it never resizes.
+void LruCacheInitWithConfig(LruCache* const cache,
+                            const LruCacheConfig* const config);
+
+// Changes the capacity of `cache`, evicting entries until they fit.
+//
+// Thread Safety:
+//  This function holds the write lock of the cache.
+void LruCacheSetCapacity(LruCache* const cache, const size_t capacity);
+
+// Returns the number of entries of `cache`.
+size_t LruCacheSize(LruCache* const cache);
+
+// Fills `stats` with the counters of `cache`.
+void LruCacheGetStats(LruCache* const cache, LruCacheStats* const stats);
+
+// Frees up an `LruCache` instance and the entries associated with it without
+// calling the eviction callback.
+void LruCacheFree(LruCache* const cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#include "lrucache/iterators.h"
+#include "lrucache/ops.h"
+
+#endif  // STLC_INCLUDE_DATA_LRUCACHE_LRUCACHE_H_
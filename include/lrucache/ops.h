@@ -0,0 +1,106 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_INCLUDE_DATA_LRUCACHE_OPS_H_
+#define STLC_INCLUDE_DATA_LRUCACHE_OPS_H_
+
+#include "bool.h"
+#include "lrucache/lrucache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Caches a copy of the `value_size` bytes of `value` under the `key_size`
+// bytes of `key`, replacing the value cached for the key if any, and evicts
+// the least recently used entries until the cache fits its capacity again.
+//
+// Returns:
+//  TRUE if the value was cached, FALSE if it alone exceeds the capacity or
+//  could not be allocated.
+//
+// Remarks:
+//  The eviction callback runs under the write lock of the cache and must not
+//  call back into it.
+//
+// Thread Safety:
+//  This function holds the write lock of the cache.
+bool_t LruCachePut(LruCache *const cache, const void *const key,
+                   const size_t key_size, const void *const value,
+                   const size_t value_size);
+
+// Looks the `key_size` bytes of `key` up and marks the entry as the most
+// recently used.
+//
+// Returns:
+//  A pointer to the cached value, or NULL on a miss.  `value_size`, if not
+//  NULL, receives the size of the value.  The pointer is only valid until the
+//  entry is evicted, overwritten or removed; use `LruCacheGetCopy()` when
+//  other threads may put keys concurrently.
+//
+// Thread Safety:
+//  A LRU cache holds the write lock to reorder its list; a CLOCK cache only
+//  holds the read lock.
+void *LruCacheGet(LruCache *const cache, const void *const key,
+                  const size_t key_size, size_t *const value_size);
+
+// Looks the `key_size` bytes of `key` up like `LruCacheGet()` and copies up to
+// `out_size` bytes of the value into `out` while the lock is still held.
+//
+// Returns:
+//  TRUE on a hit.  `value_size`, if not NULL, receives the size of the whole
+//  value, which may exceed `out_size`.
+bool_t LruCacheGetCopy(LruCache *const cache, const void *const key,
+                       const size_t key_size, void *const out,
+                       const size_t out_size, size_t *const value_size);
+
+// Tests whether the `key_size` bytes of `key` are cached without counting a
+// hit or a miss and without touching the recency order.
+//
+// Thread Safety:
+//  This function only holds the read lock of the cache.
+bool_t LruCacheContains(LruCache *const cache, const void *const key,
+                        const size_t key_size);
+
+// Removes the entry of the `key_size` bytes of `key` without calling the
+// eviction callback.
+//
+// Returns:
+//  TRUE if an entry was removed, FALSE if the key was not cached.
+//
+// Thread Safety:
+//  This function holds the write lock of the cache.
+bool_t LruCacheRemove(LruCache *const cache, const void *const key,
+                      const size_t key_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // STLC_INCLUDE_DATA_LRUCACHE_OPS_H_
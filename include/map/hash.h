@@ -0,0 +1,69 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_INCLUDE_DATA_MAP_HASH_H_
+#define STLC_INCLUDE_DATA_MAP_HASH_H_
+
+#include <stddef.h>
+
+#include "map/map.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Keys of at least this many bytes are hashed by `HashBytes()` with eight
+// independent accumulators fed 64 bytes at a time, using AVX2 or SSE2 when
+// available.  Shorter keys take the multiply-mix path which consumes 16 bytes
+// per multiply and 48 bytes per loop iteration; it is the faster of the two
+// until the setup of the accumulators is paid off.
+#define HASH_LONG_KEY 0x400
+
+// Hashes the `key_size` bytes of `key` under `seed`.
+//
+// The function belongs to the wyhash family: it reads the key eight bytes at a
+// time and folds them with 64x64->128 bit multiplies.  Changing `seed` changes
+// every hash, so a map seeded with `HashRandomSeed()` can not be flooded with
+// keys that were chosen to collide.  The result only depends on the bytes, the
+// length and the seed, never on the instruction set the library was built for.
+//
+// Its signature matches `hash_seeded_f` so it can be handed to
+// `MapInitSeeded()` together with `KeyCmpN`.
+hash_t HashBytes(const void* const key, const size_t key_size,
+                 const hash_t seed);
+
+// Returns a seed drawn from the system random source, or from the clock and
+// the address space layout when no such source is available.
+hash_t HashRandomSeed(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // STLC_INCLUDE_DATA_MAP_HASH_H_
@@ -30,12 +30,64 @@
 #ifndef STLC_INCLUDE_DATA_MAP_ITERATORS_H_
 #define STLC_INCLUDE_DATA_MAP_ITERATORS_H_
 
+#include <sys/types.h>
+
+#include "bool.h"
 #include "map/map.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Maximum number of buckets `MapIteratorNext()` fetches under one acquisition
+// of the read lock, so that sparse tables do not hold writers off for long.
+#define MAP_ITERATOR_SCAN_STEP 0x100
+
+// Number of entries `MapIteratorNext()` stops fetching at once it buffered
+// them, so that the read lock is taken once per batch rather than per entry.
+#define MAP_ITERATOR_BATCH 0x40
+
+// Number of cursors ahead whose buckets `MapIteratorNext()` prefetches.
+#define MAP_ITERATOR_PREFETCH 0x08
+
+// Minimum number of buckets worth handing to a worker of
+// `MapParallelTraverse()`.
+#define MAP_PARALLEL_MIN_BUCKETS 0x1000
+
+// A cursor over the entries of a `Map` that only takes the read lock while it
+// fetches the next bucket, in the spirit of the Redis `SCAN` command.
+//
+// The cursor walks bucket indices by incrementing their reversed bits, so a
+// cursor taken on one capacity stays meaningful after the table doubled or
+// halved: every entry present during the whole iteration is returned at least
+// once, although entries may be returned more than once across a resize.
+//
+// Attributes:
+//  map      - the map iterated over.
+//  cursor   - the cursor of the next buckets to fetch.
+//  resume   - the cursor of the first buckets whose entries are buffered,
+//             which `MapIteratorCursor()` hands out.
+//  done     - whether the last buckets have been fetched.
+//  entries  - copies of the entries of the buckets fetched last, each one
+//             padded to `MAP_ENTRY_ALIGNMENT`.
+//  size     - the number of bytes of `entries` in use.
+//  offset   - the offset in `entries` of the next copy to return.
+//  count    - the number of buffered entries.
+//  index    - the index of the next buffered entry to return.
+//  capacity - the number of bytes `entries` has room for.
+typedef struct MapIterator {
+  Map *map;
+  size_t cursor;
+  size_t resume;
+  bool_t done;
+  unsigned char *entries;
+  size_t size;
+  size_t offset;
+  size_t count;
+  size_t index;
+  size_t capacity;
+} MapIterator;
+
 // Traverses the entire map and calls the given predicate function on each map
 // element.
 //
@@ -52,11 +104,83 @@ extern "C" {
 //  The number of map elements traversed.
 //
 // Remarks:
-//  The function acquires the map mutex lock before traversing the map to ensure
-//  thread safety. The function does not modify the map or its elements.
+//  The function holds the read lock of the map while traversing it to ensure
+//  thread safety, so `predicate` may look keys up but must not insert or remove
+//  any.  The function does not modify the map or its elements.  During an
+//  incremental resize the entries not migrated yet are visited after the
+//  others.
 void MapTraverse(Map *const map,
                  bool_t (*predicate)(const void *key, const void *value));
 
+// Traverses the entire map like `MapTraverse()` and calls `predicate` on each
+// entry, exposing the sizes of its key and value and the hash it is stored
+// under, for example to persist them along with the key.
+//
+// Remarks:
+//  The same locking rules as for `MapTraverse()` apply.  `predicate` must not
+//  modify the entry.
+void MapTraverseEntries(Map *const map,
+                        bool_t (*predicate)(const MapEntry *entry));
+
+// Creates an iterator over `map` starting at `cursor`, which is `0` to start
+// from the beginning or a value returned by `MapIteratorCursor()` to resume an
+// earlier iteration.
+//
+// Returns:
+//  The iterator which must be released with `MapIteratorFree()`, or NULL on
+//  allocation failure.
+MapIterator *MapIteratorNew(Map *const map, const size_t cursor);
+
+// Returns the next entry of the iteration, or NULL once every bucket has been
+// visited.
+//
+// Remarks:
+//  The read lock of the map is only held while the next non-empty buckets are
+//  fetched, so writers may run between two calls.  The entries of the fetched
+//  buckets are copied while the lock is held, so the returned entry is a
+//  snapshot owned by the iterator that stays valid until the next call to
+//  `MapIteratorNext()` or `MapIteratorFree()`, whatever writers do meanwhile.
+const MapEntry *MapIteratorNext(MapIterator *const iterator);
+
+// Returns the cursor to hand to `MapIteratorNew()` to resume the iteration
+// later, possibly after the map was resized, or `0` once it is over.  Entries
+// returned since the buckets in flight were fetched may be returned again.
+size_t MapIteratorCursor(const MapIterator *const iterator);
+
+// Frees up an iterator created by `MapIteratorNew()`.
+void MapIteratorFree(MapIterator *const iterator);
+
+// Traverses the entire map like `MapTraverse()`, splitting the bucket range
+// across `workers` threads that call `predicate` concurrently.
+//
+// Params:
+//  map       - A pointer to the map to traverse.
+//  workers   - The number of threads to use, or `0` to use one per online
+//              processor.  Fewer are used when the map has less than
+//              `MAP_PARALLEL_MIN_BUCKETS` buckets per thread.
+//  predicate - The function called on every entry.  It must be safe to call
+//              from several threads at once.  Returning FALSE stops every
+//              worker as soon as it notices.
+//
+// Remarks:
+//  The calling thread holds the read lock of the map on behalf of the workers
+//  for the whole traversal, so `predicate` may look keys up but must not insert
+//  or remove any.
+void MapParallelTraverse(Map *const map, size_t workers,
+                         bool_t (*predicate)(const void *key,
+                                             const void *value));
+
+// Traverses `map` like `MapTraverse()` under its read lock.
+//
+// Returns:
+//  FALSE if `predicate` stopped the traversal, TRUE otherwise.
+//
+// This function is meant to be protected inside `map` and `shardedmap`
+// modules.
+bool_t _MapTraverseUntil(Map *const map,
+                         bool_t (*predicate)(const void *key,
+                                             const void *value));
+
 #ifdef __cplusplus
 }
 #endif
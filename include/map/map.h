@@ -30,16 +30,40 @@
 #ifndef STLC_INCLUDE_DATA_MAP_MAP_H_
 #define STLC_INCLUDE_DATA_MAP_MAP_H_
 
+#include <pthread.h>
+#include <stddef.h>
 #include <sys/types.h>
 
 #include "bool.h"
+#include "map/slab.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Bucket counts are powers of two inside these bounds.  The upper bound is
+// the largest bucket count whose array is still addressable; use
+// `MapConfig::max_capacity` to cap the growth of a map below it.
 #define MAP_MIN_CAPACITY 0x20
-#define MAP_MAX_CAPACITY 0xF4240
+#define MAP_MAX_CAPACITY ((size_t)0x01 << (sizeof(size_t) * 0x08 - 0x04))
+
+// Bucket arrays of at least this many bytes are mapped with `mmap()` and
+// `MAP_NORESERVE` where available, so that a huge table neither needs one
+// contiguous heap block nor commits memory for buckets that are never
+// touched.
+#define MAP_BUCKETS_MMAP_THRESHOLD 0x200000
+
+// Default growth policy.  The table doubles once it holds more entries than
+// `max_load_factor` times its bucket count and halves (at least) once it holds
+// fewer than `min_load_factor` times its bucket count.
+#define MAP_DEFAULT_MAX_LOAD_FACTOR 1.0
+#define MAP_DEFAULT_MIN_LOAD_FACTOR 0.125
+
+// Number of buckets of the old table migrated by every operation while an
+// incremental resize is in flight.  A grown table takes as many inserts as the
+// old one had buckets before it is due to grow again, so one bucket per insert
+// would do; sixteen keep a wide margin and also cover shrinking.
+#define MAP_REHASH_STEP 0x10
 
 // Custom type to represent hash data.
 typedef size_t hash_t;
@@ -60,8 +84,41 @@ typedef hash_t (*hash_f)(const void* key);
 // pair inside the `Map`.
 typedef bool_t (*key_eq_f)(const void* key1, const void* key2);
 
+// Function signature for a hash function that is told the length of the `key`.
+//
+// Unlike `hash_f` this never has to scan the key for a terminator, so keys may
+// be arbitrary bytes such as UUIDs or packed structs.
+typedef hash_t (*hash_n_f)(const void* key, const size_t key_size);
+
+// Function signature for a key comparison function that is told the length of
+// both keys.
+typedef bool_t (*key_eq_n_f)(const void* key1, const size_t key1_size,
+                             const void* key2, const size_t key2_size);
+
+// Function signature for a sized hash function that is also keyed by a
+// per-map `seed`, such as `HashBytes`.
+typedef hash_t (*hash_seeded_f)(const void* key, const size_t key_size,
+                                const hash_t seed);
+
+// Function signature for the callback `MapUpsert()` uses to fold `update` of
+// `update_size` bytes into the `value_size` bytes of the value already stored
+// for a key, in place.
+typedef void (*value_merge_f)(void* value, const size_t value_size,
+                              const void* update, const size_t update_size);
+
 // Creates a Map entry inside of a bucket.  This map entry is later extended in
 // case the `LoadFactor` exceeds by `1` due to collision.
+//
+// Entries owned by a `Map` are created with `MapEntryNew()` as a single
+// allocation: `key` and `value` point into the trailing `data` buffer which
+// holds the key bytes followed by the value bytes:
+//
+//       +~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~+
+//       ! key|value|hash|next|sizes ! key bytes | value bytes !
+//       +~~+~~~~+~~~~~~~~~~~~~~~~~~~+~~~~~~~~~~~+~~~~~~~~~~~~~+
+//          |    |                   ^           ^
+//          +~~~~|~~~~~~~~~~~~~~~~~~~+           |
+//               +~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~+
 typedef struct MapEntry {
   void* key;
   void* value;
@@ -74,8 +131,30 @@ typedef struct MapEntry {
   //       ! key|value|hash|next+~~~~> + key|value|hash|next+~~~> NULL
   //       +~~~~~~~~~~~~~~~~~~~~+      +~~~~~~~~~~~~~~~~~~~~+
   struct MapEntry* next;
+
+  size_t key_size;
+  size_t value_size;
+  // Number of bytes reserved for the value inside `data`.  A new value that
+  // fits is copied over the old one in place.  Invariant:
+  //     value_size <= value_capacity
+  size_t value_capacity;
+
+  unsigned char data[];
 } MapEntry;
 
+// Alignment of the value bytes inside a `MapEntry`, at least as strict as the
+// alignment of memory returned by `malloc()`.
+#define MAP_ENTRY_ALIGNMENT 0x10
+
+// Offset of the value bytes inside `MapEntry::data`.  The key bytes are padded
+// so the value is aligned to `MAP_ENTRY_ALIGNMENT`.
+//
+// This macro is meant to be protected inside `map` module.
+#define _MAP_ENTRY_VALUE_OFFSET(key_size)                             \
+  (((offsetof(MapEntry, data) + (key_size) + MAP_ENTRY_ALIGNMENT - 1) & \
+    ~(size_t)(MAP_ENTRY_ALIGNMENT - 1)) -                               \
+   offsetof(MapEntry, data))
+
 // Initializes a MapEntry with the specified key, key size, value, value size,
 // hash, and next MapEntry.
 //
@@ -87,10 +166,33 @@ typedef struct MapEntry {
 //  value_size - The size of the value.
 //  hash       - The hash value for the key.
 //  next       - A pointer to the next MapEntry in the map.
+//
+// Remarks:
+//  The key and the value are copied into two separate allocations that the
+//  caller owns.  Entries stored inside a `Map` are created with `MapEntryNew()`
+//  instead.
 void MapEntryInit(MapEntry* map_entry, const void* key, const size_t key_size,
                   const void* value, const size_t value_size, const hash_t hash,
                   MapEntry* const next);
 
+// Allocates a MapEntry holding copies of the key and the value in a single
+// block.
+//
+// Params:
+//  key        - A pointer to the key.
+//  key_size   - The size of the key.
+//  value      - A pointer to the value.
+//  value_size - The size of the value.
+//  hash       - The hash value for the key.
+//  next       - A pointer to the next MapEntry in the map.
+//
+// Returns:
+//  The new entry which must be released with a single `free()`, or NULL if
+//  `key` or `value` is NULL or the allocation failed.
+MapEntry* MapEntryNew(const void* key, const size_t key_size,
+                      const void* value, const size_t value_size,
+                      const hash_t hash, MapEntry* const next);
+
 // The Map structure represents a hash table that associates keys with values.
 // It contains the following fields:
 //
@@ -99,29 +201,247 @@ void MapEntryInit(MapEntry* map_entry, const void* key, const size_t key_size,
 //                values for keys.
 //  key_eq_func - a function pointer to the key equality function used to
 //                compare keys for equality.
+//  hash_n_func, key_eq_n_func - the sized callbacks, see `MapConfig`; when set
+//                they are used instead of `hash_func` and `key_eq_func`.
+//  hash_seeded_func - the seeded hash function, see `MapConfig`; when set it
+//                is used instead of every other hash function.
+//  seed        - the seed handed to `hash_seeded_func`.
 //  buckets     - a pointer to an array of MapEntry pointers, which represent
 //                the entries stored in the hash table.
-//  capacity    - the maximum number of MapEntry pointers that can be stored in
-//                buckets.
+//  capacity    - the number of buckets, always a power of two.
 //  size        - the number of MapEntry pointers currently stored in buckets.
-//  mutex       - a mutex used to synchronize access to the hash table in a
-//                multi-threaded context.
+//  slab        - the pool entries are allocated from, or NULL if entries are
+//                allocated with `malloc()`.
+//  incremental_rehash - whether `MapRealloc()` migrates the entries gradually,
+//                see `MapConfig`.
+//  old_buckets - the bucket array being migrated from during an incremental
+//                resize, or NULL when no resize is in flight.
+//  old_capacity - the number of buckets of `old_buckets`.
+//  rehash_index - the index of the next bucket of `old_buckets` to migrate;
+//                every bucket below it is empty.
+//  max_load_factor, min_load_factor - the growth policy, see `MapConfig`.
+//  min_capacity - the bucket count the map was created with; it never shrinks
+//                below it.
+//  max_capacity - the bucket count the map never grows beyond.
+//  grow_at     - the size above which an insert grows the table.
+//  shrink_at   - the size below which a remove shrinks the table.
+//  lock        - a reader/writer lock used to synchronize access to the hash
+//                table in a multi-threaded context.  Lookups and traversals
+//                share it; inserts, removes and resizes hold it exclusively.
 typedef struct Map {
   hash_f hash_func;
   key_eq_f key_eq_func;
+  hash_n_f hash_n_func;
+  key_eq_n_f key_eq_n_func;
+  hash_seeded_f hash_seeded_func;
+  hash_t seed;
   MapEntry** buckets;
   size_t capacity;
   size_t size;
-  pthread_mutex_t mutex;
+  MapSlab* slab;
+  bool_t incremental_rehash;
+  MapEntry** old_buckets;
+  size_t old_capacity;
+  size_t rehash_index;
+  double max_load_factor;
+  double min_load_factor;
+  size_t min_capacity;
+  size_t max_capacity;
+  size_t grow_at;
+  size_t shrink_at;
+  pthread_rwlock_t lock;
 } Map;
 
+// Options a `Map` is created with by `MapInitWithConfig()`.  Always start from
+// `MapConfigInit()` so options added later keep their defaults.
+//
+// Attributes:
+//  capacity    - the number of buckets to allocate, rounded up to a power of
+//                two.
+//  hash_func   - the hash function used to calculate hash codes for keys.
+//  key_eq_func - the key comparison function used to compare keys for
+//                equality.
+//  hash_n_func, key_eq_n_func - length-aware callbacks that take precedence
+//                over `hash_func` and `key_eq_func` when both are set; they
+//                receive the `key_size` given to the `*N` operations.  Defaults
+//                to NULL.
+//  hash_seeded_func - a sized hash function keyed by `seed`; it is paired
+//                with `key_eq_n_func` and takes precedence over the other hash
+//                functions.  Defaults to NULL.
+//  seed        - the seed for `hash_seeded_func`, or `0` to draw a random one
+//                with `HashRandomSeed()` so that colliding keys can not be
+//                precomputed.  Defaults to `0`.
+//  use_slab    - carve entries out of a per-map `MapSlab` instead of calling
+//                `malloc()` for each of them.  Removed entries are recycled and
+//                `MapFree()` releases the whole pool page by page.  Defaults to
+//                `FALSE`.
+//  incremental_rehash - keep the old and the new bucket arrays alive on resize
+//                and migrate `MAP_REHASH_STEP` buckets on every following
+//                operation instead of rehashing every entry at once.  Lookups
+//                check both arrays until the migration is over.  Defaults to
+//                `FALSE`.
+//  max_load_factor - the average number of entries per bucket above which an
+//                insert doubles the table.  Must be positive.  Defaults to
+//                `MAP_DEFAULT_MAX_LOAD_FACTOR`.
+//  min_load_factor - the average number of entries per bucket below which a
+//                remove shrinks the table back to `max_load_factor / 2`, never
+//                below the initial capacity.  Must be below half of
+//                `max_load_factor` so a resize can not be undone by the next
+//                operation; `0` disables shrinking.  Defaults to
+//                `MAP_DEFAULT_MIN_LOAD_FACTOR`.
+//  max_capacity - the bucket count the table stops growing at; inserts past
+//                it only lengthen the chains.  Rounded up to a power of two.
+//                Defaults to `MAP_MAX_CAPACITY`.
+typedef struct MapConfig {
+  size_t capacity;
+  hash_f hash_func;
+  key_eq_f key_eq_func;
+  hash_n_f hash_n_func;
+  key_eq_n_f key_eq_n_func;
+  hash_seeded_f hash_seeded_func;
+  hash_t seed;
+  bool_t use_slab;
+  bool_t incremental_rehash;
+  double max_load_factor;
+  double min_load_factor;
+  size_t max_capacity;
+} MapConfig;
+
+// Fills `config` with the given capacity and callbacks and the default value
+// of every other option.
+void MapConfigInit(MapConfig* const config, const size_t capacity,
+                   hash_f hash_func, key_eq_f key_eq_func);
+
+// Initializes a new instance of the Map data structure as described by
+// `config`.
+//
+// Remarks:
+//  This function behaves like `MapInit()` for the capacity and the callbacks.
+//  If either pointer is NULL, this function returns immediately without doing
+//  anything.
+void MapInitWithConfig(Map* const map, const MapConfig* const config);
+
+// Copies the allocation statistics of the slab of `map` into `stats`.
+//
+// Returns:
+//  TRUE on success, or FALSE if `map` was not created with `use_slab`.
+bool_t MapGetSlabStats(Map* const map, MapSlabStats* const stats);
+
+// Allocates an entry for `map` the way `MapEntryNew()` does, taking the memory
+// from the slab of `map` when it has one.  `value` may be NULL to reserve
+// `value_size` uninitialized bytes for the value.
+//
+// This function is meant to be protected inside `map` module.
+MapEntry* _MapEntryAlloc(Map* const map, const void* key,
+                         const size_t key_size, const void* value,
+                         const size_t value_size, const hash_t hash,
+                         MapEntry* const next);
+
+// Grows `entry` so that it can hold a value of `value_size` bytes.  The key
+// and the chain link are preserved; the value bytes are not.
+//
+// Returns:
+//  The entry which may have moved, or NULL on allocation failure in which case
+//  `entry` is left untouched.
+//
+// This function is meant to be protected inside `map` module.
+MapEntry* _MapEntryGrow(Map* const map, MapEntry* const entry,
+                        const size_t value_size);
+
+// Releases an entry allocated by `_MapEntryAlloc()`.
+//
+// This function is meant to be protected inside `map` module.
+void _MapEntryRelease(Map* const map, MapEntry* const entry);
+
+// Computes the bucket index of `hash` in a bucket array of `capacity` buckets.
+// `capacity` is a power of two, so the mixed hash is masked rather than taken
+// modulo.
+//
+// This macro is meant to be protected inside `map` module.
+#define _MAP_BUCKET_INDEX(hash, capacity) \
+  (MapMixHash(hash) & ((capacity) - 1))
+
+// Allocates a zeroed array of `capacity` bucket pointers, mapping it lazily
+// when it spans at least `MAP_BUCKETS_MMAP_THRESHOLD` bytes.
+//
+// Returns:
+//  The bucket array which must be released with `_MapBucketsFree()`, or NULL
+//  on failure.
+//
+// This function is meant to be protected inside `map` module.
+MapEntry** _MapBucketsAlloc(const size_t capacity);
+
+// Releases a bucket array of `capacity` buckets allocated by
+// `_MapBucketsAlloc()`.
+//
+// This function is meant to be protected inside `map` module.
+void _MapBucketsFree(MapEntry** const buckets, const size_t capacity);
+
+// Swaps in a new bucket array of `capacity` buckets, a power of two, and
+// migrates the entries into it at once or, with `incremental_rehash`, leaves
+// the migration to the following writes.  The caller must hold the write
+// lock of `map`.
+//
+// This function is meant to be protected inside `map` module.
+void _MapReallocLocked(Map* const map, const size_t capacity);
+
+// Applies the growth policy of `map` after an insert or a remove: doubles the
+// table once `size` went above `grow_at` and shrinks it back to half of the
+// maximum load factor once `size` went below `shrink_at`.  Does nothing while
+// an incremental resize is in flight.  The caller must hold the write lock
+// of `map`.
+//
+// This function is meant to be protected inside `map` module.
+void _MapResizeIfNeeded(Map* const map);
+
+// Migrates up to `buckets` buckets of an in-flight incremental resize and
+// releases the old bucket array once it is empty.  Does nothing when no resize
+// is in flight.  The caller must hold the write lock of `map`.
+//
+// This function is meant to be protected inside `map`, `hashset`,
+// `lrucache` and `expiringmap` modules.
+void _MapRehashStep(Map* const map, size_t buckets);
+
+// Hashes the `key_size` bytes of `key` with the seeded hash function of
+// `map`, its sized one or its unsized one, whichever it was created with.
+//
+// This function is meant to be protected inside `map`, `shardedmap`,
+// `hashset`, `lrucache` and `expiringmap` modules.
+hash_t _MapHashKey(const Map* const map, const void* key,
+                   const size_t key_size);
+
+// Returns the link pointing to the entry of `key` with hash `hash`, looking in
+// both bucket arrays during an incremental resize, or NULL if `key` is not
+// present.  Storing `(*link)->next` into `*link` unlinks the entry.  The
+// caller must hold the lock of `map`, for writing if it modifies the chain.
+//
+// This function is meant to be protected inside `map`, `hashset`,
+// `lrucache` and `expiringmap` modules.
+MapEntry** _MapFindLink(Map* const map, const void* key, const size_t key_size,
+                        const hash_t hash);
+
+// Grows the bucket array of `map` like `MapReserve()`.  The caller must hold
+// the write lock of `map`.
+//
+// This function is meant to be protected inside `map` and `hashset` modules.
+void _MapReserveLocked(Map* const map, const size_t count);
+
+// Reserves slab memory for `n` entries whose key and value sizes are given by
+// `key_sizes` and `value_sizes`, so that every class is served from a single
+// allocation while they are inserted.  Does nothing when `map` has no slab.
+// The caller must hold the write lock of `map`.
+//
+// This function is meant to be protected inside `map` module.
+void _MapReserveEntries(Map* const map, const size_t* key_sizes,
+                        const size_t* value_sizes, const size_t n);
+
 // Initializes a new instance of the Map data structure with the specified
 // capacity and hash and key comparison functions.
 //
 // Params:
 //  map         - A pointer to the Map data structure to be initialized.
 //  capacity    - The capacity of the Map, which is the number of buckets to
-//                allocate.
+//                allocate.  It is rounded up to the next power of two.
 //  hash_func   - A pointer to the hash function used to calculate hash codes
 //                for keys.
 //  key_eq_func - A pointer to the key comparison function used to compare keys
@@ -142,27 +462,71 @@ typedef struct Map {
 void MapInit(Map* const map, const size_t capacity, hash_f hash_func,
              key_eq_f key_eq_func);
 
+// Initializes a new instance of the Map data structure whose keys are hashed
+// and compared by the length-aware `hash_n_func` and `key_eq_n_func`, for
+// example `HashN` and `KeyCmpN`.
+//
+// Remarks:
+//  This function behaves like `MapInit()` otherwise.  Use `MapInsertN()`,
+//  `MapGetN()` and `MapRemoveN()` to pass the length of every key.
+void MapInitN(Map* const map, const size_t capacity, hash_n_f hash_n_func,
+              key_eq_n_f key_eq_n_func);
+
+// Initializes a new instance of the Map data structure whose keys are hashed
+// by `hash_seeded_func` under a random per-map seed and compared by
+// `key_eq_n_func`, for example `HashBytes` and `KeyCmpN`.
+//
+// Remarks:
+//  This function behaves like `MapInitN()` otherwise.
+void MapInitSeeded(Map* const map, const size_t capacity,
+                   hash_seeded_f hash_seeded_func, key_eq_n_f key_eq_n_func);
+
+// Returns the hash `map` uses for the `key_size` bytes of `key`, to be handed
+// to the `*WithHash` operations.
+//
+// Remarks:
+//  The hash can be reused with every map hashing keys the same way, that is
+//  maps created with the same hash function and, for seeded hash functions,
+//  the same `MapConfig::seed`.  Persisted hashes stay valid across reloads
+//  only under that condition; maps drawing a random seed hash differently
+//  every time.
+hash_t MapHashKey(const Map* const map, const void* key,
+                  const size_t key_size);
+
 // Re-allocates a `Map` instance with the specified capacity inside the default
 // capacity constraints, rehashing all the entries.
 //
 // Params:
 //  map          - A pointer to the `Map` data structure to be re-allocated.
 //  new_capacity - The new capacity of the `Map`, which is the number of buckets
-//                 to allocate.
+//                 to allocate.  It is rounded up to the next power of two.
 //
 // Remarks:
-//  This function acquires a mutex lock before accessing the map for thread
-//  safety.
+//  This function acquires the write lock of the map for thread safety.
 //    * If `map` is `NULL`, the function returns without doing anything.
 //    * If allocation of `new_buckets` fails, the function returns with an error
 //      message.
 //
 //  The function rehashes all entries in the current map to their new bucket
-//  index in the new map
-//    * If `map->size` is greater than `new_capacity`, `map->size` is set to
-//      `new_capacity`.
+//  index in the new map.  A capacity below the number of entries is allowed;
+//  the chains simply grow longer until the growth policy kicks in.
+//
+//  When the map was created with `incremental_rehash` the entries are only
+//  moved by the operations that follow, `MAP_REHASH_STEP` buckets at a time.
+//  A resize that is still in flight is completed before a new one starts.
 void MapRealloc(Map* const map, const size_t new_capacity);
 
+// Grows the bucket array of `map` so that `count` entries fit without going
+// above its maximum load factor, that is without any resize while they are
+// inserted.  Never shrinks the table and never exceeds `max_capacity`.
+//
+// Remarks:
+//  This function acquires the write lock of the map.  A resize that is still
+//  in flight is completed first and the new bucket array is filled at once,
+//  even with `incremental_rehash`, so the inserts that follow do not migrate
+//  anything.
+void MapReserve(Map* const map, const size_t count);
+
 // Frees up a `Map` instance and the entries associated with it.
 //
 // This function is resposible for clearning up the free-store occupied by your
@@ -175,6 +539,9 @@ void MapFree(Map* const map);
 // This functionality allow us to place a `key` inside our `Map` provided that
 // the given `key` is a `string` data type.  We read `keylen` bytes from the
 // given `key` and accumulate a `hash` value.
+//
+// This is the byte-at-a-time djb2 hash; prefer `HashBytes` from "map/hash.h"
+// for new maps.
 hash_t Hash(const void* const key);
 
 // Compares the eqaulity of two `keys` of `string` data type.
@@ -183,11 +550,39 @@ hash_t Hash(const void* const key);
 // data type and must have a `NULL` terminator character.
 bool_t KeyCmp(const void* key1, const void* key2);
 
+// Creates a hash from the `key_size` bytes of `key`.
+//
+// Produces the same hash as `Hash` for a string passed without its terminator
+// but never scans the key, so it works for binary keys too.
+hash_t HashN(const void* const key, const size_t key_size);
+
+// Compares two keys of `key1_size` and `key2_size` bytes for byte-wise
+// equality.
+bool_t KeyCmpN(const void* key1, const size_t key1_size, const void* key2,
+               const size_t key2_size);
+
+// Scrambles a `hash_t` so that every input bit affects the low bits of the
+// result.
+//
+// Tables that index with a power-of-two mask only look at the low bits of a
+// hash; weak hashes such as `Hash()` cluster badly there unless mixed first.
+// This is the 64-bit finalizer of MurmurHash3.
+static inline hash_t MapMixHash(const hash_t hash) {
+  unsigned long long x = (unsigned long long)hash;
+  x ^= x >> 33;
+  x *= 0xFF51AFD7ED558CCDULL;
+  x ^= x >> 33;
+  x *= 0xC4CEB9FE1A85EC53ULL;
+  x ^= x >> 33;
+  return (hash_t)x;
+}
+
 #ifdef __cplusplus
 }
 #endif
 
 #include "map/iterators.h"
+#include "map/mapped.h"
 #include "map/ops.h"
 
 #endif  // STLC_INCLUDE_DATA_MAP_MAP_H_
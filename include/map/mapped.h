@@ -0,0 +1,194 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_INCLUDE_DATA_MAP_MAPPED_H_
+#define STLC_INCLUDE_DATA_MAP_MAPPED_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bool.h"
+#include "map/map.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Magic number identifying a file written by `MapSave()`, "STLCMAP1" read as a
+// little-endian integer.
+#define MAP_FILE_MAGIC 0x3150414D434C5453ULL
+
+// Alignment of every entry and every value inside a map file.  Mapped files
+// start on a page boundary, so the values of a mapped map keep the alignment
+// they have inside a `MapEntry`.
+#define MAP_FILE_ALIGNMENT MAP_ENTRY_ALIGNMENT
+
+// Rounds `size` up to the next multiple of `MAP_FILE_ALIGNMENT`.
+//
+// This macro is meant to be protected inside `map` module.
+#define _MAP_FILE_ALIGN(size)                  \
+  (((size) + MAP_FILE_ALIGNMENT - 0x01) &      \
+   ~(uint64_t)(MAP_FILE_ALIGNMENT - 0x01))
+
+// Header at the start of a map file.  Every position inside the file is an
+// offset from its start, so the file can be mapped at any address.
+//
+// Attributes:
+//  magic          - `MAP_FILE_MAGIC`.
+//  seed           - the seed of the saved map, used again to hash the keys
+//                   looked up when the map hashes with a seeded function.
+//  count          - the number of entries.
+//  bucket_count   - the number of buckets, a power of two.
+//  buckets_offset - the offset of `bucket_count + 1` entry offsets.  The
+//                   entries of bucket `i` are stored back to back between the
+//                   offsets `i` and `i + 1`.
+//  size           - the size of the whole file.
+typedef struct MapFileHeader {
+  uint64_t magic;
+  uint64_t seed;
+  uint64_t count;
+  uint64_t bucket_count;
+  uint64_t buckets_offset;
+  uint64_t size;
+} MapFileHeader;
+
+// An entry inside a map file.  The key is stored at `data` and the value right
+// after it at `_MAP_FILE_VALUE_OFFSET(key_size)`, so an entry is read with a
+// single page-in in the common case.
+typedef struct MapFileEntry {
+  uint64_t hash;
+  uint64_t key_size;
+  uint64_t value_size;
+  unsigned char data[];
+} MapFileEntry;
+
+// Computes the offset of the value from `data` in a `MapFileEntry` holding a
+// key of `key_size` bytes, aligning the value to `MAP_FILE_ALIGNMENT` inside
+// the file.
+//
+// This macro is meant to be protected inside `map` module.
+#define _MAP_FILE_VALUE_OFFSET(key_size)                                  \
+  (_MAP_FILE_ALIGN(offsetof(MapFileEntry, data) + (uint64_t)(key_size)) - \
+   offsetof(MapFileEntry, data))
+
+// Computes the size of a `MapFileEntry` holding a key of `key_size` bytes and
+// a value of `value_size` bytes, padded so the next entry stays aligned.
+//
+// This macro is meant to be protected inside `map` module.
+#define _MAP_FILE_ENTRY_SIZE(key_size, value_size)                 \
+  _MAP_FILE_ALIGN(offsetof(MapFileEntry, data) +                   \
+                  _MAP_FILE_VALUE_OFFSET(key_size) + (value_size))
+
+// A read-only view of a map file written by `MapSave()` and mapped into
+// memory by `MapOpenMapped()`.  Nothing is copied: the entries stay in the
+// page cache and are paged in on first access, and processes mapping the same
+// file share its pages.
+//
+// The hash functions cannot be stored inside the file, so the view is given
+// the same callbacks the saved map was created with and looks keys up through
+// them exactly like the `Map` would.
+typedef struct MappedMap {
+  hash_f hash_func;
+  key_eq_f key_eq_func;
+  hash_n_f hash_n_func;
+  key_eq_n_f key_eq_n_func;
+  hash_seeded_f hash_seeded_func;
+  hash_t seed;
+
+  const unsigned char* data;
+  size_t size;
+  const MapFileHeader* header;
+  const uint64_t* buckets;
+} MappedMap;
+
+// Writes every entry of `map` to the file at `path` in a position-independent
+// layout that `MapOpenMapped()` maps back without parsing.  The entries of a
+// bucket are stored next to each other, so a lookup touches the bucket offsets
+// and a single run of entries.
+//
+// Returns:
+//  TRUE once the file is complete, FALSE if it could not be written.
+//
+// Remarks:
+//  The file is written next to `path` and renamed over it once complete, so
+//  a reader never maps a partial file.  An in-flight incremental resize is
+//  finished first, and the entries are then written under the read lock of
+//  `map`, so lookups can go on while it is saved.
+bool_t MapSave(Map* const map, const char* const path);
+
+// Maps the file at `path` written by `MapSave()` read-only into `mapped`.
+// `hash_func` and `key_eq_func` must be the functions the saved map was
+// initialized with by `MapInit()`.
+//
+// Returns:
+//  TRUE if `mapped` is ready for lookups, FALSE if the file could not be
+//  mapped or is not a map file.
+//
+// Remarks:
+//  Only the header is validated, so opening takes the same time regardless of
+//  the size of the file.  The pages are read lazily on first access.
+bool_t MapOpenMapped(MappedMap* const mapped, const char* const path,
+                     hash_f hash_func, key_eq_f key_eq_func);
+
+// Maps the file at `path` like `MapOpenMapped()`, taking the hash and key
+// comparison functions from `config`.  The seed is taken from the file, so a
+// map hashed with a random seed is looked up with the same one.
+bool_t MapOpenMappedWithConfig(MappedMap* const mapped, const char* const path,
+                               const MapConfig* const config);
+
+// Returns the number of entries of `mapped`.
+size_t MappedMapSize(const MappedMap* const mapped);
+
+// Looks up `key` like `MapGet()`.
+//
+// Returns:
+//  A pointer to the value inside the mapped file, valid until
+//  `MappedMapClose()`, or NULL if `key` is not present.
+const void* MappedMapGet(const MappedMap* const mapped, const void* key);
+
+// Looks up the `key_size` bytes of `key` like `MapGetN()`.  `value_size`, if
+// not NULL, receives the size of the value found.
+const void* MappedMapGetN(const MappedMap* const mapped, const void* key,
+                          const size_t key_size, size_t* const value_size);
+
+// Calls `predicate` on every entry of `mapped` in file order until it returns
+// FALSE.
+void MappedMapTraverse(const MappedMap* const mapped,
+                       bool_t (*predicate)(const void* key,
+                                           const void* value));
+
+// Unmaps the file of `mapped`.  The pointers returned by the lookups become
+// invalid.
+void MappedMapClose(MappedMap* const mapped);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // STLC_INCLUDE_DATA_MAP_MAPPED_H_
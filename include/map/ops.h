@@ -30,13 +30,19 @@
 #ifndef STLC_INCLUDE_DATA_MAP_OPS_H_
 #define STLC_INCLUDE_DATA_MAP_OPS_H_
 
+#include "bool.h"
 #include "map/map.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// Insert a new key-value pair into the map.
+// Number of keys `MapGetMany()` and `MapContainsMany()` keep in flight: the
+// buckets of a whole batch are prefetched before the first of them is read.
+#define MAP_BATCH_WIDTH 0x10
+
+// Insert a new key-value pair into the map, hashing and comparing exactly
+// `key_size` bytes of the key with the sized callbacks of the map.
 //
 // Args:
 //  map        - A pointer to the map to insert the key-value pair into.
@@ -49,19 +55,24 @@ extern "C" {
 //  If the map, key, or value pointers are NULL, this function will immediately
 //  return without doing anything. The key and value pointers must point to
 //  valid memory of the specified sizes. If a key already exists in the map, its
-//  value will be replaced with the new value.
+//  value will be replaced with the new value; the new value is copied over the
+//  old one without allocating when it is not larger than the first value
+//  stored for the key.
 //
 // Thread Safety:
-//  This function locks the mutex associated with the map while it is performing
-//  its operations to ensure thread safety.
-void MapInsert(Map *const map, const void *const key, const size_t key_size,
-               const void *const value, const size_t value_size);
+//  This function holds the write lock of the map while it is performing its
+//  operations to ensure thread safety.  During an incremental resize it also
+//  migrates `MAP_REHASH_STEP` buckets.
+void MapInsertN(Map *const map, const void *const key, const size_t key_size,
+                const void *const value, const size_t value_size);
 
-// Retrieve the value associated with the given key in the map.
+// Retrieve the value associated with the `key_size` bytes of `key` in the
+// map.
 //
 // Params:
-//  map - A pointer to the map.
-//  key - A pointer to the key.
+//  map      - A pointer to the map.
+//  key      - A pointer to the key.
+//  key_size - The size of the key in bytes.
 //
 // Returns:
 //  A pointer to the value associated with the key, or NULL if the key is not
@@ -73,9 +84,15 @@ void MapInsert(Map *const map, const void *const key, const size_t key_size,
 //  initialize the map. Also note that this function does not check if the map
 //  or key pointers are NULL, as passing NULL to these parameters is considered
 //  undefined behavior.
-void *MapGet(Map *const map, const void *key);
+//
+// Thread Safety:
+//  This function only holds the read lock of the map, so lookups from any
+//  number of threads run in parallel and only wait for writers.  Lookups never
+//  migrate entries; during an incremental resize they look the key up in both
+//  bucket arrays.
+void *MapGetN(Map *const map, const void *key, const size_t key_size);
 
-// Remove an entry from the map with the given key.
+// Remove an entry from the map with the given `key_size` bytes of key.
 //
 // Params:
 //  map      - The map from which to remove the entry.
@@ -85,6 +102,274 @@ void *MapGet(Map *const map, const void *key);
 // Effects:
 //  * Removes an entry from the map with the given key, if it exists.
 //  * Frees the memory used by the removed entry.
+void MapRemoveN(Map *const map, const void *key, const size_t key_size);
+
+// Retrieves the values of `n` keys at once, overlapping the cache misses of
+// their lookups.
+//
+// Params:
+//  map        - A pointer to the map.
+//  keys       - An array of `n` pointers to the keys to look up.
+//  key_sizes  - An array of the `n` key sizes in bytes, or NULL to look every
+//               key up the way `MapGet()` does.
+//  n          - The number of keys.
+//  out_values - An array of `n` pointers receiving the value of every key, or
+//               NULL for the keys that are not found.
+//
+// Remarks:
+//  The keys are processed in batches of `MAP_BATCH_WIDTH`: every key of a
+//  batch is hashed and its bucket prefetched, then the chain heads are
+//  prefetched, and only then are the chains walked.  A lookup of a cold table
+//  thus waits for one round of memory latency per batch instead of one per
+//  key.
+//
+// Thread Safety:
+//  The read lock of the map is held for one batch at a time, so writers are
+//  only held off for `MAP_BATCH_WIDTH` lookups.  Keys of different batches may
+//  therefore see different versions of the map.
+void MapGetMany(Map *const map, const void *const *keys,
+                const size_t *key_sizes, const size_t n,
+                void **const out_values);
+
+// Tests the presence of `n` keys at once like `MapGetMany()`.
+//
+// Params:
+//  map       - A pointer to the map.
+//  keys      - An array of `n` pointers to the keys to look up.
+//  key_sizes - An array of the `n` key sizes in bytes, or NULL to look every
+//              key up the way `MapGet()` does.
+//  n         - The number of keys.
+//  out_found - An array of `n` flags set to TRUE for the keys present in the
+//              map, or NULL if only the count is of interest.
+//
+// Returns:
+//  The number of keys present in the map.
+size_t MapContainsMany(Map *const map, const void *const *keys,
+                       const size_t *key_sizes, const size_t n,
+                       bool_t *const out_found);
+
+// Inserts `n` key-value pairs at once, overwriting the values of the keys
+// that are already present like `MapInsertN()`.
+//
+// Params:
+//  map         - A pointer to the map to insert the key-value pairs into.
+//  keys        - An array of `n` pointers to the keys to insert.
+//  key_sizes   - An array of the `n` key sizes in bytes.
+//  values      - An array of `n` pointers to the values to insert.
+//  value_sizes - An array of the `n` value sizes in bytes.
+//  n           - The number of key-value pairs.
+//
+// Returns:
+//  The number of new entries added to the map.
+//
+// Remarks:
+//  The bucket array is grown once, as by `MapReserve()`, for `n` more entries
+//  so the load never triggers an intermediate resize; keys already present
+//  make it slightly larger than needed.  On a map created with `use_slab` the
+//  entries of every size class are carved out of a single allocation.  The
+//  buckets of every `MAP_BATCH_WIDTH` keys are prefetched before they are
+//  inserted.  Pairs with a NULL key or value are skipped.
+//
+// Thread Safety:
+//  This function holds the write lock of the map once for the whole call.
+size_t MapInsertMany(Map *const map, const void *const *keys,
+                     const size_t *key_sizes, const void *const *values,
+                     const size_t *value_sizes, const size_t n);
+
+// Returns the value of `key`, inserting a copy of the `value_size` bytes of
+// `value` for it first if the key is not present.  The key is hashed and its
+// chain walked only once.
+//
+// Params:
+//  map        - A pointer to the map.
+//  key        - A pointer to the key.
+//  key_size   - The size of the key in bytes.
+//  value      - A pointer to the value to insert if the key is not present.
+//  value_size - The size of the value in bytes.
+//  inserted   - Set to TRUE if the value was inserted, FALSE if the key was
+//               already present; may be NULL.
+//
+// Returns:
+//  A pointer to the value stored in the map, which may be written through in
+//  place, or NULL on failure.  It stays valid until the entry is removed or
+//  overwritten with a larger value.
+//
+// Thread Safety:
+//  This function holds the write lock of the map while it looks the key up.
+//  Accesses through the returned pointer happen outside of it and must be
+//  synchronized by the caller if other threads use the same key.
+void *MapGetOrInsert(Map *const map, const void *const key,
+                     const size_t key_size, const void *const value,
+                     const size_t value_size, bool_t *const inserted);
+
+// Inserts a copy of the `value_size` bytes of `value` for `key`, or folds
+// `value` into the value already stored for it with `merge`, in place.  The key
+// is hashed and its chain walked only once.
+//
+// Params:
+//  map        - A pointer to the map.
+//  key        - A pointer to the key.
+//  key_size   - The size of the key in bytes.
+//  value      - A pointer to the value to insert or merge.
+//  value_size - The size of the value in bytes.
+//  merge      - The callback folding `value` into the stored value, which keeps
+//               its size.  When NULL the stored value is overwritten like
+//               `MapInsertN()` does.
+//
+// Returns:
+//  A pointer to the value stored in the map, or NULL on failure.  It stays
+//  valid until the entry is removed or overwritten with a larger value.
+//
+// Thread Safety:
+//  This function holds the write lock of the map, including while `merge`
+//  runs, so `merge` must not call back into the map.
+void *MapUpsert(Map *const map, const void *const key, const size_t key_size,
+                const void *const value, const size_t value_size,
+                value_merge_f merge);
+
+// Returns a slot of `value_size` bytes for the value of `key` to be
+// constructed in place, inserting the key if it is not present.  The key is
+// hashed and its chain walked only once.
+//
+// Params:
+//  map        - A pointer to the map.
+//  key        - A pointer to the key.
+//  key_size   - The size of the key in bytes.
+//  value_size - The size of the value in bytes.
+//  inserted   - Set to TRUE if the key was inserted, FALSE if it was already
+//               present; may be NULL.
+//
+// Returns:
+//  A pointer to the `value_size` bytes of the value, or NULL on failure.  The
+//  bytes are uninitialized for a new key.  For a key already present the old
+//  bytes are kept when they fit and unspecified otherwise.
+//
+// Thread Safety:
+//  This function holds the write lock of the map while it looks the key up.
+//  The slot is filled in outside of it, so other threads must not read the
+//  key until the caller is done.
+void *MapEmplace(Map *const map, const void *const key, const size_t key_size,
+                 const size_t value_size, bool_t *const inserted);
+
+// Inserts like `MapInsertN()` a key whose hash was computed beforehand with
+// `MapHashKey()`, possibly on another map hashing keys the same way.
+//
+// Remarks:
+//  `hash` must be the hash `map` computes for the key; a different value makes
+//  the key land in the wrong chain, where later lookups do not find it.
+void MapInsertWithHash(Map *const map, const void *const key,
+                       const size_t key_size, const hash_t hash,
+                       const void *const value, const size_t value_size);
+
+// Looks a key up like `MapGetN()` with the hash computed beforehand with
+// `MapHashKey()`, so that one hash serves lookups in several maps.
+//
+// Returns:
+//  A pointer to the value associated with the key, or NULL if the key is not
+//  found in the map or `hash` is not the hash `map` computes for it.
+void *MapGetWithHash(Map *const map, const void *key, const size_t key_size,
+                     const hash_t hash);
+
+// Removes a key like `MapRemoveN()` with the hash computed beforehand with
+// `MapHashKey()`.
+void MapRemoveWithHash(Map *const map, const void *key, const size_t key_size,
+                       const hash_t hash);
+
+// Inserts like `MapInsertN()` with the precomputed `hash` of the key.
+//
+// Returns:
+//  TRUE if a new entry was added, FALSE if the value of an existing entry was
+//  overwritten or the insert failed.
+//
+// This function is meant to be protected inside `map`, `shardedmap` and
+// `smallmap` modules.
+bool_t _MapInsertHashed(Map *const map, const void *const key,
+                        const size_t key_size, const hash_t hash,
+                        const void *const value, const size_t value_size);
+
+// Looks a key up like `MapGetN()` with the precomputed `hash` of the key.
+//
+// This function is meant to be protected inside `map`, `shardedmap`,
+// `hashset` and `smallmap` modules.
+void *_MapGetHashed(Map *const map, const void *key, const size_t key_size,
+                    const hash_t hash);
+
+// Removes a key like `MapRemoveN()` with the precomputed `hash` of the key.
+//
+// Returns:
+//  TRUE if an entry was removed, FALSE if the key was not present.
+//
+// This function is meant to be protected inside `map`, `shardedmap`,
+// `hashset` and `smallmap` modules.
+bool_t _MapRemoveHashed(Map *const map, const void *key, const size_t key_size,
+                        const hash_t hash);
+
+// Adds `key` with the precomputed `hash` and a value of zero bytes unless it
+// is already present, then applies the growth policy.  The caller must hold
+// the write lock of `map`.
+//
+// Returns:
+//  TRUE if a new entry was added, FALSE if the key was already present or the
+//  entry could not be allocated.
+//
+// This function is meant to be protected inside `map` and `hashset` modules.
+bool_t _MapAddKeyLocked(Map *const map, const void *const key,
+                        const size_t key_size, const hash_t hash);
+
+// Adds `key` with the precomputed `hash` and `value_size` uninitialized value
+// bytes unless it is already present, then applies the growth policy.  The
+// caller must hold the write lock of `map`.  Entries never move when the
+// bucket array is resized, so the entry stays valid until it is removed.
+//
+// Returns:
+//  The new entry, or NULL if the key was already present or the entry could
+//  not be allocated.
+//
+// This function is meant to be protected inside `map`, `lrucache` and
+// `expiringmap` modules.
+MapEntry *_MapAddEntryLocked(Map *const map, const void *const key,
+                             const size_t key_size, const hash_t hash,
+                             const size_t value_size);
+
+// Unlinks `entry` from the buckets of `map` by address, without comparing any
+// key, releases it and applies the growth policy.  The caller must hold the
+// write lock of `map`.
+//
+// Returns:
+//  TRUE if `entry` was found and removed.
+//
+// This function is meant to be protected inside `map`, `lrucache` and
+// `expiringmap` modules.
+bool_t _MapRemoveEntryLocked(Map *const map, MapEntry *const entry);
+
+// Links `entry`, allocated with `MapEntryNew()` for a key absent from `map`
+// and hashed the way `map` hashes it, into the buckets of `map` without
+// copying it and applies the growth policy.  `map` takes the entry over, so it
+// must not have a slab.  The caller must hold the write lock of `map`.
+//
+// This function is meant to be protected inside `map` and `smallmap` modules.
+void _MapLinkEntryLocked(Map *const map, MapEntry *const entry);
+
+// Insert a new key-value pair into the map.
+//
+// Remarks:
+//  Same as `MapInsertN()`; `key_size` is only handed to the hash and equality
+//  callbacks when the map was created with sized ones.
+void MapInsert(Map *const map, const void *const key, const size_t key_size,
+               const void *const value, const size_t value_size);
+
+// Retrieve the value associated with the given key in the map.
+//
+// Remarks:
+//  Same as `MapGetN()` for maps created with unsized callbacks.  On a map
+//  created with sized or seeded callbacks `key` must be a string and is looked
+//  up without its terminator, i.e. with `strlen(key)` bytes.
+void *MapGet(Map *const map, const void *key);
+
+// Remove an entry from the map with the given key.
+//
+// Remarks:
+//  Same as `MapRemoveN()`.
 void MapRemove(Map *const map, const void *key, const size_t key_size);
 
 #ifdef __cplusplus
@@ -0,0 +1,143 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_INCLUDE_DATA_MAP_SLAB_H_
+#define STLC_INCLUDE_DATA_MAP_SLAB_H_
+
+#include <sys/types.h>
+
+#include "bool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Size of the pages a `MapSlab` carves chunks out of.  Only
+// `MapSlabReserve()` allocates larger ones.
+#define MAP_SLAB_PAGE_SIZE 0x40000
+
+// Alignment of every chunk; every class size is a multiple of it.
+#define MAP_SLAB_ALIGNMENT 0x10
+
+// Number of chunk size classes.  Requests larger than the biggest class are
+// served by `malloc()` directly.
+#define MAP_SLAB_CLASSES 0xA
+
+// Allocation statistics of a `MapSlab`.
+//
+// Attributes:
+//  pages          - the number of pages allocated.
+//  bytes_reserved - the number of bytes held by pages.
+//  chunks_in_use  - the number of chunks currently handed out.
+//  chunks_free    - the number of chunks waiting on the free lists.
+//  large_in_use   - the number of requests above the biggest class currently
+//                   served by `malloc()`.
+//  allocations    - the total number of allocations served.
+//  recycled       - the number of allocations served from a free list.
+typedef struct MapSlabStats {
+  size_t pages;
+  size_t bytes_reserved;
+  size_t chunks_in_use;
+  size_t chunks_free;
+  size_t large_in_use;
+  size_t allocations;
+  size_t recycled;
+} MapSlabStats;
+
+// A page of chunks of a single size class.  Pages of all the classes are linked
+// together so they can be released in one pass.
+typedef struct MapSlabPage {
+  struct MapSlabPage* next;
+} MapSlabPage;
+
+// A released chunk waiting on the free list of its class.
+typedef struct MapSlabChunk {
+  struct MapSlabChunk* next;
+} MapSlabChunk;
+
+// The `MapSlab` structure is a size-class pool allocator for map entries.
+//
+// Each class hands out fixed-size chunks bumped out of `MAP_SLAB_PAGE_SIZE`
+// pages and recycles released chunks through an intrusive free list.  Releasing
+// the whole pool costs one `free()` per page instead of one per chunk.
+//
+// The pool does no locking of its own; the map owning it serializes access.
+//
+// Attributes:
+//  pages      - a list of every page allocated.
+//  free_lists - the released chunks of every class.
+//  cursor     - the next unused byte of the current page of every class.
+//  limit      - the end of the current page of every class.
+//  stats      - allocation statistics.
+typedef struct MapSlab {
+  MapSlabPage* pages;
+  MapSlabChunk* free_lists[MAP_SLAB_CLASSES];
+  unsigned char* cursor[MAP_SLAB_CLASSES];
+  unsigned char* limit[MAP_SLAB_CLASSES];
+  MapSlabStats stats;
+} MapSlab;
+
+// Initializes an empty `MapSlab`.  No page is allocated until the first
+// request of a class.
+void MapSlabInit(MapSlab* const slab);
+
+// Returns the number of bytes actually reserved for a request of `size` bytes,
+// that is the chunk size of the class serving it or `size` itself when the
+// request is too large for any class.
+size_t MapSlabChunkSize(const size_t size);
+
+// Returns TRUE if a request of `size` bytes is served by `malloc()` rather
+// than by a size class.
+bool_t MapSlabIsLarge(const size_t size);
+
+// Allocates `size` bytes from `slab`.  The memory is aligned to
+// `MAP_SLAB_ALIGNMENT`.  Returns NULL on allocation failure.
+void* MapSlabAlloc(MapSlab* const slab, const size_t size);
+
+// Makes sure `count` chunks of the class serving `size` bytes can be handed
+// out without allocating another page, allocating a single page large enough
+// for all of them if the current page of the class is too small.  The tail of
+// the current page is given up in that case.  Requests too large for any
+// class are left to `malloc()`.  Returns FALSE on allocation failure.
+bool_t MapSlabReserve(MapSlab* const slab, const size_t size,
+                      const size_t count);
+
+// Returns the chunk `ptr` of `size` bytes to `slab`.  `size` must be the value
+// passed to `MapSlabAlloc()` or the `MapSlabChunkSize()` of it.
+void MapSlabFree(MapSlab* const slab, void* const ptr, const size_t size);
+
+// Releases every page of `slab` at once.  Large allocations still in use are
+// not tracked by the pool and must be freed by the caller before.
+void MapSlabRelease(MapSlab* const slab);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // STLC_INCLUDE_DATA_MAP_SLAB_H_
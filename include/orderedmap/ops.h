@@ -0,0 +1,90 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_INCLUDE_DATA_ORDEREDMAP_OPS_H_
+#define STLC_INCLUDE_DATA_ORDEREDMAP_OPS_H_
+
+#include "bool.h"
+#include "orderedmap/orderedmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Insert a new key-value pair into the ordered map.
+//
+// Params:
+//  map        - A pointer to the map to insert the key-value pair into.
+//  key        - A pointer to the key to insert.
+//  key_size   - The size of the key in bytes.
+//  value      - A pointer to the value to insert.
+//  value_size - The size of the value in bytes.
+//
+// Remarks:
+//  A new key is appended after every other key.  If the key already exists in
+//  the map, its value is replaced and it keeps its position.
+//
+// Thread Safety:
+//  This function holds the write lock of the map.
+void OrderedMapInsert(OrderedMap *const map, const void *const key,
+                      const size_t key_size, const void *const value,
+                      const size_t value_size);
+
+// Retrieve the value associated with the `key_size` bytes of `key`.
+//
+// Returns:
+//  A pointer to the value, or NULL if the key is not present.  `value_size`,
+//  if not NULL, receives the size of the value.  The keys and values live in
+//  one arena that moves as it grows, so the pointer is only valid until the
+//  next insert or remove.
+//
+// Thread Safety:
+//  This function only holds the read lock of the map.
+void *OrderedMapGet(OrderedMap *const map, const void *const key,
+                    const size_t key_size, size_t *const value_size);
+
+// Remove an entry from the ordered map with the given `key_size` bytes of key.
+//
+// Returns:
+//  TRUE if an entry was removed, FALSE if the key was not present.
+//
+// Remarks:
+//  The entry is left as a hole in the entries array.  The tables are rebuilt
+//  without the holes once they outnumber the live entries.
+//
+// Thread Safety:
+//  This function holds the write lock of the map.
+bool_t OrderedMapRemove(OrderedMap *const map, const void *const key,
+                        const size_t key_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // STLC_INCLUDE_DATA_ORDEREDMAP_OPS_H_
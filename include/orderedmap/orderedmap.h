@@ -0,0 +1,282 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_INCLUDE_DATA_ORDEREDMAP_ORDEREDMAP_H_
+#define STLC_INCLUDE_DATA_ORDEREDMAP_ORDEREDMAP_H_
+
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "bool.h"
+#include "map/map.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Minimum number of slots of the index table.
+#define ORDEREDMAP_MIN_CAPACITY 0x08
+
+// Values of an index slot that does not point at an entry: a slot that was
+// never used, which ends a probe, and a slot whose entry was removed, which
+// probes go on past.
+#define ORDEREDMAP_INDEX_EMPTY (-0x01)
+#define ORDEREDMAP_INDEX_DUMMY (-0x02)
+
+// `OrderedMapEntry::offset` of a removed entry.
+#define ORDEREDMAP_DELETED SIZE_MAX
+
+// Alignment of the keys and values inside the arena, enough for any pointer,
+// integer or `double` value.  Packing the arena tighter than the 16 bytes of
+// `MAP_ENTRY_ALIGNMENT` saves a third of the arena for small keys and values.
+#define ORDEREDMAP_ALIGNMENT 0x08
+
+// Largest key or value size the map accepts.
+#define ORDEREDMAP_MAX_ITEM_SIZE UINT32_MAX
+
+// Minimum size of the arena once it is allocated.
+#define ORDEREDMAP_MIN_ARENA 0x100
+
+// Rounds `size` up to the next multiple of `ORDEREDMAP_ALIGNMENT`.
+//
+// This macro is meant to be protected inside `orderedmap` module.
+#define _ORDEREDMAP_ALIGN(size)               \
+  (((size) + ORDEREDMAP_ALIGNMENT - 0x01) & \
+   ~(size_t)(ORDEREDMAP_ALIGNMENT - 0x01))
+
+// Number of entries an index table of `capacity` slots holds before it is
+// rebuilt, keeping at least a third of the slots empty so probes stay short.
+//
+// This macro is meant to be protected inside `orderedmap` module.
+#define _ORDEREDMAP_USABLE(capacity) (((capacity) << 0x01) / 0x03)
+
+// Number of arena bytes taken by an entry with a key of `key_size` bytes and a
+// value of `value_size` bytes.
+//
+// This macro is meant to be protected inside `orderedmap` module.
+#define _ORDEREDMAP_BLOCK_SIZE(key_size, value_size) \
+  (_ORDEREDMAP_ALIGN(key_size) + _ORDEREDMAP_ALIGN(value_size))
+
+// Returns the key of `entry` inside the arena of `map`.
+//
+// This macro is meant to be protected inside `orderedmap` module.
+#define _ORDEREDMAP_KEY(map, entry) ((map)->arena + (entry)->offset)
+
+// Returns the value of `entry` inside the arena of `map`.
+//
+// This macro is meant to be protected inside `orderedmap` module.
+#define _ORDEREDMAP_VALUE(map, entry) \
+  ((map)->arena + (entry)->offset + _ORDEREDMAP_ALIGN((entry)->key_size))
+
+// An entry of the dense entries array.  The key and the value are stored back
+// to back in the arena of the map at `offset`.
+//
+// Attributes:
+//  hash       - the hash of the key.
+//  offset     - the offset of the key inside the arena, or
+//               `ORDEREDMAP_DELETED` once the entry was removed.
+//  key_size   - the size of the key in bytes.
+//  value_size - the size of the value in bytes.
+//
+// The sizes are 32 bits wide so an entry takes 24 bytes.
+typedef struct OrderedMapEntry {
+  hash_t hash;
+  size_t offset;
+  uint32_t key_size;
+  uint32_t value_size;
+} OrderedMapEntry;
+
+// The `OrderedMap` structure is a hash map that remembers the order its keys
+// were inserted in, laid out like the compact dictionaries of CPython:
+//
+//    indices  [ 2 | - | 0 | x | 1 | - | - | - ]   sparse, 1 to 8 bytes a slot
+//    entries  [ hash|offset|sizes ] x 3           dense, in insertion order
+//    arena    [ key0 | value0 | key1 | value1 | key2 | value2 ]
+//
+// The open-addressed index table only holds positions into the entries array,
+// stored on the fewest bytes that can address it, so the sparse part costs 1
+// to 8 bytes per slot instead of a pointer.  Iterating is a linear scan of the
+// entries array and of the arena, in insertion order, and does not depend on
+// the capacity of the index table.  Overwriting a key keeps its position.
+//
+// Attributes:
+//  hash_func, key_eq_func, hash_n_func, key_eq_n_func - the callbacks of the
+//                     map, used like the ones of a `Map`.
+//  indices          - the index table of `capacity` slots of `index_width`
+//                     bytes.
+//  capacity         - the number of slots of the index table, a power of two.
+//  index_width      - the number of bytes of an index slot.
+//  entries          - the dense array of entries.
+//  entries_capacity - the number of entries `entries` holds; it grows on its
+//                     own up to `_ORDEREDMAP_USABLE(capacity)`.
+//  entries_used     - the number of entries used, including removed ones.
+//  size             - the number of live entries.
+//  arena            - the bytes of the keys and values.
+//  arena_capacity   - the size of `arena`.
+//  arena_used       - the number of bytes of `arena` used.
+//  arena_dead       - the bytes of `arena_used` left by removed or moved
+//                     entries.
+//  lock             - a read-write lock guarding the map.
+typedef struct OrderedMap {
+  hash_f hash_func;
+  key_eq_f key_eq_func;
+  hash_n_f hash_n_func;
+  key_eq_n_f key_eq_n_func;
+
+  void* indices;
+  size_t capacity;
+  size_t index_width;
+  OrderedMapEntry* entries;
+  size_t entries_capacity;
+  size_t entries_used;
+  size_t size;
+  unsigned char* arena;
+  size_t arena_capacity;
+  size_t arena_used;
+  size_t arena_dead;
+  pthread_rwlock_t lock;
+} OrderedMap;
+
+// Returns the value of the index slot `slot` of `map`.
+//
+// This function is meant to be protected inside `orderedmap` module.
+static inline int64_t _OrderedMapIndexAt(const OrderedMap* const map,
+                                         const size_t slot) {
+  switch (map->index_width) {
+    case 0x01:
+      return ((const int8_t*)map->indices)[slot];
+    case 0x02:
+      return ((const int16_t*)map->indices)[slot];
+    case 0x04:
+      return ((const int32_t*)map->indices)[slot];
+    default:
+      return ((const int64_t*)map->indices)[slot];
+  }
+}
+
+// Stores `index` into the index slot `slot` of `map`.
+//
+// This function is meant to be protected inside `orderedmap` module.
+static inline void _OrderedMapSetIndex(OrderedMap* const map,
+                                       const size_t slot,
+                                       const int64_t index) {
+  switch (map->index_width) {
+    case 0x01:
+      ((int8_t*)map->indices)[slot] = (int8_t)index;
+      break;
+    case 0x02:
+      ((int16_t*)map->indices)[slot] = (int16_t)index;
+      break;
+    case 0x04:
+      ((int32_t*)map->indices)[slot] = (int32_t)index;
+      break;
+    default:
+      ((int64_t*)map->indices)[slot] = index;
+      break;
+  }
+}
+
+// Hashes the `key_size` bytes of `key` with the sized hash function of `map`
+// or its unsized one, whichever it was created with.
+//
+// This function is meant to be protected inside `orderedmap` module.
+hash_t _OrderedMapHashKey(const OrderedMap* const map, const void* key,
+                          const size_t key_size);
+
+// Rebuilds the entries array and the index table of `map` for an index table
+// of `capacity` slots and an entries array of `count` entries, dropping the
+// removed entries and keeping the others in order.  `count` is clamped between
+// the live entries and `_ORDEREDMAP_USABLE(capacity)`.  The arena is compacted
+// too when most of it is dead.  The caller must hold the write lock of `map`.
+//
+// Returns:
+//  FALSE if the new tables could not be allocated, in which case `map` is
+//  left as is.
+//
+// This function is meant to be protected inside `orderedmap` module.
+bool_t _OrderedMapRebuildLocked(OrderedMap* const map, const size_t capacity,
+                                const size_t count);
+
+// Copies the `key_size` bytes of `key` and the `value_size` bytes of `value`
+// at the end of the arena of `map`, compacting or growing it first if they do
+// not fit.  The offsets of the entries may change, their positions do not.
+// The caller must hold the write lock of `map`.
+//
+// Returns:
+//  The offset of the copy, or `ORDEREDMAP_DELETED` on allocation failure.
+//
+// This function is meant to be protected inside `orderedmap` module.
+size_t _OrderedMapAppendLocked(OrderedMap* const map, const void* const key,
+                               const size_t key_size, const void* const value,
+                               const size_t value_size);
+
+// Returns the number of index slots needed to hold `count` entries.
+//
+// This function is meant to be protected inside `orderedmap` module.
+size_t _OrderedMapCapacityFor(const size_t count);
+
+// Initializes a new instance of the `OrderedMap` data structure.
+//
+// Params:
+//  map         - A pointer to the `OrderedMap` to be initialized.
+//  count       - The number of entries to make room for.
+//  hash_func   - A pointer to the hash function used to calculate hash codes
+//                for keys.
+//  key_eq_func - A pointer to the key comparison function used to compare keys
+//                for equality.
+//
+// Remarks:
+//  If the pointer passed to `map` is NULL, this function returns immediately
+//  without doing anything.  On failure `map->indices` is left NULL.
+void OrderedMapInit(OrderedMap* const map, const size_t count,
+                    hash_f hash_func, key_eq_f key_eq_func);
+
+// Initializes a new instance of the `OrderedMap` data structure like
+// `OrderedMapInit()` with length-aware callbacks, like `MapInitN()`.
+void OrderedMapInitN(OrderedMap* const map, const size_t count,
+                     hash_n_f hash_n_func, key_eq_n_f key_eq_n_func);
+
+// Grows the tables of `map` so that `count` entries fit without a rebuild.
+void OrderedMapReserve(OrderedMap* const map, const size_t count);
+
+// Returns the number of entries of `map`.
+size_t OrderedMapSize(OrderedMap* const map);
+
+// Frees up an `OrderedMap` instance and the entries associated with it.
+void OrderedMapFree(OrderedMap* const map);
+
+#ifdef __cplusplus
+}
+#endif
+
+#include "orderedmap/iterators.h"
+#include "orderedmap/ops.h"
+
+#endif  // STLC_INCLUDE_DATA_ORDEREDMAP_ORDEREDMAP_H_
@@ -0,0 +1,132 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_INCLUDE_DATA_SHARDEDMAP_SHARDEDMAP_H_
+#define STLC_INCLUDE_DATA_SHARDEDMAP_SHARDEDMAP_H_
+
+#include <sys/types.h>
+
+#include "bool.h"
+#include "map/map.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SHARDEDMAP_MIN_SHARDS 0x01
+#define SHARDEDMAP_MAX_SHARDS 0x400
+
+// Size of the cache line the shards are padded to.
+#define SHARDEDMAP_SHARD_ALIGNMENT 0x40
+
+// A single shard of a `ShardedMap`: an independently locked `Map` padded to
+// its own cache lines so that the locks of neighbouring shards do not bounce
+// the same line between cores.
+typedef struct ShardedMapShard {
+  Map map;
+} __attribute__((aligned(SHARDEDMAP_SHARD_ALIGNMENT))) ShardedMapShard;
+
+// The `ShardedMap` structure partitions its keys over `shard_count` `Map`
+// instances by the high bits of their mixed hash.  Every shard has its own
+// lock, so writers on different shards never wait for each other.
+//
+//       +~~~~~~~~~~~~~~~~~~~+
+//       ! hash(key) >> bits !~~~+~~~~> [ Map | Map | Map | ... | Map ]
+//       +~~~~~~~~~~~~~~~~~~~+
+//
+// Attributes:
+//  shards      - a contiguous array of `shard_count` shards.
+//  shard_count - the number of shards, always a power of two.
+//  shard_bits  - log2 of `shard_count`, the number of high hash bits that
+//                select a shard.
+//  size        - the number of entries of all shards, updated atomically so
+//                that it can be read without taking any lock.
+typedef struct ShardedMap {
+  ShardedMapShard* shards;
+  size_t shard_count;
+  size_t shard_bits;
+  size_t size;
+} ShardedMap;
+
+// Returns the `Map` of the shard `hash` belongs to.  Shards use the low bits
+// of the mixed hash for their bucket index and the high bits select the shard.
+//
+// This macro is meant to be protected inside `shardedmap` module.
+#define _SHARDEDMAP_SHARD(map, hash)                                      \
+  (&(map)                                                                 \
+        ->shards[(map)->shard_bits == 0                                   \
+                     ? 0                                                  \
+                     : MapMixHash(hash) >>                                \
+                           (sizeof(hash_t) * 0x08 - (map)->shard_bits)]   \
+        .map)
+
+// Initializes a new instance of the `ShardedMap` data structure.
+//
+// Params:
+//  map         - A pointer to the `ShardedMap` to be initialized.
+//  shard_count - The number of shards; it is rounded up to the next power of
+//                two inside [`SHARDEDMAP_MIN_SHARDS`, `SHARDEDMAP_MAX_SHARDS`].
+//  capacity    - The total number of buckets, spread evenly over the shards;
+//                every shard gets at least `MAP_MIN_CAPACITY`.
+//  hash_func   - A pointer to the hash function used to calculate hash codes
+//                for keys.
+//  key_eq_func - A pointer to the key comparison function used to compare keys
+//                for equality.
+//
+// Remarks:
+//  If the pointer passed to `map` is NULL, this function returns immediately
+//  without doing anything.  On failure `map->shards` is left NULL.
+void ShardedMapInit(ShardedMap* const map, const size_t shard_count,
+                    const size_t capacity, hash_f hash_func,
+                    key_eq_f key_eq_func);
+
+// Initializes a new instance of the `ShardedMap` data structure whose shards
+// are created as described by `config`.
+//
+// Remarks:
+//  `config->capacity` is the total number of buckets, spread evenly over the
+//  shards.  A seeded hash function gets one seed shared by all shards, drawn
+//  with `HashRandomSeed()` unless `config->seed` is set, so every key hashes
+//  the same whichever shard computes it.
+void ShardedMapInitWithConfig(ShardedMap* const map, const size_t shard_count,
+                              const MapConfig* const config);
+
+// Returns the number of entries of `map` without taking any lock.  Concurrent
+// writers may change it right after it is read.
+size_t ShardedMapSize(const ShardedMap* const map);
+
+// Frees up a `ShardedMap` instance, its shards and the entries associated
+// with them.
+void ShardedMapFree(ShardedMap* const map);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // STLC_INCLUDE_DATA_SHARDEDMAP_SHARDEDMAP_H_
@@ -0,0 +1,76 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_INCLUDE_DATA_SMALLMAP_OPS_H_
+#define STLC_INCLUDE_DATA_SMALLMAP_OPS_H_
+
+#include "bool.h"
+#include "smallmap/smallmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Insert a new key-value pair into the small map.
+//
+// Params:
+//  map        - A pointer to the map to insert the key-value pair into.
+//  key        - A pointer to the key to insert.
+//  key_size   - The size of the key in bytes.
+//  value      - A pointer to the value to insert.
+//  value_size - The size of the value in bytes.
+//
+// Remarks:
+//  If the key already exists in the map, its value is replaced.  Inserting a
+//  new key into a map holding `SMALLMAP_INLINE_CAPACITY` inline entries
+//  promotes it to a `Map` first.
+void SmallMapInsert(SmallMap *const map, const void *const key,
+                    const size_t key_size, const void *const value,
+                    const size_t value_size);
+
+// Retrieve the value associated with the `key_size` bytes of `key`.
+//
+// Returns:
+//  A pointer to the value, or NULL if the key is not present.  The pointer
+//  stays valid until the key is overwritten or removed, or the map promoted.
+void *SmallMapGet(SmallMap *const map, const void *const key,
+                  const size_t key_size);
+
+// Remove an entry from the small map with the given `key_size` bytes of key.
+//
+// Returns:
+//  TRUE if an entry was removed, FALSE if the key was not present.
+bool_t SmallMapRemove(SmallMap *const map, const void *const key,
+                      const size_t key_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // STLC_INCLUDE_DATA_SMALLMAP_OPS_H_
@@ -0,0 +1,154 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_INCLUDE_DATA_SMALLMAP_SMALLMAP_H_
+#define STLC_INCLUDE_DATA_SMALLMAP_SMALLMAP_H_
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "bool.h"
+#include "map/map.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Number of entries a `SmallMap` keeps inline before it promotes itself to a
+// `Map`.  Every slot costs a pointer inside the `SmallMap` itself.
+#define SMALLMAP_INLINE_CAPACITY 0x08
+
+// The `SmallMap` structure is a map for tables that usually hold a handful of
+// keys, such as per-object attribute maps.  Up to `SMALLMAP_INLINE_CAPACITY`
+// entries are kept in an array inside the structure and found by a linear
+// scan comparing hashes first; there is no bucket array and no lock:
+//
+//    +~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~+
+//    ! hash | key_eq | size | e0 | e1 | e2 |  -  | ... |  - !   88 bytes
+//    +~~~~~~~~~~~~~~~~~~~~~~~~~~~~|~~~~~~~~~~~~~~~~~~~~~~~~+
+//                                 +~~> key|value|hash|next|sizes|bytes
+//
+// The entries are `MapEntry` blocks.  Inserting one more key into a full array
+// moves the entries into a `Map` allocated on the heap, which the `SmallMap`
+// keeps using from then on, even if keys are removed later.
+//
+// Thread Safety:
+//  A `SmallMap` is not synchronized; callers guard it the way they guard the
+//  object that owns it.  Once promoted, the underlying `Map` takes its own
+//  lock in addition.
+//
+// Attributes:
+//  hash_func, hash_n_func     - the hash function, unsized or sized depending
+//                               on `sized`.
+//  key_eq_func, key_eq_n_func - the key comparison function, unsized or sized
+//                               depending on `sized`.
+//  size     - the number of inline entries; unused once promoted.
+//  sized    - whether the map was created with `SmallMapInitN()`.
+//  promoted - whether the entries live in `map` instead of `entries`.
+//  entries  - the inline entries, in no particular order.
+//  map      - the `Map` holding the entries once promoted.
+typedef struct SmallMap {
+  union {
+    hash_f hash_func;
+    hash_n_f hash_n_func;
+  };
+  union {
+    key_eq_f key_eq_func;
+    key_eq_n_f key_eq_n_func;
+  };
+  uint32_t size;
+  bool_t sized;
+  bool_t promoted;
+  union {
+    MapEntry* entries[SMALLMAP_INLINE_CAPACITY];
+    Map* map;
+  };
+} SmallMap;
+
+// Hashes the `key_size` bytes of `key` the way the `Map` a `SmallMap` gets
+// promoted to does.
+//
+// This function is meant to be protected inside `smallmap` module.
+hash_t _SmallMapHashKey(const SmallMap* const map, const void* key,
+                        const size_t key_size);
+
+// Returns the position in `map->entries` of the inline entry of the
+// `key_size` bytes of `key` with hash `hash`, or `map->size` if it is absent.
+//
+// This function is meant to be protected inside `smallmap` module.
+size_t _SmallMapFind(const SmallMap* const map, const void* key,
+                     const size_t key_size, const hash_t hash);
+
+// Moves the inline entries of `map` into a newly allocated `Map`.
+//
+// Returns:
+//  FALSE if the `Map` could not be allocated, in which case `map` is left
+//  as is.
+//
+// This function is meant to be protected inside `smallmap` module.
+bool_t _SmallMapPromote(SmallMap* const map);
+
+// Initializes a new, empty instance of the `SmallMap` data structure.  No
+// memory is allocated until the first insert.
+//
+// Params:
+//  map         - A pointer to the `SmallMap` to be initialized.
+//  hash_func   - A pointer to the hash function used to calculate hash codes
+//                for keys.
+//  key_eq_func - A pointer to the key comparison function used to compare keys
+//                for equality.
+//
+// Remarks:
+//  If the pointer passed to `map` is NULL, this function returns immediately
+//  without doing anything.
+void SmallMapInit(SmallMap* const map, hash_f hash_func, key_eq_f key_eq_func);
+
+// Initializes a new instance of the `SmallMap` data structure like
+// `SmallMapInit()` with length-aware callbacks, like `MapInitN()`.
+void SmallMapInitN(SmallMap* const map, hash_n_f hash_n_func,
+                   key_eq_n_f key_eq_n_func);
+
+// Returns the number of entries of `map`.
+size_t SmallMapSize(SmallMap* const map);
+
+// Returns whether the entries of `map` were moved into a `Map`.
+bool_t SmallMapIsPromoted(const SmallMap* const map);
+
+// Frees up a `SmallMap` instance and the entries associated with it.  The map
+// is left empty and may be used again.
+void SmallMapFree(SmallMap* const map);
+
+#ifdef __cplusplus
+}
+#endif
+
+#include "smallmap/iterators.h"
+#include "smallmap/ops.h"
+
+#endif  // STLC_INCLUDE_DATA_SMALLMAP_SMALLMAP_H_
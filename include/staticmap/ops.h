@@ -0,0 +1,70 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_INCLUDE_DATA_STATICMAP_OPS_H_
+#define STLC_INCLUDE_DATA_STATICMAP_OPS_H_
+
+#include "bool.h"
+#include "staticmap/staticmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Retrieve the value associated with the `key_size` bytes of `key`.
+//
+// Params:
+//  map        - A pointer to the map.
+//  key        - A pointer to the key.
+//  key_size   - The size of the key in bytes.
+//  value_size - Receives the size of the value in bytes; may be NULL.
+//
+// Returns:
+//  A pointer to the value inside the buffer of the map, or NULL if the key is
+//  not found in the map.
+//
+// Remarks:
+//  The key is hashed once and only the slot its pilot selects is read; the
+//  entry itself is only read when the hash stored in the slot matches.
+//
+// Thread Safety:
+//  The map is never modified, so any number of threads may look keys up
+//  without synchronization.
+const void *StaticMapGet(const StaticMap *const map, const void *const key,
+                         const size_t key_size, size_t *const value_size);
+
+// Tests whether the `key_size` bytes of `key` are a key of `map`.
+bool_t StaticMapContains(const StaticMap *const map, const void *const key,
+                         const size_t key_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // STLC_INCLUDE_DATA_STATICMAP_OPS_H_
@@ -0,0 +1,237 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_INCLUDE_DATA_STATICMAP_STATICMAP_H_
+#define STLC_INCLUDE_DATA_STATICMAP_STATICMAP_H_
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "bool.h"
+#include "map/map.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Identifies a buffer holding a `StaticMap`; the bytes spell "STLCSMAP".
+#define STATICMAP_MAGIC 0x50414D53434C5453ULL
+
+// The average number of keys hashed to the same bucket.  Every bucket stores a
+// 16-bit pilot, so the hash metadata costs `16 / STATICMAP_BUCKET_LOAD` bits
+// per key.
+#define STATICMAP_BUCKET_LOAD 0x06
+
+// The slot array is `STATICMAP_LOAD_NUMERATOR / STATICMAP_LOAD_DENOMINATOR`
+// full.  The spare slots bound the pilot search of the buckets placed last to
+// about a thousand pilots, far below `STATICMAP_MAX_PILOT`.
+#define STATICMAP_LOAD_NUMERATOR 0x7
+#define STATICMAP_LOAD_DENOMINATOR 0x8
+
+// The number of pilots tried for a bucket before the build starts over with
+// another seed, and the number of seeds tried before it gives up.
+#define STATICMAP_MAX_PILOT 0xFFFF
+#define STATICMAP_MAX_ATTEMPTS 0x10
+
+// Alignment of the sections of the buffer and of the values inside it.
+#define STATICMAP_ALIGNMENT 0x10
+
+// The `offset` of a slot that holds no entry.
+#define STATICMAP_EMPTY_SLOT UINT64_MAX
+
+// The header at the start of a `StaticMap` buffer.  Every offset is counted
+// from the start of the buffer, so the buffer can be written to a file and
+// mapped back at any address.
+//
+//       +~~~~~~~~+~~~~~~~~~~~~~~~~+~~~~~~~~~~~~~~~~~~~~+~~~~~~~~~~~~~~~~~~~+
+//       ! header | pilots[bucket] | slots[slot_count]  | entries ...       !
+//       +~~~~~~~~+~~~~~~~~~~~~~~~~+~~~~~~~~~~~~~~~~~~~~+~~~~~~~~~~~~~~~~~~~+
+//
+// Attributes:
+//  magic          - `STATICMAP_MAGIC`.
+//  seed           - the seed every key is hashed with by `HashBytes()`.
+//  count          - the number of entries.
+//  bucket_count   - the number of buckets, i.e. of pilots.
+//  slot_count     - the number of slots.
+//  pilots_offset  - the offset of the `uint16_t` pilots.
+//  slots_offset   - the offset of the slots.
+//  entries_offset - the offset of the first entry.
+//  size           - the size of the whole buffer in bytes.
+typedef struct StaticMapHeader {
+  uint64_t magic;
+  uint64_t seed;
+  uint64_t count;
+  uint64_t bucket_count;
+  uint64_t slot_count;
+  uint64_t pilots_offset;
+  uint64_t slots_offset;
+  uint64_t entries_offset;
+  uint64_t size;
+} StaticMapHeader;
+
+// A slot of a `StaticMap`: the full hash of the key it holds and the offset of
+// its entry.  Comparing the hash rejects almost every missing key without
+// touching the entry.
+typedef struct StaticMapSlot {
+  uint64_t hash;
+  uint64_t offset;
+} StaticMapSlot;
+
+// An entry of a `StaticMap`.  The key bytes follow the sizes and the value
+// starts at the next multiple of `STATICMAP_ALIGNMENT`:
+//
+//       +~~~~~~~~~~~~~~~~~~~~~+~~~~~~~~~~~~~~~~~~~~~+~~~~~~~~~~~~~~~~~~~~~+
+//       ! key_size|value_size ! key bytes | padding ! value bytes|padding !
+//       +~~~~~~~~~~~~~~~~~~~~~+~~~~~~~~~~~~~~~~~~~~~+~~~~~~~~~~~~~~~~~~~~~+
+typedef struct StaticMapEntry {
+  uint64_t key_size;
+  uint64_t value_size;
+  unsigned char data[];
+} StaticMapEntry;
+
+// The `StaticMap` structure is an immutable map built once with a perfect hash
+// function in the style of PTHash: the keys are split into buckets and every
+// bucket gets the pilot that moves all of its keys into free slots.  A lookup
+// hashes the key once, reads the pilot of its bucket and checks the only slot
+// the key can be in; there are no chains, no probe sequences and no locks.
+//
+// The whole map lives in one contiguous buffer described by
+// `StaticMapHeader`.
+//
+// Attributes:
+//  data      - the buffer.
+//  size      - the size of the buffer in bytes.
+//  header    - the header at the start of `data`.
+//  pilots    - the pilot of every bucket.
+//  slots     - the slot array.
+//  owns_data - whether `StaticMapFree()` releases `data`.
+typedef struct StaticMap {
+  const unsigned char* data;
+  size_t size;
+  const StaticMapHeader* header;
+  const uint16_t* pilots;
+  const StaticMapSlot* slots;
+  bool_t owns_data;
+} StaticMap;
+
+// Maps `hash` onto [0, `n`) with a multiply and a shift instead of a modulo.
+//
+// This macro is meant to be protected inside `staticmap` module.
+#define _STATICMAP_REDUCE(hash, n) \
+  ((uint64_t)(((unsigned __int128)(uint64_t)(hash) * (uint64_t)(n)) >> 0x40))
+
+// The number of dense buckets of a map of `bucket_count` buckets.
+//
+// This macro is meant to be protected inside `staticmap` module.
+#define _STATICMAP_DENSE_BUCKETS(bucket_count) \
+  (((bucket_count)*0x3 + 0x9) / 0xA)
+
+// Computes the bucket of a key of hash `hash`.  As in PTHash, 60% of the keys
+// go to the first 30% of the buckets: the dense buckets are placed while the
+// table is still empty, which leaves small buckets for the crowded end of the
+// build.  The low half of the hash picks the group, the high half the bucket.
+//
+// This macro is meant to be protected inside `staticmap` module.
+#define _STATICMAP_BUCKET(hash, bucket_count)                            \
+  ((uint32_t)(hash) < 0x9999999AU                                       \
+       ? _STATICMAP_REDUCE(hash, _STATICMAP_DENSE_BUCKETS(bucket_count)) \
+       : _STATICMAP_DENSE_BUCKETS(bucket_count) +                       \
+             _STATICMAP_REDUCE(                                         \
+                 hash, (bucket_count)-_STATICMAP_DENSE_BUCKETS(bucket_count)))
+
+// Computes the slot a key of hash `hash` lands in under `pilot`.
+//
+// This macro is meant to be protected inside `staticmap` module.
+#define _STATICMAP_SLOT(hash, pilot, slot_count)                     \
+  _STATICMAP_REDUCE(                                                 \
+      MapMixHash((hash_t)((hash) ^                                   \
+                          (uint64_t)(pilot)*0x9E3779B97F4A7C15ULL)), \
+      slot_count)
+
+// Rounds `size` up to a multiple of `STATICMAP_ALIGNMENT`.
+//
+// This macro is meant to be protected inside `staticmap` module.
+#define _STATICMAP_ALIGN(size) \
+  (((size) + STATICMAP_ALIGNMENT - 1) & ~(uint64_t)(STATICMAP_ALIGNMENT - 1))
+
+// Builds a `StaticMap` holding copies of `n` key-value pairs.
+//
+// Params:
+//  map         - A pointer to the `StaticMap` to be built.
+//  keys        - An array of `n` pointers to the keys.
+//  key_sizes   - An array of the `n` key sizes in bytes.
+//  values      - An array of `n` pointers to the values.
+//  value_sizes - An array of the `n` value sizes in bytes.
+//  n           - The number of key-value pairs.
+//
+// Returns:
+//  TRUE on success.  FALSE if an argument is NULL, a key appears twice, an
+//  allocation failed or no perfect hash function was found within
+//  `STATICMAP_MAX_ATTEMPTS` seeds; `map->data` is left NULL then.
+//
+// Remarks:
+//  Keys are hashed and compared byte-wise, by `HashBytes()` and `memcmp()`.
+bool_t StaticMapBuild(StaticMap* const map, const void* const* keys,
+                      const size_t* key_sizes, const void* const* values,
+                      const size_t* value_sizes, const size_t n);
+
+// Builds a `StaticMap` holding copies of the entries of `source`.
+//
+// Remarks:
+//  Every key is taken with the `key_size` it was inserted with, so it must be
+//  looked up with the same number of bytes.  The read lock of `source` is held
+//  while the map is built.
+bool_t StaticMapBuildFromMap(StaticMap* const map, Map* const source);
+
+// Opens a `StaticMap` over the `size` bytes of `data`, as produced by a build,
+// without copying them.  `data` must stay valid, e.g. mapped, until the map is
+// freed, and must be aligned to `STATICMAP_ALIGNMENT`.
+//
+// Returns:
+//  TRUE on success, or FALSE if the header of `data` does not describe a valid
+//  map of `size` bytes.  Only the header is validated, so `data` must come
+//  from a trusted source.
+bool_t StaticMapOpen(StaticMap* const map, const void* const data,
+                     const size_t size);
+
+// Returns the number of entries of `map`.
+size_t StaticMapSize(const StaticMap* const map);
+
+// Frees up a `StaticMap` instance, releasing its buffer unless it was opened
+// with `StaticMapOpen()`.
+void StaticMapFree(StaticMap* const map);
+
+#ifdef __cplusplus
+}
+#endif
+
+#include "staticmap/iterators.h"
+#include "staticmap/ops.h"
+
+#endif  // STLC_INCLUDE_DATA_STATICMAP_STATICMAP_H_
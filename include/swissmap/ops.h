@@ -0,0 +1,88 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_INCLUDE_DATA_SWISSMAP_OPS_H_
+#define STLC_INCLUDE_DATA_SWISSMAP_OPS_H_
+
+#include "swissmap/swissmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Insert a new key-value pair into the swiss map.
+//
+// Args:
+//  map        - A pointer to the map to insert the key-value pair into.
+//  key        - A pointer to the key to insert.
+//  key_size   - The size of the key in bytes.
+//  value      - A pointer to the value to insert.
+//  value_size - The size of the value in bytes.
+//
+// Remarks:
+//  If the map, key, or value pointers are NULL, this function will immediately
+//  return without doing anything.  If a key already exists in the map, its
+//  value will be replaced with the new value.  The existing key is searched
+//  for and the insertion slot is picked in the same group-wise probe, unless
+//  the table has to be rebuilt first, in which case the slot is probed for
+//  again.  A new key is not inserted if the table is full and cannot grow.
+//
+// Thread Safety:
+//  This function locks the mutex associated with the map.
+void SwissMapInsert(SwissMap *const map, const void *const key,
+                    const size_t key_size, const void *const value,
+                    const size_t value_size);
+
+// Retrieve the value associated with the given key in the swiss map.
+//
+// Returns:
+//  A pointer to the value associated with the key, or NULL if the key is not
+//  found in the map.
+//
+// Remarks:
+//  Each probe step compares the fingerprint of `key` against a whole group of
+//  control bytes and only dereferences slots whose fingerprint matches.  The
+//  probe stops at the first group that has an empty control byte.  This
+//  function locks the mutex associated with the map.
+void *SwissMapGet(SwissMap *const map, const void *key);
+
+// Remove an entry from the swiss map with the given key.
+//
+// Effects:
+//  * Removes an entry from the map with the given key, if it exists.
+//  * Marks the slot empty when its group still has an empty slot, or leaves a
+//    tombstone otherwise so probes passing through the group keep going.
+//  * Frees the memory used by the removed entry.
+void SwissMapRemove(SwissMap *const map, const void *key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // STLC_INCLUDE_DATA_SWISSMAP_OPS_H_
@@ -0,0 +1,199 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_INCLUDE_DATA_SWISSMAP_SWISSMAP_H_
+#define STLC_INCLUDE_DATA_SWISSMAP_SWISSMAP_H_
+
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "bool.h"
+#include "map/map.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Number of control bytes compared at once.  The slot array is split into
+// aligned groups of this many slots and probing moves one group at a time.
+#define SWISSMAP_GROUP_WIDTH 0x10
+
+// The table is rebuilt once live entries plus tombstones exceed 7/8 of the
+// slots.
+#define SWISSMAP_MAX_LOAD_NUMERATOR 0x7
+#define SWISSMAP_MAX_LOAD_DENOMINATOR 0x8
+
+// Control byte values.  A full slot stores the low 7 bits of its mixed hash
+// (its fingerprint), so the high bit tells free slots from full ones.
+//
+// clang-format off
+#define SWISSMAP_CTRL_EMPTY   ((int8_t)-128)  // 0b10000000
+#define SWISSMAP_CTRL_DELETED ((int8_t)-2)    // 0b11111110
+// clang-format on
+
+// A single slot of the `SwissMap` table.  The key and the value are copied into
+// one block pointed to by `data`; the key bytes are padded so the value is
+// aligned to `MAP_ENTRY_ALIGNMENT` like the value of a `MapEntry`.
+typedef struct SwissMapSlot {
+  hash_t hash;
+  unsigned char* data;
+  size_t key_size;
+} SwissMapSlot;
+
+// The `SwissMap` structure is an open-addressing hash table that keeps a 1-byte
+// control array alongside its slots:
+//
+//       ctrl  : [ h2|h2|--|h2|..16..|h2 ][ h2|--|--|h2|..16..|h2 ] ...
+//       slots : [ s0|s1|s2|s3|..16..|sF ][ s0|s1|s2|s3|..16..|sF ] ...
+//
+// A lookup hashes the key once, picks a starting group with the high bits of
+// the mixed hash and compares the low 7 bits against the 16 control bytes of
+// the group with a single SSE2 instruction, or as two 64-bit words with SWAR
+// bit tricks where SSE2 is not available.  The slot array is only touched for
+// fingerprint matches.  It takes the same `hash_f` and `key_eq_f` callbacks as
+// `Map`.
+//
+// Attributes:
+//  hash_func   - a function pointer to the hash function used to generate hash
+//                values for keys.
+//  key_eq_func - a function pointer to the key equality function used to
+//                compare keys for equality.
+//  ctrl        - `capacity` control bytes.
+//  slots       - `capacity` slots.
+//  capacity    - the number of slots, a power of two multiple of
+//                `SWISSMAP_GROUP_WIDTH`.
+//  size        - the number of live entries.
+//  tombstones  - the number of `SWISSMAP_CTRL_DELETED` control bytes.
+//  mutex       - a mutex used to synchronize access to the table in a
+//                multi-threaded context.
+typedef struct SwissMap {
+  hash_f hash_func;
+  key_eq_f key_eq_func;
+  int8_t* ctrl;
+  SwissMapSlot* slots;
+  size_t capacity;
+  size_t size;
+  size_t tombstones;
+  pthread_mutex_t mutex;
+} SwissMap;
+
+// Offset of the value bytes inside the `data` block of a slot holding a key of
+// `key_size` bytes.
+//
+// This macro is meant to be protected inside `swissmap` module.
+#define _SWISSMAP_VALUE_OFFSET(key_size)  \
+  (((key_size) + MAP_ENTRY_ALIGNMENT - 1) & \
+   ~(size_t)(MAP_ENTRY_ALIGNMENT - 1))
+
+// Initializes a new instance of the `SwissMap` data structure.
+//
+// Params:
+//  map         - A pointer to the `SwissMap` to be initialized.
+//  capacity    - The minimum number of slots to allocate; it is rounded up to
+//                the next power of two and to at least `SWISSMAP_GROUP_WIDTH`.
+//  hash_func   - A pointer to the hash function used to calculate hash codes
+//                for keys.
+//  key_eq_func - A pointer to the key comparison function used to compare keys
+//                for equality.
+//
+// Remarks:
+//  If the pointer passed to `map` is NULL, this function returns immediately
+//  without doing anything.  On allocation failure `map->slots` is left NULL.
+void SwissMapInit(SwissMap* const map, const size_t capacity,
+                  hash_f hash_func, key_eq_f key_eq_func);
+
+// Re-allocates the table of `map` to hold `capacity` slots, rounded up to a
+// power of two, re-inserting all the entries and dropping every tombstone.
+// The caller must hold the mutex of `map`.
+//
+// Returns:
+//  `FALSE` if `capacity` slots cannot hold the current entries under the
+//  maximum load factor or could not be allocated, in which case `map` is left
+//  unchanged.
+//
+// This function is meant to be protected inside `swissmap` module.
+bool_t _SwissMapReallocLocked(SwissMap* const map, const size_t capacity);
+
+// Re-allocates the table of a `SwissMap` to hold `new_capacity` slots (rounded
+// up to a power of two), re-inserting all the entries and dropping every
+// tombstone.
+//
+// Remarks:
+//  The request is ignored if `new_capacity` slots cannot hold the current
+//  entries under the maximum load factor.  This function acquires the map
+//  mutex.
+void SwissMapRealloc(SwissMap* const map, const size_t new_capacity);
+
+// Frees up a `SwissMap` instance and the entries associated with it.
+void SwissMapFree(SwissMap* const map);
+
+// Returns a bit mask with bit `i` set for every control byte `i` of the group
+// starting at `ctrl` that equals `h2`.
+//
+// This function is meant to be protected inside `swissmap` module.
+uint32_t _SwissMapMatch(const int8_t* const ctrl, const int8_t h2);
+
+// Returns a bit mask with bit `i` set for every control byte `i` of the group
+// starting at `ctrl` that is `SWISSMAP_CTRL_EMPTY`.
+//
+// This function is meant to be protected inside `swissmap` module.
+uint32_t _SwissMapMatchEmpty(const int8_t* const ctrl);
+
+// Returns a bit mask with bit `i` set for every control byte `i` of the group
+// starting at `ctrl` that is either empty or deleted.
+//
+// This function is meant to be protected inside `swissmap` module.
+uint32_t _SwissMapMatchEmptyOrDeleted(const int8_t* const ctrl);
+
+// Index of the group a probe for `hash` starts at.
+//
+// This macro is meant to be protected inside `swissmap` module.
+#define _SWISSMAP_H1(map, hash) \
+  ((MapMixHash(hash) >> 7) & ((map)->capacity / SWISSMAP_GROUP_WIDTH - 1))
+
+// The 7-bit fingerprint stored in the control byte of `hash`.
+//
+// This macro is meant to be protected inside `swissmap` module.
+#define _SWISSMAP_H2(hash) ((int8_t)(MapMixHash(hash) & 0x7F))
+
+// Places an entry known to be absent from `map` into the first free slot of
+// its probe sequence and returns the slot index.
+//
+// This function is meant to be protected inside `swissmap` module.
+size_t _SwissMapPlace(SwissMap* const map, const hash_t hash);
+
+#ifdef __cplusplus
+}
+#endif
+
+#include "swissmap/iterators.h"
+#include "swissmap/ops.h"
+
+#endif  // STLC_INCLUDE_DATA_SWISSMAP_SWISSMAP_H_
@@ -0,0 +1,263 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "btreemap/btreemap.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bool.h"
+
+// Rounds `size` up to the next multiple of the power of two `alignment`.
+#define ALIGN_UP(size, alignment) \
+  (((size) + (alignment)-1) & ~(size_t)((alignment)-1))
+
+// Returns the number of keys and values a leaf of `node_size` bytes holds.
+static size_t ComputeBTreeMapLeafCapacity(const size_t node_size,
+                                          const size_t key_size,
+                                          const size_t value_size) {
+  const size_t header = offsetof(BTreeMapNode, data);
+  if (node_size <= header) return 0;
+  size_t capacity = (node_size - header) / (key_size + value_size);
+  while (capacity > 0 &&
+         ALIGN_UP(header + capacity * key_size, 0x10) + capacity * value_size >
+             node_size)
+    --capacity;
+  return capacity;
+}
+
+// Returns the number of separator keys an inner node of `node_size` bytes
+// holds along with one more child.
+static size_t ComputeBTreeMapInnerCapacity(const size_t node_size,
+                                           const size_t key_size) {
+  const size_t header = offsetof(BTreeMapNode, data);
+  const size_t child = sizeof(BTreeMapNode*);
+  if (node_size <= header + child) return 0;
+  size_t capacity = (node_size - header - child) / (key_size + child);
+  while (capacity > 0 && ALIGN_UP(header + capacity * key_size, child) +
+                                (capacity + 1) * child >
+                            node_size)
+    --capacity;
+  return capacity;
+}
+
+// Allocates a node of `map`, a leaf if `leaf` is TRUE, with no keys.
+//
+// This function is meant to be protected inside `btreemap` module.
+BTreeMapNode* _BTreeMapNodeNew(const BTreeMap* const map, const bool_t leaf) {
+  void* memory;
+  if (posix_memalign(&memory, BTREEMAP_CACHE_LINE, map->node_size) != 0) {
+    fprintf(stderr, "_BTreeMapNodeNew: failed to allocate node of size: %zu\n",
+            map->node_size);
+    return NULL;
+  }
+  BTreeMapNode* const node = (BTreeMapNode*)memory;
+  node->count = 0;
+  node->leaf = leaf;
+  node->prev = NULL;
+  node->next = NULL;
+  return node;
+}
+
+// Frees `node` and every node below it.
+//
+// This function is meant to be protected inside `btreemap` module.
+void _BTreeMapNodeFree(const BTreeMap* const map, BTreeMapNode* const node) {
+  if (node == NULL) return;
+  if (node->leaf == FALSE) {
+    BTreeMapNode** const children = _BTREEMAP_CHILDREN(map, node);
+    for (size_t i = 0; i <= node->count; ++i)
+      _BTreeMapNodeFree(map, children[i]);
+  }
+  free(node);
+}
+
+// Returns the position of the first key of `node` not ordering before `key`,
+// setting `*found` if it is equal to `key`.
+//
+// This function is meant to be protected inside `btreemap` module.
+size_t _BTreeMapLowerBound(const BTreeMap* const map,
+                           const BTreeMapNode* const node, const void* key,
+                           bool_t* const found) {
+  size_t low = 0, high = node->count;
+  while (low < high) {
+    const size_t middle = low + ((high - low) >> 0x01);
+    if (map->key_cmp_func(_BTREEMAP_KEY(map, node, middle), key) < 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  *found = low < node->count &&
+                   map->key_cmp_func(_BTREEMAP_KEY(map, node, low), key) == 0
+               ? TRUE
+               : FALSE;
+  return low;
+}
+
+// Returns the index of the child of the inner `node` that `key` belongs to.
+//
+// This function is meant to be protected inside `btreemap` module.
+size_t _BTreeMapChildIndex(const BTreeMap* const map,
+                           const BTreeMapNode* const node, const void* key) {
+  // A separator is the smallest key of the child to its right, so keys equal
+  // to it go right.
+  size_t low = 0, high = node->count;
+  while (low < high) {
+    const size_t middle = low + ((high - low) >> 0x01);
+    if (map->key_cmp_func(_BTREEMAP_KEY(map, node, middle), key) <= 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+// Returns the leaf `key` belongs to.  The caller must hold the lock of `map`.
+//
+// This function is meant to be protected inside `btreemap` module.
+BTreeMapNode* _BTreeMapFindLeaf(const BTreeMap* const map, const void* key) {
+  BTreeMapNode* node = map->root;
+  while (node->leaf == FALSE) {
+    node = _BTREEMAP_CHILDREN(map, node)[_BTreeMapChildIndex(map, node, key)];
+    _BTREEMAP_PREFETCH(map, node);
+  }
+  return node;
+}
+
+// Fills `config` with the given sizes and comparator and the default node
+// size.
+void BTreeMapConfigInit(BTreeMapConfig* const config, const size_t key_size,
+                        const size_t value_size, key_cmp_f key_cmp_func) {
+  if (config == NULL) return;
+  config->key_size = key_size;
+  config->value_size = value_size;
+  config->node_size = BTREEMAP_NODE_SIZE;
+  config->key_cmp_func = key_cmp_func;
+}
+
+// Initializes a new, empty instance of the `BTreeMap` data structure.
+//
+// Params:
+//  map          - A pointer to the `BTreeMap` to be initialized.
+//  key_size     - The size of every key in bytes.
+//  value_size   - The size of every value in bytes.
+//  key_cmp_func - A pointer to the function used to order the keys.
+//
+// Remarks:
+//  If the pointer passed to `map` is NULL, this function returns immediately
+//  without doing anything.  On failure `map->root` is left NULL.
+void BTreeMapInit(BTreeMap* const map, const size_t key_size,
+                  const size_t value_size, key_cmp_f key_cmp_func) {
+  BTreeMapConfig config;
+  BTreeMapConfigInit(&config, key_size, value_size, key_cmp_func);
+  BTreeMapInitWithConfig(map, &config);
+}
+
+// Initializes a new, empty instance of the `BTreeMap` data structure as
+// described by `config`.
+void BTreeMapInitWithConfig(BTreeMap* const map,
+                            const BTreeMapConfig* const config) {
+  if (map == NULL) return;
+  map->root = NULL;
+  if (config == NULL || config->key_cmp_func == NULL ||
+      config->key_size == 0) {
+    fprintf(stderr,
+            "BTreeMapInitWithConfig: key comparison and key_size required\n");
+    return;
+  }
+
+  map->key_cmp_func = config->key_cmp_func;
+  map->key_size = config->key_size;
+  map->value_size = config->value_size;
+  size_t node_size = ALIGN_UP(config->node_size, BTREEMAP_CACHE_LINE);
+  while (ComputeBTreeMapLeafCapacity(node_size, map->key_size,
+                                     map->value_size) < BTREEMAP_MIN_FANOUT ||
+         ComputeBTreeMapInnerCapacity(node_size, map->key_size) <
+             BTREEMAP_MIN_FANOUT)
+    node_size += BTREEMAP_CACHE_LINE;
+  map->node_size = node_size;
+  map->leaf_capacity =
+      ComputeBTreeMapLeafCapacity(node_size, map->key_size, map->value_size);
+  map->inner_capacity = ComputeBTreeMapInnerCapacity(node_size, map->key_size);
+  map->values_offset = ALIGN_UP(
+      offsetof(BTreeMapNode, data) + map->leaf_capacity * map->key_size, 0x10);
+  map->children_offset =
+      ALIGN_UP(offsetof(BTreeMapNode, data) +
+                   map->inner_capacity * map->key_size,
+               sizeof(BTreeMapNode*));
+  map->height = 1;
+  map->size = 0;
+
+  // An inner node being split holds one key and one child more than it can;
+  // the children come first to keep them aligned, then the keys and the
+  // separator moving up.
+  map->scratch = (unsigned char*)malloc(
+      (map->inner_capacity + 0x02) * sizeof(BTreeMapNode*) +
+      (map->inner_capacity + 0x02) * map->key_size);
+  BTreeMapNode* const root = _BTreeMapNodeNew(map, TRUE);
+  if (map->scratch == NULL || root == NULL) {
+    fprintf(stderr, "BTreeMapInitWithConfig: failed to allocate tree\n");
+    free(map->scratch);
+    free(root);
+    return;
+  }
+  map->root = root;
+  map->first = root;
+  pthread_rwlock_init(&map->lock, NULL);
+}
+
+// Returns the number of keys of `map`.
+size_t BTreeMapSize(BTreeMap* const map) {
+  if (map == NULL || map->root == NULL) return 0;
+
+  pthread_rwlock_rdlock(&map->lock);
+  const size_t size = map->size;
+  pthread_rwlock_unlock(&map->lock);
+  return size;
+}
+
+// Frees up a `BTreeMap` instance and the nodes associated with it.
+void BTreeMapFree(BTreeMap* const map) {
+  if (map == NULL || map->root == NULL) return;
+
+  pthread_rwlock_wrlock(&map->lock);
+  _BTreeMapNodeFree(map, map->root);
+  free(map->scratch);
+  map->root = NULL;
+  map->first = NULL;
+  map->scratch = NULL;
+  map->height = 0;
+  map->size = 0;
+  pthread_rwlock_unlock(&map->lock);
+  pthread_rwlock_destroy(&map->lock);
+}
@@ -0,0 +1,154 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "btreemap/iterators.h"
+
+#include <pthread.h>
+
+#include "bool.h"
+#include "btreemap/btreemap.h"
+
+// Traverses the tree in ascending key order and calls the given predicate
+// function on each entry.
+//
+// Params:
+//  map       - A pointer to the tree to traverse.
+//  predicate - A function pointer to the predicate function to call on each
+//              key and value.  Traversal stops as soon as it returns `FALSE`.
+//
+// Remarks:
+//  The function holds the read lock of the tree, so `predicate` may look keys
+//  up but must not insert or remove any.
+void BTreeMapTraverse(BTreeMap *const map,
+                      bool_t (*predicate)(const void *key, const void *value)) {
+  BTreeMapRange(map, NULL, NULL, predicate);
+}
+
+// Traverses the keys `low <= key < high` of the tree in ascending order like
+// `BTreeMapTraverse()`.
+//
+// Params:
+//  map       - A pointer to the tree to traverse.
+//  low       - The first key of the range, or NULL to start at the smallest.
+//  high      - The key ending the range, or NULL to run to the largest.
+//  predicate - The function called on each key and value in the range.
+//
+// Returns:
+//  The number of keys `predicate` was called on.
+//
+// Remarks:
+//  One descent finds `low`; the rest of the range is a sequential walk of the
+//  leaves.  A prefix scan is the range from the prefix to its successor.
+size_t BTreeMapRange(BTreeMap *const map, const void *const low,
+                     const void *const high,
+                     bool_t (*predicate)(const void *key, const void *value)) {
+  if (map == NULL || map->root == NULL || predicate == NULL) return 0;
+
+  pthread_rwlock_rdlock(&map->lock);
+  BTreeMapNode *node = map->first;
+  size_t index = 0;
+  if (low != NULL) {
+    bool_t found;
+    node = _BTreeMapFindLeaf(map, low);
+    index = _BTreeMapLowerBound(map, node, low, &found);
+  }
+
+  size_t visited = 0;
+  bool_t running = TRUE;
+  for (; node != NULL && running == TRUE; node = node->next, index = 0) {
+    if (node->next != NULL) _BTREEMAP_PREFETCH(map, node->next);
+    // When the last key of the leaf is below `high`, so are all the others.
+    const bool_t bounded =
+        high != NULL && node->count != 0 &&
+                map->key_cmp_func(_BTREEMAP_KEY(map, node, node->count - 1),
+                                  high) >= 0
+            ? TRUE
+            : FALSE;
+    for (; index < node->count; ++index) {
+      const void *const key = _BTREEMAP_KEY(map, node, index);
+      if (bounded == TRUE && map->key_cmp_func(key, high) >= 0) {
+        running = FALSE;
+        break;
+      }
+      ++visited;
+      if (predicate(key, _BTREEMAP_VALUE(map, node, index)) == FALSE) {
+        running = FALSE;
+        break;
+      }
+    }
+  }
+  pthread_rwlock_unlock(&map->lock);
+  return visited;
+}
+
+// Creates an iterator positioned at the first key of `map` not ordering before
+// `key`, or at the smallest key if `key` is NULL.
+//
+// Remarks:
+//  The iterator takes no lock; the tree must not be modified while it is in
+//  use.
+BTreeMapIterator BTreeMapSeek(BTreeMap *const map, const void *const key) {
+  BTreeMapIterator iterator;
+  iterator.map = map;
+  iterator.node = NULL;
+  iterator.index = 0;
+  if (map == NULL || map->root == NULL) return iterator;
+
+  if (key == NULL) {
+    iterator.node = map->first;
+  } else {
+    bool_t found;
+    iterator.node = _BTreeMapFindLeaf(map, key);
+    iterator.index = _BTreeMapLowerBound(map, iterator.node, key, &found);
+  }
+  return iterator;
+}
+
+// Advances `iterator`, storing the pointers to the key and the value it was
+// positioned at into `key` and `value`, either of which may be NULL.
+//
+// Returns:
+//  FALSE once every key was returned, TRUE otherwise.
+bool_t BTreeMapIteratorNext(BTreeMapIterator *const iterator,
+                            const void **const key, const void **const value) {
+  if (iterator == NULL) return FALSE;
+
+  while (iterator->node != NULL && iterator->index >= iterator->node->count) {
+    iterator->node = iterator->node->next;
+    iterator->index = 0;
+  }
+  if (iterator->node == NULL) return FALSE;
+
+  if (key != NULL)
+    *key = _BTREEMAP_KEY(iterator->map, iterator->node, iterator->index);
+  if (value != NULL)
+    *value = _BTREEMAP_VALUE(iterator->map, iterator->node, iterator->index);
+  ++(iterator->index);
+  return TRUE;
+}
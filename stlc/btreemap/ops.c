@@ -0,0 +1,456 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "btreemap/ops.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bool.h"
+#include "btreemap/btreemap.h"
+
+// Inserts `key` and `value` at position `pos` of the leaf `node`, which has
+// room for them.
+static void InsertBTreeMapLeaf(const BTreeMap *const map,
+                               BTreeMapNode *const node, const size_t pos,
+                               const void *const key,
+                               const void *const value) {
+  const size_t moved = node->count - pos;
+  memmove(_BTREEMAP_KEY(map, node, pos + 1), _BTREEMAP_KEY(map, node, pos),
+          moved * map->key_size);
+  memcpy(_BTREEMAP_KEY(map, node, pos), key, map->key_size);
+  if (map->value_size != 0) {
+    memmove(_BTREEMAP_VALUE(map, node, pos + 1),
+            _BTREEMAP_VALUE(map, node, pos), moved * map->value_size);
+    memcpy(_BTREEMAP_VALUE(map, node, pos), value, map->value_size);
+  }
+  ++(node->count);
+}
+
+// Hands the separator in the scratch area of `map` and the new node `right`
+// to the inner nodes on `path`, from the bottom up, splitting the full ones
+// with the nodes of `spare` and growing a new root if the top one splits.
+static void InsertBTreeMapSeparator(BTreeMap *const map,
+                                    BTreeMapNode **const path,
+                                    const size_t *const slots, size_t depth,
+                                    BTreeMapNode *right,
+                                    BTreeMapNode **spare) {
+  const size_t capacity = map->inner_capacity;
+  BTreeMapNode **const children = (BTreeMapNode **)map->scratch;
+  unsigned char *const keys =
+      map->scratch + (capacity + 0x02) * sizeof(BTreeMapNode *);
+  unsigned char *const separator = keys + (capacity + 0x01) * map->key_size;
+
+  while (depth > 0) {
+    BTreeMapNode *const parent = path[--depth];
+    const size_t slot = slots[depth];
+    const size_t count = parent->count;
+    BTreeMapNode **const parent_children = _BTREEMAP_CHILDREN(map, parent);
+    if (count < capacity) {
+      memmove(_BTREEMAP_KEY(map, parent, slot + 1),
+              _BTREEMAP_KEY(map, parent, slot), (count - slot) * map->key_size);
+      memcpy(_BTREEMAP_KEY(map, parent, slot), separator, map->key_size);
+      memmove(&parent_children[slot + 2], &parent_children[slot + 1],
+              (count - slot) * sizeof(BTreeMapNode *));
+      parent_children[slot + 1] = right;
+      ++(parent->count);
+      return;
+    }
+
+    // Lay the overfull node out in the scratch area, then share it out.
+    memcpy(keys, _BTREEMAP_KEY(map, parent, 0), slot * map->key_size);
+    memcpy(keys + slot * map->key_size, separator, map->key_size);
+    memcpy(keys + (slot + 1) * map->key_size, _BTREEMAP_KEY(map, parent, slot),
+           (count - slot) * map->key_size);
+    memcpy(children, parent_children, (slot + 1) * sizeof(BTreeMapNode *));
+    children[slot + 1] = right;
+    memcpy(&children[slot + 2], &parent_children[slot + 1],
+           (count - slot) * sizeof(BTreeMapNode *));
+
+    const size_t middle = (count + 1) >> 0x01;
+    BTreeMapNode *const sibling = *spare++;
+    memcpy(_BTREEMAP_KEY(map, parent, 0), keys, middle * map->key_size);
+    memcpy(parent_children, children, (middle + 1) * sizeof(BTreeMapNode *));
+    parent->count = (uint32_t)middle;
+    memcpy(_BTREEMAP_KEY(map, sibling, 0), keys + (middle + 1) * map->key_size,
+           (count - middle) * map->key_size);
+    memcpy(_BTREEMAP_CHILDREN(map, sibling), &children[middle + 1],
+           (count - middle + 1) * sizeof(BTreeMapNode *));
+    sibling->count = (uint32_t)(count - middle);
+    memcpy(separator, keys + middle * map->key_size, map->key_size);
+    right = sibling;
+  }
+
+  BTreeMapNode *const root = *spare;
+  memcpy(_BTREEMAP_KEY(map, root, 0), separator, map->key_size);
+  _BTREEMAP_CHILDREN(map, root)[0] = map->root;
+  _BTREEMAP_CHILDREN(map, root)[1] = right;
+  root->count = 1;
+  map->root = root;
+  ++(map->height);
+}
+
+// Insert a new key-value pair into the tree.
+//
+// Params:
+//  map   - A pointer to the tree to insert the key-value pair into.
+//  key   - A pointer to the `key_size` bytes of the key.
+//  value - A pointer to the `value_size` bytes of the value; may be NULL if
+//          `value_size` is zero.
+//
+// Remarks:
+//  If the key already exists in the tree, its value is replaced.  A full leaf
+//  is split in two halves, except the rightmost leaf when the key goes past
+//  its end, which keeps its keys so that ascending inserts fill leaves up.
+//
+// Thread Safety:
+//  This function holds the write lock of the tree.
+void BTreeMapInsert(BTreeMap *const map, const void *const key,
+                    const void *const value) {
+  if (map == NULL || map->root == NULL || key == NULL ||
+      (value == NULL && map->value_size != 0))
+    return;
+
+  pthread_rwlock_wrlock(&map->lock);
+  BTreeMapNode *path[BTREEMAP_MAX_DEPTH];
+  size_t slots[BTREEMAP_MAX_DEPTH];
+  size_t depth = 0;
+  BTreeMapNode *node = map->root;
+  while (node->leaf == FALSE) {
+    const size_t slot = _BTreeMapChildIndex(map, node, key);
+    path[depth] = node;
+    slots[depth++] = slot;
+    node = _BTREEMAP_CHILDREN(map, node)[slot];
+  }
+
+  bool_t found;
+  const size_t pos = _BTreeMapLowerBound(map, node, key, &found);
+  if (found == TRUE) {
+    if (map->value_size != 0)
+      memcpy(_BTREEMAP_VALUE(map, node, pos), value, map->value_size);
+    pthread_rwlock_unlock(&map->lock);
+    return;
+  }
+  if (node->count < map->leaf_capacity) {
+    InsertBTreeMapLeaf(map, node, pos, key, value);
+    ++(map->size);
+    pthread_rwlock_unlock(&map->lock);
+    return;
+  }
+
+  // Allocate every node the split needs up front so that a failure leaves
+  // the tree untouched: the new leaf, a sibling for every full inner node
+  // above it and a new root if they are all full.
+  BTreeMapNode *spare[BTREEMAP_MAX_DEPTH + 0x02];
+  size_t needed = 1;
+  size_t full = depth;
+  while (full > 0 && path[full - 1]->count == map->inner_capacity) {
+    --full;
+    ++needed;
+  }
+  if (full == 0) ++needed;
+  for (size_t i = 0; i < needed; ++i) {
+    spare[i] = _BTreeMapNodeNew(map, i == 0 ? TRUE : FALSE);
+    if (spare[i] == NULL) {
+      while (i > 0) free(spare[--i]);
+      pthread_rwlock_unlock(&map->lock);
+      return;
+    }
+  }
+
+  BTreeMapNode *const right = spare[0];
+  const size_t count = node->count;
+  const size_t split =
+      pos == count && node->next == NULL ? count : (count + 1) >> 0x01;
+  memcpy(_BTREEMAP_KEY(map, right, 0), _BTREEMAP_KEY(map, node, split),
+         (count - split) * map->key_size);
+  if (map->value_size != 0) {
+    memcpy(_BTREEMAP_VALUE(map, right, 0), _BTREEMAP_VALUE(map, node, split),
+           (count - split) * map->value_size);
+  }
+  right->count = (uint32_t)(count - split);
+  node->count = (uint32_t)split;
+  right->prev = node;
+  right->next = node->next;
+  if (node->next != NULL) node->next->prev = right;
+  node->next = right;
+  if (pos < split) {
+    InsertBTreeMapLeaf(map, node, pos, key, value);
+  } else {
+    InsertBTreeMapLeaf(map, right, pos - split, key, value);
+  }
+  ++(map->size);
+
+  unsigned char *const separator =
+      map->scratch + (map->inner_capacity + 0x02) * sizeof(BTreeMapNode *) +
+      (map->inner_capacity + 0x01) * map->key_size;
+  memcpy(separator, _BTREEMAP_KEY(map, right, 0), map->key_size);
+  InsertBTreeMapSeparator(map, path, slots, depth, right, &spare[1]);
+  pthread_rwlock_unlock(&map->lock);
+}
+
+// Retrieve the value associated with `key`.
+//
+// Returns:
+//  A pointer to the value, or NULL if the key is not present.  Values live
+//  inside the leaves, so the pointer is only valid until the next insert or
+//  remove.
+//
+// Thread Safety:
+//  This function only holds the read lock of the tree.
+void *BTreeMapGet(BTreeMap *const map, const void *const key) {
+  if (map == NULL || map->root == NULL || key == NULL) return NULL;
+
+  pthread_rwlock_rdlock(&map->lock);
+  BTreeMapNode *const leaf = _BTreeMapFindLeaf(map, key);
+  bool_t found;
+  const size_t pos = _BTreeMapLowerBound(map, leaf, key, &found);
+  void *const value = found == TRUE ? _BTREEMAP_VALUE(map, leaf, pos) : NULL;
+  pthread_rwlock_unlock(&map->lock);
+  return value;
+}
+
+// Remove the entry of `key` from the tree.
+//
+// Returns:
+//  TRUE if an entry was removed, FALSE if the key was not present.
+//
+// Remarks:
+//  Nodes are not rebalanced: a leaf is only freed once its last key is gone,
+//  as in many database B+-trees, so removes never move keys across nodes.
+//
+// Thread Safety:
+//  This function holds the write lock of the tree.
+bool_t BTreeMapRemove(BTreeMap *const map, const void *const key) {
+  if (map == NULL || map->root == NULL || key == NULL) return FALSE;
+
+  pthread_rwlock_wrlock(&map->lock);
+  BTreeMapNode *path[BTREEMAP_MAX_DEPTH];
+  size_t slots[BTREEMAP_MAX_DEPTH];
+  size_t depth = 0;
+  BTreeMapNode *node = map->root;
+  while (node->leaf == FALSE) {
+    const size_t slot = _BTreeMapChildIndex(map, node, key);
+    path[depth] = node;
+    slots[depth++] = slot;
+    node = _BTREEMAP_CHILDREN(map, node)[slot];
+  }
+
+  bool_t found;
+  const size_t pos = _BTreeMapLowerBound(map, node, key, &found);
+  if (found == FALSE) {
+    pthread_rwlock_unlock(&map->lock);
+    return FALSE;
+  }
+  const size_t moved = node->count - pos - 1;
+  memmove(_BTREEMAP_KEY(map, node, pos), _BTREEMAP_KEY(map, node, pos + 1),
+          moved * map->key_size);
+  if (map->value_size != 0) {
+    memmove(_BTREEMAP_VALUE(map, node, pos),
+            _BTREEMAP_VALUE(map, node, pos + 1), moved * map->value_size);
+  }
+  --(node->count);
+  --(map->size);
+
+  if (node->count == 0 && node != map->root) {
+    if (node->prev != NULL) {
+      node->prev->next = node->next;
+    } else {
+      map->first = node->next;
+    }
+    if (node->next != NULL) node->next->prev = node->prev;
+    free(node);
+
+    // Drop the child from its parent, and the parents left without children.
+    while (depth > 0) {
+      BTreeMapNode *const parent = path[--depth];
+      if (parent->count == 0) {
+        free(parent);
+        continue;
+      }
+      const size_t slot = slots[depth];
+      const size_t separator = slot == 0 ? 0 : slot - 1;
+      memmove(_BTREEMAP_KEY(map, parent, separator),
+              _BTREEMAP_KEY(map, parent, separator + 1),
+              (parent->count - separator - 1) * map->key_size);
+      BTreeMapNode **const children = _BTREEMAP_CHILDREN(map, parent);
+      memmove(&children[slot], &children[slot + 1],
+              (parent->count - slot) * sizeof(BTreeMapNode *));
+      --(parent->count);
+      break;
+    }
+    while (map->root->leaf == FALSE && map->root->count == 0) {
+      BTreeMapNode *const root = map->root;
+      map->root = _BTREEMAP_CHILDREN(map, root)[0];
+      free(root);
+      --(map->height);
+    }
+  }
+  pthread_rwlock_unlock(&map->lock);
+  return TRUE;
+}
+
+// Loads `n` keys sorted in strictly ascending order into an empty tree in
+// O(n), building the leaves and then every inner level from left to right.
+//
+// Params:
+//  map    - A pointer to the empty tree to load.
+//  keys   - The `n` keys laid out back to back, `key_size` bytes each.
+//  values - The `n` values laid out back to back, `value_size` bytes each;
+//           may be NULL if `value_size` is zero.
+//  n      - The number of keys.
+//
+// Returns:
+//  TRUE on success, FALSE if the tree is not empty, the keys are not sorted
+//  or the nodes could not be allocated, in which case the tree is left as is.
+//
+// Remarks:
+//  The keys are spread evenly over as few nodes as possible, so the loaded
+//  tree is as short and dense as it can be with every node at least half
+//  full.
+//
+// Thread Safety:
+//  This function holds the write lock of the tree.
+bool_t BTreeMapBulkLoad(BTreeMap *const map, const void *const keys,
+                        const void *const values, const size_t n) {
+  if (map == NULL || map->root == NULL ||
+      (n != 0 && (keys == NULL || (values == NULL && map->value_size != 0))))
+    return FALSE;
+
+  const unsigned char *const key_bytes = (const unsigned char *)keys;
+  pthread_rwlock_wrlock(&map->lock);
+  if (map->size != 0) {
+    fprintf(stderr, "BTreeMapBulkLoad: tree is not empty\n");
+    pthread_rwlock_unlock(&map->lock);
+    return FALSE;
+  }
+  for (size_t i = 1; i < n; ++i) {
+    if (map->key_cmp_func(key_bytes + (i - 1) * map->key_size,
+                          key_bytes + i * map->key_size) >= 0) {
+      fprintf(stderr, "BTreeMapBulkLoad: keys not ascending at index: %zu\n",
+              i);
+      pthread_rwlock_unlock(&map->lock);
+      return FALSE;
+    }
+  }
+  if (n == 0) {
+    pthread_rwlock_unlock(&map->lock);
+    return TRUE;
+  }
+
+  size_t count = (n + map->leaf_capacity - 1) / map->leaf_capacity;
+  BTreeMapNode **const level =
+      (BTreeMapNode **)malloc(count * sizeof(BTreeMapNode *));
+  const unsigned char **const lows =
+      (const unsigned char **)malloc(count * sizeof(unsigned char *));
+  if (level == NULL || lows == NULL) {
+    fprintf(stderr, "BTreeMapBulkLoad: failed to allocate %zu leaves\n",
+            count);
+    free(level);
+    free(lows);
+    pthread_rwlock_unlock(&map->lock);
+    return FALSE;
+  }
+
+  size_t offset = 0;
+  for (size_t j = 0; j < count; ++j) {
+    const size_t m = n / count + (j < n % count ? 1 : 0);
+    BTreeMapNode *const leaf = _BTreeMapNodeNew(map, TRUE);
+    if (leaf == NULL) {
+      while (j > 0) free(level[--j]);
+      free(level);
+      free(lows);
+      pthread_rwlock_unlock(&map->lock);
+      return FALSE;
+    }
+    memcpy(_BTREEMAP_KEY(map, leaf, 0), key_bytes + offset * map->key_size,
+           m * map->key_size);
+    if (map->value_size != 0) {
+      memcpy(_BTREEMAP_VALUE(map, leaf, 0),
+             (const unsigned char *)values + offset * map->value_size,
+             m * map->value_size);
+    }
+    leaf->count = (uint32_t)m;
+    if (j > 0) {
+      leaf->prev = level[j - 1];
+      level[j - 1]->next = leaf;
+    }
+    level[j] = leaf;
+    lows[j] = _BTREEMAP_KEY(map, leaf, 0);
+    offset += m;
+  }
+  BTreeMapNode *const first = level[0];
+  size_t height = 1;
+
+  // Parents are written over the slots of their children, which are always
+  // read before: the first child of parent `p` sits at `p` or later.
+  while (count > 1) {
+    const size_t fanout = map->inner_capacity + 1;
+    const size_t parents = (count + fanout - 1) / fanout;
+    size_t child = 0;
+    for (size_t p = 0; p < parents; ++p) {
+      const size_t m = count / parents + (p < count % parents ? 1 : 0);
+      BTreeMapNode *const parent = _BTreeMapNodeNew(map, FALSE);
+      if (parent == NULL) {
+        for (size_t q = 0; q < p; ++q) _BTreeMapNodeFree(map, level[q]);
+        for (size_t r = child; r < count; ++r) _BTreeMapNodeFree(map, level[r]);
+        free(level);
+        free(lows);
+        pthread_rwlock_unlock(&map->lock);
+        return FALSE;
+      }
+      BTreeMapNode **const children = _BTREEMAP_CHILDREN(map, parent);
+      for (size_t c = 0; c < m; ++c) {
+        children[c] = level[child + c];
+        if (c > 0) {
+          memcpy(_BTREEMAP_KEY(map, parent, c - 1), lows[child + c],
+                 map->key_size);
+        }
+      }
+      parent->count = (uint32_t)(m - 1);
+      lows[p] = lows[child];
+      level[p] = parent;
+      child += m;
+    }
+    count = parents;
+    ++height;
+  }
+
+  _BTreeMapNodeFree(map, map->root);
+  map->root = level[0];
+  map->first = first;
+  map->height = height;
+  map->size = n;
+  free(level);
+  free(lows);
+  pthread_rwlock_unlock(&map->lock);
+  return TRUE;
+}
@@ -0,0 +1,262 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "expiringmap/expiringmap.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "bool.h"
+#include "map/map.h"
+#include "map/ops.h"
+
+// Number of ticks spanned by a slot of level `level`.
+#define EXPIRINGMAP_SLOT_SPAN(level) \
+  ((uint64_t)0x01 << ((level) * EXPIRINGMAP_WHEEL_BITS))
+
+// Number of ticks spanned by the whole of level `level`.
+#define EXPIRINGMAP_LEVEL_SPAN(level) EXPIRINGMAP_SLOT_SPAN((level) + 0x01)
+
+// Returns the index of the slot `level` holds the tick `tick` in.
+#define EXPIRINGMAP_LEVEL_SLOT(tick, level)                  \
+  ((size_t)((tick) >> ((level) * EXPIRINGMAP_WHEEL_BITS)) & \
+   (EXPIRINGMAP_WHEEL_SLOTS - 0x01))
+
+// Returns the wheel slot `deadline` belongs in at the tick `current`: the slot
+// of the finest level whose span still holds both, so that the entry gets
+// cascaded down as the ticks in between go by.
+static size_t ComputeExpiringMapSlot(const uint64_t current,
+                                     uint64_t deadline) {
+  if (deadline < current) deadline = current;
+  for (size_t level = 0; level < EXPIRINGMAP_WHEEL_LEVELS; ++level) {
+    const uint64_t shift = (level + 0x01) * EXPIRINGMAP_WHEEL_BITS;
+    if ((deadline >> shift) == (current >> shift)) {
+      return level * EXPIRINGMAP_WHEEL_SLOTS +
+             EXPIRINGMAP_LEVEL_SLOT(deadline, level);
+    }
+  }
+  return EXPIRINGMAP_OVERFLOW_SLOT;
+}
+
+// Links `entry` into the wheel slot its deadline falls into, given the
+// current tick of `map`.  A deadline already past goes into the slot of the
+// current tick.  The caller must hold the write lock of `map`.
+//
+// This function is meant to be protected inside `expiringmap` module.
+void _ExpiringMapSchedule(ExpiringMap* const map, MapEntry* const entry) {
+  ExpiringMapNode* const node = _EXPIRINGMAP_NODE(entry);
+  const size_t slot = ComputeExpiringMapSlot(map->current, node->deadline);
+  node->slot = slot;
+  node->prev = NULL;
+  node->next = map->slots[slot];
+  if (map->slots[slot] != NULL)
+    _EXPIRINGMAP_NODE(map->slots[slot])->prev = entry;
+  map->slots[slot] = entry;
+  if (slot != EXPIRINGMAP_OVERFLOW_SLOT) {
+    map->occupied[slot / EXPIRINGMAP_WHEEL_SLOTS] |=
+        (uint64_t)0x01 << (slot % EXPIRINGMAP_WHEEL_SLOTS);
+  }
+}
+
+// Unlinks `entry` from its wheel slot.  The caller must hold the write lock of
+// `map`.
+//
+// This function is meant to be protected inside `expiringmap` module.
+void _ExpiringMapUnschedule(ExpiringMap* const map, MapEntry* const entry) {
+  ExpiringMapNode* const node = _EXPIRINGMAP_NODE(entry);
+  if (node->prev != NULL) {
+    _EXPIRINGMAP_NODE(node->prev)->next = node->next;
+  } else {
+    map->slots[node->slot] = node->next;
+  }
+  if (node->next != NULL) _EXPIRINGMAP_NODE(node->next)->prev = node->prev;
+  if (map->slots[node->slot] == NULL &&
+      node->slot != EXPIRINGMAP_OVERFLOW_SLOT) {
+    map->occupied[node->slot / EXPIRINGMAP_WHEEL_SLOTS] &=
+        ~((uint64_t)0x01 << (node->slot % EXPIRINGMAP_WHEEL_SLOTS));
+  }
+  node->prev = NULL;
+  node->next = NULL;
+}
+
+// Unlinks `entry` from the wheel and from the map of `map` and releases it,
+// calling the expiry callback first if `expired`.  The caller must hold the
+// write lock of `map`.
+//
+// This function is meant to be protected inside `expiringmap` module.
+void _ExpiringMapDropLocked(ExpiringMap* const map, MapEntry* const entry,
+                            const bool_t expired) {
+  _ExpiringMapUnschedule(map, entry);
+  if (expired == TRUE && map->on_expire != NULL) {
+    map->on_expire(entry->key, entry->key_size, _EXPIRINGMAP_VALUE(entry),
+                   entry->value_size - EXPIRINGMAP_VALUE_OFFSET,
+                   _EXPIRINGMAP_NODE(entry)->deadline, map->expire_context);
+  }
+  _MapRemoveEntryLocked(&map->map, entry);
+}
+
+// Returns the first tick from the current one on at which the wheel of `map`
+// has work to do, a slot to cascade or to expire, or `UINT64_MAX` if it holds
+// no entry.  The caller must hold the lock of `map`.
+//
+// This function is meant to be protected inside `expiringmap` module.
+uint64_t _ExpiringMapNextEvent(const ExpiringMap* const map) {
+  const uint64_t current = map->current;
+  uint64_t next = UINT64_MAX;
+  for (size_t level = 0; level < EXPIRINGMAP_WHEEL_LEVELS; ++level) {
+    // The slots before the one of the current tick were cascaded or expired
+    // already, so only the ones from it on can hold entries.
+    const size_t first = EXPIRINGMAP_LEVEL_SLOT(current, level);
+    const uint64_t pending = map->occupied[level] & (~(uint64_t)0 << first);
+    if (pending == 0) continue;
+    const uint64_t base = current & ~(EXPIRINGMAP_LEVEL_SPAN(level) - 0x01);
+    uint64_t tick = base + (uint64_t)__builtin_ctzll(pending) *
+                               EXPIRINGMAP_SLOT_SPAN(level);
+    if (tick < current) tick = current;
+    if (tick < next) next = tick;
+  }
+  if (map->slots[EXPIRINGMAP_OVERFLOW_SLOT] != NULL) {
+    // The overflow slot is placed again once the top level wraps around.
+    const uint64_t span = EXPIRINGMAP_LEVEL_SPAN(EXPIRINGMAP_WHEEL_LEVELS - 1);
+    const uint64_t tick = (current + span - 0x01) & ~(span - 0x01);
+    if (tick < next) next = tick;
+  }
+  return next;
+}
+
+// Detaches the list of slot `slot` of `map` and links every entry of it again
+// where its deadline belongs at the current tick.
+static void RescheduleExpiringMapSlot(ExpiringMap* const map,
+                                      const size_t slot) {
+  MapEntry* entry = map->slots[slot];
+  map->slots[slot] = NULL;
+  if (slot != EXPIRINGMAP_OVERFLOW_SLOT) {
+    map->occupied[slot / EXPIRINGMAP_WHEEL_SLOTS] &=
+        ~((uint64_t)0x01 << (slot % EXPIRINGMAP_WHEEL_SLOTS));
+  }
+  while (entry != NULL) {
+    MapEntry* const next_entry = _EXPIRINGMAP_NODE(entry)->next;
+    _ExpiringMapSchedule(map, entry);
+    entry = next_entry;
+  }
+}
+
+// Moves the entries of every slot the current tick of `map` starts down to
+// the lower levels, coarsest level first, so that the level 0 slot of the
+// current tick holds every entry expiring at it.  The caller must hold the
+// write lock of `map`.
+//
+// This function is meant to be protected inside `expiringmap` module.
+void _ExpiringMapCascadeLocked(ExpiringMap* const map) {
+  const uint64_t current = map->current;
+  const uint64_t top_span =
+      EXPIRINGMAP_LEVEL_SPAN(EXPIRINGMAP_WHEEL_LEVELS - 1);
+  if ((current & (top_span - 0x01)) == 0 &&
+      map->slots[EXPIRINGMAP_OVERFLOW_SLOT] != NULL) {
+    RescheduleExpiringMapSlot(map, EXPIRINGMAP_OVERFLOW_SLOT);
+  }
+  for (size_t level = EXPIRINGMAP_WHEEL_LEVELS - 1; level > 0; --level) {
+    if ((current & (EXPIRINGMAP_SLOT_SPAN(level) - 0x01)) != 0) continue;
+    const size_t slot = level * EXPIRINGMAP_WHEEL_SLOTS +
+                        EXPIRINGMAP_LEVEL_SLOT(current, level);
+    if (map->slots[slot] != NULL) RescheduleExpiringMapSlot(map, slot);
+  }
+}
+
+// Initializes `config` with the defaults: a wheel starting at tick 0 without
+// an expiry callback, whose map hashes with `hash_func` and compares keys with
+// `key_eq_func`.
+void ExpiringMapConfigInit(ExpiringMapConfig* const config, hash_f hash_func,
+                           key_eq_f key_eq_func) {
+  if (config == NULL) return;
+  MapConfigInit(&config->map, MAP_MIN_CAPACITY, hash_func, key_eq_func);
+  config->now = 0;
+  config->on_expire = NULL;
+  config->expire_context = NULL;
+}
+
+// Initializes a new instance of the `ExpiringMap` data structure.
+//
+// Params:
+//  map         - A pointer to the `ExpiringMap` to be initialized.
+//  now         - The tick the wheel starts at.
+//  hash_func   - A pointer to the hash function used to calculate hash codes
+//                for keys.
+//  key_eq_func - A pointer to the key comparison function used to compare keys
+//                for equality.
+//
+// Remarks:
+//  If the pointer passed to `map` is NULL, this function returns immediately
+//  without doing anything.
+void ExpiringMapInit(ExpiringMap* const map, const uint64_t now,
+                     hash_f hash_func, key_eq_f key_eq_func) {
+  if (map == NULL) return;
+  ExpiringMapConfig config;
+  ExpiringMapConfigInit(&config, hash_func, key_eq_func);
+  config.now = now;
+  ExpiringMapInitWithConfig(map, &config);
+}
+
+// Initializes a new instance of the `ExpiringMap` data structure as described
+// by `config`.
+void ExpiringMapInitWithConfig(ExpiringMap* const map,
+                               const ExpiringMapConfig* const config) {
+  if (map == NULL || config == NULL) return;
+
+  memset(map->slots, 0, sizeof(map->slots));
+  memset(map->occupied, 0, sizeof(map->occupied));
+  map->current = config->now;
+  map->on_expire = config->on_expire;
+  map->expire_context = config->expire_context;
+  // Left NULL by a map configuration that is rejected.
+  map->map.buckets = NULL;
+  MapInitWithConfig(&map->map, &config->map);
+}
+
+// Returns the number of entries of `map`, counting the expired entries
+// `ExpiringMapAdvance()` did not release yet.
+size_t ExpiringMapSize(ExpiringMap* const map) {
+  if (map == NULL || map->map.buckets == NULL) return 0;
+
+  pthread_rwlock_rdlock(&map->map.lock);
+  const size_t size = map->map.size;
+  pthread_rwlock_unlock(&map->map.lock);
+  return size;
+}
+
+// Frees up an `ExpiringMap` instance and the entries associated with it
+// without calling the expiry callback.
+void ExpiringMapFree(ExpiringMap* const map) {
+  if (map == NULL) return;
+  MapFree(&map->map);
+  memset(map->slots, 0, sizeof(map->slots));
+  memset(map->occupied, 0, sizeof(map->occupied));
+}
@@ -0,0 +1,68 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "expiringmap/iterators.h"
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "bool.h"
+#include "expiringmap/expiringmap.h"
+
+// Traverses the entries of the map that have not expired at the tick `now`
+// and calls the given predicate function on each of them.
+//
+// Params:
+//  map       - A pointer to the map to traverse.
+//  now       - The tick the entries are checked against.
+//  predicate - A function pointer to the predicate function to call on each
+//              key and value.  Traversal stops as soon as it returns `FALSE`.
+//
+// Remarks:
+//  The function holds the read lock of the map for the whole traversal, so
+//  `predicate` may look keys up but must not put or remove any.  The entries
+//  are visited slot after slot of the timing wheel, not in deadline order.
+void ExpiringMapTraverse(ExpiringMap *const map, const uint64_t now,
+                         bool_t (*predicate)(const void *key,
+                                             const void *value)) {
+  if (map == NULL || map->map.buckets == NULL || predicate == NULL) return;
+
+  pthread_rwlock_rdlock(&map->map.lock);
+  for (size_t slot = 0; slot <= EXPIRINGMAP_OVERFLOW_SLOT; ++slot) {
+    for (const MapEntry *entry = map->slots[slot]; entry != NULL;
+         entry = _EXPIRINGMAP_NODE(entry)->next) {
+      if (_EXPIRINGMAP_NODE(entry)->deadline <= now) continue;
+      if (predicate(entry->key, _EXPIRINGMAP_VALUE(entry)) == FALSE) {
+        pthread_rwlock_unlock(&map->map.lock);
+        return;
+      }
+    }
+  }
+  pthread_rwlock_unlock(&map->map.lock);
+}
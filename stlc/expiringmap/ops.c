@@ -0,0 +1,211 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "expiringmap/ops.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bool.h"
+#include "expiringmap/expiringmap.h"
+#include "map/map.h"
+#include "map/ops.h"
+
+// Stores a copy of the `value_size` bytes of `value` under the `key_size`
+// bytes of `key` until the tick `deadline`, replacing the value and the
+// deadline stored for the key if any.
+//
+// Returns:
+//  TRUE if the value was stored, FALSE if it could not be allocated.
+//
+// Thread Safety:
+//  This function holds the write lock of the map.
+bool_t ExpiringMapPut(ExpiringMap *const map, const void *const key,
+                      const size_t key_size, const void *const value,
+                      const size_t value_size, const uint64_t deadline) {
+  if (map == NULL || map->map.buckets == NULL || key == NULL ||
+      (value == NULL && value_size != 0))
+    return FALSE;
+
+  Map *const base = &map->map;
+  const hash_t hash = _MapHashKey(base, key, key_size);
+  pthread_rwlock_wrlock(&base->lock);
+  _MapRehashStep(base, MAP_REHASH_STEP);
+
+  MapEntry **link = _MapFindLink(base, key, key_size, hash);
+  MapEntry *entry = link != NULL ? *link : NULL;
+  if (entry != NULL &&
+      EXPIRINGMAP_VALUE_OFFSET + value_size > entry->value_capacity) {
+    _ExpiringMapDropLocked(map, entry, FALSE);
+    entry = NULL;
+  }
+  if (entry != NULL) {
+    _ExpiringMapUnschedule(map, entry);
+  } else {
+    entry = _MapAddEntryLocked(base, key, key_size, hash,
+                               EXPIRINGMAP_VALUE_OFFSET + value_size);
+    if (entry == NULL) {
+      pthread_rwlock_unlock(&base->lock);
+      fprintf(stderr,
+              "ExpiringMapPut: failed to allocate entry for value_size: %zu\n",
+              value_size);
+      return FALSE;
+    }
+  }
+
+  entry->value_size = EXPIRINGMAP_VALUE_OFFSET + value_size;
+  if (value_size != 0) memcpy(_EXPIRINGMAP_VALUE(entry), value, value_size);
+  _EXPIRINGMAP_NODE(entry)->deadline = deadline;
+  _ExpiringMapSchedule(map, entry);
+
+  pthread_rwlock_unlock(&base->lock);
+  return TRUE;
+}
+
+// Looks the `key_size` bytes of `key` up at the tick `now`.  An entry whose
+// deadline is not after `now` is treated as missing even before
+// `ExpiringMapAdvance()` releases it.
+//
+// Returns:
+//  A pointer to the stored value, or NULL if the key is missing or expired.
+//  `value_size`, if not NULL, receives the size of the value.  The pointer is
+//  only valid until the entry is overwritten, removed or expired.
+//
+// Thread Safety:
+//  This function only holds the read lock of the map.
+void *ExpiringMapGet(ExpiringMap *const map, const void *const key,
+                     const size_t key_size, const uint64_t now,
+                     size_t *const value_size) {
+  if (map == NULL || map->map.buckets == NULL || key == NULL) return NULL;
+
+  Map *const base = &map->map;
+  const hash_t hash = _MapHashKey(base, key, key_size);
+  pthread_rwlock_rdlock(&base->lock);
+  MapEntry **link = _MapFindLink(base, key, key_size, hash);
+  void *value = NULL;
+  if (link != NULL && _EXPIRINGMAP_NODE(*link)->deadline > now) {
+    value = _EXPIRINGMAP_VALUE(*link);
+    if (value_size != NULL)
+      *value_size = (*link)->value_size - EXPIRINGMAP_VALUE_OFFSET;
+  }
+  pthread_rwlock_unlock(&base->lock);
+  return value;
+}
+
+// Moves the deadline of the entry of the `key_size` bytes of `key` to
+// `deadline`, for instance to extend a session on activity.
+//
+// Returns:
+//  TRUE if the key is present, even if it already expired but was not
+//  released yet.
+//
+// Thread Safety:
+//  This function holds the write lock of the map.
+bool_t ExpiringMapExpireAt(ExpiringMap *const map, const void *const key,
+                           const size_t key_size, const uint64_t deadline) {
+  if (map == NULL || map->map.buckets == NULL || key == NULL) return FALSE;
+
+  Map *const base = &map->map;
+  const hash_t hash = _MapHashKey(base, key, key_size);
+  pthread_rwlock_wrlock(&base->lock);
+  MapEntry **link = _MapFindLink(base, key, key_size, hash);
+  if (link != NULL) {
+    _ExpiringMapUnschedule(map, *link);
+    _EXPIRINGMAP_NODE(*link)->deadline = deadline;
+    _ExpiringMapSchedule(map, *link);
+  }
+  pthread_rwlock_unlock(&base->lock);
+  return link != NULL ? TRUE : FALSE;
+}
+
+// Removes the entry of the `key_size` bytes of `key` without calling the
+// expiry callback.
+//
+// Returns:
+//  TRUE if an entry was removed, FALSE if the key was not present.
+//
+// Thread Safety:
+//  This function holds the write lock of the map.
+bool_t ExpiringMapRemove(ExpiringMap *const map, const void *const key,
+                         const size_t key_size) {
+  if (map == NULL || map->map.buckets == NULL || key == NULL) return FALSE;
+
+  Map *const base = &map->map;
+  const hash_t hash = _MapHashKey(base, key, key_size);
+  pthread_rwlock_wrlock(&base->lock);
+  _MapRehashStep(base, MAP_REHASH_STEP);
+  MapEntry **link = _MapFindLink(base, key, key_size, hash);
+  if (link != NULL) _ExpiringMapDropLocked(map, *link, FALSE);
+  pthread_rwlock_unlock(&base->lock);
+  return link != NULL ? TRUE : FALSE;
+}
+
+// Advances the timing wheel of `map` to the tick `now`, releasing every entry
+// whose deadline is not after `now` and calling the expiry callback on it.
+//
+// Returns:
+//  The number of entries expired.
+//
+// Remarks:
+//  The cost is proportional to the number of entries expired and cascaded,
+//  plus a constant per level for every stretch of empty slots skipped, not to
+//  the size of the map.  A `now` before the current tick does nothing.  The
+//  expiry callback runs under the write lock of the map and must not call
+//  back into it.
+//
+// Thread Safety:
+//  This function holds the write lock of the map.
+size_t ExpiringMapAdvance(ExpiringMap *const map, const uint64_t now) {
+  if (map == NULL || map->map.buckets == NULL) return 0;
+
+  size_t expired = 0;
+  pthread_rwlock_wrlock(&map->map.lock);
+  while (map->current <= now) {
+    const uint64_t next = _ExpiringMapNextEvent(map);
+    if (next == UINT64_MAX || next > now) {
+      map->current = now + 0x01;
+      break;
+    }
+    map->current = next;
+    _ExpiringMapCascadeLocked(map);
+
+    // Every entry left in the level 0 slot of the tick expires at it.
+    const size_t slot =
+        (size_t)(map->current & (EXPIRINGMAP_WHEEL_SLOTS - 0x01));
+    while (map->slots[slot] != NULL) {
+      _ExpiringMapDropLocked(map, map->slots[slot], TRUE);
+      ++expired;
+    }
+    ++(map->current);
+  }
+  pthread_rwlock_unlock(&map->map.lock);
+  return expired;
+}
@@ -0,0 +1,180 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "flatmap/flatmap.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+
+// Rounds `capacity` up to the next power of two that is at least
+// `FLATMAP_MIN_CAPACITY`.
+static size_t ComputeFlatMapCapacity(const size_t capacity) {
+  size_t result = FLATMAP_MIN_CAPACITY;
+  while (result < capacity) result <<= 1;
+  return result;
+}
+
+// Places `slot` into the slot array of `map` using Robin Hood displacement.
+// The entry must not already be present in `map`.  `slot->psl` is ignored.
+//
+// This function is meant to be protected inside `flatmap` module.
+void _FlatMapPlace(FlatMap* const map, FlatMapSlot slot) {
+  const size_t mask = map->capacity - 1;
+  size_t index = _FLATMAP_HOME_SLOT(map, slot.hash);
+  slot.psl = 1;
+  for (;;) {
+    FlatMapSlot* const resident = &map->slots[index];
+    if (resident->psl == 0) {
+      *resident = slot;
+      return;
+    }
+    // Take from the rich: the entry that is closer to its home slot gives up
+    // its place and continues probing.
+    if (resident->psl < slot.psl) {
+      const FlatMapSlot displaced = *resident;
+      *resident = slot;
+      slot = displaced;
+    }
+    index = (index + 1) & mask;
+    ++(slot.psl);
+  }
+}
+
+// Initializes a new instance of the `FlatMap` data structure.
+//
+// Params:
+//  map         - A pointer to the `FlatMap` to be initialized.
+//  capacity    - The minimum number of slots to allocate; it is rounded up to
+//                the next power of two and to at least `FLATMAP_MIN_CAPACITY`.
+//  hash_func   - A pointer to the hash function used to calculate hash codes
+//                for keys.
+//  key_eq_func - A pointer to the key comparison function used to compare keys
+//                for equality.
+//
+// Remarks:
+//  If the pointer passed to `map` is NULL, this function returns immediately
+//  without doing anything.  On allocation failure `map->slots` is left NULL.
+void FlatMapInit(FlatMap* const map, const size_t capacity, hash_f hash_func,
+                 key_eq_f key_eq_func) {
+  if (map == NULL) return;
+
+  map->hash_func = hash_func;
+  map->key_eq_func = key_eq_func;
+  map->size = 0;
+  map->capacity = ComputeFlatMapCapacity(capacity);
+  if ((map->slots = (FlatMapSlot*)calloc(map->capacity,
+                                         sizeof(FlatMapSlot))) == NULL) {
+    fprintf(stderr,
+            "FlatMapInit: failed to allocate slots for capacity: %zu\n",
+            map->capacity);
+    map->capacity = 0;
+    return;
+  }
+
+  pthread_mutexattr_t mutex_attr;
+  pthread_mutexattr_init(&mutex_attr);
+  pthread_mutexattr_settype(&mutex_attr, PTHREAD_MUTEX_RECURSIVE);
+  if (pthread_mutex_init(&map->mutex, &mutex_attr) != 0) {
+    fprintf(stderr, "FlatMapInit: failed to initialize mutex\n");
+    free(map->slots);
+    map->slots = NULL;
+    map->capacity = 0;
+  }
+  pthread_mutexattr_destroy(&mutex_attr);
+}
+
+// Re-allocates the slot array of `map` to hold `capacity` slots, rounded up to
+// a power of two, and re-inserts all the entries.  The caller must hold the
+// mutex of `map`.
+//
+// Returns:
+//  `FALSE` if `capacity` slots cannot hold the current entries under the
+//  maximum load factor or could not be allocated, in which case `map` is left
+//  unchanged.
+//
+// This function is meant to be protected inside `flatmap` module.
+bool_t _FlatMapReallocLocked(FlatMap* const map, const size_t capacity) {
+  const size_t new_capacity = ComputeFlatMapCapacity(capacity);
+  if (map->size * FLATMAP_MAX_LOAD_DENOMINATOR >
+      new_capacity * FLATMAP_MAX_LOAD_NUMERATOR) {
+    fprintf(stderr, "FlatMapRealloc: capacity %zu too small for size: %zu\n",
+            new_capacity, map->size);
+    return FALSE;
+  }
+
+  FlatMapSlot* new_slots;
+  if ((new_slots = (FlatMapSlot*)calloc(new_capacity, sizeof(FlatMapSlot))) ==
+      NULL) {
+    fprintf(stderr,
+            "FlatMapRealloc: failed to allocate slots for capacity: %zu\n",
+            new_capacity);
+    return FALSE;
+  }
+
+  FlatMapSlot* const old_slots = map->slots;
+  const size_t old_capacity = map->capacity;
+  map->slots = new_slots;
+  map->capacity = new_capacity;
+  for (size_t i = 0; i < old_capacity; ++i) {
+    if (old_slots[i].psl != 0) _FlatMapPlace(map, old_slots[i]);
+  }
+  free(old_slots);
+  return TRUE;
+}
+
+// Re-allocates the slot array of a `FlatMap` to hold `new_capacity` slots
+// (rounded up to a power of two), re-inserting all the entries.
+//
+// Remarks:
+//  The request is ignored if `new_capacity` slots cannot hold the current
+//  entries under the maximum load factor.  This function acquires the map
+//  mutex.
+void FlatMapRealloc(FlatMap* const map, const size_t new_capacity) {
+  if (map == NULL || map->slots == NULL) return;
+
+  pthread_mutex_lock(&map->mutex);
+  _FlatMapReallocLocked(map, new_capacity);
+  pthread_mutex_unlock(&map->mutex);
+}
+
+// Frees up a `FlatMap` instance and the entries associated with it.
+void FlatMapFree(FlatMap* const map) {
+  if (map == NULL || map->slots == NULL) return;
+
+  for (size_t i = 0; i < map->capacity; ++i) {
+    if (map->slots[i].psl != 0) free(map->slots[i].data);
+  }
+  free(map->slots);
+  map->slots = NULL;
+  map->capacity = 0;
+  map->size = 0;
+  pthread_mutex_destroy(&map->mutex);
+}
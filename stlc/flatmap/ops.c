@@ -0,0 +1,199 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "flatmap/ops.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bool.h"
+#include "flatmap/flatmap.h"
+
+// Returns the index of the slot holding `key` or `map->capacity` if `key` is
+// not present.
+//
+// The probe ends at the first slot whose entry sits closer to its home slot
+// than `key` would at that position; Robin Hood ordering guarantees `key` can
+// not be stored past that point.
+static size_t FindFlatMapSlot(const FlatMap *const map, const void *key,
+                              const hash_t hash) {
+  const size_t mask = map->capacity - 1;
+  size_t index = _FLATMAP_HOME_SLOT(map, hash);
+  for (size_t psl = 1; map->slots[index].psl >= psl; ++psl) {
+    const FlatMapSlot *const slot = &map->slots[index];
+    if (slot->hash == hash && map->key_eq_func(slot->data, key) == TRUE)
+      return index;
+    index = (index + 1) & mask;
+  }
+  return map->capacity;
+}
+
+// Insert a new key-value pair into the flat map.
+//
+// Args:
+//  map        - A pointer to the map to insert the key-value pair into.
+//  key        - A pointer to the key to insert.
+//  key_size   - The size of the key in bytes.
+//  value      - A pointer to the value to insert.
+//  value_size - The size of the value in bytes.
+//
+// Remarks:
+//  If the map, key, or value pointers are NULL, this function will immediately
+//  return without doing anything.  If a key already exists in the map, its
+//  value will be replaced with the new value.  New entries are placed with
+//  Robin Hood displacement: an entry that is further from its home slot than
+//  the resident entry takes the slot and the resident continues probing.  A
+//  new key is not inserted if the table is full and cannot grow.
+//
+// Thread Safety:
+//  This function locks the mutex associated with the map.
+void FlatMapInsert(FlatMap *const map, const void *const key,
+                   const size_t key_size, const void *const value,
+                   const size_t value_size) {
+  if (map == NULL || map->slots == NULL || key == NULL || value == NULL)
+    return;
+
+  const hash_t hash = map->hash_func(key);
+  pthread_mutex_lock(&(map->mutex));
+
+  const size_t index = FindFlatMapSlot(map, key, hash);
+  if (index != map->capacity) {
+    FlatMapSlot *const slot = &map->slots[index];
+    const size_t value_offset = _FLATMAP_VALUE_OFFSET(slot->key_size);
+    unsigned char *data =
+        (unsigned char *)realloc(slot->data, value_offset + value_size);
+    if (data == NULL) {
+      fprintf(stderr,
+              "FlatMapInsert: failed to allocate value for value_size: %zu\n",
+              value_size);
+      pthread_mutex_unlock(&(map->mutex));
+      return;
+    }
+    memcpy(data + value_offset, value, value_size);
+    slot->data = data;
+    pthread_mutex_unlock(&(map->mutex));
+    return;
+  }
+
+  if ((map->size + 1) * FLATMAP_MAX_LOAD_DENOMINATOR >
+      map->capacity * FLATMAP_MAX_LOAD_NUMERATOR) {
+    // Placing the entry over the load limit could fill the table, and a full
+    // table never ends a probe.
+    if (_FlatMapReallocLocked(map, map->capacity << 1) == FALSE) {
+      pthread_mutex_unlock(&(map->mutex));
+      return;
+    }
+  }
+
+  FlatMapSlot slot;
+  slot.hash = hash;
+  slot.key_size = key_size;
+  const size_t value_offset = _FLATMAP_VALUE_OFFSET(key_size);
+  if ((slot.data = (unsigned char *)malloc(value_offset + value_size)) ==
+      NULL) {
+    fprintf(stderr,
+            "FlatMapInsert: failed to allocate entry for key_size: %zu, "
+            "value_size: %zu\n",
+            key_size, value_size);
+    pthread_mutex_unlock(&(map->mutex));
+    return;
+  }
+  memcpy(slot.data, key, key_size);
+  memcpy(slot.data + value_offset, value, value_size);
+  _FlatMapPlace(map, slot);
+  ++(map->size);
+
+  pthread_mutex_unlock(&(map->mutex));
+}
+
+// Retrieve the value associated with the given key in the flat map.
+//
+// Returns:
+//  A pointer to the value associated with the key, or NULL if the key is not
+//  found in the map.
+//
+// Remarks:
+//  The probe stops as soon as it meets a slot whose entry is closer to its
+//  home slot than the probed key would be, so misses are as cheap as hits.
+//  This function locks the mutex associated with the map.
+void *FlatMapGet(FlatMap *const map, const void *key) {
+  if (map == NULL || map->slots == NULL || key == NULL) return NULL;
+
+  const hash_t hash = map->hash_func(key);
+  pthread_mutex_lock(&(map->mutex));
+
+  void *value = NULL;
+  const size_t index = FindFlatMapSlot(map, key, hash);
+  if (index != map->capacity) {
+    value = map->slots[index].data +
+            _FLATMAP_VALUE_OFFSET(map->slots[index].key_size);
+  }
+
+  pthread_mutex_unlock(&(map->mutex));
+  return value;
+}
+
+// Remove an entry from the flat map with the given key.
+//
+// Effects:
+//  * Removes an entry from the map with the given key, if it exists.
+//  * Shifts the following entries of the cluster back by one slot so no
+//    tombstones are left behind.
+//  * Frees the memory used by the removed entry.
+void FlatMapRemove(FlatMap *const map, const void *key) {
+  if (map == NULL || map->slots == NULL || key == NULL) return;
+
+  const hash_t hash = map->hash_func(key);
+  pthread_mutex_lock(&(map->mutex));
+
+  size_t index = FindFlatMapSlot(map, key, hash);
+  if (index == map->capacity) {
+    pthread_mutex_unlock(&(map->mutex));
+    return;
+  }
+  free(map->slots[index].data);
+
+  // Backward-shift deletion: pull every following entry that is displaced from
+  // its home slot one step closer, stopping at an empty slot or at an entry
+  // that already sits in its home slot.
+  const size_t mask = map->capacity - 1;
+  size_t next = (index + 1) & mask;
+  while (map->slots[next].psl > 1) {
+    map->slots[index] = map->slots[next];
+    --(map->slots[index].psl);
+    index = next;
+    next = (next + 1) & mask;
+  }
+  memset(&map->slots[index], 0, sizeof(FlatMapSlot));
+  --(map->size);
+
+  pthread_mutex_unlock(&(map->mutex));
+}
@@ -0,0 +1,85 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "hashset/hashset.h"
+
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "map/map.h"
+
+// Initializes a new instance of the `HashSet` data structure.
+//
+// Params:
+//  set         - A pointer to the `HashSet` to be initialized.
+//  capacity    - The number of buckets to allocate, rounded up to a power of
+//                two.
+//  hash_func   - A pointer to the hash function used to calculate hash codes
+//                for keys.
+//  key_eq_func - A pointer to the key comparison function used to compare keys
+//                for equality.
+//
+// Remarks:
+//  If the pointer passed to `set` is NULL, this function returns immediately
+//  without doing anything.
+void HashSetInit(HashSet* const set, const size_t capacity, hash_f hash_func,
+                 key_eq_f key_eq_func) {
+  if (set == NULL) return;
+  MapInit(&set->map, capacity, hash_func, key_eq_func);
+}
+
+// Initializes a new instance of the `HashSet` data structure whose underlying
+// map is created as described by `config`.
+void HashSetInitWithConfig(HashSet* const set, const MapConfig* const config) {
+  if (set == NULL) return;
+  MapInitWithConfig(&set->map, config);
+}
+
+// Grows the bucket array of `set` like `MapReserve()` so that `count` keys fit
+// without a resize.
+void HashSetReserve(HashSet* const set, const size_t count) {
+  if (set == NULL) return;
+  MapReserve(&set->map, count);
+}
+
+// Returns the number of keys of `set`.
+size_t HashSetSize(HashSet* const set) {
+  if (set == NULL || set->map.buckets == NULL) return 0;
+
+  pthread_rwlock_rdlock(&set->map.lock);
+  const size_t size = set->map.size;
+  pthread_rwlock_unlock(&set->map.lock);
+  return size;
+}
+
+// Frees up a `HashSet` instance and the keys associated with it.
+void HashSetFree(HashSet* const set) {
+  if (set == NULL) return;
+  MapFree(&set->map);
+}
@@ -0,0 +1,78 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "hashset/iterators.h"
+
+#include <pthread.h>
+
+#include "bool.h"
+#include "hashset/hashset.h"
+#include "map/map.h"
+
+// Calls `predicate` on the key of every entry of the `capacity` buckets of
+// `buckets`.
+//
+// Returns:
+//  FALSE if `predicate` stopped the traversal, TRUE otherwise.
+static bool_t TraverseHashSetBuckets(MapEntry **const buckets,
+                                     const size_t capacity,
+                                     bool_t (*predicate)(const void *key)) {
+  for (size_t i = 0; i < capacity; ++i) {
+    for (const MapEntry *entry = buckets[i]; entry != NULL;
+         entry = entry->next) {
+      if (predicate(entry->key) == FALSE) return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+// Traverses the entire hash set and calls the given predicate function on each
+// key.
+//
+// Params:
+//  set       - A pointer to the set to traverse.
+//  predicate - A function pointer to the predicate function to call on each
+//              key.  Traversal stops as soon as it returns `FALSE`.
+//
+// Remarks:
+//  The function holds the read lock of the set for the whole traversal, so
+//  `predicate` may look keys up but must not add or remove any.
+void HashSetTraverse(HashSet *const set, bool_t (*predicate)(const void *key)) {
+  if (set == NULL || set->map.buckets == NULL || predicate == NULL) return;
+
+  Map *const map = &set->map;
+  pthread_rwlock_rdlock(&map->lock);
+
+  if (TraverseHashSetBuckets(map->buckets, map->capacity, predicate) == TRUE &&
+      map->old_buckets != NULL) {
+    TraverseHashSetBuckets(map->old_buckets, map->old_capacity, predicate);
+  }
+
+  pthread_rwlock_unlock(&map->lock);
+}
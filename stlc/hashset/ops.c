@@ -0,0 +1,279 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "hashset/ops.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "bool.h"
+#include "hashset/hashset.h"
+#include "map/map.h"
+#include "map/ops.h"
+
+// Adds a copy of the `key_size` bytes of `key` to the set.
+//
+// Returns:
+//  TRUE if the key was added, FALSE if it was already present or could not be
+//  allocated.
+//
+// Thread Safety:
+//  This function holds the write lock of the set.
+bool_t HashSetAdd(HashSet *const set, const void *const key,
+                  const size_t key_size) {
+  if (set == NULL || set->map.buckets == NULL || key == NULL) return FALSE;
+
+  Map *const map = &set->map;
+  const hash_t hash = _MapHashKey(map, key, key_size);
+  pthread_rwlock_wrlock(&map->lock);
+  _MapRehashStep(map, MAP_REHASH_STEP);
+  const bool_t added = _MapAddKeyLocked(map, key, key_size, hash);
+  pthread_rwlock_unlock(&map->lock);
+  return added;
+}
+
+// Tests whether the `key_size` bytes of `key` are a member of the set.
+//
+// Thread Safety:
+//  This function only holds the read lock of the set.
+bool_t HashSetContains(HashSet *const set, const void *const key,
+                       const size_t key_size) {
+  if (set == NULL || set->map.buckets == NULL || key == NULL) return FALSE;
+
+  return _MapGetHashed(&set->map, key, key_size,
+                       _MapHashKey(&set->map, key, key_size)) != NULL
+             ? TRUE
+             : FALSE;
+}
+
+// Removes the `key_size` bytes of `key` from the set.
+//
+// Returns:
+//  TRUE if the key was removed, FALSE if it was not present.
+//
+// Thread Safety:
+//  This function holds the write lock of the set.
+bool_t HashSetRemove(HashSet *const set, const void *const key,
+                     const size_t key_size) {
+  if (set == NULL || set->map.buckets == NULL || key == NULL) return FALSE;
+
+  return _MapRemoveHashed(&set->map, key, key_size,
+                          _MapHashKey(&set->map, key, key_size));
+}
+
+// Tells whether `a` and `b` compute the same hash for every key, in which case
+// the hash stored in an entry of one can be used to look the key up in the
+// other.
+static bool_t HashesLikeHashSet(const Map *const a, const Map *const b) {
+  return a->hash_func == b->hash_func && a->hash_n_func == b->hash_n_func &&
+                 a->hash_seeded_func == b->hash_seeded_func &&
+                 a->seed == b->seed
+             ? TRUE
+             : FALSE;
+}
+
+// Checks the arguments of a set operation writing into `out`.
+static bool_t CheckHashSetOperands(const char *const func,
+                                   const HashSet *const out,
+                                   const HashSet *const a,
+                                   const HashSet *const b) {
+  if (out == NULL || a == NULL || b == NULL || out->map.buckets == NULL ||
+      a->map.buckets == NULL || b->map.buckets == NULL)
+    return FALSE;
+  if (out == a || out == b) {
+    fprintf(stderr, "%s: `out` must be a different set than the operands\n",
+            func);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+// Takes the write lock of `out` and the read locks of `a` and `b`, which may be
+// the same set, in address order so that two operations locking the same sets
+// in opposite roles can not deadlock.
+static void LockHashSetOperands(HashSet *const out, HashSet *const a,
+                                HashSet *const b) {
+  HashSet *sets[3] = {out, a, b};
+  const size_t count = a == b ? 2 : 3;
+  for (size_t i = 1; i < count; ++i) {
+    for (size_t j = i; j > 0 && (uintptr_t)sets[j] < (uintptr_t)sets[j - 1];
+         --j) {
+      HashSet *const tmp = sets[j];
+      sets[j] = sets[j - 1];
+      sets[j - 1] = tmp;
+    }
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (sets[i] == out) {
+      pthread_rwlock_wrlock(&sets[i]->map.lock);
+    } else {
+      pthread_rwlock_rdlock(&sets[i]->map.lock);
+    }
+  }
+}
+
+// Releases the locks taken by `LockHashSetOperands()`.
+static void UnlockHashSetOperands(HashSet *const out, HashSet *const a,
+                                  HashSet *const b) {
+  pthread_rwlock_unlock(&out->map.lock);
+  pthread_rwlock_unlock(&a->map.lock);
+  if (b != a) pthread_rwlock_unlock(&b->map.lock);
+}
+
+// Adds to `out` the keys of the `capacity` buckets of `buckets`, which belong
+// to `source`.  When `probe` is not NULL only the keys whose presence in
+// `probe` equals `keep` are added.  The write lock of `out` and the read locks
+// of `source` and `probe` must be held.
+//
+// Returns:
+//  The number of keys added to `out`.
+static size_t AddHashSetBuckets(Map *const out, const Map *const source,
+                                MapEntry **const buckets,
+                                const size_t capacity, Map *const probe,
+                                const bool_t keep) {
+  const bool_t reuse_out = HashesLikeHashSet(source, out);
+  const bool_t reuse_probe =
+      probe != NULL ? HashesLikeHashSet(source, probe) : FALSE;
+  size_t added = 0;
+  for (size_t i = 0; i < capacity; ++i) {
+    for (const MapEntry *entry = buckets[i]; entry != NULL;
+         entry = entry->next) {
+      if (probe != NULL) {
+        const hash_t hash =
+            reuse_probe == TRUE
+                ? entry->hash
+                : _MapHashKey(probe, entry->key, entry->key_size);
+        const bool_t found =
+            _MapFindLink(probe, entry->key, entry->key_size, hash) != NULL
+                ? TRUE
+                : FALSE;
+        if (found != keep) continue;
+      }
+      const hash_t hash = reuse_out == TRUE
+                              ? entry->hash
+                              : _MapHashKey(out, entry->key, entry->key_size);
+      added += _MapAddKeyLocked(out, entry->key, entry->key_size, hash) == TRUE;
+    }
+  }
+  return added;
+}
+
+// Adds the keys of `source` to `out` as `AddHashSetBuckets()` does, walking
+// both bucket arrays of `source` during an incremental resize.
+static size_t AddHashSetKeys(Map *const out, const Map *const source,
+                             Map *const probe, const bool_t keep) {
+  size_t added = AddHashSetBuckets(out, source, source->buckets,
+                                   source->capacity, probe, keep);
+  if (source->old_buckets != NULL) {
+    added += AddHashSetBuckets(out, source, source->old_buckets,
+                               source->old_capacity, probe, keep);
+  }
+  return added;
+}
+
+// Adds every key of `a` and of `b` to `out`.
+//
+// Returns:
+//  The number of keys added to `out`.
+//
+// Remarks:
+//  `out` is grown once for the keys of the larger set before they are added,
+//  then the keys of the smaller one are added or found by a single probe each.
+//  `out` must be a different set than `a` and `b`, which may be the same set.
+//  When the sets hash keys the same way the hashes stored in the entries are
+//  reused instead of hashing every key again.
+//
+// Thread Safety:
+//  The read locks of `a` and `b` and the write lock of `out` are held for the
+//  whole call.  They are taken in address order, so set operations running
+//  concurrently in any direction do not deadlock.
+size_t HashSetUnion(HashSet *const out, HashSet *const a, HashSet *const b) {
+  if (CheckHashSetOperands("HashSetUnion", out, a, b) == FALSE) return 0;
+
+  LockHashSetOperands(out, a, b);
+
+  Map *const larger = a->map.size >= b->map.size ? &a->map : &b->map;
+  Map *const smaller = larger == &a->map ? &b->map : &a->map;
+  _MapReserveLocked(&out->map, out->map.size + larger->size);
+  size_t added = AddHashSetKeys(&out->map, larger, NULL, TRUE);
+  if (smaller != larger)
+    added += AddHashSetKeys(&out->map, smaller, NULL, TRUE);
+
+  UnlockHashSetOperands(out, a, b);
+  return added;
+}
+
+// Adds the keys present in both `a` and `b` to `out`.
+//
+// Returns:
+//  The number of keys added to `out`.
+//
+// Remarks:
+//  The smaller of `a` and `b` is walked and every one of its keys is probed in
+//  the larger one, so the cost is bounded by the size of the smaller set.  The
+//  other remarks of `HashSetUnion()` apply.
+size_t HashSetIntersection(HashSet *const out, HashSet *const a,
+                           HashSet *const b) {
+  if (CheckHashSetOperands("HashSetIntersection", out, a, b) == FALSE)
+    return 0;
+
+  LockHashSetOperands(out, a, b);
+
+  Map *const larger = a->map.size >= b->map.size ? &a->map : &b->map;
+  Map *const smaller = larger == &a->map ? &b->map : &a->map;
+  _MapReserveLocked(&out->map, out->map.size + smaller->size);
+  const size_t added = AddHashSetKeys(&out->map, smaller, larger, TRUE);
+
+  UnlockHashSetOperands(out, a, b);
+  return added;
+}
+
+// Adds the keys of `a` that are not present in `b` to `out`.
+//
+// Returns:
+//  The number of keys added to `out`.
+//
+// Remarks:
+//  Every key of the result comes from `a`, so `a` is walked and its keys are
+//  probed in `b`; the probes are skipped altogether when `b` is empty.  The
+//  other remarks of `HashSetUnion()` apply.
+size_t HashSetDifference(HashSet *const out, HashSet *const a,
+                         HashSet *const b) {
+  if (CheckHashSetOperands("HashSetDifference", out, a, b) == FALSE) return 0;
+
+  LockHashSetOperands(out, a, b);
+
+  _MapReserveLocked(&out->map, out->map.size + a->map.size);
+  const size_t added = AddHashSetKeys(&out->map, &a->map,
+                                      b->map.size != 0 ? &b->map : NULL, FALSE);
+
+  UnlockHashSetOperands(out, a, b);
+  return added;
+}
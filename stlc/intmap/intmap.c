@@ -0,0 +1,203 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "intmap/intmap.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "bool.h"
+
+// Rounds `capacity` up to the next power of two that is at least
+// `INTMAP_MIN_CAPACITY`.
+static size_t ComputeIntMapCapacity(const size_t capacity) {
+  size_t result = INTMAP_MIN_CAPACITY;
+  while (result < capacity) result <<= 1;
+  return result;
+}
+
+// Allocates an array of `capacity` empty slots or returns NULL.
+//
+// `INTMAP_EMPTY_KEY` has every bit set, so a byte-wise fill marks every slot
+// as empty at once.
+static IntMapSlot* AllocIntMapSlots(const size_t capacity) {
+  IntMapSlot* const slots = (IntMapSlot*)malloc(capacity * sizeof(IntMapSlot));
+  if (slots == NULL) return NULL;
+  memset(slots, 0xFF, capacity * sizeof(IntMapSlot));
+  return slots;
+}
+
+// Moves every entry of `map` into a new slot array of `capacity` slots.  The
+// map mutex must be held.
+static bool_t RehashIntMapLocked(IntMap* const map, const size_t capacity) {
+  IntMapSlot* new_slots;
+  if ((new_slots = AllocIntMapSlots(capacity)) == NULL) {
+    fprintf(stderr, "IntMap: failed to allocate slots for capacity: %zu\n",
+            capacity);
+    return FALSE;
+  }
+
+  IntMapSlot* const old_slots = map->slots;
+  const size_t old_capacity = map->capacity;
+  map->slots = new_slots;
+  map->capacity = capacity;
+  for (size_t i = 0; i < old_capacity; ++i) {
+    if (old_slots[i].key != INTMAP_EMPTY_KEY)
+      _IntMapPlace(map, old_slots[i].key, old_slots[i].value);
+  }
+  free(old_slots);
+  return TRUE;
+}
+
+// Places `key` and `value` into the slot array of `map`.  The key must not
+// already be present in `map` and must not be `INTMAP_EMPTY_KEY`.
+//
+// Returns:
+//  A pointer to the slot the entry was placed into.
+//
+// This function is meant to be protected inside `intmap` module.
+IntMapSlot* _IntMapPlace(IntMap* const map, const uint64_t key,
+                         const uint64_t value) {
+  const size_t mask = map->capacity - 1;
+  size_t index = _INTMAP_HOME_SLOT(map, key);
+  while (map->slots[index].key != INTMAP_EMPTY_KEY) index = (index + 1) & mask;
+  map->slots[index].key = key;
+  map->slots[index].value = value;
+  return &map->slots[index];
+}
+
+// Grows the slot array of `map` so that `count` entries fit without exceeding
+// the maximum load factor.  The map mutex must be held.
+//
+// Returns:
+//  `FALSE` if the slot array had to grow but could not be allocated.
+//
+// This function is meant to be protected inside `intmap` module.
+bool_t _IntMapReserveLocked(IntMap* const map, const size_t count) {
+  if (count * INTMAP_MAX_LOAD_DENOMINATOR <=
+      map->capacity * INTMAP_MAX_LOAD_NUMERATOR) {
+    return TRUE;
+  }
+  size_t capacity = map->capacity << 1;
+  while (count * INTMAP_MAX_LOAD_DENOMINATOR >
+         capacity * INTMAP_MAX_LOAD_NUMERATOR) {
+    capacity <<= 1;
+  }
+  return RehashIntMapLocked(map, capacity);
+}
+
+// Initializes a new instance of the `IntMap` data structure.
+//
+// Params:
+//  map      - A pointer to the `IntMap` to be initialized.
+//  capacity - The minimum number of slots to allocate; it is rounded up to the
+//             next power of two and to at least `INTMAP_MIN_CAPACITY`.
+//
+// Remarks:
+//  If the pointer passed to `map` is NULL, this function returns immediately
+//  without doing anything.  On allocation failure `map->slots` is left NULL.
+void IntMapInit(IntMap* const map, const size_t capacity) {
+  if (map == NULL) return;
+
+  map->size = 0;
+  map->has_empty_key = FALSE;
+  map->empty_value = 0;
+  map->capacity = ComputeIntMapCapacity(capacity);
+  if ((map->slots = AllocIntMapSlots(map->capacity)) == NULL) {
+    fprintf(stderr, "IntMapInit: failed to allocate slots for capacity: %zu\n",
+            map->capacity);
+    map->capacity = 0;
+    return;
+  }
+
+  pthread_mutexattr_t mutex_attr;
+  pthread_mutexattr_init(&mutex_attr);
+  pthread_mutexattr_settype(&mutex_attr, PTHREAD_MUTEX_RECURSIVE);
+  if (pthread_mutex_init(&map->mutex, &mutex_attr) != 0) {
+    fprintf(stderr, "IntMapInit: failed to initialize mutex\n");
+    free(map->slots);
+    map->slots = NULL;
+    map->capacity = 0;
+  }
+  pthread_mutexattr_destroy(&mutex_attr);
+}
+
+// Re-allocates the slot array of an `IntMap` to hold `new_capacity` slots
+// (rounded up to a power of two), re-inserting all the entries.
+//
+// Remarks:
+//  The request is ignored if `new_capacity` slots cannot hold the current
+//  entries under the maximum load factor.  This function acquires the map
+//  mutex.
+void IntMapRealloc(IntMap* const map, const size_t new_capacity) {
+  if (map == NULL || map->slots == NULL) return;
+
+  pthread_mutex_lock(&map->mutex);
+
+  const size_t capacity = ComputeIntMapCapacity(new_capacity);
+  if (map->size * INTMAP_MAX_LOAD_DENOMINATOR >
+      capacity * INTMAP_MAX_LOAD_NUMERATOR) {
+    fprintf(stderr, "IntMapRealloc: capacity %zu too small for size: %zu\n",
+            capacity, map->size);
+    pthread_mutex_unlock(&map->mutex);
+    return;
+  }
+  RehashIntMapLocked(map, capacity);
+
+  pthread_mutex_unlock(&map->mutex);
+}
+
+// Grows the slot array of an `IntMap` so that `count` entries fit without
+// exceeding the maximum load factor.  The table never shrinks.
+//
+// Remarks:
+//  This function acquires the map mutex.
+void IntMapReserve(IntMap* const map, const size_t count) {
+  if (map == NULL || map->slots == NULL) return;
+
+  pthread_mutex_lock(&map->mutex);
+  _IntMapReserveLocked(map, count);
+  pthread_mutex_unlock(&map->mutex);
+}
+
+// Frees up an `IntMap` instance.
+void IntMapFree(IntMap* const map) {
+  if (map == NULL || map->slots == NULL) return;
+
+  free(map->slots);
+  map->slots = NULL;
+  map->capacity = 0;
+  map->size = 0;
+  map->has_empty_key = FALSE;
+  pthread_mutex_destroy(&map->mutex);
+}
@@ -0,0 +1,414 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "intmap/ops.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "bool.h"
+#include "intmap/intmap.h"
+
+// Returns the index of the slot holding `key` or of the empty slot that ends
+// its probe sequence if `key` is not present.  The table always keeps at least
+// one empty slot, so the probe terminates.
+static size_t ProbeIntMap(const IntMap *const map, const uint64_t key,
+                          size_t index) {
+  const size_t mask = map->capacity - 1;
+  for (;;) {
+    const uint64_t resident = map->slots[index].key;
+    if (resident == key || resident == INTMAP_EMPTY_KEY) return index;
+    index = (index + 1) & mask;
+  }
+}
+
+// Returns a pointer to the value of `key`, adding an entry holding `value` for
+// it first if the key is not present.  The map mutex must be held.
+//
+// Returns:
+//  A pointer to the value or NULL if the slot array had to grow but could not
+//  be allocated.
+static uint64_t *FindOrAddIntMapValueLocked(IntMap *const map,
+                                            const uint64_t key,
+                                            const uint64_t value,
+                                            bool_t *const inserted) {
+  if (key == INTMAP_EMPTY_KEY) {
+    *inserted = map->has_empty_key == TRUE ? FALSE : TRUE;
+    if (*inserted == TRUE) {
+      map->has_empty_key = TRUE;
+      map->empty_value = value;
+      ++(map->size);
+    }
+    return &map->empty_value;
+  }
+
+  size_t index = ProbeIntMap(map, key, _INTMAP_HOME_SLOT(map, key));
+  if (map->slots[index].key == key) {
+    *inserted = FALSE;
+    return &map->slots[index].value;
+  }
+
+  if ((map->size + 1) * INTMAP_MAX_LOAD_DENOMINATOR >
+      map->capacity * INTMAP_MAX_LOAD_NUMERATOR) {
+    if (_IntMapReserveLocked(map, map->size + 1) == FALSE) return NULL;
+    index = ProbeIntMap(map, key, _INTMAP_HOME_SLOT(map, key));
+  }
+  map->slots[index].key = key;
+  map->slots[index].value = value;
+  ++(map->size);
+  *inserted = TRUE;
+  return &map->slots[index].value;
+}
+
+// Insert a new key-value pair into the integer map.
+//
+// Args:
+//  map   - A pointer to the map to insert the key-value pair into.
+//  key   - The key to insert.
+//  value - The value to insert.
+//
+// Remarks:
+//  If a key already exists in the map, its value will be replaced with the new
+//  value.  Nothing is allocated per entry; the slot array doubles once the
+//  maximum load factor would be exceeded.
+//
+// Thread Safety:
+//  This function locks the mutex associated with the map.
+void IntMapInsert(IntMap *const map, const uint64_t key, const uint64_t value) {
+  if (map == NULL || map->slots == NULL) return;
+
+  pthread_mutex_lock(&(map->mutex));
+
+  bool_t inserted;
+  uint64_t *const stored =
+      FindOrAddIntMapValueLocked(map, key, value, &inserted);
+  if (stored == NULL) {
+    fprintf(stderr, "IntMapInsert: failed to grow map of size: %zu\n",
+            map->size);
+  } else if (inserted == FALSE) {
+    *stored = value;
+  }
+
+  pthread_mutex_unlock(&(map->mutex));
+}
+
+// Retrieve the value associated with the given key in the integer map.
+//
+// Args:
+//  map   - A pointer to the map.
+//  key   - The key to look up.
+//  value - Receives the value associated with `key` if it is found; may be
+//          NULL to only test for presence.
+//
+// Returns:
+//  TRUE if the key is present in the map, FALSE otherwise.
+//
+// Thread Safety:
+//  This function locks the mutex associated with the map.
+bool_t IntMapGet(IntMap *const map, const uint64_t key, uint64_t *const value) {
+  if (map == NULL || map->slots == NULL) return FALSE;
+
+  pthread_mutex_lock(&(map->mutex));
+
+  bool_t found = FALSE;
+  if (key == INTMAP_EMPTY_KEY) {
+    if ((found = map->has_empty_key) == TRUE && value != NULL)
+      *value = map->empty_value;
+  } else {
+    const IntMapSlot *const slot =
+        &map->slots[ProbeIntMap(map, key, _INTMAP_HOME_SLOT(map, key))];
+    if (slot->key == key) {
+      found = TRUE;
+      if (value != NULL) *value = slot->value;
+    }
+  }
+
+  pthread_mutex_unlock(&(map->mutex));
+  return found;
+}
+
+// Remove an entry from the integer map with the given key.
+//
+// Effects:
+//  * Removes an entry from the map with the given key, if it exists.
+//  * Shifts the following entries of the cluster back so no tombstones are
+//    left behind.
+void IntMapRemove(IntMap *const map, const uint64_t key) {
+  if (map == NULL || map->slots == NULL) return;
+
+  pthread_mutex_lock(&(map->mutex));
+
+  if (key == INTMAP_EMPTY_KEY) {
+    if (map->has_empty_key == TRUE) {
+      map->has_empty_key = FALSE;
+      --(map->size);
+    }
+    pthread_mutex_unlock(&(map->mutex));
+    return;
+  }
+
+  size_t index = ProbeIntMap(map, key, _INTMAP_HOME_SLOT(map, key));
+  if (map->slots[index].key != key) {
+    pthread_mutex_unlock(&(map->mutex));
+    return;
+  }
+
+  // Backward-shift deletion: an entry further down the cluster moves into the
+  // hole unless its home slot lies between the hole and its current slot, in
+  // which case moving it would put it before its home.
+  const size_t mask = map->capacity - 1;
+  for (size_t next = (index + 1) & mask;
+       map->slots[next].key != INTMAP_EMPTY_KEY; next = (next + 1) & mask) {
+    const size_t home = _INTMAP_HOME_SLOT(map, map->slots[next].key);
+    if (((next - home) & mask) >= ((next - index) & mask)) {
+      map->slots[index] = map->slots[next];
+      index = next;
+    }
+  }
+  map->slots[index].key = INTMAP_EMPTY_KEY;
+  --(map->size);
+
+  pthread_mutex_unlock(&(map->mutex));
+}
+
+// Looks up the keys of `keys` in batches of `INTMAP_BATCH_WIDTH`, storing the
+// results into whichever of `out_values` and `out_found` are not NULL.
+//
+// The keys are mixed before the mutex is taken; under it every home slot of
+// the batch is prefetched before the first one is probed.
+static size_t GetIntMapBatch(IntMap *const map, const uint64_t *const keys,
+                             const size_t n, uint64_t *const out_values,
+                             bool_t *const out_found) {
+  size_t found = 0;
+  hash_t hashes[INTMAP_BATCH_WIDTH];
+  for (size_t base = 0; base < n; base += INTMAP_BATCH_WIDTH) {
+    const size_t width =
+        n - base < INTMAP_BATCH_WIDTH ? n - base : INTMAP_BATCH_WIDTH;
+    for (size_t i = 0; i < width; ++i)
+      hashes[i] = MapMixHash((hash_t)keys[base + i]);
+
+    pthread_mutex_lock(&(map->mutex));
+    const size_t mask = map->capacity - 1;
+    for (size_t i = 0; i < width; ++i)
+      __builtin_prefetch(&map->slots[hashes[i] & mask]);
+    for (size_t i = 0; i < width; ++i) {
+      const uint64_t key = keys[base + i];
+      bool_t hit = FALSE;
+      uint64_t value = 0;
+      if (key == INTMAP_EMPTY_KEY) {
+        hit = map->has_empty_key;
+        value = map->empty_value;
+      } else {
+        const IntMapSlot *const slot =
+            &map->slots[ProbeIntMap(map, key, hashes[i] & mask)];
+        hit = slot->key == key ? TRUE : FALSE;
+        value = slot->value;
+      }
+      if (hit == TRUE) {
+        ++found;
+        if (out_values != NULL) out_values[base + i] = value;
+      }
+      if (out_found != NULL) out_found[base + i] = hit;
+    }
+    pthread_mutex_unlock(&(map->mutex));
+  }
+  return found;
+}
+
+// Looks `n` keys up at once.
+//
+// Params:
+//  map        - A pointer to the map.
+//  keys       - An array of the `n` keys to look up.
+//  n          - The number of keys.
+//  out_values - An array of `n` values receiving the value of every key found;
+//               the entries of missing keys are left untouched.  May be NULL.
+//  out_found  - An array of `n` flags set to TRUE for the keys present in the
+//               map, or NULL if only the count is of interest.
+//
+// Returns:
+//  The number of keys present in the map.
+//
+// Remarks:
+//  The keys are processed in batches of `INTMAP_BATCH_WIDTH`: every key of a
+//  batch is hashed and its home slot prefetched before any of them is probed.
+//
+// Thread Safety:
+//  The mutex of the map is held for one batch at a time.
+size_t IntMapGetMany(IntMap *const map, const uint64_t *const keys,
+                     const size_t n, uint64_t *const out_values,
+                     bool_t *const out_found) {
+  if (map == NULL || map->slots == NULL || keys == NULL) return 0;
+  return GetIntMapBatch(map, keys, n, out_values, out_found);
+}
+
+// Tests the presence of `n` keys at once like `IntMapGetMany()`.
+//
+// Returns:
+//  The number of keys present in the map.
+size_t IntMapContainsMany(IntMap *const map, const uint64_t *const keys,
+                          const size_t n, bool_t *const out_found) {
+  if (map == NULL || map->slots == NULL || keys == NULL) return 0;
+  return GetIntMapBatch(map, keys, n, NULL, out_found);
+}
+
+// Inserts `n` key-value pairs at once, overwriting the values of the keys that
+// are already present like `IntMapInsert()`.
+//
+// Returns:
+//  The number of new entries added to the map.
+//
+// Remarks:
+//  The slot array is grown once, as by `IntMapReserve()`, for `n` more entries
+//  so the load never triggers an intermediate resize.  The home slots of every
+//  `INTMAP_BATCH_WIDTH` keys are prefetched before they are inserted.
+//
+// Thread Safety:
+//  This function locks the mutex of the map once for the whole call.
+size_t IntMapInsertMany(IntMap *const map, const uint64_t *const keys,
+                        const uint64_t *const values, const size_t n) {
+  if (map == NULL || map->slots == NULL || keys == NULL || values == NULL)
+    return 0;
+
+  pthread_mutex_lock(&(map->mutex));
+
+  if (_IntMapReserveLocked(map, map->size + n) == FALSE) {
+    fprintf(stderr, "IntMapInsertMany: failed to reserve %zu entries\n", n);
+    pthread_mutex_unlock(&(map->mutex));
+    return 0;
+  }
+
+  size_t added = 0;
+  const size_t mask = map->capacity - 1;
+  size_t homes[INTMAP_BATCH_WIDTH];
+  for (size_t base = 0; base < n; base += INTMAP_BATCH_WIDTH) {
+    const size_t width =
+        n - base < INTMAP_BATCH_WIDTH ? n - base : INTMAP_BATCH_WIDTH;
+    for (size_t i = 0; i < width; ++i) {
+      homes[i] = MapMixHash((hash_t)keys[base + i]) & mask;
+      __builtin_prefetch(&map->slots[homes[i]], 1);
+    }
+    for (size_t i = 0; i < width; ++i) {
+      const uint64_t key = keys[base + i];
+      if (key == INTMAP_EMPTY_KEY) {
+        if (map->has_empty_key == FALSE) {
+          map->has_empty_key = TRUE;
+          ++(map->size);
+          ++added;
+        }
+        map->empty_value = values[base + i];
+        continue;
+      }
+      IntMapSlot *const slot = &map->slots[ProbeIntMap(map, key, homes[i])];
+      if (slot->key != key) {
+        slot->key = key;
+        ++(map->size);
+        ++added;
+      }
+      slot->value = values[base + i];
+    }
+  }
+
+  pthread_mutex_unlock(&(map->mutex));
+  return added;
+}
+
+// Returns the value of `key`, inserting `value` for it first if the key is not
+// present.  The key is hashed and probed only once.
+//
+// Params:
+//  map      - A pointer to the map.
+//  key      - The key.
+//  value    - The value to insert if the key is not present.
+//  inserted - Set to TRUE if the value was inserted, FALSE if the key was
+//             already present; may be NULL.
+//
+// Returns:
+//  A pointer to the value stored in the map, which may be written through in
+//  place, or NULL on failure.  It stays valid until the next insertion or
+//  removal, either of which may move the entry.
+//
+// Thread Safety:
+//  This function locks the mutex of the map while it looks the key up.
+//  Accesses through the returned pointer happen outside of it.
+uint64_t *IntMapGetOrInsert(IntMap *const map, const uint64_t key,
+                            const uint64_t value, bool_t *const inserted) {
+  if (map == NULL || map->slots == NULL) return NULL;
+
+  pthread_mutex_lock(&(map->mutex));
+
+  bool_t added = FALSE;
+  uint64_t *const stored = FindOrAddIntMapValueLocked(map, key, value, &added);
+  if (stored == NULL) {
+    fprintf(stderr, "IntMapGetOrInsert: failed to grow map of size: %zu\n",
+            map->size);
+  }
+  if (inserted != NULL) *inserted = added;
+
+  pthread_mutex_unlock(&(map->mutex));
+  return stored;
+}
+
+// Inserts `value` for `key`, or folds it into the value already stored for it
+// with `merge`.  The key is hashed and probed only once.
+//
+// Params:
+//  map   - A pointer to the map.
+//  key   - The key.
+//  value - The value to insert or merge.
+//  merge - The callback folding `value` into the stored value.  When NULL the
+//          stored value is overwritten like `IntMapInsert()` does.
+//
+// Returns:
+//  The value stored for `key` once the call returns.
+//
+// Thread Safety:
+//  This function locks the mutex of the map, including while `merge` runs, so
+//  `merge` must not call back into the map.
+uint64_t IntMapUpsert(IntMap *const map, const uint64_t key,
+                      const uint64_t value, intmap_merge_f merge) {
+  if (map == NULL || map->slots == NULL) return value;
+
+  pthread_mutex_lock(&(map->mutex));
+
+  bool_t inserted;
+  uint64_t result = value;
+  uint64_t *const stored =
+      FindOrAddIntMapValueLocked(map, key, value, &inserted);
+  if (stored == NULL) {
+    fprintf(stderr, "IntMapUpsert: failed to grow map of size: %zu\n",
+            map->size);
+  } else if (inserted == FALSE) {
+    result = *stored = merge == NULL ? value : merge(*stored, value);
+  }
+
+  pthread_mutex_unlock(&(map->mutex));
+  return result;
+}
@@ -0,0 +1,225 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "lrucache/lrucache.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "bool.h"
+#include "map/map.h"
+#include "map/ops.h"
+
+// Links `entry` at the front of the recency list of `cache`.  The caller must
+// hold the write lock of `cache`.
+//
+// This function is meant to be protected inside `lrucache` module.
+void _LruCachePushFront(LruCache* const cache, MapEntry* const entry) {
+  LruCacheNode* const node = _LRUCACHE_NODE(entry);
+  node->prev = NULL;
+  node->next = cache->head;
+  if (cache->head != NULL) {
+    _LRUCACHE_NODE(cache->head)->prev = entry;
+  } else {
+    cache->tail = entry;
+  }
+  cache->head = entry;
+}
+
+// Unlinks `entry` from the recency list of `cache`.  The caller must hold the
+// write lock of `cache`.
+//
+// This function is meant to be protected inside `lrucache` module.
+void _LruCacheUnlink(LruCache* const cache, MapEntry* const entry) {
+  LruCacheNode* const node = _LRUCACHE_NODE(entry);
+  if (node->prev != NULL) {
+    _LRUCACHE_NODE(node->prev)->next = node->next;
+  } else {
+    cache->head = node->next;
+  }
+  if (node->next != NULL) {
+    _LRUCACHE_NODE(node->next)->prev = node->prev;
+  } else {
+    cache->tail = node->prev;
+  }
+  node->prev = NULL;
+  node->next = NULL;
+}
+
+// Unlinks `entry` from the recency list and from the map of `cache` and
+// releases it, calling the eviction callback first if `evicted`.  The caller
+// must hold the write lock of `cache`.
+//
+// This function is meant to be protected inside `lrucache` module.
+void _LruCacheDropLocked(LruCache* const cache, MapEntry* const entry,
+                         const bool_t evicted) {
+  _LruCacheUnlink(cache, entry);
+  cache->charge -= _LRUCACHE_NODE(entry)->charge;
+  if (evicted == TRUE) {
+    if (cache->on_evict != NULL) {
+      cache->on_evict(entry->key, entry->key_size, _LRUCACHE_VALUE(entry),
+                      entry->value_size - LRUCACHE_VALUE_OFFSET,
+                      cache->evict_context);
+    }
+    __atomic_fetch_add(&cache->evictions, 1, __ATOMIC_RELAXED);
+  }
+  _MapRemoveEntryLocked(&cache->map, entry);
+}
+
+// Evicts entries from the back of the recency list until `incoming` more fits
+// in the capacity of `cache`.  A CLOCK cache moves the referenced entries it
+// meets back to the front, clearing their bit, instead of evicting them.  The
+// caller must hold the write lock of `cache`.
+//
+// This function is meant to be protected inside `lrucache` module.
+void _LruCacheEvictLocked(LruCache* const cache, const size_t incoming) {
+  while (cache->tail != NULL && cache->charge + incoming > cache->capacity) {
+    MapEntry* const victim = cache->tail;
+    LruCacheNode* const node = _LRUCACHE_NODE(victim);
+    // Every referenced entry is moved at most once per call: the bits are
+    // only set under the read lock, which can not be held meanwhile.
+    if (cache->policy == LRUCACHE_POLICY_CLOCK && node->referenced == TRUE) {
+      node->referenced = FALSE;
+      _LruCacheUnlink(cache, victim);
+      _LruCachePushFront(cache, victim);
+      continue;
+    }
+    _LruCacheDropLocked(cache, victim, TRUE);
+  }
+}
+
+// Initializes `config` with the defaults: a count-limited LRU cache of
+// `capacity` entries without an eviction callback, whose map hashes with
+// `hash_func` and compares keys with `key_eq_func`.
+void LruCacheConfigInit(LruCacheConfig* const config, const size_t capacity,
+                        hash_f hash_func, key_eq_f key_eq_func) {
+  if (config == NULL) return;
+  MapConfigInit(&config->map, MAP_MIN_CAPACITY, hash_func, key_eq_func);
+  config->capacity = capacity;
+  config->limit = LRUCACHE_LIMIT_COUNT;
+  config->policy = LRUCACHE_POLICY_LRU;
+  config->on_evict = NULL;
+  config->evict_context = NULL;
+}
+
+// Initializes a count-limited LRU cache of `capacity` entries.
+//
+// Params:
+//  cache       - A pointer to the `LruCache` to be initialized.
+//  capacity    - The maximum number of entries.
+//  hash_func   - A pointer to the hash function used to calculate hash codes
+//                for keys.
+//  key_eq_func - A pointer to the key comparison function used to compare keys
+//                for equality.
+//
+// Remarks:
+//  If the pointer passed to `cache` is NULL, this function returns immediately
+//  without doing anything.
+void LruCacheInit(LruCache* const cache, const size_t capacity,
+                  hash_f hash_func, key_eq_f key_eq_func) {
+  if (cache == NULL) return;
+  LruCacheConfig config;
+  LruCacheConfigInit(&config, capacity, hash_func, key_eq_func);
+  LruCacheInitWithConfig(cache, &config);
+}
+
+// Initializes a new instance of the `LruCache` data structure as described by
+// `config`.  A count-limited cache reserves buckets for `capacity` entries up
+// front so that it never resizes.
+void LruCacheInitWithConfig(LruCache* const cache,
+                            const LruCacheConfig* const config) {
+  if (cache == NULL || config == NULL) return;
+
+  cache->head = NULL;
+  cache->tail = NULL;
+  cache->capacity = config->capacity;
+  cache->charge = 0;
+  cache->limit = config->limit;
+  cache->policy = config->policy;
+  cache->on_evict = config->on_evict;
+  cache->evict_context = config->evict_context;
+  cache->hits = 0;
+  cache->misses = 0;
+  cache->evictions = 0;
+  // Left NULL by a map configuration that is rejected.
+  cache->map.buckets = NULL;
+  MapInitWithConfig(&cache->map, &config->map);
+  if (cache->map.buckets != NULL && cache->limit == LRUCACHE_LIMIT_COUNT)
+    MapReserve(&cache->map, cache->capacity);
+}
+
+// Changes the capacity of `cache`, evicting entries until they fit.
+//
+// Thread Safety:
+//  This function holds the write lock of the cache.
+void LruCacheSetCapacity(LruCache* const cache, const size_t capacity) {
+  if (cache == NULL || cache->map.buckets == NULL) return;
+
+  pthread_rwlock_wrlock(&cache->map.lock);
+  cache->capacity = capacity;
+  _LruCacheEvictLocked(cache, 0);
+  pthread_rwlock_unlock(&cache->map.lock);
+}
+
+// Returns the number of entries of `cache`.
+size_t LruCacheSize(LruCache* const cache) {
+  if (cache == NULL || cache->map.buckets == NULL) return 0;
+
+  pthread_rwlock_rdlock(&cache->map.lock);
+  const size_t size = cache->map.size;
+  pthread_rwlock_unlock(&cache->map.lock);
+  return size;
+}
+
+// Fills `stats` with the counters of `cache`.
+void LruCacheGetStats(LruCache* const cache, LruCacheStats* const stats) {
+  if (cache == NULL || stats == NULL) return;
+  memset(stats, 0, sizeof(*stats));
+  if (cache->map.buckets == NULL) return;
+
+  pthread_rwlock_rdlock(&cache->map.lock);
+  stats->size = cache->map.size;
+  stats->charge = cache->charge;
+  stats->capacity = cache->capacity;
+  stats->hits = __atomic_load_n(&cache->hits, __ATOMIC_RELAXED);
+  stats->misses = __atomic_load_n(&cache->misses, __ATOMIC_RELAXED);
+  stats->evictions = __atomic_load_n(&cache->evictions, __ATOMIC_RELAXED);
+  pthread_rwlock_unlock(&cache->map.lock);
+}
+
+// Frees up an `LruCache` instance and the entries associated with it without
+// calling the eviction callback.
+void LruCacheFree(LruCache* const cache) {
+  if (cache == NULL) return;
+  MapFree(&cache->map);
+  cache->head = NULL;
+  cache->tail = NULL;
+  cache->charge = 0;
+}
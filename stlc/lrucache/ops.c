@@ -0,0 +1,243 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "lrucache/ops.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bool.h"
+#include "lrucache/lrucache.h"
+#include "map/map.h"
+#include "map/ops.h"
+
+// Marks `entry` as just used: a LRU cache moves it to the front of its list,
+// which the caller must hold the write lock for, while a CLOCK cache only
+// sets its reference bit, which the read lock is enough for.
+static void TouchLruCacheEntry(LruCache *const cache, MapEntry *const entry) {
+  if (cache->policy == LRUCACHE_POLICY_CLOCK) {
+    // Readers only store TRUE, and the bit is left alone once set so that the
+    // cache line stays shared between the threads hitting the entry.
+    bool_t *const referenced = &_LRUCACHE_NODE(entry)->referenced;
+    if (__atomic_load_n(referenced, __ATOMIC_RELAXED) == FALSE)
+      __atomic_store_n(referenced, TRUE, __ATOMIC_RELAXED);
+    return;
+  }
+  if (cache->head != entry) {
+    _LruCacheUnlink(cache, entry);
+    _LruCachePushFront(cache, entry);
+  }
+}
+
+// Caches a copy of the `value_size` bytes of `value` under the `key_size`
+// bytes of `key`, replacing the value cached for the key if any, and evicts
+// the least recently used entries until the cache fits its capacity again.
+//
+// Returns:
+//  TRUE if the value was cached, FALSE if it alone exceeds the capacity or
+//  could not be allocated.
+//
+// Remarks:
+//  The eviction callback runs under the write lock of the cache and must not
+//  call back into it.
+//
+// Thread Safety:
+//  This function holds the write lock of the cache.
+bool_t LruCachePut(LruCache *const cache, const void *const key,
+                   const size_t key_size, const void *const value,
+                   const size_t value_size) {
+  if (cache == NULL || cache->map.buckets == NULL || key == NULL ||
+      (value == NULL && value_size != 0))
+    return FALSE;
+  const size_t charge = _LRUCACHE_CHARGE(cache, key_size, value_size);
+  if (charge > cache->capacity) return FALSE;
+
+  Map *const map = &cache->map;
+  const hash_t hash = _MapHashKey(map, key, key_size);
+  pthread_rwlock_wrlock(&map->lock);
+  _MapRehashStep(map, MAP_REHASH_STEP);
+
+  MapEntry **link = _MapFindLink(map, key, key_size, hash);
+  if (link != NULL) {
+    MapEntry *const entry = *link;
+    LruCacheNode *const node = _LRUCACHE_NODE(entry);
+    if (LRUCACHE_VALUE_OFFSET + value_size <= entry->value_capacity) {
+      // Overwrite in place; the entry has just been touched, so it is the
+      // last one the eviction below would pick.
+      memcpy(_LRUCACHE_VALUE(entry), value, value_size);
+      entry->value_size = LRUCACHE_VALUE_OFFSET + value_size;
+      cache->charge += charge - node->charge;
+      node->charge = charge;
+      TouchLruCacheEntry(cache, entry);
+      _LruCacheEvictLocked(cache, 0);
+      pthread_rwlock_unlock(&map->lock);
+      return TRUE;
+    }
+    _LruCacheDropLocked(cache, entry, FALSE);
+  }
+
+  // Make room first, so that a CLOCK cache can not pick the new entry.
+  _LruCacheEvictLocked(cache, charge);
+  MapEntry *const entry = _MapAddEntryLocked(
+      map, key, key_size, hash, LRUCACHE_VALUE_OFFSET + value_size);
+  if (entry == NULL) {
+    pthread_rwlock_unlock(&map->lock);
+    fprintf(stderr,
+            "LruCachePut: failed to allocate entry for value_size: %zu\n",
+            value_size);
+    return FALSE;
+  }
+  LruCacheNode *const node = _LRUCACHE_NODE(entry);
+  node->charge = charge;
+  node->referenced = FALSE;
+  if (value_size != 0) memcpy(_LRUCACHE_VALUE(entry), value, value_size);
+  _LruCachePushFront(cache, entry);
+  cache->charge += charge;
+
+  pthread_rwlock_unlock(&map->lock);
+  return TRUE;
+}
+
+// Takes the lock the policy of `cache` needs for a lookup, finds the entry of
+// `key` and counts the hit or the miss.  The caller must release the lock.
+//
+// Returns:
+//  The entry, already marked as just used, or NULL on a miss.
+static MapEntry *LookUpLruCacheEntry(LruCache *const cache,
+                                     const void *const key,
+                                     const size_t key_size) {
+  Map *const map = &cache->map;
+  const hash_t hash = _MapHashKey(map, key, key_size);
+  if (cache->policy == LRUCACHE_POLICY_CLOCK) {
+    pthread_rwlock_rdlock(&map->lock);
+  } else {
+    pthread_rwlock_wrlock(&map->lock);
+  }
+
+  MapEntry **link = _MapFindLink(map, key, key_size, hash);
+  if (link == NULL) {
+    __atomic_fetch_add(&cache->misses, 1, __ATOMIC_RELAXED);
+    return NULL;
+  }
+  __atomic_fetch_add(&cache->hits, 1, __ATOMIC_RELAXED);
+  TouchLruCacheEntry(cache, *link);
+  return *link;
+}
+
+// Looks the `key_size` bytes of `key` up and marks the entry as the most
+// recently used.
+//
+// Returns:
+//  A pointer to the cached value, or NULL on a miss.  `value_size`, if not
+//  NULL, receives the size of the value.  The pointer is only valid until the
+//  entry is evicted, overwritten or removed; use `LruCacheGetCopy()` when
+//  other threads may put keys concurrently.
+//
+// Thread Safety:
+//  A LRU cache holds the write lock to reorder its list; a CLOCK cache only
+//  holds the read lock.
+void *LruCacheGet(LruCache *const cache, const void *const key,
+                  const size_t key_size, size_t *const value_size) {
+  if (cache == NULL || cache->map.buckets == NULL || key == NULL) return NULL;
+
+  MapEntry *const entry = LookUpLruCacheEntry(cache, key, key_size);
+  void *value = NULL;
+  if (entry != NULL) {
+    value = _LRUCACHE_VALUE(entry);
+    if (value_size != NULL)
+      *value_size = entry->value_size - LRUCACHE_VALUE_OFFSET;
+  }
+  pthread_rwlock_unlock(&cache->map.lock);
+  return value;
+}
+
+// Looks the `key_size` bytes of `key` up like `LruCacheGet()` and copies up to
+// `out_size` bytes of the value into `out` while the lock is still held.
+//
+// Returns:
+//  TRUE on a hit.  `value_size`, if not NULL, receives the size of the whole
+//  value, which may exceed `out_size`.
+bool_t LruCacheGetCopy(LruCache *const cache, const void *const key,
+                       const size_t key_size, void *const out,
+                       const size_t out_size, size_t *const value_size) {
+  if (cache == NULL || cache->map.buckets == NULL || key == NULL ||
+      (out == NULL && out_size != 0))
+    return FALSE;
+
+  MapEntry *const entry = LookUpLruCacheEntry(cache, key, key_size);
+  if (entry != NULL) {
+    const size_t size = entry->value_size - LRUCACHE_VALUE_OFFSET;
+    if (size != 0 && out_size != 0)
+      memcpy(out, _LRUCACHE_VALUE(entry), size < out_size ? size : out_size);
+    if (value_size != NULL) *value_size = size;
+  }
+  pthread_rwlock_unlock(&cache->map.lock);
+  return entry != NULL ? TRUE : FALSE;
+}
+
+// Tests whether the `key_size` bytes of `key` are cached without counting a
+// hit or a miss and without touching the recency order.
+//
+// Thread Safety:
+//  This function only holds the read lock of the cache.
+bool_t LruCacheContains(LruCache *const cache, const void *const key,
+                        const size_t key_size) {
+  if (cache == NULL || cache->map.buckets == NULL || key == NULL) return FALSE;
+
+  Map *const map = &cache->map;
+  const hash_t hash = _MapHashKey(map, key, key_size);
+  pthread_rwlock_rdlock(&map->lock);
+  const bool_t found =
+      _MapFindLink(map, key, key_size, hash) != NULL ? TRUE : FALSE;
+  pthread_rwlock_unlock(&map->lock);
+  return found;
+}
+
+// Removes the entry of the `key_size` bytes of `key` without calling the
+// eviction callback.
+//
+// Returns:
+//  TRUE if an entry was removed, FALSE if the key was not cached.
+//
+// Thread Safety:
+//  This function holds the write lock of the cache.
+bool_t LruCacheRemove(LruCache *const cache, const void *const key,
+                      const size_t key_size) {
+  if (cache == NULL || cache->map.buckets == NULL || key == NULL) return FALSE;
+
+  Map *const map = &cache->map;
+  const hash_t hash = _MapHashKey(map, key, key_size);
+  pthread_rwlock_wrlock(&map->lock);
+  _MapRehashStep(map, MAP_REHASH_STEP);
+  MapEntry **link = _MapFindLink(map, key, key_size, hash);
+  if (link != NULL) _LruCacheDropLocked(cache, *link, FALSE);
+  pthread_rwlock_unlock(&map->lock);
+  return link != NULL ? TRUE : FALSE;
+}
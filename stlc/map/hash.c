@@ -0,0 +1,325 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "map/hash.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// The AVX2 accumulator is compiled in on x86 whatever the target flags are and
+// picked at run time when the processor supports it.
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define HASH_HAVE_AVX2 1
+#include <immintrin.h>
+#else
+#define HASH_HAVE_AVX2 0
+#endif
+
+// Constants with balanced bits every hash is keyed with, taken from wyhash.
+static const uint64_t kHashSecret[0x04] = {
+    0x2D358DCCAA6C78A5ULL, 0x8BB84B93962EACC9ULL, 0x4B33A62ED433D4A3ULL,
+    0x4D5A2DA51DE1AA47ULL};
+
+// Multiplier the long-key accumulators are scrambled with.
+#define HASH_SCRAMBLE_PRIME 0x9E3779B1ULL
+
+// Number of 64 byte stripes accumulated between two scrambles.
+#define HASH_STRIPES_PER_BLOCK 0x10
+
+// Multiplies `*a` by `*b`, storing the low half of the 128 bit product in `*a`
+// and the high half in `*b`.
+static inline void HashMultiply(uint64_t* const a, uint64_t* const b) {
+#if defined(__SIZEOF_INT128__)
+  const __uint128_t product = (__uint128_t)*a * *b;
+  *a = (uint64_t)product;
+  *b = (uint64_t)(product >> 0x40);
+#else
+  const uint64_t ha = *a >> 0x20, la = (uint32_t)*a;
+  const uint64_t hb = *b >> 0x20, lb = (uint32_t)*b;
+  const uint64_t hh = ha * hb, hl = ha * lb, lh = la * hb, ll = la * lb;
+  const uint64_t mid = (ll >> 0x20) + (uint32_t)hl + (uint32_t)lh;
+  *a = (mid << 0x20) | (uint32_t)ll;
+  *b = hh + (hl >> 0x20) + (lh >> 0x20) + (mid >> 0x20);
+#endif
+}
+
+// Folds `a` and `b` into one word through their 128 bit product.
+static inline uint64_t HashMix(uint64_t a, uint64_t b) {
+  HashMultiply(&a, &b);
+  return a ^ b;
+}
+
+// Reads eight bytes of `p` as a little endian word.
+static inline uint64_t HashRead8(const unsigned char* const p) {
+  uint64_t word;
+  memcpy(&word, p, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  word = __builtin_bswap64(word);
+#endif
+  return word;
+}
+
+// Reads four bytes of `p` as a little endian word.
+static inline uint64_t HashRead4(const unsigned char* const p) {
+  uint32_t word;
+  memcpy(&word, p, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  word = __builtin_bswap32(word);
+#endif
+  return word;
+}
+
+// Keeps the long-key accumulators from saturating: folds their high bits down
+// and multiplies them by an odd constant.
+static void HashScramble(uint64_t* const acc, const uint64_t* const keys) {
+  for (size_t j = 0; j < 0x08; ++j) {
+    acc[j] ^= acc[j] >> 0x2F;
+    acc[j] ^= keys[j];
+    acc[j] *= HASH_SCRAMBLE_PRIME;
+  }
+}
+
+// Feeds `stripes` stripes of 64 bytes starting at `p` into the eight
+// accumulators `acc` keyed by `keys`.
+//
+// Every lane adds the product of the two halves of its keyed input word to its
+// own accumulator and the raw input word to its neighbour, so no input bit is
+// lost even when the product is zero.  The vector versions below compute
+// exactly the same sums several lanes at a time.
+#if !defined(__SSE2__)
+static void HashAccumulate(const unsigned char* p, const size_t stripes,
+                           uint64_t* const acc, const uint64_t* const keys) {
+  for (size_t n = 0; n < stripes; ++n, p += 0x40) {
+    for (size_t j = 0; j < 0x08; ++j) {
+      const uint64_t data = HashRead8(p + 0x08 * j);
+      const uint64_t keyed = data ^ keys[j];
+      acc[j ^ 1] += data;
+      acc[j] += (keyed & 0xFFFFFFFFULL) * (keyed >> 0x20);
+    }
+    if (n % HASH_STRIPES_PER_BLOCK == HASH_STRIPES_PER_BLOCK - 1) {
+      HashScramble(acc, keys);
+    }
+  }
+}
+#else
+static void HashAccumulate(const unsigned char* p, const size_t stripes,
+                           uint64_t* const acc, const uint64_t* const keys) {
+  __m128i vacc[0x04];
+  __m128i vkeys[0x04];
+  for (size_t j = 0; j < 0x04; ++j) {
+    vacc[j] = _mm_loadu_si128((const __m128i*)(acc + 2 * j));
+    vkeys[j] = _mm_loadu_si128((const __m128i*)(keys + 2 * j));
+  }
+  for (size_t n = 0; n < stripes; ++n, p += 0x40) {
+    for (size_t j = 0; j < 0x04; ++j) {
+      const __m128i data = _mm_loadu_si128((const __m128i*)(p + 0x10 * j));
+      const __m128i keyed = _mm_xor_si128(data, vkeys[j]);
+      const __m128i product =
+          _mm_mul_epu32(keyed, _mm_srli_epi64(keyed, 0x20));
+      const __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+      vacc[j] = _mm_add_epi64(vacc[j], _mm_add_epi64(product, swapped));
+    }
+    if (n % HASH_STRIPES_PER_BLOCK == HASH_STRIPES_PER_BLOCK - 1) {
+      for (size_t j = 0; j < 0x04; ++j) {
+        _mm_storeu_si128((__m128i*)(acc + 2 * j), vacc[j]);
+      }
+      HashScramble(acc, keys);
+      for (size_t j = 0; j < 0x04; ++j) {
+        vacc[j] = _mm_loadu_si128((const __m128i*)(acc + 2 * j));
+      }
+    }
+  }
+  for (size_t j = 0; j < 0x04; ++j) {
+    _mm_storeu_si128((__m128i*)(acc + 2 * j), vacc[j]);
+  }
+}
+#endif
+
+#if HASH_HAVE_AVX2
+__attribute__((target("avx2"))) static void HashAccumulateAvx2(
+    const unsigned char* p, const size_t stripes, uint64_t* const acc,
+    const uint64_t* const keys) {
+  __m256i vacc[0x02];
+  __m256i vkeys[0x02];
+  for (size_t j = 0; j < 0x02; ++j) {
+    vacc[j] = _mm256_loadu_si256((const __m256i*)(acc + 4 * j));
+    vkeys[j] = _mm256_loadu_si256((const __m256i*)(keys + 4 * j));
+  }
+  for (size_t n = 0; n < stripes; ++n, p += 0x40) {
+    for (size_t j = 0; j < 0x02; ++j) {
+      const __m256i data = _mm256_loadu_si256((const __m256i*)(p + 0x20 * j));
+      const __m256i keyed = _mm256_xor_si256(data, vkeys[j]);
+      const __m256i product =
+          _mm256_mul_epu32(keyed, _mm256_srli_epi64(keyed, 0x20));
+      const __m256i swapped =
+          _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+      vacc[j] = _mm256_add_epi64(vacc[j], _mm256_add_epi64(product, swapped));
+    }
+    if (n % HASH_STRIPES_PER_BLOCK == HASH_STRIPES_PER_BLOCK - 1) {
+      for (size_t j = 0; j < 0x02; ++j) {
+        _mm256_storeu_si256((__m256i*)(acc + 4 * j), vacc[j]);
+      }
+      HashScramble(acc, keys);
+      for (size_t j = 0; j < 0x02; ++j) {
+        vacc[j] = _mm256_loadu_si256((const __m256i*)(acc + 4 * j));
+      }
+    }
+  }
+  for (size_t j = 0; j < 0x02; ++j) {
+    _mm256_storeu_si256((__m256i*)(acc + 4 * j), vacc[j]);
+  }
+}
+#endif
+
+// Consumes `stripes` stripes of 64 bytes starting at `p` with eight
+// accumulators keyed by `seed` and folds them into one word.
+static uint64_t HashStripes(const unsigned char* p, const size_t stripes,
+                            const uint64_t seed) {
+  uint64_t keys[0x08];
+  uint64_t acc[0x08];
+  for (size_t j = 0; j < 0x08; ++j) {
+    keys[j] = HashMix(seed ^ kHashSecret[j & 0x03],
+                      kHashSecret[(j + 1) & 0x03] + j);
+    acc[j] = keys[j];
+  }
+
+#if HASH_HAVE_AVX2
+  if (__builtin_cpu_supports("avx2")) {
+    HashAccumulateAvx2(p, stripes, acc, keys);
+  } else {
+    HashAccumulate(p, stripes, acc, keys);
+  }
+#else
+  HashAccumulate(p, stripes, acc, keys);
+#endif
+
+  uint64_t hash = seed;
+  for (size_t j = 0; j < 0x08; j += 2) {
+    hash = HashMix(acc[j] ^ hash, acc[j + 1] ^ kHashSecret[j >> 1]);
+  }
+  return hash;
+}
+
+// Hashes the `key_size` bytes of `key` under `seed`.
+//
+// The function belongs to the wyhash family: it reads the key eight bytes at a
+// time and folds them with 64x64->128 bit multiplies.  Changing `seed` changes
+// every hash, so a map seeded with `HashRandomSeed()` can not be flooded with
+// keys that were chosen to collide.  The result only depends on the bytes, the
+// length and the seed, never on the instruction set the library was built for.
+//
+// Its signature matches `hash_seeded_f` so it can be handed to
+// `MapInitSeeded()` together with `KeyCmpN`.
+hash_t HashBytes(const void* const key, const size_t key_size,
+                 const hash_t seed) {
+  const unsigned char* p = (const unsigned char*)key;
+  const size_t len = p != NULL ? key_size : 0;
+  uint64_t state = HashMix((uint64_t)seed ^ kHashSecret[0], kHashSecret[1]);
+  uint64_t a;
+  uint64_t b;
+
+  if (len <= 0x10) {
+    if (len >= 0x04) {
+      // Two possibly overlapping reads from each end cover every byte.
+      const size_t shift = (len >> 0x03) << 0x02;
+      a = (HashRead4(p) << 0x20) | HashRead4(p + shift);
+      b = (HashRead4(p + len - 0x04) << 0x20) |
+          HashRead4(p + len - 0x04 - shift);
+    } else if (len > 0) {
+      a = ((uint64_t)p[0] << 0x10) | ((uint64_t)p[len >> 1] << 0x08) |
+          p[len - 1];
+      b = 0;
+    } else {
+      a = 0;
+      b = 0;
+    }
+  } else {
+    size_t remaining = len;
+    if (remaining >= HASH_LONG_KEY) {
+      // Leave at least one byte for the tail so it always ends on real data.
+      const size_t stripes = (remaining - 1) >> 0x06;
+      state = HashStripes(p, stripes, state);
+      p += stripes << 0x06;
+      remaining -= stripes << 0x06;
+    } else if (remaining > 0x30) {
+      uint64_t state1 = state;
+      uint64_t state2 = state;
+      do {
+        state = HashMix(HashRead8(p) ^ kHashSecret[1],
+                        HashRead8(p + 0x08) ^ state);
+        state1 = HashMix(HashRead8(p + 0x10) ^ kHashSecret[2],
+                         HashRead8(p + 0x18) ^ state1);
+        state2 = HashMix(HashRead8(p + 0x20) ^ kHashSecret[3],
+                         HashRead8(p + 0x28) ^ state2);
+        p += 0x30;
+        remaining -= 0x30;
+      } while (remaining > 0x30);
+      state ^= state1 ^ state2;
+    }
+    while (remaining > 0x10) {
+      state =
+          HashMix(HashRead8(p) ^ kHashSecret[1], HashRead8(p + 0x08) ^ state);
+      p += 0x10;
+      remaining -= 0x10;
+    }
+    // The last 16 bytes of the key, overlapping the bytes consumed above.
+    a = HashRead8(p + remaining - 0x10);
+    b = HashRead8(p + remaining - 0x08);
+  }
+
+  a ^= kHashSecret[1];
+  b ^= state;
+  HashMultiply(&a, &b);
+  return (hash_t)HashMix(a ^ kHashSecret[0] ^ len, b ^ kHashSecret[1]);
+}
+
+// Returns a seed drawn from the system random source, or from the clock and
+// the address space layout when no such source is available.
+hash_t HashRandomSeed(void) {
+  uint64_t seed = 0;
+  FILE* urandom = fopen("/dev/urandom", "rb");
+  if (urandom != NULL) {
+    const size_t read = fread(&seed, sizeof(seed), 1, urandom);
+    fclose(urandom);
+    if (read == 1) return (hash_t)seed;
+  }
+
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  seed = HashMix((uint64_t)ts.tv_nsec ^ kHashSecret[2],
+                 (uint64_t)ts.tv_sec ^ (uint64_t)(uintptr_t)&seed);
+  return (hash_t)seed;
+}
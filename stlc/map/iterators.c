@@ -29,12 +29,193 @@
 
 #include "map/iterators.h"
 
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 #include "bool.h"
 #include "map/iterators.h"
 #include "map/map.h"
 
+// Calls `predicate` on every entry of the bucket array `buckets` of `capacity`
+// buckets.  Returns FALSE as soon as `predicate` does, TRUE otherwise.
+static bool_t TraverseMapBuckets(MapEntry **const buckets,
+                                 const size_t capacity,
+                                 bool_t (*predicate)(const void *key,
+                                                     const void *value)) {
+  for (size_t i = 0; i < capacity; i++) {
+    for (MapEntry *entry = buckets[i]; entry != NULL; entry = entry->next) {
+      if (predicate(entry->key, entry->value) == FALSE) return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+// Reverses the bits of `value`: the bits are swapped inside every byte, then
+// the bytes are swapped.
+static size_t ReverseMapCursor(size_t value) {
+  value = ((value >> 0x01) & (size_t)0x5555555555555555ULL) |
+          ((value & (size_t)0x5555555555555555ULL) << 0x01);
+  value = ((value >> 0x02) & (size_t)0x3333333333333333ULL) |
+          ((value & (size_t)0x3333333333333333ULL) << 0x02);
+  value = ((value >> 0x04) & (size_t)0x0F0F0F0F0F0F0F0FULL) |
+          ((value & (size_t)0x0F0F0F0F0F0F0F0FULL) << 0x04);
+  return sizeof(size_t) == 0x08 ? (size_t)__builtin_bswap64(value)
+                                 : (size_t)__builtin_bswap32(value);
+}
+
+// Returns the cursor following `cursor` in a table of `mask + 1` buckets: the
+// bucket index bits are incremented from the most significant one down, so
+// that the buckets a bucket splits into on growth all come after it.
+static size_t NextMapCursor(size_t cursor, const size_t mask) {
+  cursor |= ~mask;
+  cursor = ReverseMapCursor(cursor);
+  ++cursor;
+  return ReverseMapCursor(cursor);
+}
+
+// Returns the number of bytes the copy of `entry` takes in the buffer of an
+// iterator, padded so that the next copy is aligned to `MAP_ENTRY_ALIGNMENT`.
+static size_t MapIteratorCopySize(const MapEntry *const entry) {
+  return (offsetof(MapEntry, data) + _MAP_ENTRY_VALUE_OFFSET(entry->key_size) +
+          entry->value_size + MAP_ENTRY_ALIGNMENT - 1) &
+         ~(size_t)(MAP_ENTRY_ALIGNMENT - 1);
+}
+
+// Appends copies of the entries of the chain starting at `entry` to the buffer
+// of `iterator`, so that they stay readable once the read lock is released.
+// The `key` and `value` pointers of the copies are only set when they are
+// returned, as the buffer may move while it grows.  Returns FALSE on
+// allocation failure.
+static bool_t BufferMapIteratorChain(MapIterator *const iterator,
+                                     const MapEntry *entry) {
+  for (; entry != NULL; entry = entry->next) {
+    const size_t value_offset = _MAP_ENTRY_VALUE_OFFSET(entry->key_size);
+    const size_t size = MapIteratorCopySize(entry);
+    if (iterator->size + size > iterator->capacity) {
+      size_t capacity = iterator->capacity == 0 ? 0x400 : iterator->capacity;
+      while (capacity < iterator->size + size) capacity <<= 0x01;
+      unsigned char *entries =
+          (unsigned char *)realloc(iterator->entries, capacity);
+      if (entries == NULL) {
+        fprintf(stderr,
+                "MapIteratorNext: failed to buffer entries for capacity: "
+                "%zu\n",
+                capacity);
+        return FALSE;
+      }
+      iterator->entries = entries;
+      iterator->capacity = capacity;
+    }
+    MapEntry *const copy = (MapEntry *)(iterator->entries + iterator->size);
+    copy->hash = entry->hash;
+    copy->next = NULL;
+    copy->key_size = entry->key_size;
+    copy->value_size = entry->value_size;
+    copy->value_capacity = entry->value_size;
+    memcpy(copy->data, entry->key, entry->key_size);
+    memcpy(copy->data + value_offset, entry->value, entry->value_size);
+    iterator->size += size;
+    ++iterator->count;
+  }
+  return TRUE;
+}
+
+// Buffers the entries of the buckets at the cursor of `iterator` and advances
+// it.  During an incremental resize that is the bucket of the smaller table
+// and every bucket of the larger one it splits into.  The caller must hold the
+// read lock of the map.
+static void FetchMapIteratorBuckets(MapIterator *const iterator) {
+  const Map *const map = iterator->map;
+  size_t cursor = iterator->cursor;
+  bool_t buffered = TRUE;
+
+  if (map->old_buckets == NULL) {
+    const size_t mask = map->capacity - 1;
+    buffered = BufferMapIteratorChain(iterator, map->buckets[cursor & mask]);
+    cursor = NextMapCursor(cursor, mask);
+  } else {
+    MapEntry **small = map->buckets;
+    MapEntry **large = map->old_buckets;
+    size_t small_mask = map->capacity - 1;
+    size_t large_mask = map->old_capacity - 1;
+    if (small_mask > large_mask) {
+      small = map->old_buckets;
+      large = map->buckets;
+      small_mask = map->old_capacity - 1;
+      large_mask = map->capacity - 1;
+    }
+
+    buffered = BufferMapIteratorChain(iterator, small[cursor & small_mask]);
+    do {
+      if (buffered == TRUE) {
+        buffered =
+            BufferMapIteratorChain(iterator, large[cursor & large_mask]);
+      }
+      cursor = (((cursor | small_mask) + 1) & ~small_mask) |
+               (cursor & small_mask);
+    } while (cursor & (small_mask ^ large_mask));
+    cursor = NextMapCursor(cursor, small_mask);
+  }
+
+  iterator->cursor = cursor;
+  if (cursor == 0 || buffered == FALSE) iterator->done = TRUE;
+}
+
+// The share of the buckets of a `MapParallelTraverse()` worker.
+typedef struct MapTraverseWorker {
+  MapEntry **buckets;
+  size_t begin;
+  size_t end;
+  MapEntry **old_buckets;
+  size_t old_begin;
+  size_t old_end;
+  bool_t (*predicate)(const void *key, const void *value);
+  bool_t *stop;
+} MapTraverseWorker;
+
+// Calls the predicate of the worker `arg` on the entries of its slices until
+// it or another worker's predicate returns FALSE.
+static void *TraverseMapSlice(void *arg) {
+  MapTraverseWorker *const worker = (MapTraverseWorker *)arg;
+  for (size_t i = worker->begin; i < worker->end; ++i) {
+    if (__atomic_load_n(worker->stop, __ATOMIC_RELAXED) == TRUE) return NULL;
+    for (MapEntry *entry = worker->buckets[i]; entry != NULL;
+         entry = entry->next) {
+      if (worker->predicate(entry->key, entry->value) == FALSE) {
+        __atomic_store_n(worker->stop, TRUE, __ATOMIC_RELAXED);
+        return NULL;
+      }
+    }
+  }
+  for (size_t i = worker->old_begin; i < worker->old_end; ++i) {
+    if (__atomic_load_n(worker->stop, __ATOMIC_RELAXED) == TRUE) return NULL;
+    for (MapEntry *entry = worker->old_buckets[i]; entry != NULL;
+         entry = entry->next) {
+      if (worker->predicate(entry->key, entry->value) == FALSE) {
+        __atomic_store_n(worker->stop, TRUE, __ATOMIC_RELAXED);
+        return NULL;
+      }
+    }
+  }
+  return NULL;
+}
+
+// Calls `predicate` on every entry of the bucket array `buckets` of `capacity`
+// buckets.  Returns FALSE as soon as `predicate` does, TRUE otherwise.
+static bool_t TraverseMapBucketEntries(MapEntry **const buckets,
+                                       const size_t capacity,
+                                       bool_t (*predicate)(const MapEntry *)) {
+  for (size_t i = 0; i < capacity; i++) {
+    for (MapEntry *entry = buckets[i]; entry != NULL; entry = entry->next) {
+      if (predicate(entry) == FALSE) return FALSE;
+    }
+  }
+  return TRUE;
+}
+
 // Traverses the entire map and calls the given predicate function on each map
 // element.
 //
@@ -51,25 +232,244 @@
 //  The number of map elements traversed.
 //
 // Remarks:
-//  The function acquires the map mutex lock before traversing the map to ensure
-//  thread safety. The function does not modify the map or its elements.
+//  The function holds the read lock of the map while traversing it to ensure
+//  thread safety, so `predicate` may look keys up but must not insert or remove
+//  any.  The function does not modify the map or its elements.  During an
+//  incremental resize the entries not migrated yet are visited after the
+//  others.
 void MapTraverse(Map *const map,
                  bool_t (*predicate)(const void *key, const void *value)) {
   if (map == NULL || predicate == NULL) return;
 
-  pthread_mutex_lock(&map->mutex);
+  _MapTraverseUntil(map, predicate);
+}
+
+// Traverses the entire map like `MapTraverse()` and calls `predicate` on each
+// entry, exposing the sizes of its key and value and the hash it is stored
+// under, for example to persist them along with the key.
+//
+// Remarks:
+//  The same locking rules as for `MapTraverse()` apply.  `predicate` must not
+//  modify the entry.
+void MapTraverseEntries(Map *const map,
+                        bool_t (*predicate)(const MapEntry *entry)) {
+  if (map == NULL || predicate == NULL) return;
 
-  for (size_t i = 0; i < map->capacity; i++) {
-    MapEntry *entry = map->buckets[i];
+  pthread_rwlock_rdlock(&map->lock);
+  if (TraverseMapBucketEntries(map->buckets, map->capacity, predicate) ==
+          TRUE &&
+      map->old_buckets != NULL) {
+    TraverseMapBucketEntries(map->old_buckets, map->old_capacity, predicate);
+  }
+  pthread_rwlock_unlock(&map->lock);
+}
+
+// Creates an iterator over `map` starting at `cursor`, which is `0` to start
+// from the beginning or a value returned by `MapIteratorCursor()` to resume an
+// earlier iteration.
+//
+// Returns:
+//  The iterator which must be released with `MapIteratorFree()`, or NULL on
+//  allocation failure.
+MapIterator *MapIteratorNew(Map *const map, const size_t cursor) {
+  if (map == NULL) return NULL;
 
-    while (entry != NULL) {
-      if (predicate(entry->key, entry->value) == FALSE) {
-        pthread_mutex_unlock(&map->mutex);
-        return;
+  MapIterator *iterator;
+  if ((iterator = (MapIterator *)malloc(sizeof(MapIterator))) == NULL) {
+    fprintf(stderr, "MapIteratorNew: failed to allocate iterator\n");
+    return NULL;
+  }
+  iterator->map = map;
+  iterator->cursor = cursor;
+  iterator->resume = cursor;
+  iterator->done = FALSE;
+  iterator->entries = NULL;
+  iterator->size = 0;
+  iterator->offset = 0;
+  iterator->count = 0;
+  iterator->index = 0;
+  iterator->capacity = 0;
+  return iterator;
+}
+
+// Returns the next entry of the iteration, or NULL once every bucket has been
+// visited.
+//
+// Remarks:
+//  The read lock of the map is only held while the next non-empty buckets are
+//  fetched, so writers may run between two calls.  The entries of the fetched
+//  buckets are copied while the lock is held, so the returned entry is a
+//  snapshot owned by the iterator that stays valid until the next call to
+//  `MapIteratorNext()` or `MapIteratorFree()`, whatever writers do meanwhile.
+const MapEntry *MapIteratorNext(MapIterator *const iterator) {
+  if (iterator == NULL) return NULL;
+
+  while (iterator->index == iterator->count) {
+    if (iterator->done == TRUE) return NULL;
+    iterator->size = 0;
+    iterator->offset = 0;
+    iterator->count = 0;
+    iterator->index = 0;
+
+    const Map *const map = iterator->map;
+    pthread_rwlock_rdlock(&iterator->map->lock);
+    // Consecutive cursors are far apart in the bucket array, so the buckets
+    // `MAP_ITERATOR_PREFETCH` cursors ahead are prefetched.
+    const size_t mask = map->capacity - 1;
+    size_t ahead = iterator->cursor;
+    if (map->old_buckets == NULL) {
+      for (size_t i = 0; i < MAP_ITERATOR_PREFETCH; ++i) {
+        __builtin_prefetch(&map->buckets[ahead & mask], 0, 0);
+        ahead = NextMapCursor(ahead, mask);
+      }
+    }
+
+    iterator->resume = iterator->cursor;
+    for (size_t step = 0;
+         step < MAP_ITERATOR_SCAN_STEP && iterator->done == FALSE &&
+         iterator->count < MAP_ITERATOR_BATCH;
+         ++step) {
+      if (map->old_buckets == NULL) {
+        __builtin_prefetch(&map->buckets[ahead & mask], 0, 0);
+        ahead = NextMapCursor(ahead, mask);
       }
-      entry = entry->next;
+      FetchMapIteratorBuckets(iterator);
     }
+    pthread_rwlock_unlock(&iterator->map->lock);
+  }
+  MapEntry *const entry = (MapEntry *)(iterator->entries + iterator->offset);
+  entry->key = entry->data;
+  entry->value = entry->data + _MAP_ENTRY_VALUE_OFFSET(entry->key_size);
+  iterator->offset += MapIteratorCopySize(entry);
+  ++iterator->index;
+  return entry;
+}
+
+// Returns the cursor to hand to `MapIteratorNew()` to resume the iteration
+// later, possibly after the map was resized, or `0` once it is over.  Entries
+// returned since the buckets in flight were fetched may be returned again.
+size_t MapIteratorCursor(const MapIterator *const iterator) {
+  if (iterator == NULL) return 0;
+  return iterator->index < iterator->count ? iterator->resume
+                                           : iterator->cursor;
+}
+
+// Frees up an iterator created by `MapIteratorNew()`.
+void MapIteratorFree(MapIterator *const iterator) {
+  if (iterator == NULL) return;
+  free(iterator->entries);
+  free(iterator);
+}
+
+// Traverses the entire map like `MapTraverse()`, splitting the bucket range
+// across `workers` threads that call `predicate` concurrently.
+//
+// Params:
+//  map       - A pointer to the map to traverse.
+//  workers   - The number of threads to use, or `0` to use one per online
+//              processor.  Fewer are used when the map has less than
+//              `MAP_PARALLEL_MIN_BUCKETS` buckets per thread.
+//  predicate - The function called on every entry.  It must be safe to call
+//              from several threads at once.  Returning FALSE stops every
+//              worker as soon as it notices.
+//
+// Remarks:
+//  The calling thread holds the read lock of the map on behalf of the workers
+//  for the whole traversal, so `predicate` may look keys up but must not insert
+//  or remove any.
+void MapParallelTraverse(Map *const map, size_t workers,
+                         bool_t (*predicate)(const void *key,
+                                             const void *value)) {
+  if (map == NULL || predicate == NULL) return;
+
+  if (workers == 0) {
+    const long online = sysconf(_SC_NPROCESSORS_ONLN);
+    workers = online > 0 ? (size_t)online : 1;
+  }
+
+  pthread_rwlock_rdlock(&map->lock);
+  const size_t buckets = map->capacity + map->old_capacity;
+  if (workers > buckets / MAP_PARALLEL_MIN_BUCKETS) {
+    workers = buckets / MAP_PARALLEL_MIN_BUCKETS;
+  }
+  if (workers <= 1) {
+    if (TraverseMapBuckets(map->buckets, map->capacity, predicate) == TRUE &&
+        map->old_buckets != NULL) {
+      TraverseMapBuckets(map->old_buckets, map->old_capacity, predicate);
+    }
+    pthread_rwlock_unlock(&map->lock);
+    return;
+  }
+
+  MapTraverseWorker *slices;
+  pthread_t *threads;
+  slices = (MapTraverseWorker *)malloc(workers * sizeof(MapTraverseWorker));
+  threads = (pthread_t *)malloc(workers * sizeof(pthread_t));
+  if (slices == NULL || threads == NULL) {
+    fprintf(stderr, "MapParallelTraverse: failed to allocate %zu workers\n",
+            workers);
+    free(slices);
+    free(threads);
+    pthread_rwlock_unlock(&map->lock);
+    return;
+  }
+
+  // Both bucket arrays are split into `workers` contiguous slices.
+  bool_t stop = FALSE;
+  for (size_t i = 0; i < workers; ++i) {
+    slices[i].buckets = map->buckets;
+    slices[i].begin = map->capacity * i / workers;
+    slices[i].end = map->capacity * (i + 1) / workers;
+    slices[i].old_buckets = map->old_buckets;
+    slices[i].old_begin = map->old_capacity * i / workers;
+    slices[i].old_end = map->old_capacity * (i + 1) / workers;
+    slices[i].predicate = predicate;
+    slices[i].stop = &stop;
+  }
+
+  // The calling thread takes the first slice itself.  A slice whose thread
+  // can not be created is traversed inline as well.
+  bool_t *spawned = (bool_t *)calloc(workers, sizeof(bool_t));
+  for (size_t i = 1; i < workers; ++i) {
+    if (spawned != NULL && pthread_create(&threads[i], NULL,
+                                          TraverseMapSlice, &slices[i]) == 0) {
+      spawned[i] = TRUE;
+    }
+  }
+  TraverseMapSlice(&slices[0]);
+  for (size_t i = 1; i < workers; ++i) {
+    if (spawned != NULL && spawned[i] == TRUE) {
+      pthread_join(threads[i], NULL);
+    } else {
+      TraverseMapSlice(&slices[i]);
+    }
+  }
+  pthread_rwlock_unlock(&map->lock);
+
+  free(spawned);
+  free(threads);
+  free(slices);
+}
+
+// Traverses `map` like `MapTraverse()` under its read lock.
+//
+// Returns:
+//  FALSE if `predicate` stopped the traversal, TRUE otherwise.
+//
+// This function is meant to be protected inside `map` and `shardedmap`
+// modules.
+bool_t _MapTraverseUntil(Map *const map,
+                         bool_t (*predicate)(const void *key,
+                                             const void *value)) {
+  pthread_rwlock_rdlock(&map->lock);
+
+  bool_t completed =
+      TraverseMapBuckets(map->buckets, map->capacity, predicate);
+  if (completed == TRUE && map->old_buckets != NULL) {
+    completed =
+        TraverseMapBuckets(map->old_buckets, map->old_capacity, predicate);
   }
 
-  pthread_mutex_unlock(&map->mutex);
+  pthread_rwlock_unlock(&map->lock);
+  return completed;
 }
@@ -31,11 +31,14 @@
 
 #include <assert.h>
 #include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 
+#include "map/hash.h"
 #include "map/ops.h"
 
 // Creates a hash from a `key` of `string` data type.
@@ -43,6 +46,9 @@
 // This functionality allow us to place a `key` inside our `Map` provided that
 // the given `key` is a `string` data type. We read `keylen` bytes from the
 // given `key` and accumulate a `hash` value.
+//
+// This is the byte-at-a-time djb2 hash; prefer `HashBytes` from "map/hash.h"
+// for new maps.
 hash_t Hash(const void* const key) {
   hash_t hash = 0X1505;
   if (key == NULL) return hash;
@@ -50,11 +56,11 @@ hash_t Hash(const void* const key) {
   const unsigned char* key_ = (const unsigned char*)key;
   size_t keylen = strlen((const char*)key_);
 
-  // This implementation uses the FNV-1a algorithm, which is a simple but
-  // effective hash function for strings. It starts with an initial value of
-  // 5381 and multiplies it by 33 (left shift by 5 and then add) for each
-  // character in the string. Finally, it adds the character value to the hash.
-  // The hash value is returned at the end.
+  // This implementation uses the djb2 algorithm, which is a simple hash
+  // function for strings. It starts with an initial value of 5381 and
+  // multiplies it by 33 (left shift by 5 and then add) for each character in
+  // the string. Finally, it adds the character value to the hash. The hash
+  // value is returned at the end.
   for (size_t i = 0; i < keylen; ++i) {
     hash = ((hash << 0X5) + hash) + key_[i];
   }
@@ -71,6 +77,31 @@ bool_t KeyCmp(const void* key1, const void* key2) {
   return strcmp((char*)key1, (char*)key2) == 0 ? TRUE : FALSE;
 }
 
+// Creates a hash from the `key_size` bytes of `key`.
+//
+// Produces the same hash as `Hash` for a string passed without its terminator
+// but never scans the key, so it works for binary keys too.
+hash_t HashN(const void* const key, const size_t key_size) {
+  hash_t hash = 0X1505;
+  if (key == NULL) return hash;
+
+  const unsigned char* key_ = (const unsigned char*)key;
+  for (size_t i = 0; i < key_size; ++i) {
+    hash = ((hash << 0X5) + hash) + key_[i];
+  }
+  return hash;
+}
+
+// Compares two keys of `key1_size` and `key2_size` bytes for byte-wise
+// equality.
+bool_t KeyCmpN(const void* key1, const size_t key1_size, const void* key2,
+               const size_t key2_size) {
+  if (key1 == NULL && key2 == NULL) return TRUE;
+  if (key1 == NULL || key2 == NULL) return FALSE;
+  if (key1_size != key2_size) return FALSE;
+  return memcmp(key1, key2, key1_size) == 0 ? TRUE : FALSE;
+}
+
 // Initializes a MapEntry with the specified key, key size, value, value size,
 // hash, and next MapEntry.
 //
@@ -82,6 +113,11 @@ bool_t KeyCmp(const void* key1, const void* key2) {
 //  value_size - The size of the value.
 //  hash       - The hash value for the key.
 //  next       - A pointer to the next MapEntry in the map.
+//
+// Remarks:
+//  The key and the value are copied into two separate allocations that the
+//  caller owns.  Entries stored inside a `Map` are created with `MapEntryNew()`
+//  instead.
 void MapEntryInit(MapEntry* map_entry, const void* key, const size_t key_size,
                   const void* value, const size_t value_size, const hash_t hash,
                   MapEntry* const next) {
@@ -105,7 +141,145 @@ void MapEntryInit(MapEntry* map_entry, const void* key, const size_t key_size,
   memcpy(map_entry->value, value, value_size);
 
   map_entry->hash = hash;
-  map_entry->next = NULL;
+  map_entry->next = next;
+  map_entry->key_size = key_size;
+  map_entry->value_size = value_size;
+  map_entry->value_capacity = value_size;
+}
+
+// Total number of bytes of an entry block holding a key of `key_size` bytes and
+// `value_capacity` bytes reserved for the value.
+static size_t ComputeMapEntrySize(const size_t key_size,
+                                  const size_t value_capacity) {
+  return sizeof(MapEntry) + _MAP_ENTRY_VALUE_OFFSET(key_size) + value_capacity;
+}
+
+// Fills the freshly allocated entry block `map_entry` reserving
+// `value_capacity` bytes for the value.  The value bytes are left
+// uninitialized when `value` is NULL.
+static MapEntry* FillMapEntry(MapEntry* const map_entry, const void* key,
+                              const size_t key_size, const void* value,
+                              const size_t value_size,
+                              const size_t value_capacity, const hash_t hash,
+                              MapEntry* const next) {
+  map_entry->key = map_entry->data;
+  map_entry->value = map_entry->data + _MAP_ENTRY_VALUE_OFFSET(key_size);
+  memcpy(map_entry->key, key, key_size);
+  if (value != NULL) memcpy(map_entry->value, value, value_size);
+  map_entry->hash = hash;
+  map_entry->next = next;
+  map_entry->key_size = key_size;
+  map_entry->value_size = value_size;
+  map_entry->value_capacity = value_capacity;
+  return map_entry;
+}
+
+// Allocates a MapEntry holding copies of the key and the value in a single
+// block.
+//
+// Params:
+//  key        - A pointer to the key.
+//  key_size   - The size of the key.
+//  value      - A pointer to the value.
+//  value_size - The size of the value.
+//  hash       - The hash value for the key.
+//  next       - A pointer to the next MapEntry in the map.
+//
+// Returns:
+//  The new entry which must be released with a single `free()`, or NULL if
+//  `key` or `value` is NULL or the allocation failed.
+MapEntry* MapEntryNew(const void* key, const size_t key_size,
+                      const void* value, const size_t value_size,
+                      const hash_t hash, MapEntry* const next) {
+  if (key == NULL || value == NULL) return NULL;
+
+  MapEntry* map_entry;
+  if ((map_entry = (MapEntry*)malloc(
+           ComputeMapEntrySize(key_size, value_size))) == NULL) {
+    fprintf(stderr,
+            "MapEntryNew: failed to allocate entry for key_size: %zu, "
+            "value_size: %zu\n",
+            key_size, value_size);
+    return NULL;
+  }
+  return FillMapEntry(map_entry, key, key_size, value, value_size, value_size,
+                      hash, next);
+}
+
+// Allocates an entry for `map` the way `MapEntryNew()` does, taking the memory
+// from the slab of `map` when it has one.  `value` may be NULL to reserve
+// `value_size` uninitialized bytes for the value.
+//
+// This function is meant to be protected inside `map` module.
+MapEntry* _MapEntryAlloc(Map* const map, const void* key,
+                         const size_t key_size, const void* value,
+                         const size_t value_size, const hash_t hash,
+                         MapEntry* const next) {
+  if (key == NULL) return NULL;
+
+  // Hand the slack of a slab chunk to the value so later overwrites can reuse
+  // it.
+  const size_t size =
+      map->slab == NULL
+          ? ComputeMapEntrySize(key_size, value_size)
+          : MapSlabChunkSize(ComputeMapEntrySize(key_size, value_size));
+  MapEntry* map_entry =
+      map->slab == NULL ? (MapEntry*)malloc(size)
+                        : (MapEntry*)MapSlabAlloc(map->slab, size);
+  if (map_entry == NULL) {
+    fprintf(stderr,
+            "_MapEntryAlloc: failed to allocate entry for key_size: %zu, "
+            "value_size: %zu\n",
+            key_size, value_size);
+    return NULL;
+  }
+  return FillMapEntry(map_entry, key, key_size, value, value_size,
+                      size - ComputeMapEntrySize(key_size, 0), hash, next);
+}
+
+// Grows `entry` so that it can hold a value of `value_size` bytes.  The key
+// and the chain link are preserved; the value bytes are not.
+//
+// Returns:
+//  The entry which may have moved, or NULL on allocation failure in which case
+//  `entry` is left untouched.
+//
+// This function is meant to be protected inside `map` module.
+MapEntry* _MapEntryGrow(Map* const map, MapEntry* const entry,
+                        const size_t value_size) {
+  MapEntry* grown;
+  size_t value_capacity = value_size;
+  if (map->slab == NULL) {
+    grown = (MapEntry*)realloc(
+        entry, ComputeMapEntrySize(entry->key_size, value_size));
+  } else {
+    const size_t size =
+        MapSlabChunkSize(ComputeMapEntrySize(entry->key_size, value_size));
+    if ((grown = (MapEntry*)MapSlabAlloc(map->slab, size)) != NULL) {
+      memcpy(grown, entry, ComputeMapEntrySize(entry->key_size, 0));
+      MapSlabFree(map->slab, entry,
+                  ComputeMapEntrySize(entry->key_size, entry->value_capacity));
+      value_capacity = size - ComputeMapEntrySize(entry->key_size, 0);
+    }
+  }
+  if (grown == NULL) return NULL;
+
+  grown->key = grown->data;
+  grown->value = grown->data + _MAP_ENTRY_VALUE_OFFSET(grown->key_size);
+  grown->value_capacity = value_capacity;
+  return grown;
+}
+
+// Releases an entry allocated by `_MapEntryAlloc()`.
+//
+// This function is meant to be protected inside `map` module.
+void _MapEntryRelease(Map* const map, MapEntry* const entry) {
+  if (map->slab == NULL) {
+    free(entry);
+    return;
+  }
+  MapSlabFree(map->slab, entry,
+              ComputeMapEntrySize(entry->key_size, entry->value_capacity));
 }
 
 // Initializes a new instance of the Map data structure with the specified
@@ -133,32 +307,173 @@ void MapEntryInit(MapEntry* map_entry, const void* key, const size_t key_size,
 //  and return a boolean value indicating whether they are equal or not.
 void MapInit(Map* const map, const size_t capacity, hash_f hash_func,
              key_eq_f key_eq_func) {
-  if (map == NULL) return;
-  if (capacity < MAP_MIN_CAPACITY || capacity > MAP_MAX_CAPACITY) {
+  MapConfig config;
+  MapConfigInit(&config, capacity, hash_func, key_eq_func);
+  MapInitWithConfig(map, &config);
+}
+
+// Initializes a new instance of the Map data structure whose keys are hashed
+// and compared by the length-aware `hash_n_func` and `key_eq_n_func`, for
+// example `HashN` and `KeyCmpN`.
+//
+// Remarks:
+//  This function behaves like `MapInit()` otherwise.  Use `MapInsertN()`,
+//  `MapGetN()` and `MapRemoveN()` to pass the length of every key.
+void MapInitN(Map* const map, const size_t capacity, hash_n_f hash_n_func,
+              key_eq_n_f key_eq_n_func) {
+  MapConfig config;
+  MapConfigInit(&config, capacity, NULL, NULL);
+  config.hash_n_func = hash_n_func;
+  config.key_eq_n_func = key_eq_n_func;
+  MapInitWithConfig(map, &config);
+}
+
+// Initializes a new instance of the Map data structure whose keys are hashed
+// by `hash_seeded_func` under a random per-map seed and compared by
+// `key_eq_n_func`, for example `HashBytes` and `KeyCmpN`.
+//
+// Remarks:
+//  This function behaves like `MapInitN()` otherwise.
+void MapInitSeeded(Map* const map, const size_t capacity,
+                   hash_seeded_f hash_seeded_func, key_eq_n_f key_eq_n_func) {
+  MapConfig config;
+  MapConfigInit(&config, capacity, NULL, NULL);
+  config.hash_seeded_func = hash_seeded_func;
+  config.key_eq_n_func = key_eq_n_func;
+  MapInitWithConfig(map, &config);
+}
+
+// Fills `config` with the given capacity and callbacks and the default value
+// of every other option.
+void MapConfigInit(MapConfig* const config, const size_t capacity,
+                   hash_f hash_func, key_eq_f key_eq_func) {
+  if (config == NULL) return;
+
+  config->capacity = capacity;
+  config->hash_func = hash_func;
+  config->key_eq_func = key_eq_func;
+  config->hash_n_func = NULL;
+  config->key_eq_n_func = NULL;
+  config->hash_seeded_func = NULL;
+  config->seed = 0;
+  config->use_slab = FALSE;
+  config->incremental_rehash = FALSE;
+  config->max_load_factor = MAP_DEFAULT_MAX_LOAD_FACTOR;
+  config->min_load_factor = MAP_DEFAULT_MIN_LOAD_FACTOR;
+  config->max_capacity = MAP_MAX_CAPACITY;
+}
+
+// Rounds `capacity` up to the next power of two.
+static size_t ComputeMapCapacity(const size_t capacity) {
+  size_t rounded = MAP_MIN_CAPACITY;
+  while (rounded < capacity) rounded <<= 0x01;
+  return rounded;
+}
+
+// Recomputes the sizes at which `map` grows and shrinks after its capacity
+// changed.
+static void UpdateMapThresholds(Map* const map) {
+  map->grow_at = map->capacity < map->max_capacity
+                     ? (size_t)(map->max_load_factor * (double)map->capacity)
+                     : SIZE_MAX;
+  map->shrink_at = (size_t)(map->min_load_factor * (double)map->capacity);
+}
+
+// Initializes a new instance of the Map data structure as described by
+// `config`.
+//
+// Remarks:
+//  This function behaves like `MapInit()` for the capacity and the callbacks.
+//  If either pointer is NULL, this function returns immediately without doing
+//  anything.
+void MapInitWithConfig(Map* const map, const MapConfig* const config) {
+  if (map == NULL || config == NULL) return;
+  if (config->capacity < MAP_MIN_CAPACITY ||
+      config->capacity > MAP_MAX_CAPACITY) {
     fprintf(stderr, "MapInit: capacity out of range [%zu, %zu]: %zu\n",
-            MAP_MIN_CAPACITY, MAP_MAX_CAPACITY, capacity);
+            MAP_MIN_CAPACITY, MAP_MAX_CAPACITY, config->capacity);
     return;
   }
+  if (!(config->max_load_factor > 0) || !(config->min_load_factor >= 0) ||
+      !(config->min_load_factor < config->max_load_factor / 2)) {
+    fprintf(stderr,
+            "MapInit: invalid load factors, min: %f, max: %f, expected "
+            "0 <= min < max / 2\n",
+            config->min_load_factor, config->max_load_factor);
+    return;
+  }
+  if (config->max_capacity < config->capacity ||
+      config->max_capacity > MAP_MAX_CAPACITY) {
+    fprintf(stderr, "MapInit: max_capacity out of range [%zu, %zu]: %zu\n",
+            config->capacity, MAP_MAX_CAPACITY, config->max_capacity);
+    return;
+  }
+  const size_t capacity = ComputeMapCapacity(config->capacity);
 
   map->capacity = capacity;
   map->size = 0;
-  map->hash_func = hash_func;
-  map->key_eq_func = key_eq_func;
-  if ((map->buckets = (MapEntry**)calloc(capacity, sizeof(MapEntry*))) ==
-      NULL) {
+  map->hash_func = config->hash_func;
+  map->key_eq_func = config->key_eq_func;
+  map->hash_n_func = NULL;
+  map->key_eq_n_func = NULL;
+  map->hash_seeded_func = NULL;
+  map->seed = 0;
+  if (config->key_eq_n_func != NULL) {
+    if (config->hash_seeded_func != NULL) {
+      map->hash_seeded_func = config->hash_seeded_func;
+      map->seed = config->seed != 0 ? config->seed : HashRandomSeed();
+      map->key_eq_n_func = config->key_eq_n_func;
+    } else if (config->hash_n_func != NULL) {
+      map->hash_n_func = config->hash_n_func;
+      map->key_eq_n_func = config->key_eq_n_func;
+    }
+  }
+  map->slab = NULL;
+  map->incremental_rehash = config->incremental_rehash;
+  map->old_buckets = NULL;
+  map->old_capacity = 0;
+  map->rehash_index = 0;
+  map->max_load_factor = config->max_load_factor;
+  map->min_load_factor = config->min_load_factor;
+  map->min_capacity = capacity;
+  map->max_capacity = ComputeMapCapacity(config->max_capacity);
+  UpdateMapThresholds(map);
+  if ((map->buckets = _MapBucketsAlloc(capacity)) == NULL) {
     fprintf(stderr, "MapInit: failed to allocate buckets for capacity: %zu\n",
             capacity);
     return;
   }
 
-  pthread_mutexattr_t mutex_attr;
-  pthread_mutexattr_init(&mutex_attr);
-  pthread_mutexattr_settype(&mutex_attr, PTHREAD_MUTEX_RECURSIVE);
-  if (pthread_mutex_init(&map->mutex, &mutex_attr) != 0) {
-    fprintf(stderr, "MapInit: failed to initialize mutex\n");
-    free(map->buckets);
+  if (config->use_slab == TRUE) {
+    if ((map->slab = (MapSlab*)malloc(sizeof(MapSlab))) == NULL) {
+      fprintf(stderr, "MapInit: failed to allocate slab\n");
+      _MapBucketsFree(map->buckets, capacity);
+      map->buckets = NULL;
+      return;
+    }
+    MapSlabInit(map->slab);
+  }
+
+  if (pthread_rwlock_init(&map->lock, NULL) != 0) {
+    fprintf(stderr, "MapInit: failed to initialize lock\n");
+    _MapBucketsFree(map->buckets, capacity);
+    free(map->slab);
+    map->buckets = NULL;
+    map->slab = NULL;
   }
-  pthread_mutexattr_destroy(&mutex_attr);
+}
+
+// Copies the allocation statistics of the slab of `map` into `stats`.
+//
+// Returns:
+//  TRUE on success, or FALSE if `map` was not created with `use_slab`.
+bool_t MapGetSlabStats(Map* const map, MapSlabStats* const stats) {
+  if (map == NULL || stats == NULL || map->slab == NULL) return FALSE;
+
+  pthread_rwlock_rdlock(&map->lock);
+  *stats = map->slab->stats;
+  pthread_rwlock_unlock(&map->lock);
+  return TRUE;
 }
 
 // Re-allocates a `Map` instance with the specified capacity inside the default
@@ -167,19 +482,21 @@ void MapInit(Map* const map, const size_t capacity, hash_f hash_func,
 // Params:
 //  map          - A pointer to the `Map` data structure to be re-allocated.
 //  new_capacity - The new capacity of the `Map`, which is the number of buckets
-//                 to allocate.
+//                 to allocate.  It is rounded up to the next power of two.
 //
 // Remarks:
-//  This function acquires a mutex lock before accessing the map for thread
-//  safety.
+//  This function acquires the write lock of the map for thread safety.
 //    * If `map` is `NULL`, the function returns without doing anything.
 //    * If allocation of `new_buckets` fails, the function returns with an error
 //      message.
 //
 //  The function rehashes all entries in the current map to their new bucket
-//  index in the new map
-//    * If `map->size` is greater than `new_capacity`, `map->size` is set to
-//      `new_capacity`.
+//  index in the new map.  A capacity below the number of entries is allowed;
+//  the chains simply grow longer until the growth policy kicks in.
+//
+//  When the map was created with `incremental_rehash` the entries are only
+//  moved by the operations that follow, `MAP_REHASH_STEP` buckets at a time.
+//  A resize that is still in flight is completed before a new one starts.
 void MapRealloc(Map* const map, const size_t new_capacity) {
   if (map == NULL) return;
   if (new_capacity < MAP_MIN_CAPACITY || new_capacity > MAP_MAX_CAPACITY) {
@@ -188,32 +505,293 @@ void MapRealloc(Map* const map, const size_t new_capacity) {
     return;
   }
 
-  pthread_mutex_lock(&map->mutex);
+  pthread_rwlock_wrlock(&map->lock);
+  _MapReallocLocked(map, ComputeMapCapacity(new_capacity));
+  pthread_rwlock_unlock(&map->lock);
+}
+
+// Grows the bucket array of `map` so that `count` entries fit without going
+// above its maximum load factor, that is without any resize while they are
+// inserted.  Never shrinks the table and never exceeds `max_capacity`.
+//
+// Remarks:
+//  This function acquires the write lock of the map.  A resize that is still
+//  in flight is completed first and the new bucket array is filled at once,
+//  even with `incremental_rehash`, so the inserts that follow do not migrate
+//  anything.
+void MapReserve(Map* const map, const size_t count) {
+  if (map == NULL) return;
+
+  pthread_rwlock_wrlock(&map->lock);
+  _MapReserveLocked(map, count);
+  pthread_rwlock_unlock(&map->lock);
+}
+
+// Grows the bucket array of `map` like `MapReserve()`.  The caller must hold
+// the write lock of `map`.
+//
+// This function is meant to be protected inside `map` and `hashset` modules.
+void _MapReserveLocked(Map* const map, const size_t count) {
+  _MapRehashStep(map, map->old_capacity);
+
+  const double buckets = (double)count / map->max_load_factor;
+  if (buckets <= (double)map->capacity) return;
+
+  size_t capacity = map->max_capacity;
+  if (buckets < (double)map->max_capacity) {
+    capacity = (size_t)buckets;
+    if ((double)capacity < buckets) ++capacity;
+    capacity = ComputeMapCapacity(capacity);
+  }
+  if (capacity <= map->capacity) return;
+
+  _MapReallocLocked(map, capacity);
+  _MapRehashStep(map, map->old_capacity);
+}
+
+// Reserves slab memory for `n` entries whose key and value sizes are given by
+// `key_sizes` and `value_sizes`, so that every class is served from a single
+// allocation while they are inserted.  Does nothing when `map` has no slab.
+// The caller must hold the write lock of `map`.
+//
+// This function is meant to be protected inside `map` module.
+void _MapReserveEntries(Map* const map, const size_t* key_sizes,
+                        const size_t* value_sizes, const size_t n) {
+  if (map->slab == NULL) return;
+
+  // Entries of a bulk load usually fall into one or two classes, so the counts
+  // are gathered per chunk size with a linear search.
+  size_t chunk_sizes[MAP_SLAB_CLASSES];
+  size_t counts[MAP_SLAB_CLASSES];
+  size_t classes = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const size_t size = ComputeMapEntrySize(key_sizes[i], value_sizes[i]);
+    if (MapSlabIsLarge(size) == TRUE) continue;
+
+    const size_t chunk_size = MapSlabChunkSize(size);
+    size_t j = 0;
+    while (j < classes && chunk_sizes[j] != chunk_size) ++j;
+    if (j == classes) {
+      chunk_sizes[classes] = chunk_size;
+      counts[classes++] = 0;
+    }
+    ++counts[j];
+  }
+  for (size_t j = 0; j < classes; ++j) {
+    MapSlabReserve(map->slab, chunk_sizes[j], counts[j]);
+  }
+}
+
+// Swaps in a new bucket array of `capacity` buckets, a power of two, and
+// migrates the entries into it at once or, with `incremental_rehash`, leaves
+// the migration to the following writes.  The caller must hold the write
+// lock of `map`.
+//
+// This function is meant to be protected inside `map` module.
+void _MapReallocLocked(Map* const map, const size_t capacity) {
+  // Only two bucket arrays are ever alive at once.
+  _MapRehashStep(map, map->old_capacity);
 
   MapEntry** new_buckets;
-  if ((new_buckets = (MapEntry**)calloc(new_capacity, sizeof(MapEntry*))) ==
-      NULL) {
-    fprintf(stderr, "MapRealloc: failed to allocate buckets for capacity: %zu",
-            new_capacity);
+  if ((new_buckets = _MapBucketsAlloc(capacity)) == NULL) {
+    fprintf(stderr,
+            "MapRealloc: failed to allocate buckets for capacity: %zu\n",
+            capacity);
     return;
   }
 
-  for (size_t i = 0; i < map->capacity; ++i) {
-    MapEntry* entry = map->buckets[i];
+  map->old_buckets = map->buckets;
+  map->old_capacity = map->capacity;
+  map->rehash_index = 0;
+  map->buckets = new_buckets;
+  map->capacity = capacity;
+  UpdateMapThresholds(map);
+  if (map->incremental_rehash == FALSE) {
+    _MapRehashStep(map, map->old_capacity);
+  }
+}
+
+// Allocates a zeroed array of `capacity` bucket pointers, mapping it lazily
+// when it spans at least `MAP_BUCKETS_MMAP_THRESHOLD` bytes.
+//
+// Returns:
+//  The bucket array which must be released with `_MapBucketsFree()`, or NULL
+//  on failure.
+//
+// This function is meant to be protected inside `map` module.
+MapEntry** _MapBucketsAlloc(const size_t capacity) {
+#if defined(MAP_NORESERVE) && defined(MAP_ANONYMOUS)
+  const size_t size = capacity * sizeof(MapEntry*);
+  if (size >= MAP_BUCKETS_MMAP_THRESHOLD) {
+    // Anonymous mappings are zero-filled and only take up memory for the
+    // pages that are written to.
+    void* buckets = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return buckets == MAP_FAILED ? NULL : (MapEntry**)buckets;
+  }
+#endif
+  return (MapEntry**)calloc(capacity, sizeof(MapEntry*));
+}
+
+// Releases a bucket array of `capacity` buckets allocated by
+// `_MapBucketsAlloc()`.
+//
+// This function is meant to be protected inside `map` module.
+void _MapBucketsFree(MapEntry** const buckets, const size_t capacity) {
+  if (buckets == NULL) return;
+#if defined(MAP_NORESERVE) && defined(MAP_ANONYMOUS)
+  const size_t size = capacity * sizeof(MapEntry*);
+  if (size >= MAP_BUCKETS_MMAP_THRESHOLD) {
+    munmap(buckets, size);
+    return;
+  }
+#endif
+  free(buckets);
+}
+
+// Applies the growth policy of `map` after an insert or a remove: doubles the
+// table once `size` went above `grow_at` and shrinks it back to half of the
+// maximum load factor once `size` went below `shrink_at`.  Does nothing while
+// an incremental resize is in flight, since starting another one would force
+// the current one to complete at once.  The caller must hold the write lock
+// of `map`.
+//
+// This function is meant to be protected inside `map` module.
+void _MapResizeIfNeeded(Map* const map) {
+  if (map->old_buckets != NULL) return;
+
+  if (map->size > map->grow_at) {
+    _MapReallocLocked(map, map->capacity << 1);
+    return;
+  }
+  if (map->size < map->shrink_at && map->capacity > map->min_capacity) {
+    size_t target =
+        (size_t)((double)map->size / (map->max_load_factor / 2)) + 0x01;
+    if (target < map->min_capacity) target = map->min_capacity;
+    target = ComputeMapCapacity(target);
+    if (target < map->capacity) _MapReallocLocked(map, target);
+  }
+}
+
+// Migrates up to `buckets` buckets of an in-flight incremental resize and
+// releases the old bucket array once it is empty.  Does nothing when no resize
+// is in flight.  The caller must hold the write lock of `map`.
+//
+// This function is meant to be protected inside `map`, `hashset`,
+// `lrucache` and `expiringmap` modules.
+void _MapRehashStep(Map* const map, size_t buckets) {
+  if (map->old_buckets == NULL) return;
+
+  for (; buckets > 0 && map->rehash_index < map->old_capacity;
+       --buckets, ++(map->rehash_index)) {
+    MapEntry* entry = map->old_buckets[map->rehash_index];
     while (entry != NULL) {
       MapEntry* next_entry = entry->next;
-      const size_t new_bucket_index = entry->hash % new_capacity;
-      entry->next = new_buckets[new_bucket_index];
-      new_buckets[new_bucket_index] = entry;
+      const size_t new_bucket_index =
+          _MAP_BUCKET_INDEX(entry->hash, map->capacity);
+      entry->next = map->buckets[new_bucket_index];
+      map->buckets[new_bucket_index] = entry;
       entry = next_entry;
     }
+    map->old_buckets[map->rehash_index] = NULL;
   }
-  free(map->buckets);
-  map->buckets = new_buckets;
-  map->capacity = new_capacity;
-  if (map->size > map->capacity) map->size = map->capacity;
 
-  pthread_mutex_unlock(&map->mutex);
+  if (map->rehash_index == map->old_capacity) {
+    _MapBucketsFree(map->old_buckets, map->old_capacity);
+    map->old_buckets = NULL;
+    map->old_capacity = 0;
+    map->rehash_index = 0;
+  }
+}
+
+// Returns the hash `map` uses for the `key_size` bytes of `key`, to be handed
+// to the `*WithHash` operations.
+//
+// Remarks:
+//  The hash can be reused with every map hashing keys the same way, that is
+//  maps created with the same hash function and, for seeded hash functions,
+//  the same `MapConfig::seed`.  Persisted hashes stay valid across reloads
+//  only under that condition; maps drawing a random seed hash differently
+//  every time.
+hash_t MapHashKey(const Map* const map, const void* key,
+                  const size_t key_size) {
+  if (map == NULL || key == NULL) return 0;
+  return _MapHashKey(map, key, key_size);
+}
+
+// Hashes the `key_size` bytes of `key` with the seeded hash function of
+// `map`, its sized one or its unsized one, whichever it was created with.
+//
+// This function is meant to be protected inside `map`, `shardedmap`,
+// `hashset`, `lrucache` and `expiringmap` modules.
+hash_t _MapHashKey(const Map* const map, const void* key,
+                   const size_t key_size) {
+  if (map->hash_seeded_func != NULL) {
+    return map->hash_seeded_func(key, key_size, map->seed);
+  }
+  if (map->hash_n_func != NULL) return map->hash_n_func(key, key_size);
+  return map->hash_func(key);
+}
+
+// Walks the chain starting at `link` for the entry of `key` with hash `hash`
+// and returns the link pointing to it, or NULL.
+static MapEntry** FindMapChainLink(const Map* const map, MapEntry** link,
+                                   const void* key, const size_t key_size,
+                                   const hash_t hash) {
+  if (map->key_eq_n_func != NULL) {
+    for (; *link != NULL; link = &(*link)->next) {
+      if ((*link)->hash == hash &&
+          map->key_eq_n_func((*link)->key, (*link)->key_size, key,
+                             key_size) == TRUE)
+        return link;
+    }
+    return NULL;
+  }
+  for (; *link != NULL; link = &(*link)->next) {
+    if ((*link)->hash == hash && map->key_eq_func((*link)->key, key) == TRUE)
+      return link;
+  }
+  return NULL;
+}
+
+// Returns the link pointing to the entry of `key` with hash `hash`, looking in
+// both bucket arrays during an incremental resize, or NULL if `key` is not
+// present.  Storing `(*link)->next` into `*link` unlinks the entry.  The
+// caller must hold the lock of `map`, for writing if it modifies the chain.
+//
+// This function is meant to be protected inside `map`, `hashset`,
+// `lrucache` and `expiringmap` modules.
+MapEntry** _MapFindLink(Map* const map, const void* key, const size_t key_size,
+                        const hash_t hash) {
+  MapEntry** link = FindMapChainLink(
+      map, &map->buckets[_MAP_BUCKET_INDEX(hash, map->capacity)], key,
+      key_size, hash);
+  if (link != NULL || map->old_buckets == NULL) return link;
+
+  // Buckets below `rehash_index` have been migrated already and are empty.
+  return FindMapChainLink(
+      map, &map->old_buckets[_MAP_BUCKET_INDEX(hash, map->old_capacity)], key,
+      key_size, hash);
+}
+
+// Frees every entry of the bucket array `buckets` of `capacity` buckets that
+// is not released together with the slab of `map`.
+static void FreeMapBuckets(Map* const map, MapEntry** const buckets,
+                           const size_t capacity) {
+  for (size_t i = 0; i < capacity; ++i) {
+    MapEntry* entry = buckets[i];
+    while (entry != NULL) {
+      MapEntry* next_entry = entry->next;
+      const size_t size =
+          ComputeMapEntrySize(entry->key_size, entry->value_capacity);
+      if (map->slab == NULL) {
+        free(entry);
+      } else if (MapSlabIsLarge(size) == TRUE) {
+        MapSlabFree(map->slab, entry, size);
+      }
+      entry = next_entry;
+    }
+  }
 }
 
 // Frees up a `Map` instance and the entries associated with it.
@@ -224,17 +802,23 @@ void MapRealloc(Map* const map, const size_t new_capacity) {
 void MapFree(Map* map) {
   if (map == NULL) return;
 
-  for (size_t i = 0; i < map->capacity; ++i) {
-    MapEntry* entry = map->buckets[i];
-    while (entry != NULL) {
-      MapEntry* next_entry = entry->next;
-      free(entry->key);
-      free(entry->value);
-      free(entry);
-      entry = next_entry;
+  // Entries carved out of the slab go away with its pages, so the buckets only
+  // need to be walked for entries that had to be allocated with `malloc()`.
+  if (map->slab == NULL || map->slab->stats.large_in_use != 0) {
+    FreeMapBuckets(map, map->buckets, map->capacity);
+    if (map->old_buckets != NULL) {
+      FreeMapBuckets(map, map->old_buckets, map->old_capacity);
     }
   }
+  if (map->slab != NULL) {
+    MapSlabRelease(map->slab);
+    free(map->slab);
+    map->slab = NULL;
+  }
 
-  free(map->buckets);
-  pthread_mutex_destroy(&map->mutex);
+  if (map->old_buckets != NULL) {
+    _MapBucketsFree(map->old_buckets, map->old_capacity);
+  }
+  _MapBucketsFree(map->buckets, map->capacity);
+  pthread_rwlock_destroy(&map->lock);
 }
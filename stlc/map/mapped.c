@@ -0,0 +1,390 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "map/mapped.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bool.h"
+#include "map/map.h"
+
+// Suffix of the file `MapSave()` writes before renaming it over the target.
+#define MAP_FILE_TEMP_SUFFIX ".tmp"
+
+// Zero bytes written as padding between the keys, values and entries.
+static const unsigned char kMapFilePadding[MAP_FILE_ALIGNMENT] = {0};
+
+// Takes the read lock of `map` once no incremental resize is in flight, so
+// every entry is found in `buckets` alone.  An in-flight resize is finished
+// under the write lock first.
+static void AcquireMapSaveLock(Map* const map) {
+  for (;;) {
+    pthread_rwlock_rdlock(&map->lock);
+    if (map->old_buckets == NULL) return;
+    pthread_rwlock_unlock(&map->lock);
+
+    pthread_rwlock_wrlock(&map->lock);
+    _MapRehashStep(map, map->old_capacity);
+    pthread_rwlock_unlock(&map->lock);
+  }
+}
+
+// Writes `size` bytes of `data` followed by the zero bytes padding them up to
+// `padded_size`.
+static bool_t WriteMapFileBytes(FILE* const file, const void* const data,
+                                const size_t size, const size_t padded_size) {
+  if (size != 0 && fwrite(data, 0x01, size, file) != size) return FALSE;
+  const size_t padding = padded_size - size;
+  return padding == 0 ||
+                 fwrite(kMapFilePadding, 0x01, padding, file) == padding
+             ? TRUE
+             : FALSE;
+}
+
+// Writes `entry` as a `MapFileEntry` and returns the number of bytes written,
+// or 0 on failure.
+static uint64_t WriteMapFileEntry(FILE* const file,
+                                  const MapEntry* const entry) {
+  const MapFileEntry header = {.hash = (uint64_t)entry->hash,
+                               .key_size = (uint64_t)entry->key_size,
+                               .value_size = (uint64_t)entry->value_size};
+  const uint64_t value_offset = _MAP_FILE_VALUE_OFFSET(entry->key_size);
+  const uint64_t size =
+      _MAP_FILE_ENTRY_SIZE(entry->key_size, entry->value_size);
+  const uint64_t value_padded_size =
+      size - offsetof(MapFileEntry, data) - value_offset;
+
+  if (fwrite(&header, offsetof(MapFileEntry, data), 0x01, file) != 0x01 ||
+      WriteMapFileBytes(file, entry->key, entry->key_size, value_offset) ==
+          FALSE ||
+      WriteMapFileBytes(file, entry->value, entry->value_size,
+                        value_padded_size) == FALSE)
+    return 0;
+  return size;
+}
+
+// Writes the header, the entries and the bucket offsets of `map` to `file`.
+// The caller must hold the read lock of `map`.
+static bool_t WriteMapFile(Map* const map, FILE* const file) {
+  const size_t capacity = map->capacity;
+  uint64_t* const offsets =
+      (uint64_t*)malloc((capacity + 0x01) * sizeof(uint64_t));
+  if (offsets == NULL) {
+    fprintf(stderr, "MapSave: Memory allocation failed\n");
+    return FALSE;
+  }
+
+  // The header is written again once the offsets are known.
+  MapFileHeader header = {.magic = MAP_FILE_MAGIC,
+                          .seed = (uint64_t)map->seed,
+                          .count = (uint64_t)map->size,
+                          .bucket_count = (uint64_t)capacity};
+  bool_t written = WriteMapFileBytes(file, &header, sizeof(header),
+                                     _MAP_FILE_ALIGN(sizeof(header)));
+  uint64_t offset = _MAP_FILE_ALIGN(sizeof(header));
+  for (size_t i = 0; written == TRUE && i < capacity; ++i) {
+    offsets[i] = offset;
+    for (const MapEntry* entry = map->buckets[i]; entry != NULL;
+         entry = entry->next) {
+      const uint64_t size = WriteMapFileEntry(file, entry);
+      if (size == 0) {
+        written = FALSE;
+        break;
+      }
+      offset += size;
+    }
+  }
+  offsets[capacity] = offset;
+
+  header.buckets_offset = offset;
+  header.size = offset + (capacity + 0x01) * sizeof(uint64_t);
+  if (written == TRUE) {
+    written = fwrite(offsets, sizeof(uint64_t), capacity + 0x01, file) ==
+                      capacity + 0x01 &&
+                      fseek(file, 0, SEEK_SET) == 0 &&
+                      fwrite(&header, sizeof(header), 0x01, file) == 0x01
+                  ? TRUE
+                  : FALSE;
+  }
+  free(offsets);
+  return written;
+}
+
+// Writes every entry of `map` to the file at `path` in a position-independent
+// layout that `MapOpenMapped()` maps back without parsing.  The entries of a
+// bucket are stored next to each other, so a lookup touches the bucket offsets
+// and a single run of entries.
+//
+// Returns:
+//  TRUE once the file is complete, FALSE if it could not be written.
+//
+// Remarks:
+//  The file is written next to `path` and renamed over it once complete, so
+//  a reader never maps a partial file.  An in-flight incremental resize is
+//  finished first, and the entries are then written under the read lock of
+//  `map`, so lookups can go on while it is saved.
+bool_t MapSave(Map* const map, const char* const path) {
+  if (map == NULL || path == NULL) return FALSE;
+  if (map->buckets == NULL) {
+    fprintf(stderr, "MapSave: Map is not initialized\n");
+    return FALSE;
+  }
+
+  const size_t path_length = strlen(path);
+  char* const temp_path =
+      (char*)malloc(path_length + sizeof(MAP_FILE_TEMP_SUFFIX));
+  if (temp_path == NULL) {
+    fprintf(stderr, "MapSave: Memory allocation failed\n");
+    return FALSE;
+  }
+  memcpy(temp_path, path, path_length);
+  memcpy(temp_path + path_length, MAP_FILE_TEMP_SUFFIX,
+         sizeof(MAP_FILE_TEMP_SUFFIX));
+
+  FILE* const file = fopen(temp_path, "wb");
+  if (file == NULL) {
+    fprintf(stderr, "MapSave: Cannot open '%s' for writing\n", temp_path);
+    free(temp_path);
+    return FALSE;
+  }
+
+  AcquireMapSaveLock(map);
+  bool_t saved = WriteMapFile(map, file);
+  pthread_rwlock_unlock(&map->lock);
+
+  if (saved == TRUE && (fflush(file) != 0 || fsync(fileno(file)) != 0))
+    saved = FALSE;
+  if (fclose(file) != 0) saved = FALSE;
+  if (saved == TRUE && rename(temp_path, path) != 0) saved = FALSE;
+  if (saved == FALSE) {
+    fprintf(stderr, "MapSave: Cannot write '%s'\n", path);
+    remove(temp_path);
+  }
+  free(temp_path);
+  return saved;
+}
+
+// Maps the file at `path` into `mapped` and validates its header.  The
+// callbacks of `mapped` are left to the caller.
+static bool_t MapMappedFile(MappedMap* const mapped, const char* const path) {
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "MapOpenMapped: Cannot open '%s'\n", path);
+    return FALSE;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(MapFileHeader)) {
+    fprintf(stderr, "MapOpenMapped: '%s' is not a map file\n", path);
+    close(fd);
+    return FALSE;
+  }
+
+  // No `MAP_POPULATE`: the pages are read from the page cache on first
+  // access, so opening does not depend on the size of the file.
+  const size_t size = (size_t)st.st_size;
+  void* const data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    fprintf(stderr, "MapOpenMapped: Cannot map '%s'\n", path);
+    return FALSE;
+  }
+
+  const MapFileHeader* const header = (const MapFileHeader*)data;
+  const uint64_t bucket_count = header->bucket_count;
+  if (header->magic != MAP_FILE_MAGIC || header->size != size ||
+      bucket_count == 0 || (bucket_count & (bucket_count - 0x01)) != 0 ||
+      bucket_count >= size / sizeof(uint64_t) ||
+      header->buckets_offset % sizeof(uint64_t) != 0 ||
+      header->buckets_offset < sizeof(MapFileHeader) ||
+      header->buckets_offset + (bucket_count + 0x01) * sizeof(uint64_t) !=
+          size) {
+    fprintf(stderr, "MapOpenMapped: '%s' is not a map file\n", path);
+    munmap(data, size);
+    return FALSE;
+  }
+
+#ifdef MADV_RANDOM
+  // Lookups jump around the file, so reading ahead only wastes page cache.
+  madvise(data, size, MADV_RANDOM);
+#endif
+
+  mapped->data = (const unsigned char*)data;
+  mapped->size = size;
+  mapped->header = header;
+  mapped->buckets =
+      (const uint64_t*)(mapped->data + header->buckets_offset);
+  return TRUE;
+}
+
+// Maps the file at `path` written by `MapSave()` read-only into `mapped`.
+// `hash_func` and `key_eq_func` must be the functions the saved map was
+// initialized with by `MapInit()`.
+//
+// Returns:
+//  TRUE if `mapped` is ready for lookups, FALSE if the file could not be
+//  mapped or is not a map file.
+//
+// Remarks:
+//  Only the header is validated, so opening takes the same time regardless of
+//  the size of the file.  The pages are read lazily on first access.
+bool_t MapOpenMapped(MappedMap* const mapped, const char* const path,
+                     hash_f hash_func, key_eq_f key_eq_func) {
+  if (mapped == NULL || path == NULL) return FALSE;
+  if (hash_func == NULL || key_eq_func == NULL) {
+    fprintf(stderr, "MapOpenMapped: Hash and key comparison required\n");
+    return FALSE;
+  }
+
+  memset(mapped, 0, sizeof(*mapped));
+  if (MapMappedFile(mapped, path) == FALSE) return FALSE;
+  mapped->hash_func = hash_func;
+  mapped->key_eq_func = key_eq_func;
+  mapped->seed = (hash_t)mapped->header->seed;
+  return TRUE;
+}
+
+// Maps the file at `path` like `MapOpenMapped()`, taking the hash and key
+// comparison functions from `config`.  The seed is taken from the file, so a
+// map hashed with a random seed is looked up with the same one.
+bool_t MapOpenMappedWithConfig(MappedMap* const mapped, const char* const path,
+                               const MapConfig* const config) {
+  if (mapped == NULL || path == NULL || config == NULL) return FALSE;
+  if ((config->hash_func == NULL && config->hash_n_func == NULL &&
+       config->hash_seeded_func == NULL) ||
+      (config->key_eq_func == NULL && config->key_eq_n_func == NULL)) {
+    fprintf(stderr,
+            "MapOpenMappedWithConfig: Hash and key comparison required\n");
+    return FALSE;
+  }
+
+  memset(mapped, 0, sizeof(*mapped));
+  if (MapMappedFile(mapped, path) == FALSE) return FALSE;
+  mapped->hash_func = config->hash_func;
+  mapped->key_eq_func = config->key_eq_func;
+  mapped->hash_n_func = config->hash_n_func;
+  mapped->key_eq_n_func = config->key_eq_n_func;
+  mapped->hash_seeded_func = config->hash_seeded_func;
+  mapped->seed = (hash_t)mapped->header->seed;
+  return TRUE;
+}
+
+// Returns the number of entries of `mapped`.
+size_t MappedMapSize(const MappedMap* const mapped) {
+  if (mapped == NULL || mapped->header == NULL) return 0;
+  return (size_t)mapped->header->count;
+}
+
+// Hashes the `key_size` bytes of `key` with the callbacks of `mapped` like
+// `_MapHashKey()` does for a `Map`.
+static hash_t HashMappedMapKey(const MappedMap* const mapped, const void* key,
+                               const size_t key_size) {
+  if (mapped->hash_seeded_func != NULL) {
+    return mapped->hash_seeded_func(key, key_size, mapped->seed);
+  }
+  if (mapped->hash_n_func != NULL) return mapped->hash_n_func(key, key_size);
+  return mapped->hash_func(key);
+}
+
+// Looks up `key` like `MapGet()`.
+//
+// Returns:
+//  A pointer to the value inside the mapped file, valid until
+//  `MappedMapClose()`, or NULL if `key` is not present.
+const void* MappedMapGet(const MappedMap* const mapped, const void* key) {
+  if (mapped == NULL || key == NULL) return NULL;
+  return MappedMapGetN(
+      mapped, key,
+      mapped->key_eq_n_func != NULL ? strlen((const char*)key) : 0, NULL);
+}
+
+// Looks up the `key_size` bytes of `key` like `MapGetN()`.  `value_size`, if
+// not NULL, receives the size of the value found.
+const void* MappedMapGetN(const MappedMap* const mapped, const void* key,
+                          const size_t key_size, size_t* const value_size) {
+  if (mapped == NULL || mapped->data == NULL || key == NULL) return NULL;
+
+  const hash_t hash = HashMappedMapKey(mapped, key, key_size);
+  const size_t index =
+      _MAP_BUCKET_INDEX(hash, (size_t)mapped->header->bucket_count);
+  uint64_t offset = mapped->buckets[index];
+  const uint64_t end = mapped->buckets[index + 0x01];
+  if (end > mapped->header->buckets_offset) return NULL;
+
+  while (offset < end) {
+    const MapFileEntry* const entry =
+        (const MapFileEntry*)(mapped->data + offset);
+    offset += _MAP_FILE_ENTRY_SIZE(entry->key_size, entry->value_size);
+    if (entry->hash != (uint64_t)hash) continue;
+    const bool_t equal =
+        mapped->key_eq_n_func != NULL
+            ? mapped->key_eq_n_func(entry->data, (size_t)entry->key_size, key,
+                                    key_size)
+            : mapped->key_eq_func(entry->data, key);
+    if (equal == TRUE) {
+      if (value_size != NULL) *value_size = (size_t)entry->value_size;
+      return entry->data + _MAP_FILE_VALUE_OFFSET(entry->key_size);
+    }
+  }
+  return NULL;
+}
+
+// Calls `predicate` on every entry of `mapped` in file order until it returns
+// FALSE.
+void MappedMapTraverse(const MappedMap* const mapped,
+                       bool_t (*predicate)(const void* key,
+                                           const void* value)) {
+  if (mapped == NULL || mapped->data == NULL || predicate == NULL) return;
+
+  uint64_t offset = _MAP_FILE_ALIGN(sizeof(MapFileHeader));
+  while (offset < mapped->header->buckets_offset) {
+    const MapFileEntry* const entry =
+        (const MapFileEntry*)(mapped->data + offset);
+    offset += _MAP_FILE_ENTRY_SIZE(entry->key_size, entry->value_size);
+    if (predicate(entry->data,
+                  entry->data + _MAP_FILE_VALUE_OFFSET(entry->key_size)) ==
+        FALSE)
+      return;
+  }
+}
+
+// Unmaps the file of `mapped`.  The pointers returned by the lookups become
+// invalid.
+void MappedMapClose(MappedMap* const mapped) {
+  if (mapped == NULL || mapped->data == NULL) return;
+  munmap((void*)mapped->data, mapped->size);
+  memset(mapped, 0, sizeof(*mapped));
+}
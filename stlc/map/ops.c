@@ -30,6 +30,7 @@
 #include "map/ops.h"
 
 #include <assert.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -37,7 +38,88 @@
 #include "bool.h"
 #include "map/map.h"
 
-// Insert a new key-value pair into the map.
+// Returns the link pointing to the entry of `key` with the precomputed
+// `hash`, adding a new entry holding `value_size` bytes of `value` at the head
+// of its bucket when the key is not present.  `value` may be NULL to leave the
+// new value uninitialized.  The growth policy is left to the caller, which
+// must apply it once it is done with the link.  The caller must hold the write
+// lock of `map`.
+//
+// Returns:
+//  The link, or NULL on allocation failure.  `*inserted` tells whether the
+//  entry is new.
+static MapEntry **FindOrAddMapEntryLocked(Map *const map, const void *key,
+                                          const size_t key_size,
+                                          const hash_t hash,
+                                          const void *const value,
+                                          const size_t value_size,
+                                          bool_t *const inserted) {
+  *inserted = FALSE;
+  MapEntry **link = _MapFindLink(map, key, key_size, hash);
+  if (link != NULL) return link;
+
+  const size_t bucket_index = _MAP_BUCKET_INDEX(hash, map->capacity);
+  MapEntry *new_entry = _MapEntryAlloc(map, key, key_size, value, value_size,
+                                       hash, map->buckets[bucket_index]);
+  if (new_entry == NULL) return NULL;
+  map->buckets[bucket_index] = new_entry;
+  ++(map->size);
+  *inserted = TRUE;
+  return &map->buckets[bucket_index];
+}
+
+// Makes the entry `*link` hold `value_size` bytes, growing the entry block and
+// relinking it when they do not fit in the bytes reserved for the value.  The
+// value bytes are unspecified if the entry had to grow.  `func` names the
+// public function in allocation failure messages.
+//
+// Returns:
+//  The entry, or NULL on allocation failure in which case it is left as is.
+static MapEntry *ResizeMapEntryValue(const char *const func, Map *const map,
+                                     MapEntry **const link,
+                                     const size_t value_size) {
+  MapEntry *entry = *link;
+  if (value_size > entry->value_capacity) {
+    if ((entry = _MapEntryGrow(map, entry, value_size)) == NULL) {
+      fprintf(stderr, "%s: failed to allocate value for value_size: %zu\n",
+              func, value_size);
+      return NULL;
+    }
+    *link = entry;
+  }
+  entry->value_size = value_size;
+  return entry;
+}
+
+// Inserts or overwrites the entry of `key` with the precomputed `hash` and
+// applies the growth policy on behalf of the public function `func`.  The
+// caller must hold the write lock of `map`.
+//
+// Returns:
+//  TRUE if a new entry was added.
+static bool_t InsertMapEntryLocked(const char *const func, Map *const map,
+                                   const void *const key,
+                                   const size_t key_size, const hash_t hash,
+                                   const void *const value,
+                                   const size_t value_size) {
+  bool_t inserted;
+  MapEntry **link = FindOrAddMapEntryLocked(map, key, key_size, hash, value,
+                                            value_size, &inserted);
+  if (link == NULL) return FALSE;
+  if (inserted == TRUE) {
+    _MapResizeIfNeeded(map);
+    return TRUE;
+  }
+
+  // Overwrite in place when the new value fits in the bytes reserved for the
+  // old one; otherwise grow the entry block and relink it.
+  MapEntry *entry = ResizeMapEntryValue(func, map, link, value_size);
+  if (entry != NULL) memcpy(entry->value, value, value_size);
+  return FALSE;
+}
+
+// Insert a new key-value pair into the map, hashing and comparing exactly
+// `key_size` bytes of the key with the sized callbacks of the map.
 //
 // Args:
 //  map        - A pointer to the map to insert the key-value pair into.
@@ -50,49 +132,49 @@
 //  If the map, key, or value pointers are NULL, this function will immediately
 //  return without doing anything. The key and value pointers must point to
 //  valid memory of the specified sizes. If a key already exists in the map, its
-//  value will be replaced with the new value.
+//  value will be replaced with the new value; the new value is copied over the
+//  old one without allocating when it is not larger than the first value
+//  stored for the key.
 //
 // Thread Safety:
-//  This function locks the mutex associated with the map while it is performing
-//  its operations to ensure thread safety.
-void MapInsert(Map *const map, const void *const key, const size_t key_size,
-               const void *const value, const size_t value_size) {
+//  This function holds the write lock of the map while it is performing its
+//  operations to ensure thread safety.  During an incremental resize it also
+//  migrates `MAP_REHASH_STEP` buckets.
+void MapInsertN(Map *const map, const void *const key, const size_t key_size,
+                const void *const value, const size_t value_size) {
   if (map == NULL || key == NULL || value == NULL) return;
-  if (map->size >= map->capacity) {
-    MapRealloc(map, ((map->size >> 0x03) + (map->size < 0x09 ? 0x03 : 0x06)) +
-                        map->size);
-  }
-
-  const hash_t hash = map->hash_func(key);
-  const size_t bucket_index = hash % map->capacity;
-  pthread_mutex_lock(&(map->mutex));
 
-  MapEntry *entry = map->buckets[bucket_index];
-  while (entry != NULL) {
-    if (entry->hash == hash && map->key_eq_func(entry->key, key) == TRUE) {
-      free(entry->value);
-      entry->value = (void *)malloc(value_size);
-      memcpy(entry->value, value, value_size);
-      pthread_mutex_unlock(&(map->mutex));
-      return;
-    }
-    entry = entry->next;
-  }
-
-  MapEntry *new_entry = (MapEntry *)malloc(sizeof(MapEntry));
-  MapEntryInit(new_entry, key, key_size, value, value_size, hash,
-               map->buckets[bucket_index]);
-  map->buckets[bucket_index] = new_entry;
-  ++(map->size);
+  _MapInsertHashed(map, key, key_size, _MapHashKey(map, key, key_size), value,
+                   value_size);
+}
 
-  pthread_mutex_unlock(&(map->mutex));
+// Inserts like `MapInsertN()` with the precomputed `hash` of the key.
+//
+// Returns:
+//  TRUE if a new entry was added, FALSE if the value of an existing entry was
+//  overwritten or the insert failed.
+//
+// This function is meant to be protected inside `map`, `shardedmap` and
+// `smallmap` modules.
+bool_t _MapInsertHashed(Map *const map, const void *const key,
+                        const size_t key_size, const hash_t hash,
+                        const void *const value, const size_t value_size) {
+  pthread_rwlock_wrlock(&(map->lock));
+  _MapRehashStep(map, MAP_REHASH_STEP);
+  const bool_t inserted =
+      InsertMapEntryLocked("MapInsertN", map, key, key_size, hash, value,
+                           value_size);
+  pthread_rwlock_unlock(&(map->lock));
+  return inserted;
 }
 
-// Retrieve the value associated with the given key in the map.
+// Retrieve the value associated with the `key_size` bytes of `key` in the
+// map.
 //
 // Params:
-//  map - A pointer to the map.
-//  key - A pointer to the key.
+//  map      - A pointer to the map.
+//  key      - A pointer to the key.
+//  key_size - The size of the key in bytes.
 //
 // Returns:
 //  A pointer to the value associated with the key, or NULL if the key is not
@@ -104,24 +186,34 @@ void MapInsert(Map *const map, const void *const key, const size_t key_size,
 //  initialize the map. Also note that this function does not check if the map
 //  or key pointers are NULL, as passing NULL to these parameters is considered
 //  undefined behavior.
-void *MapGet(Map *const map, const void *key) {
+//
+// Thread Safety:
+//  This function only holds the read lock of the map, so lookups from any
+//  number of threads run in parallel and only wait for writers.  Lookups never
+//  migrate entries; during an incremental resize they look the key up in both
+//  bucket arrays.
+void *MapGetN(Map *const map, const void *key, const size_t key_size) {
   if (map == NULL || key == NULL) return NULL;
 
-  hash_t hash = map->hash_func(key);
-  size_t bucket_index = hash % map->capacity;
+  return _MapGetHashed(map, key, key_size, _MapHashKey(map, key, key_size));
+}
+
+// Looks a key up like `MapGetN()` with the precomputed `hash` of the key.
+//
+// This function is meant to be protected inside `map`, `shardedmap`,
+// `hashset` and `smallmap` modules.
+void *_MapGetHashed(Map *const map, const void *key, const size_t key_size,
+                    const hash_t hash) {
+  pthread_rwlock_rdlock(&(map->lock));
 
-  MapEntry *entry = map->buckets[bucket_index];
-  while (entry != NULL) {
-    if (hash == entry->hash && map->key_eq_func(entry->key, key) == TRUE) {
-      return entry->value;
-    }
-    entry = entry->value;
-  }
+  MapEntry **link = _MapFindLink(map, key, key_size, hash);
+  void *value = link != NULL ? (*link)->value : NULL;
 
-  return NULL;
+  pthread_rwlock_unlock(&(map->lock));
+  return value;
 }
 
-// Remove an entry from the map with the given key.
+// Remove an entry from the map with the given `key_size` bytes of key.
 //
 // Params:
 //  map      - The map from which to remove the entry.
@@ -131,32 +223,514 @@ void *MapGet(Map *const map, const void *key) {
 // Effects:
 //  * Removes an entry from the map with the given key, if it exists.
 //  * Frees the memory used by the removed entry.
-void MapRemove(Map *const map, const void *key, const size_t key_size) {
-  if (map == NULL || key == NULL || MapGet(map, key) == NULL) return;
-
-  const hash_t hash = map->hash_func(key);
-  const size_t bucket_index = hash % map->capacity;
-
-  pthread_mutex_lock(&(map->mutex));
-
-  MapEntry *entry = map->buckets[bucket_index];
-  MapEntry *prev_entry = NULL;
-  while (entry != NULL) {
-    if (entry->hash == hash && map->key_eq_func(entry->key, key) == TRUE) {
-      if (prev_entry == NULL) {
-        map->buckets[bucket_index] = entry->next;
-      } else {
-        prev_entry->next = entry->next;
-      }
-      free(entry->key);
-      free(entry->value);
-      free(entry);
-      --(map->size);
-      break;
+//  * Shrinks the bucket array once the map fell below its minimum load
+//    factor.
+//
+// Thread Safety:
+//  This function holds the write lock of the map.  During an incremental
+//  resize it also migrates `MAP_REHASH_STEP` buckets.
+void MapRemoveN(Map *const map, const void *key, const size_t key_size) {
+  if (map == NULL || key == NULL) return;
+
+  _MapRemoveHashed(map, key, key_size, _MapHashKey(map, key, key_size));
+}
+
+// Removes a key like `MapRemoveN()` with the precomputed `hash` of the key.
+//
+// Returns:
+//  TRUE if an entry was removed, FALSE if the key was not present.
+//
+// This function is meant to be protected inside `map`, `shardedmap`,
+// `hashset` and `smallmap` modules.
+bool_t _MapRemoveHashed(Map *const map, const void *key, const size_t key_size,
+                        const hash_t hash) {
+  pthread_rwlock_wrlock(&(map->lock));
+  _MapRehashStep(map, MAP_REHASH_STEP);
+
+  MapEntry **link = _MapFindLink(map, key, key_size, hash);
+  if (link != NULL) {
+    MapEntry *entry = *link;
+    *link = entry->next;
+    _MapEntryRelease(map, entry);
+    --(map->size);
+    _MapResizeIfNeeded(map);
+  }
+
+  pthread_rwlock_unlock(&(map->lock));
+  return link != NULL ? TRUE : FALSE;
+}
+
+// Adds `key` with the precomputed `hash` and a value of zero bytes unless it
+// is already present, then applies the growth policy.  The caller must hold
+// the write lock of `map`.
+//
+// Returns:
+//  TRUE if a new entry was added, FALSE if the key was already present or the
+//  entry could not be allocated.
+//
+// This function is meant to be protected inside `map` and `hashset` modules.
+bool_t _MapAddKeyLocked(Map *const map, const void *const key,
+                        const size_t key_size, const hash_t hash) {
+  return _MapAddEntryLocked(map, key, key_size, hash, 0) != NULL ? TRUE
+                                                                 : FALSE;
+}
+
+// Adds `key` with the precomputed `hash` and `value_size` uninitialized value
+// bytes unless it is already present, then applies the growth policy.  The
+// caller must hold the write lock of `map`.  Entries never move when the
+// bucket array is resized, so the entry stays valid until it is removed.
+//
+// Returns:
+//  The new entry, or NULL if the key was already present or the entry could
+//  not be allocated.
+//
+// This function is meant to be protected inside `map`, `lrucache` and
+// `expiringmap` modules.
+MapEntry *_MapAddEntryLocked(Map *const map, const void *const key,
+                             const size_t key_size, const hash_t hash,
+                             const size_t value_size) {
+  bool_t inserted;
+  MapEntry **link = FindOrAddMapEntryLocked(map, key, key_size, hash, NULL,
+                                            value_size, &inserted);
+  if (link == NULL || inserted == FALSE) return NULL;
+  MapEntry *const entry = *link;
+  _MapResizeIfNeeded(map);
+  return entry;
+}
+
+// Returns the link pointing to `entry` in the chain starting at `link`, or
+// NULL if the chain does not hold it.
+static MapEntry **FindMapEntryLinkByAddress(MapEntry **link,
+                                            const MapEntry *const entry) {
+  for (; *link != NULL; link = &(*link)->next) {
+    if (*link == entry) return link;
+  }
+  return NULL;
+}
+
+// Unlinks `entry` from the buckets of `map` by address, without comparing any
+// key, releases it and applies the growth policy.  The caller must hold the
+// write lock of `map`.
+//
+// Returns:
+//  TRUE if `entry` was found and removed.
+//
+// This function is meant to be protected inside `map`, `lrucache` and
+// `expiringmap` modules.
+bool_t _MapRemoveEntryLocked(Map *const map, MapEntry *const entry) {
+  MapEntry **link = FindMapEntryLinkByAddress(
+      &map->buckets[_MAP_BUCKET_INDEX(entry->hash, map->capacity)], entry);
+  if (link == NULL && map->old_buckets != NULL) {
+    link = FindMapEntryLinkByAddress(
+        &map->old_buckets[_MAP_BUCKET_INDEX(entry->hash, map->old_capacity)],
+        entry);
+  }
+  if (link == NULL) return FALSE;
+
+  *link = entry->next;
+  _MapEntryRelease(map, entry);
+  --(map->size);
+  _MapResizeIfNeeded(map);
+  return TRUE;
+}
+
+// Links `entry`, allocated with `MapEntryNew()` for a key absent from `map`
+// and hashed the way `map` hashes it, into the buckets of `map` without
+// copying it and applies the growth policy.  `map` takes the entry over, so it
+// must not have a slab.  The caller must hold the write lock of `map`.
+//
+// This function is meant to be protected inside `map` and `smallmap` modules.
+void _MapLinkEntryLocked(Map *const map, MapEntry *const entry) {
+  const size_t bucket_index = _MAP_BUCKET_INDEX(entry->hash, map->capacity);
+  entry->next = map->buckets[bucket_index];
+  map->buckets[bucket_index] = entry;
+  ++(map->size);
+  _MapResizeIfNeeded(map);
+}
+
+// Looks the `n <= MAP_BATCH_WIDTH` keys of one batch up into `out_values`.
+// All keys are hashed before the read lock is taken, then their buckets and
+// chain heads are prefetched in two passes so that the misses of the whole
+// batch overlap before the chains are walked.
+static void GetMapBatch(Map *const map, const void *const *keys,
+                        const size_t *key_sizes, const size_t n,
+                        void **const out_values) {
+  size_t sizes[MAP_BATCH_WIDTH];
+  hash_t hashes[MAP_BATCH_WIDTH];
+  MapEntry **heads[MAP_BATCH_WIDTH];
+
+  for (size_t i = 0; i < n; ++i) {
+    if (key_sizes != NULL) {
+      sizes[i] = key_sizes[i];
+    } else {
+      sizes[i] =
+          map->key_eq_n_func != NULL ? strlen((const char *)keys[i]) : 0;
+    }
+    hashes[i] = _MapHashKey(map, keys[i], sizes[i]);
+  }
+
+  pthread_rwlock_rdlock(&(map->lock));
+
+  for (size_t i = 0; i < n; ++i) {
+    heads[i] = &map->buckets[_MAP_BUCKET_INDEX(hashes[i], map->capacity)];
+    __builtin_prefetch(heads[i], 0, 1);
+    if (map->old_buckets != NULL) {
+      __builtin_prefetch(
+          &map->old_buckets[_MAP_BUCKET_INDEX(hashes[i], map->old_capacity)],
+          0, 1);
+    }
+  }
+  for (size_t i = 0; i < n; ++i) {
+    if (*heads[i] != NULL) __builtin_prefetch(*heads[i], 0, 1);
+  }
+  for (size_t i = 0; i < n; ++i) {
+    MapEntry **link = _MapFindLink(map, keys[i], sizes[i], hashes[i]);
+    out_values[i] = link != NULL ? (*link)->value : NULL;
+  }
+
+  pthread_rwlock_unlock(&(map->lock));
+}
+
+// Retrieves the values of `n` keys at once, overlapping the cache misses of
+// their lookups.
+//
+// Params:
+//  map        - A pointer to the map.
+//  keys       - An array of `n` pointers to the keys to look up.
+//  key_sizes  - An array of the `n` key sizes in bytes, or NULL to look every
+//               key up the way `MapGet()` does.
+//  n          - The number of keys.
+//  out_values - An array of `n` pointers receiving the value of every key, or
+//               NULL for the keys that are not found.
+//
+// Remarks:
+//  The keys are processed in batches of `MAP_BATCH_WIDTH`: every key of a
+//  batch is hashed and its bucket prefetched, then the chain heads are
+//  prefetched, and only then are the chains walked.  A lookup of a cold table
+//  thus waits for one round of memory latency per batch instead of one per
+//  key.
+//
+// Thread Safety:
+//  The read lock of the map is held for one batch at a time, so writers are
+//  only held off for `MAP_BATCH_WIDTH` lookups.  Keys of different batches may
+//  therefore see different versions of the map.
+void MapGetMany(Map *const map, const void *const *keys,
+                const size_t *key_sizes, const size_t n,
+                void **const out_values) {
+  if (map == NULL || keys == NULL || out_values == NULL) return;
+
+  for (size_t i = 0; i < n; i += MAP_BATCH_WIDTH) {
+    const size_t batch = n - i < MAP_BATCH_WIDTH ? n - i : MAP_BATCH_WIDTH;
+    GetMapBatch(map, keys + i, key_sizes != NULL ? key_sizes + i : NULL,
+                batch, out_values + i);
+  }
+}
+
+// Tests the presence of `n` keys at once like `MapGetMany()`.
+//
+// Params:
+//  map       - A pointer to the map.
+//  keys      - An array of `n` pointers to the keys to look up.
+//  key_sizes - An array of the `n` key sizes in bytes, or NULL to look every
+//              key up the way `MapGet()` does.
+//  n         - The number of keys.
+//  out_found - An array of `n` flags set to TRUE for the keys present in the
+//              map, or NULL if only the count is of interest.
+//
+// Returns:
+//  The number of keys present in the map.
+size_t MapContainsMany(Map *const map, const void *const *keys,
+                       const size_t *key_sizes, const size_t n,
+                       bool_t *const out_found) {
+  if (map == NULL || keys == NULL) return 0;
+
+  size_t found = 0;
+  void *values[MAP_BATCH_WIDTH];
+  for (size_t i = 0; i < n; i += MAP_BATCH_WIDTH) {
+    const size_t batch = n - i < MAP_BATCH_WIDTH ? n - i : MAP_BATCH_WIDTH;
+    GetMapBatch(map, keys + i, key_sizes != NULL ? key_sizes + i : NULL,
+                batch, values);
+    for (size_t j = 0; j < batch; ++j) {
+      const bool_t present = values[j] != NULL ? TRUE : FALSE;
+      if (out_found != NULL) out_found[i + j] = present;
+      found += present;
     }
-    prev_entry = entry;
-    entry = entry->next;
   }
+  return found;
+}
+
+// Inserts `n` key-value pairs at once, overwriting the values of the keys
+// that are already present like `MapInsertN()`.
+//
+// Params:
+//  map         - A pointer to the map to insert the key-value pairs into.
+//  keys        - An array of `n` pointers to the keys to insert.
+//  key_sizes   - An array of the `n` key sizes in bytes.
+//  values      - An array of `n` pointers to the values to insert.
+//  value_sizes - An array of the `n` value sizes in bytes.
+//  n           - The number of key-value pairs.
+//
+// Returns:
+//  The number of new entries added to the map.
+//
+// Remarks:
+//  The bucket array is grown once, as by `MapReserve()`, for `n` more entries
+//  so the load never triggers an intermediate resize; keys already present
+//  make it slightly larger than needed.  On a map created with `use_slab` the
+//  entries of every size class are carved out of a single allocation.  The
+//  buckets of every `MAP_BATCH_WIDTH` keys are prefetched before they are
+//  inserted.  Pairs with a NULL key or value are skipped.
+//
+// Thread Safety:
+//  This function holds the write lock of the map once for the whole call.
+size_t MapInsertMany(Map *const map, const void *const *keys,
+                     const size_t *key_sizes, const void *const *values,
+                     const size_t *value_sizes, const size_t n) {
+  if (map == NULL || keys == NULL || key_sizes == NULL || values == NULL ||
+      value_sizes == NULL)
+    return 0;
+
+  size_t inserted = 0;
+  // Key `i` is hashed and its bucket prefetched `MAP_BATCH_WIDTH` keys before
+  // it is inserted, and its chain head halfway in between, so that both
+  // misses of a key overlap with the inserts of the keys before it.
+  const size_t head_distance = MAP_BATCH_WIDTH / 2;
+  hash_t hashes[MAP_BATCH_WIDTH];
+  pthread_rwlock_wrlock(&(map->lock));
+  _MapReserveLocked(map, map->size + n);
+  _MapReserveEntries(map, key_sizes, value_sizes, n);
+
+  for (size_t i = 0; i < n + MAP_BATCH_WIDTH; ++i) {
+    // The slot of the key being inserted is reused by key `i` right after.
+    const size_t key = i - MAP_BATCH_WIDTH;
+    if (i >= MAP_BATCH_WIDTH && keys[key] != NULL && values[key] != NULL) {
+      inserted += InsertMapEntryLocked(
+          "MapInsertMany", map, keys[key], key_sizes[key],
+          hashes[key % MAP_BATCH_WIDTH], values[key], value_sizes[key]);
+    }
+
+    const size_t ahead = i - head_distance;
+    if (i >= head_distance && ahead < n && keys[ahead] != NULL) {
+      const MapEntry *head = map->buckets[_MAP_BUCKET_INDEX(
+          hashes[ahead % MAP_BATCH_WIDTH], map->capacity)];
+      if (head != NULL) __builtin_prefetch(head, 0, 1);
+    }
+
+    if (i < n && keys[i] != NULL) {
+      hashes[i % MAP_BATCH_WIDTH] = _MapHashKey(map, keys[i], key_sizes[i]);
+      __builtin_prefetch(&map->buckets[_MAP_BUCKET_INDEX(
+                             hashes[i % MAP_BATCH_WIDTH], map->capacity)],
+                         1, 1);
+    }
+  }
+
+  pthread_rwlock_unlock(&(map->lock));
+  return inserted;
+}
 
-  pthread_mutex_unlock(&(map->mutex));
+// Returns the value of `key`, inserting a copy of the `value_size` bytes of
+// `value` for it first if the key is not present.  The key is hashed and its
+// chain walked only once.
+//
+// Params:
+//  map        - A pointer to the map.
+//  key        - A pointer to the key.
+//  key_size   - The size of the key in bytes.
+//  value      - A pointer to the value to insert if the key is not present.
+//  value_size - The size of the value in bytes.
+//  inserted   - Set to TRUE if the value was inserted, FALSE if the key was
+//               already present; may be NULL.
+//
+// Returns:
+//  A pointer to the value stored in the map, which may be written through in
+//  place, or NULL on failure.  It stays valid until the entry is removed or
+//  overwritten with a larger value.
+//
+// Thread Safety:
+//  This function holds the write lock of the map while it looks the key up.
+//  Accesses through the returned pointer happen outside of it and must be
+//  synchronized by the caller if other threads use the same key.
+void *MapGetOrInsert(Map *const map, const void *const key,
+                     const size_t key_size, const void *const value,
+                     const size_t value_size, bool_t *const inserted) {
+  if (map == NULL || key == NULL || value == NULL) return NULL;
+
+  const hash_t hash = _MapHashKey(map, key, key_size);
+  bool_t added = FALSE;
+  pthread_rwlock_wrlock(&(map->lock));
+  _MapRehashStep(map, MAP_REHASH_STEP);
+
+  MapEntry **link = FindOrAddMapEntryLocked(map, key, key_size, hash, value,
+                                            value_size, &added);
+  // Entries never move when the bucket array is resized.
+  void *slot = link != NULL ? (*link)->value : NULL;
+  if (added == TRUE) _MapResizeIfNeeded(map);
+
+  pthread_rwlock_unlock(&(map->lock));
+  if (inserted != NULL) *inserted = added;
+  return slot;
+}
+
+// Inserts a copy of the `value_size` bytes of `value` for `key`, or folds
+// `value` into the value already stored for it with `merge`, in place.  The key
+// is hashed and its chain walked only once.
+//
+// Params:
+//  map        - A pointer to the map.
+//  key        - A pointer to the key.
+//  key_size   - The size of the key in bytes.
+//  value      - A pointer to the value to insert or merge.
+//  value_size - The size of the value in bytes.
+//  merge      - The callback folding `value` into the stored value, which keeps
+//               its size.  When NULL the stored value is overwritten like
+//               `MapInsertN()` does.
+//
+// Returns:
+//  A pointer to the value stored in the map, or NULL on failure.  It stays
+//  valid until the entry is removed or overwritten with a larger value.
+//
+// Thread Safety:
+//  This function holds the write lock of the map, including while `merge`
+//  runs, so `merge` must not call back into the map.
+void *MapUpsert(Map *const map, const void *const key, const size_t key_size,
+                const void *const value, const size_t value_size,
+                value_merge_f merge) {
+  if (map == NULL || key == NULL || value == NULL) return NULL;
+
+  const hash_t hash = _MapHashKey(map, key, key_size);
+  bool_t added = FALSE;
+  pthread_rwlock_wrlock(&(map->lock));
+  _MapRehashStep(map, MAP_REHASH_STEP);
+
+  void *slot = NULL;
+  MapEntry **link = FindOrAddMapEntryLocked(map, key, key_size, hash, value,
+                                            value_size, &added);
+  if (link != NULL && added == TRUE) {
+    slot = (*link)->value;
+    _MapResizeIfNeeded(map);
+  } else if (link != NULL && merge != NULL) {
+    slot = (*link)->value;
+    merge(slot, (*link)->value_size, value, value_size);
+  } else if (link != NULL) {
+    MapEntry *entry = ResizeMapEntryValue("MapUpsert", map, link, value_size);
+    if (entry != NULL) {
+      memcpy(entry->value, value, value_size);
+      slot = entry->value;
+    }
+  }
+
+  pthread_rwlock_unlock(&(map->lock));
+  return slot;
+}
+
+// Returns a slot of `value_size` bytes for the value of `key` to be
+// constructed in place, inserting the key if it is not present.  The key is
+// hashed and its chain walked only once.
+//
+// Params:
+//  map        - A pointer to the map.
+//  key        - A pointer to the key.
+//  key_size   - The size of the key in bytes.
+//  value_size - The size of the value in bytes.
+//  inserted   - Set to TRUE if the key was inserted, FALSE if it was already
+//               present; may be NULL.
+//
+// Returns:
+//  A pointer to the `value_size` bytes of the value, or NULL on failure.  The
+//  bytes are uninitialized for a new key.  For a key already present the old
+//  bytes are kept when they fit and unspecified otherwise.
+//
+// Thread Safety:
+//  This function holds the write lock of the map while it looks the key up.
+//  The slot is filled in outside of it, so other threads must not read the
+//  key until the caller is done.
+void *MapEmplace(Map *const map, const void *const key, const size_t key_size,
+                 const size_t value_size, bool_t *const inserted) {
+  if (map == NULL || key == NULL) return NULL;
+
+  const hash_t hash = _MapHashKey(map, key, key_size);
+  bool_t added = FALSE;
+  pthread_rwlock_wrlock(&(map->lock));
+  _MapRehashStep(map, MAP_REHASH_STEP);
+
+  void *slot = NULL;
+  MapEntry **link = FindOrAddMapEntryLocked(map, key, key_size, hash, NULL,
+                                            value_size, &added);
+  if (link != NULL && added == TRUE) {
+    slot = (*link)->value;
+    _MapResizeIfNeeded(map);
+  } else if (link != NULL) {
+    MapEntry *entry = ResizeMapEntryValue("MapEmplace", map, link, value_size);
+    if (entry != NULL) slot = entry->value;
+  }
+
+  pthread_rwlock_unlock(&(map->lock));
+  if (inserted != NULL) *inserted = added;
+  return slot;
+}
+
+// Inserts like `MapInsertN()` a key whose hash was computed beforehand with
+// `MapHashKey()`, possibly on another map hashing keys the same way.
+//
+// Remarks:
+//  `hash` must be the hash `map` computes for the key; a different value makes
+//  the key land in the wrong chain, where later lookups do not find it.
+void MapInsertWithHash(Map *const map, const void *const key,
+                       const size_t key_size, const hash_t hash,
+                       const void *const value, const size_t value_size) {
+  if (map == NULL || key == NULL || value == NULL) return;
+
+  _MapInsertHashed(map, key, key_size, hash, value, value_size);
+}
+
+// Looks a key up like `MapGetN()` with the hash computed beforehand with
+// `MapHashKey()`, so that one hash serves lookups in several maps.
+//
+// Returns:
+//  A pointer to the value associated with the key, or NULL if the key is not
+//  found in the map or `hash` is not the hash `map` computes for it.
+void *MapGetWithHash(Map *const map, const void *key, const size_t key_size,
+                     const hash_t hash) {
+  if (map == NULL || key == NULL) return NULL;
+
+  return _MapGetHashed(map, key, key_size, hash);
+}
+
+// Removes a key like `MapRemoveN()` with the hash computed beforehand with
+// `MapHashKey()`.
+void MapRemoveWithHash(Map *const map, const void *key, const size_t key_size,
+                       const hash_t hash) {
+  if (map == NULL || key == NULL) return;
+
+  _MapRemoveHashed(map, key, key_size, hash);
+}
+
+// Insert a new key-value pair into the map.
+//
+// Remarks:
+//  Same as `MapInsertN()`; `key_size` is only handed to the hash and equality
+//  callbacks when the map was created with sized ones.
+void MapInsert(Map *const map, const void *const key, const size_t key_size,
+               const void *const value, const size_t value_size) {
+  MapInsertN(map, key, key_size, value, value_size);
+}
+
+// Retrieve the value associated with the given key in the map.
+//
+// Remarks:
+//  Same as `MapGetN()` for maps created with unsized callbacks.  On a map
+//  created with sized or seeded callbacks `key` must be a string and is looked
+//  up without its terminator, i.e. with `strlen(key)` bytes.
+void *MapGet(Map *const map, const void *key) {
+  if (map == NULL || key == NULL) return NULL;
+  return MapGetN(map, key,
+                 map->key_eq_n_func != NULL ? strlen((const char *)key) : 0);
+}
+
+// Remove an entry from the map with the given key.
+//
+// Remarks:
+//  Same as `MapRemoveN()`.
+void MapRemove(Map *const map, const void *key, const size_t key_size) {
+  MapRemoveN(map, key, key_size);
 }
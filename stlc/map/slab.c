@@ -0,0 +1,190 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "map/slab.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "bool.h"
+
+// Offset of the first chunk inside a page, past the page header.
+#define MAP_SLAB_PAGE_HEADER                      \
+  ((sizeof(MapSlabPage) + MAP_SLAB_ALIGNMENT - 1) & \
+   ~(size_t)(MAP_SLAB_ALIGNMENT - 1))
+
+// Chunk size of every class.  Classes grow by roughly 1.5x so at most a third
+// of a chunk is wasted, and every size is a multiple of `MAP_SLAB_ALIGNMENT`.
+static const size_t kMapSlabClassSizes[MAP_SLAB_CLASSES] = {
+    0x40, 0x60, 0x80, 0xC0, 0x100, 0x180, 0x200, 0x300, 0x400, 0x600};
+
+// Returns the index of the smallest class that fits `size` or
+// `MAP_SLAB_CLASSES` if no class does.
+static size_t ComputeMapSlabClass(const size_t size) {
+  size_t index = 0;
+  while (index < MAP_SLAB_CLASSES && kMapSlabClassSizes[index] < size) ++index;
+  return index;
+}
+
+// Initializes an empty `MapSlab`.  No page is allocated until the first
+// request of a class.
+void MapSlabInit(MapSlab* const slab) {
+  if (slab == NULL) return;
+  memset(slab, 0, sizeof(MapSlab));
+}
+
+// Returns the number of bytes actually reserved for a request of `size` bytes,
+// that is the chunk size of the class serving it or `size` itself when the
+// request is too large for any class.
+size_t MapSlabChunkSize(const size_t size) {
+  const size_t index = ComputeMapSlabClass(size);
+  return index == MAP_SLAB_CLASSES ? size : kMapSlabClassSizes[index];
+}
+
+// Returns TRUE if a request of `size` bytes is served by `malloc()` rather
+// than by a size class.
+bool_t MapSlabIsLarge(const size_t size) {
+  return ComputeMapSlabClass(size) == MAP_SLAB_CLASSES ? TRUE : FALSE;
+}
+
+// Allocates `size` bytes from `slab`.  The memory is aligned to
+// `MAP_SLAB_ALIGNMENT`.  Returns NULL on allocation failure.
+void* MapSlabAlloc(MapSlab* const slab, const size_t size) {
+  const size_t index = ComputeMapSlabClass(size);
+  if (index == MAP_SLAB_CLASSES) {
+    void* ptr = malloc(size);
+    if (ptr != NULL) {
+      ++(slab->stats.large_in_use);
+      ++(slab->stats.allocations);
+    }
+    return ptr;
+  }
+
+  MapSlabChunk* chunk = slab->free_lists[index];
+  if (chunk != NULL) {
+    slab->free_lists[index] = chunk->next;
+    --(slab->stats.chunks_free);
+    ++(slab->stats.chunks_in_use);
+    ++(slab->stats.allocations);
+    ++(slab->stats.recycled);
+    return chunk;
+  }
+
+  const size_t chunk_size = kMapSlabClassSizes[index];
+  if (slab->cursor[index] == NULL ||
+      slab->cursor[index] + chunk_size > slab->limit[index]) {
+    MapSlabPage* page;
+    if ((page = (MapSlabPage*)malloc(MAP_SLAB_PAGE_SIZE)) == NULL) {
+      fprintf(stderr, "MapSlabAlloc: failed to allocate page for size: %zu\n",
+              size);
+      return NULL;
+    }
+    page->next = slab->pages;
+    slab->pages = page;
+    slab->cursor[index] = (unsigned char*)page + MAP_SLAB_PAGE_HEADER;
+    slab->limit[index] = (unsigned char*)page + MAP_SLAB_PAGE_SIZE;
+    ++(slab->stats.pages);
+    slab->stats.bytes_reserved += MAP_SLAB_PAGE_SIZE;
+  }
+
+  void* ptr = slab->cursor[index];
+  slab->cursor[index] += chunk_size;
+  ++(slab->stats.chunks_in_use);
+  ++(slab->stats.allocations);
+  return ptr;
+}
+
+// Makes sure `count` chunks of the class serving `size` bytes can be handed
+// out without allocating another page, allocating a single page large enough
+// for all of them if the current page of the class is too small.  The tail of
+// the current page is given up in that case.  Requests too large for any
+// class are left to `malloc()`.  Returns FALSE on allocation failure.
+bool_t MapSlabReserve(MapSlab* const slab, const size_t size,
+                      const size_t count) {
+  const size_t index = ComputeMapSlabClass(size);
+  if (index == MAP_SLAB_CLASSES || count == 0) return TRUE;
+
+  const size_t chunk_size = kMapSlabClassSizes[index];
+  if (slab->cursor[index] != NULL &&
+      (size_t)(slab->limit[index] - slab->cursor[index]) / chunk_size >= count)
+    return TRUE;
+
+  size_t page_size = MAP_SLAB_PAGE_HEADER + count * chunk_size;
+  if (page_size < MAP_SLAB_PAGE_SIZE) page_size = MAP_SLAB_PAGE_SIZE;
+  MapSlabPage* page;
+  if ((page = (MapSlabPage*)malloc(page_size)) == NULL) {
+    fprintf(stderr,
+            "MapSlabReserve: failed to allocate page for size: %zu, count: "
+            "%zu\n",
+            size, count);
+    return FALSE;
+  }
+  page->next = slab->pages;
+  slab->pages = page;
+  slab->cursor[index] = (unsigned char*)page + MAP_SLAB_PAGE_HEADER;
+  slab->limit[index] = (unsigned char*)page + page_size;
+  ++(slab->stats.pages);
+  slab->stats.bytes_reserved += page_size;
+  return TRUE;
+}
+
+// Returns the chunk `ptr` of `size` bytes to `slab`.  `size` must be the value
+// passed to `MapSlabAlloc()` or the `MapSlabChunkSize()` of it.
+void MapSlabFree(MapSlab* const slab, void* const ptr, const size_t size) {
+  if (ptr == NULL) return;
+
+  const size_t index = ComputeMapSlabClass(size);
+  if (index == MAP_SLAB_CLASSES) {
+    free(ptr);
+    --(slab->stats.large_in_use);
+    return;
+  }
+
+  MapSlabChunk* const chunk = (MapSlabChunk*)ptr;
+  chunk->next = slab->free_lists[index];
+  slab->free_lists[index] = chunk;
+  --(slab->stats.chunks_in_use);
+  ++(slab->stats.chunks_free);
+}
+
+// Releases every page of `slab` at once.  Large allocations still in use are
+// not tracked by the pool and must be freed by the caller before.
+void MapSlabRelease(MapSlab* const slab) {
+  if (slab == NULL) return;
+
+  MapSlabPage* page = slab->pages;
+  while (page != NULL) {
+    MapSlabPage* next_page = page->next;
+    free(page);
+    page = next_page;
+  }
+  memset(slab, 0, sizeof(MapSlab));
+}
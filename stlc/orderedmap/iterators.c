@@ -0,0 +1,65 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "orderedmap/iterators.h"
+
+#include <pthread.h>
+
+#include "bool.h"
+#include "orderedmap/orderedmap.h"
+
+// Traverses the ordered map in insertion order and calls the given predicate
+// function on each entry.
+//
+// Params:
+//  map       - A pointer to the map to traverse.
+//  predicate - A function pointer to the predicate function to call on each
+//              key and value.  Traversal stops as soon as it returns `FALSE`.
+//
+// Remarks:
+//  The traversal scans the dense entries array, so it costs one step per
+//  entry inserted since the last rebuild whatever the capacity of the index
+//  table, and the order survives every rebuild.  The function holds the read
+//  lock of the map, so `predicate` may look keys up but must not insert or
+//  remove any.
+void OrderedMapTraverse(OrderedMap *const map,
+                        bool_t (*predicate)(const void *key,
+                                            const void *value)) {
+  if (map == NULL || map->indices == NULL || predicate == NULL) return;
+
+  pthread_rwlock_rdlock(&map->lock);
+  for (size_t i = 0; i < map->entries_used; ++i) {
+    const OrderedMapEntry *const entry = &map->entries[i];
+    if (entry->offset == ORDEREDMAP_DELETED) continue;
+    if (predicate(_ORDEREDMAP_KEY(map, entry), _ORDEREDMAP_VALUE(map, entry)) ==
+        FALSE)
+      break;
+  }
+  pthread_rwlock_unlock(&map->lock);
+}
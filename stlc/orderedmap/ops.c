@@ -0,0 +1,262 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "orderedmap/ops.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bool.h"
+#include "map/map.h"
+#include "orderedmap/orderedmap.h"
+
+// Probes the index table of `map` for the `key_size` bytes of `key` with the
+// precomputed `hash`.  The caller must hold the lock of `map`.
+//
+// Returns:
+//  The slot pointing at the entry of the key with `*found` set, or otherwise
+//  the slot a new entry for the key should take: the first removed slot on
+//  the probe sequence, or the empty slot that ended it.
+static size_t FindOrderedMapSlot(const OrderedMap *const map,
+                                 const void *const key, const size_t key_size,
+                                 const hash_t hash, bool_t *const found) {
+  const size_t mask = map->capacity - 1;
+  size_t slot = MapMixHash(hash) & mask;
+  size_t free_slot = SIZE_MAX;
+  for (;; slot = (slot + 1) & mask) {
+    const int64_t index = _OrderedMapIndexAt(map, slot);
+    if (index == ORDEREDMAP_INDEX_EMPTY) break;
+    if (index == ORDEREDMAP_INDEX_DUMMY) {
+      if (free_slot == SIZE_MAX) free_slot = slot;
+      continue;
+    }
+    const OrderedMapEntry *const entry = &map->entries[index];
+    if (entry->hash != hash) continue;
+    const bool_t equal =
+        map->key_eq_n_func != NULL
+            ? map->key_eq_n_func(_ORDEREDMAP_KEY(map, entry), entry->key_size,
+                                 key, key_size)
+            : map->key_eq_func(_ORDEREDMAP_KEY(map, entry), key);
+    if (equal == TRUE) {
+      *found = TRUE;
+      return slot;
+    }
+  }
+  *found = FALSE;
+  return free_slot != SIZE_MAX ? free_slot : slot;
+}
+
+// Makes room in the entries array of `map` for one more entry, growing the
+// array by half while the index table has room for it and rebuilding both at
+// twice the live entries otherwise.  The caller must hold the write lock of
+// `map`.
+static bool_t GrowOrderedMapEntries(OrderedMap* const map) {
+  const size_t usable = _ORDEREDMAP_USABLE(map->capacity);
+  if (map->entries_capacity < usable) {
+    size_t entries_capacity =
+        map->entries_capacity + (map->entries_capacity >> 0x01) + 0x01;
+    if (entries_capacity > usable) entries_capacity = usable;
+    OrderedMapEntry* const entries = (OrderedMapEntry*)realloc(
+        map->entries, entries_capacity * sizeof(OrderedMapEntry));
+    if (entries == NULL) {
+      fprintf(stderr,
+              "OrderedMap: failed to grow entries to capacity: %zu\n",
+              entries_capacity);
+      return FALSE;
+    }
+    map->entries = entries;
+    map->entries_capacity = entries_capacity;
+    return TRUE;
+  }
+  const size_t count = map->size + 0x01;
+  return _OrderedMapRebuildLocked(map, _OrderedMapCapacityFor(count << 0x01),
+                                  count + (count >> 0x01));
+}
+
+// Insert a new key-value pair into the ordered map.
+//
+// Params:
+//  map        - A pointer to the map to insert the key-value pair into.
+//  key        - A pointer to the key to insert.
+//  key_size   - The size of the key in bytes.
+//  value      - A pointer to the value to insert.
+//  value_size - The size of the value in bytes.
+//
+// Remarks:
+//  A new key is appended after every other key.  If the key already exists in
+//  the map, its value is replaced and it keeps its position.
+//
+// Thread Safety:
+//  This function holds the write lock of the map.
+void OrderedMapInsert(OrderedMap *const map, const void *const key,
+                      const size_t key_size, const void *const value,
+                      const size_t value_size) {
+  if (map == NULL || map->indices == NULL || key == NULL ||
+      (value == NULL && value_size != 0))
+    return;
+  if (key_size > ORDEREDMAP_MAX_ITEM_SIZE ||
+      value_size > ORDEREDMAP_MAX_ITEM_SIZE) {
+    fprintf(stderr,
+            "OrderedMapInsert: key_size: %zu or value_size: %zu too large\n",
+            key_size, value_size);
+    return;
+  }
+
+  const hash_t hash = _OrderedMapHashKey(map, key, key_size);
+  pthread_rwlock_wrlock(&map->lock);
+
+  bool_t found;
+  size_t slot = FindOrderedMapSlot(map, key, key_size, hash, &found);
+  if (found == TRUE) {
+    OrderedMapEntry *const entry =
+        &map->entries[_OrderedMapIndexAt(map, slot)];
+    if (_ORDEREDMAP_ALIGN(value_size) <= _ORDEREDMAP_ALIGN(entry->value_size)) {
+      if (value_size != 0)
+        memcpy(_ORDEREDMAP_VALUE(map, entry), value, value_size);
+      entry->value_size = (uint32_t)value_size;
+    } else {
+      // The entry keeps its position; only its bytes move to the end of the
+      // arena.
+      const size_t offset =
+          _OrderedMapAppendLocked(map, key, key_size, value, value_size);
+      if (offset == ORDEREDMAP_DELETED) {
+        fprintf(stderr,
+                "OrderedMapInsert: failed to allocate value for value_size: "
+                "%zu\n",
+                value_size);
+      } else {
+        map->arena_dead +=
+            _ORDEREDMAP_BLOCK_SIZE(entry->key_size, entry->value_size);
+        entry->offset = offset;
+        entry->value_size = (uint32_t)value_size;
+      }
+    }
+    pthread_rwlock_unlock(&map->lock);
+    return;
+  }
+
+  if (map->entries_used == map->entries_capacity) {
+    if (GrowOrderedMapEntries(map) == FALSE) {
+      pthread_rwlock_unlock(&map->lock);
+      return;
+    }
+    // Growing may have rebuilt the index table, even at the same capacity
+    // when only tombstones were dropped, so the slot is probed again.
+    slot = FindOrderedMapSlot(map, key, key_size, hash, &found);
+  }
+  const size_t offset =
+      _OrderedMapAppendLocked(map, key, key_size, value, value_size);
+  if (offset == ORDEREDMAP_DELETED) {
+    fprintf(stderr,
+            "OrderedMapInsert: failed to allocate entry for value_size: %zu\n",
+            value_size);
+    pthread_rwlock_unlock(&map->lock);
+    return;
+  }
+  const size_t index = map->entries_used++;
+  map->entries[index].hash = hash;
+  map->entries[index].offset = offset;
+  map->entries[index].key_size = (uint32_t)key_size;
+  map->entries[index].value_size = (uint32_t)value_size;
+  _OrderedMapSetIndex(map, slot, (int64_t)index);
+  ++(map->size);
+
+  pthread_rwlock_unlock(&map->lock);
+}
+
+// Retrieve the value associated with the `key_size` bytes of `key`.
+//
+// Returns:
+//  A pointer to the value, or NULL if the key is not present.  `value_size`,
+//  if not NULL, receives the size of the value.  The keys and values live in
+//  one arena that moves as it grows, so the pointer is only valid until the
+//  next insert or remove.
+//
+// Thread Safety:
+//  This function only holds the read lock of the map.
+void *OrderedMapGet(OrderedMap *const map, const void *const key,
+                    const size_t key_size, size_t *const value_size) {
+  if (map == NULL || map->indices == NULL || key == NULL) return NULL;
+
+  const hash_t hash = _OrderedMapHashKey(map, key, key_size);
+  pthread_rwlock_rdlock(&map->lock);
+  bool_t found;
+  const size_t slot = FindOrderedMapSlot(map, key, key_size, hash, &found);
+  void *value = NULL;
+  if (found == TRUE) {
+    const OrderedMapEntry *const entry =
+        &map->entries[_OrderedMapIndexAt(map, slot)];
+    value = _ORDEREDMAP_VALUE(map, entry);
+    if (value_size != NULL) *value_size = entry->value_size;
+  }
+  pthread_rwlock_unlock(&map->lock);
+  return value;
+}
+
+// Remove an entry from the ordered map with the given `key_size` bytes of key.
+//
+// Returns:
+//  TRUE if an entry was removed, FALSE if the key was not present.
+//
+// Remarks:
+//  The entry is left as a hole in the entries array.  The tables are rebuilt
+//  without the holes once they outnumber the live entries.
+//
+// Thread Safety:
+//  This function holds the write lock of the map.
+bool_t OrderedMapRemove(OrderedMap *const map, const void *const key,
+                        const size_t key_size) {
+  if (map == NULL || map->indices == NULL || key == NULL) return FALSE;
+
+  const hash_t hash = _OrderedMapHashKey(map, key, key_size);
+  pthread_rwlock_wrlock(&map->lock);
+  bool_t found;
+  const size_t slot = FindOrderedMapSlot(map, key, key_size, hash, &found);
+  if (found == TRUE) {
+    OrderedMapEntry *const entry =
+        &map->entries[_OrderedMapIndexAt(map, slot)];
+    map->arena_dead +=
+        _ORDEREDMAP_BLOCK_SIZE(entry->key_size, entry->value_size);
+    entry->offset = ORDEREDMAP_DELETED;
+    _OrderedMapSetIndex(map, slot, ORDEREDMAP_INDEX_DUMMY);
+    --(map->size);
+
+    // Keeps scans proportional to the live entries.
+    if (map->entries_used - map->size > map->size &&
+        map->entries_used > _ORDEREDMAP_USABLE(ORDEREDMAP_MIN_CAPACITY)) {
+      _OrderedMapRebuildLocked(map, _OrderedMapCapacityFor(map->size << 0x01),
+                               map->size + (map->size >> 0x01));
+    }
+  }
+  pthread_rwlock_unlock(&map->lock);
+  return found;
+}
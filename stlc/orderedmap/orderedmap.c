@@ -0,0 +1,303 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "orderedmap/orderedmap.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "bool.h"
+#include "map/map.h"
+
+// Returns the number of bytes an index slot needs to address the entries of
+// an index table of `capacity` slots, leaving room for the negative markers.
+static size_t ComputeOrderedMapIndexWidth(const size_t capacity) {
+  if (capacity <= (size_t)INT8_MAX) return sizeof(int8_t);
+  if (capacity <= (size_t)INT16_MAX) return sizeof(int16_t);
+  if (capacity <= (size_t)INT32_MAX) return sizeof(int32_t);
+  return sizeof(int64_t);
+}
+
+// Returns the number of index slots needed to hold `count` entries.
+//
+// This function is meant to be protected inside `orderedmap` module.
+size_t _OrderedMapCapacityFor(const size_t count) {
+  size_t capacity = ORDEREDMAP_MIN_CAPACITY;
+  while (_ORDEREDMAP_USABLE(capacity) < count) capacity <<= 1;
+  return capacity;
+}
+
+// Hashes the `key_size` bytes of `key` with the sized hash function of `map`
+// or its unsized one, whichever it was created with.
+//
+// This function is meant to be protected inside `orderedmap` module.
+hash_t _OrderedMapHashKey(const OrderedMap* const map, const void* key,
+                          const size_t key_size) {
+  if (map->hash_n_func != NULL) return map->hash_n_func(key, key_size);
+  return map->hash_func(key);
+}
+
+// Moves the live keys and values of `map` into a new arena with room for
+// `extra` more bytes, in entry order, and updates the offsets of the entries.
+static bool_t CompactOrderedMapArena(OrderedMap* const map,
+                                     const size_t extra) {
+  const size_t live = map->arena_used - map->arena_dead;
+  size_t capacity = live + extra + ((live + extra) >> 0x01);
+  if (capacity < ORDEREDMAP_MIN_ARENA) capacity = ORDEREDMAP_MIN_ARENA;
+  unsigned char* const arena = (unsigned char*)malloc(capacity);
+  if (arena == NULL) return FALSE;
+
+  size_t used = 0;
+  for (size_t i = 0; i < map->entries_used; ++i) {
+    OrderedMapEntry* const entry = &map->entries[i];
+    if (entry->offset == ORDEREDMAP_DELETED) continue;
+    const size_t size =
+        _ORDEREDMAP_BLOCK_SIZE(entry->key_size, entry->value_size);
+    memcpy(arena + used, map->arena + entry->offset, size);
+    entry->offset = used;
+    used += size;
+  }
+  free(map->arena);
+  map->arena = arena;
+  map->arena_capacity = capacity;
+  map->arena_used = used;
+  map->arena_dead = 0;
+  return TRUE;
+}
+
+// Copies the `key_size` bytes of `key` and the `value_size` bytes of `value`
+// at the end of the arena of `map`, compacting or growing it first if they do
+// not fit.  The offsets of the entries may change, their positions do not.
+// The caller must hold the write lock of `map`.
+//
+// Returns:
+//  The offset of the copy, or `ORDEREDMAP_DELETED` on allocation failure.
+//
+// This function is meant to be protected inside `orderedmap` module.
+size_t _OrderedMapAppendLocked(OrderedMap* const map, const void* const key,
+                               const size_t key_size, const void* const value,
+                               const size_t value_size) {
+  const size_t size = _ORDEREDMAP_BLOCK_SIZE(key_size, value_size);
+  if (map->arena_used + size > map->arena_capacity) {
+    if (map->arena_dead >= map->arena_used / 0x03) {
+      // A third of the arena is garbage: compacting frees as much as growing
+      // it would add.
+      if (CompactOrderedMapArena(map, size) == FALSE)
+        return ORDEREDMAP_DELETED;
+    } else {
+      // Growing by half keeps the unused tail of the arena small.
+      size_t capacity = map->arena_capacity + (map->arena_capacity >> 0x01);
+      if (capacity < ORDEREDMAP_MIN_ARENA) capacity = ORDEREDMAP_MIN_ARENA;
+      if (capacity < map->arena_used + size) capacity = map->arena_used + size;
+      unsigned char* const arena =
+          (unsigned char*)realloc(map->arena, capacity);
+      if (arena == NULL) return ORDEREDMAP_DELETED;
+      map->arena = arena;
+      map->arena_capacity = capacity;
+    }
+  }
+
+  const size_t offset = map->arena_used;
+  if (key_size != 0) memcpy(map->arena + offset, key, key_size);
+  if (value_size != 0) {
+    memcpy(map->arena + offset + _ORDEREDMAP_ALIGN(key_size), value,
+           value_size);
+  }
+  map->arena_used += size;
+  return offset;
+}
+
+// Rebuilds the entries array and the index table of `map` for an index table
+// of `capacity` slots and an entries array of `count` entries, dropping the
+// removed entries and keeping the others in order.  `count` is clamped between
+// the live entries and `_ORDEREDMAP_USABLE(capacity)`.  The arena is compacted
+// too when most of it is dead.  The caller must hold the write lock of `map`.
+//
+// Returns:
+//  FALSE if the new tables could not be allocated, in which case `map` is
+//  left as is.
+//
+// This function is meant to be protected inside `orderedmap` module.
+bool_t _OrderedMapRebuildLocked(OrderedMap* const map, const size_t capacity,
+                                const size_t count) {
+  const size_t index_width = ComputeOrderedMapIndexWidth(capacity);
+  size_t entries_capacity = count;
+  if (entries_capacity < map->size) entries_capacity = map->size;
+  if (entries_capacity == 0) entries_capacity = 0x01;
+  if (entries_capacity > _ORDEREDMAP_USABLE(capacity))
+    entries_capacity = _ORDEREDMAP_USABLE(capacity);
+  void* const indices = malloc(capacity * index_width);
+  OrderedMapEntry* const entries =
+      (OrderedMapEntry*)malloc(entries_capacity * sizeof(OrderedMapEntry));
+  if (indices == NULL || entries == NULL) {
+    fprintf(stderr,
+            "OrderedMap: failed to allocate tables for capacity: %zu\n",
+            capacity);
+    free(indices);
+    free(entries);
+    return FALSE;
+  }
+  // Every marker byte is 0xFF, so a byte-wise fill empties slots of any width.
+  memset(indices, 0xFF, capacity * index_width);
+
+  size_t used = 0;
+  for (size_t i = 0; i < map->entries_used; ++i) {
+    if (map->entries[i].offset != ORDEREDMAP_DELETED)
+      entries[used++] = map->entries[i];
+  }
+  free(map->indices);
+  free(map->entries);
+  map->indices = indices;
+  map->capacity = capacity;
+  map->index_width = index_width;
+  map->entries = entries;
+  map->entries_capacity = entries_capacity;
+  map->entries_used = used;
+
+  const size_t mask = capacity - 1;
+  for (size_t i = 0; i < used; ++i) {
+    size_t slot = MapMixHash(entries[i].hash) & mask;
+    while (_OrderedMapIndexAt(map, slot) != ORDEREDMAP_INDEX_EMPTY)
+      slot = (slot + 1) & mask;
+    _OrderedMapSetIndex(map, slot, (int64_t)i);
+  }
+
+  if (map->arena_dead > map->arena_used >> 0x01)
+    CompactOrderedMapArena(map, 0);
+  return TRUE;
+}
+
+// Initializes the fields shared by `OrderedMapInit()` and `OrderedMapInitN()`
+// and allocates the tables for `count` entries.
+static void InitOrderedMap(OrderedMap* const map, const size_t count) {
+  map->indices = NULL;
+  map->capacity = 0;
+  map->index_width = 0;
+  map->entries = NULL;
+  map->entries_capacity = 0;
+  map->entries_used = 0;
+  map->size = 0;
+  map->arena = NULL;
+  map->arena_capacity = 0;
+  map->arena_used = 0;
+  map->arena_dead = 0;
+  if (_OrderedMapRebuildLocked(map, _OrderedMapCapacityFor(count), count) ==
+      FALSE)
+    return;
+  pthread_rwlock_init(&map->lock, NULL);
+}
+
+// Initializes a new instance of the `OrderedMap` data structure.
+//
+// Params:
+//  map         - A pointer to the `OrderedMap` to be initialized.
+//  count       - The number of entries to make room for.
+//  hash_func   - A pointer to the hash function used to calculate hash codes
+//                for keys.
+//  key_eq_func - A pointer to the key comparison function used to compare keys
+//                for equality.
+//
+// Remarks:
+//  If the pointer passed to `map` is NULL, this function returns immediately
+//  without doing anything.  On failure `map->indices` is left NULL.
+void OrderedMapInit(OrderedMap* const map, const size_t count,
+                    hash_f hash_func, key_eq_f key_eq_func) {
+  if (map == NULL) return;
+  map->indices = NULL;
+  if (hash_func == NULL || key_eq_func == NULL) {
+    fprintf(stderr, "OrderedMapInit: hash and key comparison required\n");
+    return;
+  }
+  map->hash_func = hash_func;
+  map->key_eq_func = key_eq_func;
+  map->hash_n_func = NULL;
+  map->key_eq_n_func = NULL;
+  InitOrderedMap(map, count);
+}
+
+// Initializes a new instance of the `OrderedMap` data structure like
+// `OrderedMapInit()` with length-aware callbacks, like `MapInitN()`.
+void OrderedMapInitN(OrderedMap* const map, const size_t count,
+                     hash_n_f hash_n_func, key_eq_n_f key_eq_n_func) {
+  if (map == NULL) return;
+  map->indices = NULL;
+  if (hash_n_func == NULL || key_eq_n_func == NULL) {
+    fprintf(stderr, "OrderedMapInitN: hash and key comparison required\n");
+    return;
+  }
+  map->hash_func = NULL;
+  map->key_eq_func = NULL;
+  map->hash_n_func = hash_n_func;
+  map->key_eq_n_func = key_eq_n_func;
+  InitOrderedMap(map, count);
+}
+
+// Grows the tables of `map` so that `count` entries fit without a rebuild.
+void OrderedMapReserve(OrderedMap* const map, const size_t count) {
+  if (map == NULL || map->indices == NULL) return;
+
+  pthread_rwlock_wrlock(&map->lock);
+  if (count > map->size &&
+      map->entries_used + (count - map->size) > map->entries_capacity)
+    _OrderedMapRebuildLocked(map, _OrderedMapCapacityFor(count), count);
+  pthread_rwlock_unlock(&map->lock);
+}
+
+// Returns the number of entries of `map`.
+size_t OrderedMapSize(OrderedMap* const map) {
+  if (map == NULL || map->indices == NULL) return 0;
+
+  pthread_rwlock_rdlock(&map->lock);
+  const size_t size = map->size;
+  pthread_rwlock_unlock(&map->lock);
+  return size;
+}
+
+// Frees up an `OrderedMap` instance and the entries associated with it.
+void OrderedMapFree(OrderedMap* const map) {
+  if (map == NULL || map->indices == NULL) return;
+
+  pthread_rwlock_wrlock(&map->lock);
+  free(map->indices);
+  free(map->entries);
+  free(map->arena);
+  map->indices = NULL;
+  map->entries = NULL;
+  map->arena = NULL;
+  map->capacity = 0;
+  map->entries_capacity = 0;
+  map->entries_used = 0;
+  map->size = 0;
+  pthread_rwlock_unlock(&map->lock);
+  pthread_rwlock_destroy(&map->lock);
+}
@@ -0,0 +1,97 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "shardedmap/ops.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bool.h"
+#include "map/map.h"
+#include "map/ops.h"
+#include "shardedmap/shardedmap.h"
+
+// Inserts a new key-value pair into the shard of `key`, or replaces the value
+// if the key is already present.
+//
+// Args:
+//  map        - A pointer to the sharded map to insert the key-value pair
+//               into.
+//  key        - A pointer to the key to insert.
+//  key_size   - The size of the key in bytes.
+//  value      - A pointer to the value to insert.
+//  value_size - The size of the value in bytes.
+//
+// Thread Safety:
+//  Only the write lock of the shard of `key` is held, so inserts into
+//  different shards run in parallel.
+void ShardedMapInsert(ShardedMap *const map, const void *const key,
+                      const size_t key_size, const void *const value,
+                      const size_t value_size) {
+  if (map == NULL || map->shards == NULL || key == NULL || value == NULL)
+    return;
+
+  // Every shard hashes the same way, so the first one computes the hash.
+  const hash_t hash = _MapHashKey(&map->shards[0].map, key, key_size);
+  if (_MapInsertHashed(_SHARDEDMAP_SHARD(map, hash), key, key_size, hash,
+                       value, value_size) == TRUE) {
+    __atomic_fetch_add(&map->size, 1, __ATOMIC_RELAXED);
+  }
+}
+
+// Retrieves the value associated with the given key.
+//
+// Returns:
+//  A pointer to the value associated with the key, or NULL if the key is not
+//  found in the map.
+//
+// Thread Safety:
+//  Only the read lock of the shard of `key` is held.
+void *ShardedMapGet(ShardedMap *const map, const void *key,
+                    const size_t key_size) {
+  if (map == NULL || map->shards == NULL || key == NULL) return NULL;
+
+  const hash_t hash = _MapHashKey(&map->shards[0].map, key, key_size);
+  return _MapGetHashed(_SHARDEDMAP_SHARD(map, hash), key, key_size, hash);
+}
+
+// Removes the entry of the given key, if present.
+//
+// Thread Safety:
+//  Only the write lock of the shard of `key` is held.
+void ShardedMapRemove(ShardedMap *const map, const void *key,
+                      const size_t key_size) {
+  if (map == NULL || map->shards == NULL || key == NULL) return;
+
+  const hash_t hash = _MapHashKey(&map->shards[0].map, key, key_size);
+  if (_MapRemoveHashed(_SHARDEDMAP_SHARD(map, hash), key, key_size, hash) ==
+      TRUE) {
+    __atomic_fetch_sub(&map->size, 1, __ATOMIC_RELAXED);
+  }
+}
@@ -0,0 +1,140 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "shardedmap/shardedmap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+
+#include "map/hash.h"
+
+// Initializes a new instance of the `ShardedMap` data structure.
+//
+// Params:
+//  map         - A pointer to the `ShardedMap` to be initialized.
+//  shard_count - The number of shards; it is rounded up to the next power of
+//                two inside [`SHARDEDMAP_MIN_SHARDS`, `SHARDEDMAP_MAX_SHARDS`].
+//  capacity    - The total number of buckets, spread evenly over the shards;
+//                every shard gets at least `MAP_MIN_CAPACITY`.
+//  hash_func   - A pointer to the hash function used to calculate hash codes
+//                for keys.
+//  key_eq_func - A pointer to the key comparison function used to compare keys
+//                for equality.
+//
+// Remarks:
+//  If the pointer passed to `map` is NULL, this function returns immediately
+//  without doing anything.  On failure `map->shards` is left NULL.
+void ShardedMapInit(ShardedMap* const map, const size_t shard_count,
+                    const size_t capacity, hash_f hash_func,
+                    key_eq_f key_eq_func) {
+  MapConfig config;
+  MapConfigInit(&config, capacity, hash_func, key_eq_func);
+  ShardedMapInitWithConfig(map, shard_count, &config);
+}
+
+// Initializes a new instance of the `ShardedMap` data structure whose shards
+// are created as described by `config`.
+//
+// Remarks:
+//  `config->capacity` is the total number of buckets, spread evenly over the
+//  shards.  A seeded hash function gets one seed shared by all shards, drawn
+//  with `HashRandomSeed()` unless `config->seed` is set, so every key hashes
+//  the same whichever shard computes it.
+void ShardedMapInitWithConfig(ShardedMap* const map, const size_t shard_count,
+                              const MapConfig* const config) {
+  if (map == NULL || config == NULL) return;
+  map->shards = NULL;
+  if (shard_count < SHARDEDMAP_MIN_SHARDS ||
+      shard_count > SHARDEDMAP_MAX_SHARDS) {
+    fprintf(stderr,
+            "ShardedMapInit: shard_count out of range [%d, %d]: %zu\n",
+            SHARDEDMAP_MIN_SHARDS, SHARDEDMAP_MAX_SHARDS, shard_count);
+    return;
+  }
+
+  map->shard_count = 1;
+  map->shard_bits = 0;
+  while (map->shard_count < shard_count) {
+    map->shard_count <<= 1;
+    ++(map->shard_bits);
+  }
+  map->size = 0;
+
+  MapConfig shard_config = *config;
+  shard_config.capacity = config->capacity / map->shard_count;
+  if (shard_config.capacity < MAP_MIN_CAPACITY) {
+    shard_config.capacity = MAP_MIN_CAPACITY;
+  }
+  if (shard_config.hash_seeded_func != NULL && shard_config.seed == 0) {
+    shard_config.seed = HashRandomSeed();
+  }
+
+  void* shards;
+  if (posix_memalign(&shards, SHARDEDMAP_SHARD_ALIGNMENT,
+                     map->shard_count * sizeof(ShardedMapShard)) != 0) {
+    fprintf(stderr,
+            "ShardedMapInit: failed to allocate shards for shard_count: %zu\n",
+            map->shard_count);
+    return;
+  }
+  map->shards = (ShardedMapShard*)shards;
+
+  for (size_t i = 0; i < map->shard_count; ++i) {
+    map->shards[i].map.buckets = NULL;
+    MapInitWithConfig(&map->shards[i].map, &shard_config);
+    if (map->shards[i].map.buckets == NULL) {
+      fprintf(stderr, "ShardedMapInit: failed to initialize shard: %zu\n", i);
+      for (size_t j = 0; j < i; ++j) MapFree(&map->shards[j].map);
+      free(map->shards);
+      map->shards = NULL;
+      return;
+    }
+  }
+}
+
+// Returns the number of entries of `map` without taking any lock.  Concurrent
+// writers may change it right after it is read.
+size_t ShardedMapSize(const ShardedMap* const map) {
+  if (map == NULL) return 0;
+  return __atomic_load_n(&map->size, __ATOMIC_RELAXED);
+}
+
+// Frees up a `ShardedMap` instance, its shards and the entries associated
+// with them.
+void ShardedMapFree(ShardedMap* const map) {
+  if (map == NULL || map->shards == NULL) return;
+
+  for (size_t i = 0; i < map->shard_count; ++i) {
+    MapFree(&map->shards[i].map);
+  }
+  free(map->shards);
+  map->shards = NULL;
+  map->size = 0;
+}
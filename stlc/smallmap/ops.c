@@ -0,0 +1,122 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "smallmap/ops.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bool.h"
+#include "map/map.h"
+#include "smallmap/smallmap.h"
+
+// Insert a new key-value pair into the small map.
+//
+// Params:
+//  map        - A pointer to the map to insert the key-value pair into.
+//  key        - A pointer to the key to insert.
+//  key_size   - The size of the key in bytes.
+//  value      - A pointer to the value to insert.
+//  value_size - The size of the value in bytes.
+//
+// Remarks:
+//  If the key already exists in the map, its value is replaced.  Inserting a
+//  new key into a map holding `SMALLMAP_INLINE_CAPACITY` inline entries
+//  promotes it to a `Map` first.
+void SmallMapInsert(SmallMap *const map, const void *const key,
+                    const size_t key_size, const void *const value,
+                    const size_t value_size) {
+  if (map == NULL || key == NULL || value == NULL) return;
+
+  const hash_t hash = _SmallMapHashKey(map, key, key_size);
+  if (map->promoted == FALSE) {
+    const size_t index = _SmallMapFind(map, key, key_size, hash);
+    if (index < map->size) {
+      MapEntry *const entry = map->entries[index];
+      if (value_size <= entry->value_capacity) {
+        memcpy(entry->value, value, value_size);
+        entry->value_size = value_size;
+        return;
+      }
+      MapEntry *const grown =
+          MapEntryNew(key, key_size, value, value_size, hash, NULL);
+      if (grown == NULL) return;
+      free(entry);
+      map->entries[index] = grown;
+      return;
+    }
+    if (map->size < SMALLMAP_INLINE_CAPACITY) {
+      MapEntry *const entry =
+          MapEntryNew(key, key_size, value, value_size, hash, NULL);
+      if (entry == NULL) return;
+      map->entries[map->size++] = entry;
+      return;
+    }
+    if (_SmallMapPromote(map) == FALSE) return;
+  }
+  _MapInsertHashed(map->map, key, key_size, hash, value, value_size);
+}
+
+// Retrieve the value associated with the `key_size` bytes of `key`.
+//
+// Returns:
+//  A pointer to the value, or NULL if the key is not present.  The pointer
+//  stays valid until the key is overwritten or removed, or the map promoted.
+void *SmallMapGet(SmallMap *const map, const void *const key,
+                  const size_t key_size) {
+  if (map == NULL || key == NULL) return NULL;
+
+  const hash_t hash = _SmallMapHashKey(map, key, key_size);
+  if (map->promoted == TRUE)
+    return _MapGetHashed(map->map, key, key_size, hash);
+  const size_t index = _SmallMapFind(map, key, key_size, hash);
+  return index < map->size ? map->entries[index]->value : NULL;
+}
+
+// Remove an entry from the small map with the given `key_size` bytes of key.
+//
+// Returns:
+//  TRUE if an entry was removed, FALSE if the key was not present.
+bool_t SmallMapRemove(SmallMap *const map, const void *const key,
+                      const size_t key_size) {
+  if (map == NULL || key == NULL) return FALSE;
+
+  const hash_t hash = _SmallMapHashKey(map, key, key_size);
+  if (map->promoted == TRUE)
+    return _MapRemoveHashed(map->map, key, key_size, hash);
+  const size_t index = _SmallMapFind(map, key, key_size, hash);
+  if (index == map->size) return FALSE;
+
+  // The last entry fills the hole; the inline entries keep no order.
+  free(map->entries[index]);
+  map->entries[index] = map->entries[--(map->size)];
+  map->entries[map->size] = NULL;
+  return TRUE;
+}
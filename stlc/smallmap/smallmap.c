@@ -0,0 +1,170 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "smallmap/smallmap.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bool.h"
+#include "map/map.h"
+#include "map/ops.h"
+
+// Hashes the `key_size` bytes of `key` the way the `Map` a `SmallMap` gets
+// promoted to does.
+//
+// This function is meant to be protected inside `smallmap` module.
+hash_t _SmallMapHashKey(const SmallMap* const map, const void* key,
+                        const size_t key_size) {
+  if (map->sized == TRUE) return map->hash_n_func(key, key_size);
+  return map->hash_func(key);
+}
+
+// Returns the position in `map->entries` of the inline entry of the
+// `key_size` bytes of `key` with hash `hash`, or `map->size` if it is absent.
+//
+// This function is meant to be protected inside `smallmap` module.
+size_t _SmallMapFind(const SmallMap* const map, const void* key,
+                     const size_t key_size, const hash_t hash) {
+  for (size_t i = 0; i < map->size; ++i) {
+    const MapEntry* const entry = map->entries[i];
+    if (entry->hash != hash) continue;
+    const bool_t equal =
+        map->sized == TRUE
+            ? map->key_eq_n_func(entry->key, entry->key_size, key, key_size)
+            : map->key_eq_func(entry->key, key);
+    if (equal == TRUE) return i;
+  }
+  return map->size;
+}
+
+// Moves the inline entries of `map` into a newly allocated `Map`.
+//
+// Returns:
+//  FALSE if the `Map` could not be allocated, in which case `map` is left
+//  as is.
+//
+// This function is meant to be protected inside `smallmap` module.
+bool_t _SmallMapPromote(SmallMap* const map) {
+  Map* const promoted = (Map*)malloc(sizeof(Map));
+  if (promoted == NULL) {
+    fprintf(stderr, "_SmallMapPromote: failed to allocate map\n");
+    return FALSE;
+  }
+  promoted->buckets = NULL;
+  if (map->sized == TRUE) {
+    MapInitN(promoted, MAP_MIN_CAPACITY, map->hash_n_func,
+             map->key_eq_n_func);
+  } else {
+    MapInit(promoted, MAP_MIN_CAPACITY, map->hash_func, map->key_eq_func);
+  }
+  if (promoted->buckets == NULL) {
+    free(promoted);
+    return FALSE;
+  }
+
+  // The inline entries were allocated with `MapEntryNew()` and hashed the way
+  // `promoted` hashes them, so they are linked in as they are.
+  pthread_rwlock_wrlock(&promoted->lock);
+  for (size_t i = 0; i < map->size; ++i) {
+    _MapLinkEntryLocked(promoted, map->entries[i]);
+  }
+  pthread_rwlock_unlock(&promoted->lock);
+  map->map = promoted;
+  map->size = 0;
+  map->promoted = TRUE;
+  return TRUE;
+}
+
+// Initializes the fields shared by `SmallMapInit()` and `SmallMapInitN()`.
+static void InitSmallMap(SmallMap* const map) {
+  map->size = 0;
+  map->promoted = FALSE;
+  for (size_t i = 0; i < SMALLMAP_INLINE_CAPACITY; ++i) map->entries[i] = NULL;
+}
+
+// Initializes a new, empty instance of the `SmallMap` data structure.  No
+// memory is allocated until the first insert.
+//
+// Params:
+//  map         - A pointer to the `SmallMap` to be initialized.
+//  hash_func   - A pointer to the hash function used to calculate hash codes
+//                for keys.
+//  key_eq_func - A pointer to the key comparison function used to compare keys
+//                for equality.
+//
+// Remarks:
+//  If the pointer passed to `map` is NULL, this function returns immediately
+//  without doing anything.
+void SmallMapInit(SmallMap* const map, hash_f hash_func,
+                  key_eq_f key_eq_func) {
+  if (map == NULL) return;
+  map->hash_func = hash_func;
+  map->key_eq_func = key_eq_func;
+  map->sized = FALSE;
+  InitSmallMap(map);
+}
+
+// Initializes a new instance of the `SmallMap` data structure like
+// `SmallMapInit()` with length-aware callbacks, like `MapInitN()`.
+void SmallMapInitN(SmallMap* const map, hash_n_f hash_n_func,
+                   key_eq_n_f key_eq_n_func) {
+  if (map == NULL) return;
+  map->hash_n_func = hash_n_func;
+  map->key_eq_n_func = key_eq_n_func;
+  map->sized = TRUE;
+  InitSmallMap(map);
+}
+
+// Returns the number of entries of `map`.
+size_t SmallMapSize(SmallMap* const map) {
+  if (map == NULL) return 0;
+  if (map->promoted == TRUE) return map->map->size;
+  return map->size;
+}
+
+// Returns whether the entries of `map` were moved into a `Map`.
+bool_t SmallMapIsPromoted(const SmallMap* const map) {
+  return map != NULL ? map->promoted : FALSE;
+}
+
+// Frees up a `SmallMap` instance and the entries associated with it.  The map
+// is left empty and may be used again.
+void SmallMapFree(SmallMap* const map) {
+  if (map == NULL) return;
+
+  if (map->promoted == TRUE) {
+    MapFree(map->map);
+    free(map->map);
+  } else {
+    for (size_t i = 0; i < map->size; ++i) free(map->entries[i]);
+  }
+  InitSmallMap(map);
+}
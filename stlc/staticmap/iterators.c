@@ -0,0 +1,62 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "staticmap/iterators.h"
+
+#include <stdint.h>
+
+#include "bool.h"
+#include "staticmap/staticmap.h"
+
+// Traverses the entire static map and calls the given predicate function on
+// each map element.
+//
+// Params:
+//  map       - A pointer to the map to traverse.
+//  predicate - A function pointer to the predicate function to call on each map
+//              element.  Traversal stops as soon as it returns `FALSE`.
+//
+// Remarks:
+//  The entries are laid out in slot order, so the traversal reads the buffer
+//  sequentially.  No lock is taken.
+void StaticMapTraverse(const StaticMap *const map,
+                       bool_t (*predicate)(const void *key,
+                                           const void *value)) {
+  if (map == NULL || map->header == NULL || predicate == NULL) return;
+
+  for (uint64_t s = 0; s < map->header->slot_count; ++s) {
+    const StaticMapSlot *const slot = &map->slots[s];
+    if (slot->offset == STATICMAP_EMPTY_SLOT) continue;
+    const StaticMapEntry *const entry =
+        (const StaticMapEntry *)(map->data + slot->offset);
+    if (predicate(entry->data,
+                  entry->data + _STATICMAP_ALIGN(entry->key_size)) == FALSE)
+      break;
+  }
+}
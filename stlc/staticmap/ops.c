@@ -0,0 +1,83 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "staticmap/ops.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "bool.h"
+#include "map/hash.h"
+#include "staticmap/staticmap.h"
+
+// Retrieve the value associated with the `key_size` bytes of `key`.
+//
+// Params:
+//  map        - A pointer to the map.
+//  key        - A pointer to the key.
+//  key_size   - The size of the key in bytes.
+//  value_size - Receives the size of the value in bytes; may be NULL.
+//
+// Returns:
+//  A pointer to the value inside the buffer of the map, or NULL if the key is
+//  not found in the map.
+//
+// Remarks:
+//  The key is hashed once and only the slot its pilot selects is read; the
+//  entry itself is only read when the hash stored in the slot matches.
+//
+// Thread Safety:
+//  The map is never modified, so any number of threads may look keys up
+//  without synchronization.
+const void *StaticMapGet(const StaticMap *const map, const void *const key,
+                         const size_t key_size, size_t *const value_size) {
+  if (map == NULL || map->header == NULL || key == NULL) return NULL;
+
+  const StaticMapHeader *const header = map->header;
+  const uint64_t hash = (uint64_t)HashBytes(key, key_size, header->seed);
+  const uint16_t pilot =
+      map->pilots[_STATICMAP_BUCKET(hash, header->bucket_count)];
+  const StaticMapSlot *const slot =
+      &map->slots[_STATICMAP_SLOT(hash, pilot, header->slot_count)];
+  if (slot->hash != hash || slot->offset == STATICMAP_EMPTY_SLOT) return NULL;
+
+  const StaticMapEntry *const entry =
+      (const StaticMapEntry *)(map->data + slot->offset);
+  if (entry->key_size != key_size ||
+      memcmp(entry->data, key, key_size) != 0)
+    return NULL;
+  if (value_size != NULL) *value_size = (size_t)entry->value_size;
+  return entry->data + _STATICMAP_ALIGN(key_size);
+}
+
+// Tests whether the `key_size` bytes of `key` are a key of `map`.
+bool_t StaticMapContains(const StaticMap *const map, const void *const key,
+                         const size_t key_size) {
+  return StaticMapGet(map, key, key_size, NULL) != NULL ? TRUE : FALSE;
+}
@@ -0,0 +1,483 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "staticmap/staticmap.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "bool.h"
+#include "map/hash.h"
+#include "map/map.h"
+
+// Marks a slot that no key has been placed into yet during a build.
+#define STATICMAP_FREE_SLOT SIZE_MAX
+
+// The state of a build: the input pairs and the scratch arrays the pilot
+// search runs on.
+//
+// Attributes:
+//  keys, key_sizes, values, value_sizes, n - the input pairs.
+//  bucket_count, slot_count - the shape of the map being built.
+//  hashes       - the hash of every key under the current seed.
+//  order        - the key indices grouped by bucket.
+//  bucket_start - the start of every bucket inside `order`, plus the end.
+//  buckets      - the bucket indices, largest bucket first.
+//  pilots       - the pilot found for every bucket.
+//  slot_keys    - the key index placed into every slot, or
+//                 `STATICMAP_FREE_SLOT`.
+//  taken        - one bit per slot telling whether a key was placed into it;
+//                 the pilot search only reads this compact copy of
+//                 `slot_keys`, which stays in cache far longer.
+//  positions    - the slots of the keys of the bucket being placed.
+typedef struct StaticMapBuilder {
+  const void* const* keys;
+  const size_t* key_sizes;
+  const void* const* values;
+  const size_t* value_sizes;
+  size_t n;
+  size_t bucket_count;
+  size_t slot_count;
+  uint64_t* hashes;
+  size_t* order;
+  size_t* bucket_start;
+  size_t* buckets;
+  uint16_t* pilots;
+  size_t* slot_keys;
+  uint64_t* taken;
+  size_t* positions;
+} StaticMapBuilder;
+
+// The outcome of one attempt to place every key under a seed.
+typedef enum StaticMapPlacement {
+  kStaticMapPlaced,
+  kStaticMapRetry,
+  kStaticMapDuplicate,
+  kStaticMapFailed
+} StaticMapPlacement;
+
+// Groups the keys of `builder` by bucket under its current `hashes` and orders
+// the buckets from the largest to the smallest, so the buckets that are the
+// hardest to place go first while the table is still empty.
+//
+// Returns:
+//  The size of the largest bucket, or `0` on allocation failure.
+static size_t SortStaticMapBuckets(StaticMapBuilder* const builder) {
+  const size_t bucket_count = builder->bucket_count;
+  size_t* const start = builder->bucket_start;
+  memset(start, 0, (bucket_count + 1) * sizeof(size_t));
+  for (size_t i = 0; i < builder->n; ++i)
+    ++start[_STATICMAP_BUCKET(builder->hashes[i], bucket_count) + 1];
+
+  size_t max_size = 1;
+  for (size_t b = 0; b < bucket_count; ++b) {
+    if (start[b + 1] > max_size) max_size = start[b + 1];
+    start[b + 1] += start[b];
+  }
+
+  // `buckets` serves as the fill cursor of every bucket first.
+  memcpy(builder->buckets, start, bucket_count * sizeof(size_t));
+  for (size_t i = 0; i < builder->n; ++i) {
+    const size_t b = _STATICMAP_BUCKET(builder->hashes[i], bucket_count);
+    builder->order[builder->buckets[b]++] = i;
+  }
+
+  // Counting sort of the buckets by decreasing size.
+  size_t* by_size;
+  if ((by_size = (size_t*)calloc(max_size + 2, sizeof(size_t))) == NULL)
+    return 0;
+  for (size_t b = 0; b < bucket_count; ++b)
+    ++by_size[max_size - (start[b + 1] - start[b]) + 1];
+  for (size_t s = 0; s <= max_size; ++s) by_size[s + 1] += by_size[s];
+  for (size_t b = 0; b < bucket_count; ++b)
+    builder->buckets[by_size[max_size - (start[b + 1] - start[b])]++] = b;
+  free(by_size);
+  return max_size;
+}
+
+// Checks the keys of a bucket for pairs sharing their full hash; no pilot can
+// separate them.
+static StaticMapPlacement CheckStaticMapBucket(
+    const StaticMapBuilder* const builder, const size_t* const keys,
+    const size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    for (size_t j = i + 1; j < size; ++j) {
+      const size_t a = keys[i];
+      const size_t b = keys[j];
+      if (builder->hashes[a] != builder->hashes[b]) continue;
+      if (builder->key_sizes[a] == builder->key_sizes[b] &&
+          memcmp(builder->keys[a], builder->keys[b], builder->key_sizes[a]) ==
+              0)
+        return kStaticMapDuplicate;
+      return kStaticMapRetry;
+    }
+  }
+  return kStaticMapPlaced;
+}
+
+// Searches the pilot of every bucket of `builder` under `seed`.
+static StaticMapPlacement PlaceStaticMapKeys(StaticMapBuilder* const builder,
+                                             const uint64_t seed) {
+  for (size_t i = 0; i < builder->n; ++i) {
+    builder->hashes[i] = (uint64_t)HashBytes(builder->keys[i],
+                                             builder->key_sizes[i], seed);
+  }
+  const size_t max_size = SortStaticMapBuckets(builder);
+  if (max_size == 0) return kStaticMapFailed;
+  free(builder->positions);
+  if ((builder->positions = (size_t*)malloc(max_size * sizeof(size_t))) ==
+      NULL)
+    return kStaticMapFailed;
+  for (size_t s = 0; s < builder->slot_count; ++s)
+    builder->slot_keys[s] = STATICMAP_FREE_SLOT;
+  memset(builder->taken, 0,
+         ((builder->slot_count + 0x3F) >> 0x06) * sizeof(uint64_t));
+
+  const size_t slot_count = builder->slot_count;
+  size_t* const positions = builder->positions;
+  uint64_t* const taken = builder->taken;
+  for (size_t k = 0; k < builder->bucket_count; ++k) {
+    const size_t b = builder->buckets[k];
+    const size_t* const keys = builder->order + builder->bucket_start[b];
+    const size_t size = builder->bucket_start[b + 1] - builder->bucket_start[b];
+    // Buckets are sorted by size, so the remaining ones are all empty.
+    if (size == 0) break;
+
+    const StaticMapPlacement check = CheckStaticMapBucket(builder, keys, size);
+    if (check != kStaticMapPlaced) return check;
+
+    size_t pilot = 0;
+    for (; pilot <= STATICMAP_MAX_PILOT; ++pilot) {
+      size_t placed = 0;
+      for (; placed < size; ++placed) {
+        const size_t slot = _STATICMAP_SLOT(builder->hashes[keys[placed]],
+                                            pilot, slot_count);
+        if ((taken[slot >> 0x06] >> (slot & 0x3F)) & 1) break;
+        size_t j = 0;
+        while (j < placed && positions[j] != slot) ++j;
+        if (j < placed) break;
+        positions[placed] = slot;
+      }
+      if (placed == size) break;
+    }
+    if (pilot > STATICMAP_MAX_PILOT) return kStaticMapRetry;
+
+    builder->pilots[b] = (uint16_t)pilot;
+    for (size_t i = 0; i < size; ++i) {
+      taken[positions[i] >> 0x06] |= (uint64_t)1 << (positions[i] & 0x3F);
+      builder->slot_keys[positions[i]] = keys[i];
+    }
+  }
+  return kStaticMapPlaced;
+}
+
+// Lays the placed keys of `builder` out into a new buffer for `map`.
+static bool_t WriteStaticMap(StaticMap* const map,
+                             const StaticMapBuilder* const builder,
+                             const uint64_t seed) {
+  const uint64_t pilots_offset = _STATICMAP_ALIGN(sizeof(StaticMapHeader));
+  const uint64_t slots_offset = _STATICMAP_ALIGN(
+      pilots_offset + builder->bucket_count * sizeof(uint16_t));
+  const uint64_t entries_offset =
+      slots_offset + builder->slot_count * sizeof(StaticMapSlot);
+  uint64_t size = entries_offset;
+  for (size_t i = 0; i < builder->n; ++i) {
+    size += sizeof(StaticMapEntry) + _STATICMAP_ALIGN(builder->key_sizes[i]) +
+            _STATICMAP_ALIGN(builder->value_sizes[i]);
+  }
+
+  unsigned char* data;
+  if ((data = (unsigned char*)calloc(1, size)) == NULL) {
+    fprintf(stderr, "StaticMapBuild: failed to allocate %llu bytes\n",
+            (unsigned long long)size);
+    return FALSE;
+  }
+
+  StaticMapHeader* const header = (StaticMapHeader*)data;
+  header->magic = STATICMAP_MAGIC;
+  header->seed = seed;
+  header->count = builder->n;
+  header->bucket_count = builder->bucket_count;
+  header->slot_count = builder->slot_count;
+  header->pilots_offset = pilots_offset;
+  header->slots_offset = slots_offset;
+  header->entries_offset = entries_offset;
+  header->size = size;
+  memcpy(data + pilots_offset, builder->pilots,
+         builder->bucket_count * sizeof(uint16_t));
+
+  // Entries follow the slot order so that a traversal reads them in sequence.
+  StaticMapSlot* const slots = (StaticMapSlot*)(data + slots_offset);
+  uint64_t offset = entries_offset;
+  for (size_t s = 0; s < builder->slot_count; ++s) {
+    const size_t i = builder->slot_keys[s];
+    if (i == STATICMAP_FREE_SLOT) {
+      slots[s].hash = 0;
+      slots[s].offset = STATICMAP_EMPTY_SLOT;
+      continue;
+    }
+    slots[s].hash = builder->hashes[i];
+    slots[s].offset = offset;
+
+    StaticMapEntry* const entry = (StaticMapEntry*)(data + offset);
+    entry->key_size = builder->key_sizes[i];
+    entry->value_size = builder->value_sizes[i];
+    memcpy(entry->data, builder->keys[i], builder->key_sizes[i]);
+    memcpy(entry->data + _STATICMAP_ALIGN(builder->key_sizes[i]),
+           builder->values[i], builder->value_sizes[i]);
+    offset += sizeof(StaticMapEntry) + _STATICMAP_ALIGN(builder->key_sizes[i]) +
+              _STATICMAP_ALIGN(builder->value_sizes[i]);
+  }
+
+  map->data = data;
+  map->size = size;
+  map->header = header;
+  map->pilots = (const uint16_t*)(data + pilots_offset);
+  map->slots = slots;
+  map->owns_data = TRUE;
+  return TRUE;
+}
+
+// Releases the scratch arrays of `builder`.
+static void FreeStaticMapBuilder(StaticMapBuilder* const builder) {
+  free(builder->hashes);
+  free(builder->order);
+  free(builder->bucket_start);
+  free(builder->buckets);
+  free(builder->pilots);
+  free(builder->slot_keys);
+  free(builder->taken);
+  free(builder->positions);
+}
+
+// Builds a `StaticMap` holding copies of `n` key-value pairs.
+//
+// Params:
+//  map         - A pointer to the `StaticMap` to be built.
+//  keys        - An array of `n` pointers to the keys.
+//  key_sizes   - An array of the `n` key sizes in bytes.
+//  values      - An array of `n` pointers to the values.
+//  value_sizes - An array of the `n` value sizes in bytes.
+//  n           - The number of key-value pairs.
+//
+// Returns:
+//  TRUE on success.  FALSE if an argument is NULL, a key appears twice, an
+//  allocation failed or no perfect hash function was found within
+//  `STATICMAP_MAX_ATTEMPTS` seeds; `map->data` is left NULL then.
+//
+// Remarks:
+//  Keys are hashed and compared byte-wise, by `HashBytes()` and `memcmp()`.
+bool_t StaticMapBuild(StaticMap* const map, const void* const* keys,
+                      const size_t* key_sizes, const void* const* values,
+                      const size_t* value_sizes, const size_t n) {
+  if (map == NULL) return FALSE;
+  memset(map, 0, sizeof(StaticMap));
+  if (n != 0 && (keys == NULL || key_sizes == NULL || values == NULL ||
+                 value_sizes == NULL))
+    return FALSE;
+
+  StaticMapBuilder builder;
+  memset(&builder, 0, sizeof(StaticMapBuilder));
+  builder.keys = keys;
+  builder.key_sizes = key_sizes;
+  builder.values = values;
+  builder.value_sizes = value_sizes;
+  builder.n = n;
+  builder.bucket_count = n / STATICMAP_BUCKET_LOAD + 2;
+  builder.slot_count =
+      n * STATICMAP_LOAD_DENOMINATOR / STATICMAP_LOAD_NUMERATOR + 1;
+  builder.hashes = (uint64_t*)malloc((n + 1) * sizeof(uint64_t));
+  builder.order = (size_t*)malloc((n + 1) * sizeof(size_t));
+  builder.bucket_start =
+      (size_t*)malloc((builder.bucket_count + 1) * sizeof(size_t));
+  builder.buckets = (size_t*)malloc(builder.bucket_count * sizeof(size_t));
+  builder.pilots = (uint16_t*)calloc(builder.bucket_count, sizeof(uint16_t));
+  builder.slot_keys = (size_t*)malloc(builder.slot_count * sizeof(size_t));
+  builder.taken = (uint64_t*)malloc(((builder.slot_count + 0x3F) >> 0x06) *
+                                    sizeof(uint64_t));
+  if (builder.hashes == NULL || builder.order == NULL ||
+      builder.bucket_start == NULL || builder.buckets == NULL ||
+      builder.pilots == NULL || builder.slot_keys == NULL ||
+      builder.taken == NULL) {
+    fprintf(stderr, "StaticMapBuild: failed to allocate the builder for: %zu\n",
+            n);
+    FreeStaticMapBuilder(&builder);
+    return FALSE;
+  }
+
+  StaticMapPlacement placement = kStaticMapRetry;
+  uint64_t seed = 0;
+  for (uint64_t attempt = 0;
+       attempt < STATICMAP_MAX_ATTEMPTS && placement == kStaticMapRetry;
+       ++attempt) {
+    seed = (uint64_t)MapMixHash((hash_t)attempt + 1);
+    placement = PlaceStaticMapKeys(&builder, seed);
+  }
+
+  bool_t built = FALSE;
+  switch (placement) {
+    case kStaticMapPlaced:
+      built = WriteStaticMap(map, &builder, seed);
+      break;
+    case kStaticMapRetry:
+      fprintf(stderr, "StaticMapBuild: no perfect hash found for: %zu keys\n",
+              n);
+      break;
+    case kStaticMapDuplicate:
+      fprintf(stderr, "StaticMapBuild: duplicate key\n");
+      break;
+    case kStaticMapFailed:
+      fprintf(stderr, "StaticMapBuild: failed to allocate the builder\n");
+      break;
+  }
+
+  FreeStaticMapBuilder(&builder);
+  return built;
+}
+
+// Collects the entries of the `capacity` buckets of `buckets` into the arrays
+// handed to `StaticMapBuild()`, starting at index `n`.
+//
+// Returns:
+//  The index following the last entry collected.
+static size_t CollectStaticMapEntries(MapEntry** const buckets,
+                                      const size_t capacity,
+                                      const void** const keys,
+                                      size_t* const key_sizes,
+                                      const void** const values,
+                                      size_t* const value_sizes, size_t n) {
+  for (size_t i = 0; i < capacity; ++i) {
+    for (const MapEntry* entry = buckets[i]; entry != NULL;
+         entry = entry->next) {
+      keys[n] = entry->key;
+      key_sizes[n] = entry->key_size;
+      values[n] = entry->value;
+      value_sizes[n] = entry->value_size;
+      ++n;
+    }
+  }
+  return n;
+}
+
+// Builds a `StaticMap` holding copies of the entries of `source`.
+//
+// Remarks:
+//  Every key is taken with the `key_size` it was inserted with, so it must be
+//  looked up with the same number of bytes.  The read lock of `source` is held
+//  while the map is built.
+bool_t StaticMapBuildFromMap(StaticMap* const map, Map* const source) {
+  if (map == NULL || source == NULL || source->buckets == NULL) return FALSE;
+
+  pthread_rwlock_rdlock(&source->lock);
+
+  const size_t count = source->size + 1;
+  const void** keys = (const void**)malloc(count * sizeof(void*));
+  size_t* key_sizes = (size_t*)malloc(count * sizeof(size_t));
+  const void** values = (const void**)malloc(count * sizeof(void*));
+  size_t* value_sizes = (size_t*)malloc(count * sizeof(size_t));
+  bool_t built = FALSE;
+  if (keys == NULL || key_sizes == NULL || values == NULL ||
+      value_sizes == NULL) {
+    fprintf(stderr, "StaticMapBuildFromMap: failed to allocate %zu entries\n",
+            source->size);
+  } else {
+    size_t n = CollectStaticMapEntries(source->buckets, source->capacity, keys,
+                                       key_sizes, values, value_sizes, 0);
+    if (source->old_buckets != NULL) {
+      n = CollectStaticMapEntries(source->old_buckets, source->old_capacity,
+                                  keys, key_sizes, values, value_sizes, n);
+    }
+    built = StaticMapBuild(map, keys, key_sizes, values, value_sizes, n);
+  }
+
+  pthread_rwlock_unlock(&source->lock);
+  free(value_sizes);
+  free(values);
+  free(key_sizes);
+  free(keys);
+  return built;
+}
+
+// Opens a `StaticMap` over the `size` bytes of `data`, as produced by a build,
+// without copying them.  `data` must stay valid, e.g. mapped, until the map is
+// freed, and must be aligned to `STATICMAP_ALIGNMENT`.
+//
+// Returns:
+//  TRUE on success, or FALSE if the header of `data` does not describe a valid
+//  map of `size` bytes.  Only the header is validated, so `data` must come
+//  from a trusted source.
+bool_t StaticMapOpen(StaticMap* const map, const void* const data,
+                     const size_t size) {
+  if (map == NULL) return FALSE;
+  memset(map, 0, sizeof(StaticMap));
+  if (data == NULL || size < sizeof(StaticMapHeader) ||
+      ((uintptr_t)data & (STATICMAP_ALIGNMENT - 1)) != 0)
+    return FALSE;
+
+  const StaticMapHeader* const header = (const StaticMapHeader*)data;
+  if (header->magic != STATICMAP_MAGIC || header->size != size ||
+      header->bucket_count == 0 || header->slot_count == 0 ||
+      header->pilots_offset < sizeof(StaticMapHeader) ||
+      header->pilots_offset + header->bucket_count * sizeof(uint16_t) >
+          header->slots_offset ||
+      (header->slots_offset & (STATICMAP_ALIGNMENT - 1)) != 0 ||
+      header->slots_offset + header->slot_count * sizeof(StaticMapSlot) !=
+          header->entries_offset ||
+      header->entries_offset > size) {
+    fprintf(stderr, "StaticMapOpen: invalid map of size: %zu\n", size);
+    return FALSE;
+  }
+
+  map->data = (const unsigned char*)data;
+  map->size = size;
+  map->header = header;
+  map->pilots = (const uint16_t*)(map->data + header->pilots_offset);
+  map->slots = (const StaticMapSlot*)(map->data + header->slots_offset);
+  map->owns_data = FALSE;
+  return TRUE;
+}
+
+// Returns the number of entries of `map`.
+size_t StaticMapSize(const StaticMap* const map) {
+  if (map == NULL || map->header == NULL) return 0;
+  return (size_t)map->header->count;
+}
+
+// Frees up a `StaticMap` instance, releasing its buffer unless it was opened
+// with `StaticMapOpen()`.
+void StaticMapFree(StaticMap* const map) {
+  if (map == NULL) return;
+
+  if (map->owns_data == TRUE) free((void*)map->data);
+  memset(map, 0, sizeof(StaticMap));
+}
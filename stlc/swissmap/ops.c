@@ -0,0 +1,228 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "swissmap/ops.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bool.h"
+#include "swissmap/swissmap.h"
+
+// Returns the index of the slot holding `key` or `map->capacity` if `key` is
+// not present.  If `free_index` is not NULL it receives the first empty or
+// deleted slot of the probe sequence, which is where `_SwissMapPlace()` would
+// put `key`, or `map->capacity` if the probe met none.
+static size_t FindSwissMapSlot(const SwissMap *const map, const void *key,
+                               const hash_t hash, size_t *const free_index) {
+  const size_t group_mask = map->capacity / SWISSMAP_GROUP_WIDTH - 1;
+  const int8_t h2 = _SWISSMAP_H2(hash);
+  size_t group = _SWISSMAP_H1(map, hash);
+  if (free_index != NULL) *free_index = map->capacity;
+  for (size_t step = 1; step <= group_mask + 1; ++step) {
+    const int8_t *const ctrl = map->ctrl + group * SWISSMAP_GROUP_WIDTH;
+    for (uint32_t match = _SwissMapMatch(ctrl, h2); match != 0;
+         match &= match - 1) {
+      const size_t index =
+          group * SWISSMAP_GROUP_WIDTH + (size_t)__builtin_ctz(match);
+      const SwissMapSlot *const slot = &map->slots[index];
+      if (slot->hash == hash && map->key_eq_func(slot->data, key) == TRUE)
+        return index;
+    }
+    if (free_index != NULL && *free_index == map->capacity) {
+      const uint32_t free_mask = _SwissMapMatchEmptyOrDeleted(ctrl);
+      if (free_mask != 0) {
+        *free_index =
+            group * SWISSMAP_GROUP_WIDTH + (size_t)__builtin_ctz(free_mask);
+      }
+    }
+    // A group with an empty slot never overflowed, so the key can not live
+    // further down the probe sequence.
+    if (_SwissMapMatchEmpty(ctrl) != 0) break;
+    group = (group + step) & group_mask;
+  }
+  return map->capacity;
+}
+
+// Insert a new key-value pair into the swiss map.
+//
+// Args:
+//  map        - A pointer to the map to insert the key-value pair into.
+//  key        - A pointer to the key to insert.
+//  key_size   - The size of the key in bytes.
+//  value      - A pointer to the value to insert.
+//  value_size - The size of the value in bytes.
+//
+// Remarks:
+//  If the map, key, or value pointers are NULL, this function will immediately
+//  return without doing anything.  If a key already exists in the map, its
+//  value will be replaced with the new value.  The existing key is searched
+//  for and the insertion slot is picked in the same group-wise probe, unless
+//  the table has to be rebuilt first, in which case the slot is probed for
+//  again.  A new key is not inserted if the table is full and cannot grow.
+//
+// Thread Safety:
+//  This function locks the mutex associated with the map.
+void SwissMapInsert(SwissMap *const map, const void *const key,
+                    const size_t key_size, const void *const value,
+                    const size_t value_size) {
+  if (map == NULL || map->slots == NULL || key == NULL || value == NULL)
+    return;
+
+  const hash_t hash = map->hash_func(key);
+  pthread_mutex_lock(&(map->mutex));
+
+  size_t free_index;
+  const size_t index = FindSwissMapSlot(map, key, hash, &free_index);
+  if (index != map->capacity) {
+    SwissMapSlot *const slot = &map->slots[index];
+    const size_t value_offset = _SWISSMAP_VALUE_OFFSET(slot->key_size);
+    unsigned char *data =
+        (unsigned char *)realloc(slot->data, value_offset + value_size);
+    if (data == NULL) {
+      fprintf(stderr,
+              "SwissMapInsert: failed to allocate value for value_size: %zu\n",
+              value_size);
+      pthread_mutex_unlock(&(map->mutex));
+      return;
+    }
+    memcpy(data + value_offset, value, value_size);
+    slot->data = data;
+    pthread_mutex_unlock(&(map->mutex));
+    return;
+  }
+
+  if ((map->size + map->tombstones + 1) * SWISSMAP_MAX_LOAD_DENOMINATOR >
+      map->capacity * SWISSMAP_MAX_LOAD_NUMERATOR) {
+    // Mostly tombstones: rebuilding at the same capacity is enough to make
+    // room.  Otherwise double the table.
+    const bool_t grow = (map->size + 1) * 2 * SWISSMAP_MAX_LOAD_DENOMINATOR >
+                        map->capacity * SWISSMAP_MAX_LOAD_NUMERATOR;
+    // Placing the entry over the load limit could fill the table, and a full
+    // table never ends a probe.
+    if (_SwissMapReallocLocked(
+            map, grow == TRUE ? map->capacity << 1 : map->capacity) == FALSE) {
+      pthread_mutex_unlock(&(map->mutex));
+      return;
+    }
+    // The slots moved, so the free slot found by the lookup is stale.
+    free_index = map->capacity;
+  }
+
+  const size_t value_offset = _SWISSMAP_VALUE_OFFSET(key_size);
+  unsigned char *data = (unsigned char *)malloc(value_offset + value_size);
+  if (data == NULL) {
+    fprintf(stderr,
+            "SwissMapInsert: failed to allocate entry for key_size: %zu, "
+            "value_size: %zu\n",
+            key_size, value_size);
+    pthread_mutex_unlock(&(map->mutex));
+    return;
+  }
+  memcpy(data, key, key_size);
+  memcpy(data + value_offset, value, value_size);
+
+  if (free_index == map->capacity) {
+    free_index = _SwissMapPlace(map, hash);
+  } else {
+    if (map->ctrl[free_index] == SWISSMAP_CTRL_DELETED) --(map->tombstones);
+    map->ctrl[free_index] = _SWISSMAP_H2(hash);
+  }
+  SwissMapSlot *const slot = &map->slots[free_index];
+  slot->hash = hash;
+  slot->data = data;
+  slot->key_size = key_size;
+  ++(map->size);
+
+  pthread_mutex_unlock(&(map->mutex));
+}
+
+// Retrieve the value associated with the given key in the swiss map.
+//
+// Returns:
+//  A pointer to the value associated with the key, or NULL if the key is not
+//  found in the map.
+//
+// Remarks:
+//  Each probe step compares the fingerprint of `key` against a whole group of
+//  control bytes and only dereferences slots whose fingerprint matches.  The
+//  probe stops at the first group that has an empty control byte.  This
+//  function locks the mutex associated with the map.
+void *SwissMapGet(SwissMap *const map, const void *key) {
+  if (map == NULL || map->slots == NULL || key == NULL) return NULL;
+
+  const hash_t hash = map->hash_func(key);
+  pthread_mutex_lock(&(map->mutex));
+
+  void *value = NULL;
+  const size_t index = FindSwissMapSlot(map, key, hash, NULL);
+  if (index != map->capacity) {
+    value = map->slots[index].data +
+            _SWISSMAP_VALUE_OFFSET(map->slots[index].key_size);
+  }
+
+  pthread_mutex_unlock(&(map->mutex));
+  return value;
+}
+
+// Remove an entry from the swiss map with the given key.
+//
+// Effects:
+//  * Removes an entry from the map with the given key, if it exists.
+//  * Marks the slot empty when its group still has an empty slot, or leaves a
+//    tombstone otherwise so probes passing through the group keep going.
+//  * Frees the memory used by the removed entry.
+void SwissMapRemove(SwissMap *const map, const void *key) {
+  if (map == NULL || map->slots == NULL || key == NULL) return;
+
+  const hash_t hash = map->hash_func(key);
+  pthread_mutex_lock(&(map->mutex));
+
+  const size_t index = FindSwissMapSlot(map, key, hash, NULL);
+  if (index == map->capacity) {
+    pthread_mutex_unlock(&(map->mutex));
+    return;
+  }
+  free(map->slots[index].data);
+
+  const int8_t *const group =
+      map->ctrl + (index & ~(size_t)(SWISSMAP_GROUP_WIDTH - 1));
+  if (_SwissMapMatchEmpty(group) != 0) {
+    map->ctrl[index] = SWISSMAP_CTRL_EMPTY;
+  } else {
+    map->ctrl[index] = SWISSMAP_CTRL_DELETED;
+    ++(map->tombstones);
+  }
+  --(map->size);
+
+  pthread_mutex_unlock(&(map->mutex));
+}
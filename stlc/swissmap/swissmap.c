@@ -0,0 +1,277 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "swissmap/swissmap.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Rounds `capacity` up to the next power of two that is at least
+// `SWISSMAP_GROUP_WIDTH`.
+static size_t ComputeSwissMapCapacity(const size_t capacity) {
+  size_t result = SWISSMAP_GROUP_WIDTH;
+  while (result < capacity) result <<= 1;
+  return result;
+}
+
+#if defined(__SSE2__)
+uint32_t _SwissMapMatch(const int8_t* const ctrl, const int8_t h2) {
+  const __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+  return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), group));
+}
+
+uint32_t _SwissMapMatchEmpty(const int8_t* const ctrl) {
+  return _SwissMapMatch(ctrl, SWISSMAP_CTRL_EMPTY);
+}
+
+uint32_t _SwissMapMatchEmptyOrDeleted(const int8_t* const ctrl) {
+  // Both `SWISSMAP_CTRL_EMPTY` and `SWISSMAP_CTRL_DELETED` have their sign bit
+  // set, which is exactly what `movemask` gathers.
+  return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)ctrl));
+}
+#else
+// The SWAR fallback loads the group as two 64-bit words and computes one high
+// bit per control byte without any carry crossing byte boundaries, so every
+// mask is exact.
+#define SWISSMAP_SWAR_LSB ((uint64_t)0x0101010101010101ULL)
+#define SWISSMAP_SWAR_MSB ((uint64_t)0x8080808080808080ULL)
+
+// Loads the 8 control bytes at `ctrl` with control byte `i` in byte `i` of the
+// word, counted from the least significant one.
+static uint64_t LoadSwissMapWord(const int8_t* const ctrl) {
+  uint64_t word;
+  memcpy(&word, ctrl, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  word = __builtin_bswap64(word);
+#endif
+  return word;
+}
+
+// Packs the high bit of every byte of `word`, which must be the only bits
+// set, into bit `i` of the result for byte `i`.
+static uint32_t PackSwissMapWord(const uint64_t word) {
+  return (uint32_t)((((word >> 0x07) * (uint64_t)0x0102040810204080ULL)) >>
+                    0x38);
+}
+
+// Sets the high bit of every byte of `word` that is zero.
+static uint64_t ZeroBytesOfSwissMapWord(const uint64_t word) {
+  const uint64_t low = ~SWISSMAP_SWAR_MSB;
+  return ~(((word & low) + low) | word) & SWISSMAP_SWAR_MSB;
+}
+
+uint32_t _SwissMapMatch(const int8_t* const ctrl, const int8_t h2) {
+  const uint64_t pattern = SWISSMAP_SWAR_LSB * (uint8_t)h2;
+  return PackSwissMapWord(
+             ZeroBytesOfSwissMapWord(LoadSwissMapWord(ctrl) ^ pattern)) |
+         PackSwissMapWord(ZeroBytesOfSwissMapWord(
+             LoadSwissMapWord(ctrl + sizeof(uint64_t)) ^ pattern))
+             << 0x08;
+}
+
+uint32_t _SwissMapMatchEmpty(const int8_t* const ctrl) {
+  // `SWISSMAP_CTRL_EMPTY` is the only control byte with its sign bit set and
+  // the bit below it clear.
+  const uint64_t low = LoadSwissMapWord(ctrl);
+  const uint64_t high = LoadSwissMapWord(ctrl + sizeof(uint64_t));
+  return PackSwissMapWord(low & ~(low << 0x01) & SWISSMAP_SWAR_MSB) |
+         PackSwissMapWord(high & ~(high << 0x01) & SWISSMAP_SWAR_MSB) << 0x08;
+}
+
+uint32_t _SwissMapMatchEmptyOrDeleted(const int8_t* const ctrl) {
+  return PackSwissMapWord(LoadSwissMapWord(ctrl) & SWISSMAP_SWAR_MSB) |
+         PackSwissMapWord(LoadSwissMapWord(ctrl + sizeof(uint64_t)) &
+                          SWISSMAP_SWAR_MSB)
+             << 0x08;
+}
+#endif
+
+// Places an entry known to be absent from `map` into the first free slot of
+// its probe sequence and returns the slot index.
+//
+// This function is meant to be protected inside `swissmap` module.
+size_t _SwissMapPlace(SwissMap* const map, const hash_t hash) {
+  const size_t group_mask = map->capacity / SWISSMAP_GROUP_WIDTH - 1;
+  size_t group = _SWISSMAP_H1(map, hash);
+  for (size_t step = 1;; ++step) {
+    const int8_t* const ctrl = map->ctrl + group * SWISSMAP_GROUP_WIDTH;
+    const uint32_t free_mask = _SwissMapMatchEmptyOrDeleted(ctrl);
+    if (free_mask != 0) {
+      const size_t index =
+          group * SWISSMAP_GROUP_WIDTH + (size_t)__builtin_ctz(free_mask);
+      if (map->ctrl[index] == SWISSMAP_CTRL_DELETED) --(map->tombstones);
+      map->ctrl[index] = _SWISSMAP_H2(hash);
+      return index;
+    }
+    // Triangular probing visits every group exactly once when the number of
+    // groups is a power of two.
+    group = (group + step) & group_mask;
+  }
+}
+
+// Initializes a new instance of the `SwissMap` data structure.
+//
+// Params:
+//  map         - A pointer to the `SwissMap` to be initialized.
+//  capacity    - The minimum number of slots to allocate; it is rounded up to
+//                the next power of two and to at least `SWISSMAP_GROUP_WIDTH`.
+//  hash_func   - A pointer to the hash function used to calculate hash codes
+//                for keys.
+//  key_eq_func - A pointer to the key comparison function used to compare keys
+//                for equality.
+//
+// Remarks:
+//  If the pointer passed to `map` is NULL, this function returns immediately
+//  without doing anything.  On allocation failure `map->slots` is left NULL.
+void SwissMapInit(SwissMap* const map, const size_t capacity,
+                  hash_f hash_func, key_eq_f key_eq_func) {
+  if (map == NULL) return;
+
+  map->hash_func = hash_func;
+  map->key_eq_func = key_eq_func;
+  map->size = 0;
+  map->tombstones = 0;
+  map->capacity = ComputeSwissMapCapacity(capacity);
+  map->ctrl = (int8_t*)malloc(map->capacity);
+  map->slots = (SwissMapSlot*)malloc(map->capacity * sizeof(SwissMapSlot));
+  if (map->ctrl == NULL || map->slots == NULL) {
+    fprintf(stderr,
+            "SwissMapInit: failed to allocate slots for capacity: %zu\n",
+            map->capacity);
+    free(map->ctrl);
+    free(map->slots);
+    map->ctrl = NULL;
+    map->slots = NULL;
+    map->capacity = 0;
+    return;
+  }
+  memset(map->ctrl, SWISSMAP_CTRL_EMPTY, map->capacity);
+
+  pthread_mutexattr_t mutex_attr;
+  pthread_mutexattr_init(&mutex_attr);
+  pthread_mutexattr_settype(&mutex_attr, PTHREAD_MUTEX_RECURSIVE);
+  if (pthread_mutex_init(&map->mutex, &mutex_attr) != 0) {
+    fprintf(stderr, "SwissMapInit: failed to initialize mutex\n");
+    free(map->ctrl);
+    free(map->slots);
+    map->ctrl = NULL;
+    map->slots = NULL;
+    map->capacity = 0;
+  }
+  pthread_mutexattr_destroy(&mutex_attr);
+}
+
+// Re-allocates the table of `map` to hold `capacity` slots, rounded up to a
+// power of two, re-inserting all the entries and dropping every tombstone.
+// The caller must hold the mutex of `map`.
+//
+// Returns:
+//  `FALSE` if `capacity` slots cannot hold the current entries under the
+//  maximum load factor or could not be allocated, in which case `map` is left
+//  unchanged.
+//
+// This function is meant to be protected inside `swissmap` module.
+bool_t _SwissMapReallocLocked(SwissMap* const map, const size_t capacity) {
+  const size_t new_capacity = ComputeSwissMapCapacity(capacity);
+  if (map->size * SWISSMAP_MAX_LOAD_DENOMINATOR >
+      new_capacity * SWISSMAP_MAX_LOAD_NUMERATOR) {
+    fprintf(stderr, "SwissMapRealloc: capacity %zu too small for size: %zu\n",
+            new_capacity, map->size);
+    return FALSE;
+  }
+
+  int8_t* const new_ctrl = (int8_t*)malloc(new_capacity);
+  SwissMapSlot* const new_slots =
+      (SwissMapSlot*)malloc(new_capacity * sizeof(SwissMapSlot));
+  if (new_ctrl == NULL || new_slots == NULL) {
+    fprintf(stderr,
+            "SwissMapRealloc: failed to allocate slots for capacity: %zu\n",
+            new_capacity);
+    free(new_ctrl);
+    free(new_slots);
+    return FALSE;
+  }
+  memset(new_ctrl, SWISSMAP_CTRL_EMPTY, new_capacity);
+
+  int8_t* const old_ctrl = map->ctrl;
+  SwissMapSlot* const old_slots = map->slots;
+  const size_t old_capacity = map->capacity;
+  map->ctrl = new_ctrl;
+  map->slots = new_slots;
+  map->capacity = new_capacity;
+  map->tombstones = 0;
+  for (size_t i = 0; i < old_capacity; ++i) {
+    if (old_ctrl[i] < 0) continue;
+    map->slots[_SwissMapPlace(map, old_slots[i].hash)] = old_slots[i];
+  }
+  free(old_ctrl);
+  free(old_slots);
+  return TRUE;
+}
+
+// Re-allocates the table of a `SwissMap` to hold `new_capacity` slots (rounded
+// up to a power of two), re-inserting all the entries and dropping every
+// tombstone.
+//
+// Remarks:
+//  The request is ignored if `new_capacity` slots cannot hold the current
+//  entries under the maximum load factor.  This function acquires the map
+//  mutex.
+void SwissMapRealloc(SwissMap* const map, const size_t new_capacity) {
+  if (map == NULL || map->slots == NULL) return;
+
+  pthread_mutex_lock(&map->mutex);
+  _SwissMapReallocLocked(map, new_capacity);
+  pthread_mutex_unlock(&map->mutex);
+}
+
+// Frees up a `SwissMap` instance and the entries associated with it.
+void SwissMapFree(SwissMap* const map) {
+  if (map == NULL || map->slots == NULL) return;
+
+  for (size_t i = 0; i < map->capacity; ++i) {
+    if (map->ctrl[i] >= 0) free(map->slots[i].data);
+  }
+  free(map->ctrl);
+  free(map->slots);
+  map->ctrl = NULL;
+  map->slots = NULL;
+  map->capacity = 0;
+  map->size = 0;
+  map->tombstones = 0;
+  pthread_mutex_destroy(&map->mutex);
+}
@@ -0,0 +1,358 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_TESTS_BTREEMAP_TESTBTREEMAP_HH_
+#define STLC_TESTS_BTREEMAP_TESTBTREEMAP_HH_
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bool.h"
+#include "btreemap/btreemap.h"
+
+static int CompareU64(const void* key1, const void* key2) {
+  const uint64_t a = *(const uint64_t*)key1, b = *(const uint64_t*)key2;
+  return a < b ? -1 : a > b ? 1 : 0;
+}
+
+static int CompareName(const void* key1, const void* key2) {
+  return std::memcmp(key1, key2, 0x10);
+}
+
+class BTreeMapTest : public ::testing::Test {
+ protected:
+  void TearDown() override { BTreeMapFree(&map); }
+
+  // Creates a tree of 8-byte keys and values with nodes of `node_size` bytes.
+  void Init(const size_t node_size = BTREEMAP_NODE_SIZE) {
+    BTreeMapConfig config;
+    BTreeMapConfigInit(&config, sizeof(uint64_t), sizeof(uint64_t),
+                       CompareU64);
+    config.node_size = node_size;
+    BTreeMapInitWithConfig(&map, &config);
+    ASSERT_NE(map.root, nullptr);
+  }
+
+  void Insert(const uint64_t key, const uint64_t value) {
+    BTreeMapInsert(&map, &key, &value);
+  }
+
+  const uint64_t* Get(const uint64_t key) {
+    return (const uint64_t*)BTreeMapGet(&map, &key);
+  }
+
+  static bool_t CollectKey(const void* key, const void* value) {
+    (void)value;
+    keys.push_back(*(const uint64_t*)key);
+    return TRUE;
+  }
+
+  std::vector<uint64_t> Keys() {
+    keys.clear();
+    BTreeMapTraverse(&map, CollectKey);
+    return keys;
+  }
+
+  std::vector<uint64_t> Range(const uint64_t* low, const uint64_t* high) {
+    keys.clear();
+    const size_t visited = BTreeMapRange(&map, low, high, CollectKey);
+    EXPECT_EQ(visited, keys.size());
+    return keys;
+  }
+
+  size_t CountLeaves() {
+    size_t leaves = 0;
+    for (BTreeMapNode* leaf = map.first; leaf != nullptr; leaf = leaf->next)
+      ++leaves;
+    return leaves;
+  }
+
+  static std::vector<uint64_t> keys;
+  BTreeMap map;
+};
+
+std::vector<uint64_t> BTreeMapTest::keys;
+
+TEST_F(BTreeMapTest, SizesNodesToCacheLines) {
+  Init(100);
+  EXPECT_EQ(map.node_size % BTREEMAP_CACHE_LINE, 0u);
+  EXPECT_GE(map.leaf_capacity, (size_t)BTREEMAP_MIN_FANOUT);
+  EXPECT_GE(map.inner_capacity, (size_t)BTREEMAP_MIN_FANOUT);
+  EXPECT_EQ((uintptr_t)map.root % BTREEMAP_CACHE_LINE, 0u);
+  EXPECT_LE(map.values_offset + map.leaf_capacity * map.value_size,
+            map.node_size);
+  EXPECT_LE(map.children_offset + (map.inner_capacity + 1) * sizeof(void*),
+            map.node_size);
+}
+
+TEST_F(BTreeMapTest, TraversesInKeyOrder) {
+  Init();
+  std::vector<uint64_t> expected(10000);
+  std::iota(expected.begin(), expected.end(), 0);
+  std::vector<uint64_t> order = expected;
+  std::shuffle(order.begin(), order.end(), std::mt19937(1));
+  for (const uint64_t key : order) Insert(key, key * 3);
+
+  EXPECT_EQ(BTreeMapSize(&map), 10000u);
+  EXPECT_GT(map.height, 1u);
+  EXPECT_EQ(Keys(), expected);
+  for (uint64_t key = 0; key < 10000; ++key) {
+    ASSERT_NE(Get(key), nullptr);
+    EXPECT_EQ(*Get(key), key * 3);
+  }
+  EXPECT_EQ(Get(10000), nullptr);
+
+  Insert(42, 7);
+  EXPECT_EQ(BTreeMapSize(&map), 10000u);
+  EXPECT_EQ(*Get(42), 7u);
+}
+
+TEST_F(BTreeMapTest, SmallNodesGrowManyLevels) {
+  Init(0);
+  std::vector<uint64_t> order(5000);
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), std::mt19937(2));
+  for (const uint64_t key : order) Insert(key, key);
+
+  EXPECT_GT(map.height, 3u);
+  std::sort(order.begin(), order.end());
+  EXPECT_EQ(Keys(), order);
+}
+
+TEST_F(BTreeMapTest, AscendingInsertsFillLeaves) {
+  Init();
+  const size_t n = 100000;
+  for (uint64_t key = 0; key < n; ++key) Insert(key, key);
+
+  // Every leaf but the last is full.
+  EXPECT_EQ(CountLeaves(), (n + map.leaf_capacity - 1) / map.leaf_capacity);
+  EXPECT_EQ(Keys().size(), n);
+}
+
+TEST_F(BTreeMapTest, ScansRanges) {
+  Init(0);
+  for (uint64_t key = 0; key < 1000; key += 2) Insert(key, key);
+
+  const uint64_t low = 101, high = 121, past = 5000;
+  EXPECT_EQ(Range(&low, &high), (std::vector<uint64_t>{102, 104, 106, 108,
+                                                       110, 112, 114, 116,
+                                                       118, 120}));
+  EXPECT_EQ(Range(&past, nullptr), std::vector<uint64_t>{});
+  EXPECT_EQ(Range(&high, &low), std::vector<uint64_t>{});
+  EXPECT_EQ(Range(nullptr, &low).size(), 51u);
+  EXPECT_EQ(Range(nullptr, nullptr).size(), 500u);
+}
+
+static size_t range_calls;
+
+static bool_t StopAfterThree(const void* key, const void* value) {
+  (void)key;
+  (void)value;
+  return ++range_calls < 3 ? TRUE : FALSE;
+}
+
+TEST_F(BTreeMapTest, RangeStopsOnFalsePredicate) {
+  Init();
+  for (uint64_t key = 0; key < 100; ++key) Insert(key, key);
+  range_calls = 0;
+  EXPECT_EQ(BTreeMapRange(&map, nullptr, nullptr, StopAfterThree), 3u);
+  EXPECT_EQ(range_calls, 3u);
+}
+
+TEST_F(BTreeMapTest, ScansPrefixes) {
+  BTreeMapInit(&map, 0x10, 0, CompareName);
+  const char* names[] = {"cpu.idle", "cpu.user", "disk.read", "cpu.system",
+                         "disk.write", "mem.free", "cpu"};
+  for (const char* name : names) {
+    char key[0x10] = {};
+    std::strncpy(key, name, sizeof(key));
+    BTreeMapInsert(&map, key, nullptr);
+  }
+
+  // Every key starting with "cpu." orders in ["cpu.", "cpu/").
+  char low[0x10] = "cpu.", high[0x10] = "cpu/";
+  std::vector<std::string> found;
+  BTreeMapIterator iterator = BTreeMapSeek(&map, low);
+  const void* key;
+  while (BTreeMapIteratorNext(&iterator, &key, nullptr) == TRUE &&
+         CompareName(key, high) < 0)
+    found.push_back((const char*)key);
+  EXPECT_EQ(found,
+            (std::vector<std::string>{"cpu.idle", "cpu.system", "cpu.user"}));
+}
+
+TEST_F(BTreeMapTest, IteratesFromASeekPosition) {
+  Init(0);
+  for (uint64_t key = 10; key <= 100; key += 10) Insert(key, key + 1);
+
+  const uint64_t start = 35;
+  BTreeMapIterator iterator = BTreeMapSeek(&map, &start);
+  std::vector<uint64_t> seen;
+  const void* key;
+  const void* value;
+  while (BTreeMapIteratorNext(&iterator, &key, &value) == TRUE) {
+    EXPECT_EQ(*(const uint64_t*)value, *(const uint64_t*)key + 1);
+    seen.push_back(*(const uint64_t*)key);
+  }
+  EXPECT_EQ(seen, (std::vector<uint64_t>{40, 50, 60, 70, 80, 90, 100}));
+  EXPECT_EQ(BTreeMapIteratorNext(&iterator, &key, &value), FALSE);
+
+  iterator = BTreeMapSeek(&map, nullptr);
+  ASSERT_EQ(BTreeMapIteratorNext(&iterator, &key, nullptr), TRUE);
+  EXPECT_EQ(*(const uint64_t*)key, 10u);
+}
+
+TEST_F(BTreeMapTest, RemovesAndCollapses) {
+  Init(0);
+  std::vector<uint64_t> order(3000);
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), std::mt19937(3));
+  for (const uint64_t key : order) Insert(key, key);
+  std::shuffle(order.begin(), order.end(), std::mt19937(4));
+
+  const uint64_t missing = 5000;
+  EXPECT_EQ(BTreeMapRemove(&map, &missing), FALSE);
+  for (size_t i = 0; i < order.size(); ++i) {
+    ASSERT_EQ(BTreeMapRemove(&map, &order[i]), TRUE);
+    ASSERT_EQ(BTreeMapRemove(&map, &order[i]), FALSE);
+    if (i % 500 == 0) {
+      std::vector<uint64_t> rest(order.begin() + i + 1, order.end());
+      std::sort(rest.begin(), rest.end());
+      ASSERT_EQ(Keys(), rest);
+    }
+  }
+  EXPECT_EQ(BTreeMapSize(&map), 0u);
+  EXPECT_EQ(map.height, 1u);
+  EXPECT_EQ(map.first, map.root);
+
+  Insert(1, 2);
+  EXPECT_EQ(*Get(1), 2u);
+}
+
+TEST_F(BTreeMapTest, BulkLoadsSortedKeys) {
+  Init();
+  const size_t n = 200000;
+  std::vector<uint64_t> keys(n), values(n);
+  for (size_t i = 0; i < n; ++i) {
+    keys[i] = i * 5;
+    values[i] = i;
+  }
+  ASSERT_EQ(BTreeMapBulkLoad(&map, keys.data(), values.data(), n), TRUE);
+
+  EXPECT_EQ(BTreeMapSize(&map), n);
+  EXPECT_EQ(CountLeaves(), (n + map.leaf_capacity - 1) / map.leaf_capacity);
+  size_t height = 1;
+  for (size_t leaves = CountLeaves(); leaves > 1;
+       leaves = (leaves + map.inner_capacity) / (map.inner_capacity + 1))
+    ++height;
+  EXPECT_EQ(map.height, height);
+  EXPECT_EQ(Keys(), keys);
+  for (size_t i = 0; i < n; i += 97) EXPECT_EQ(*Get(i * 5), i);
+  EXPECT_EQ(Get(3), nullptr);
+
+  // The loaded tree takes inserts and removes like any other.
+  Insert(3, 33);
+  EXPECT_EQ(*Get(3), 33u);
+  EXPECT_EQ(BTreeMapRemove(&map, &keys[10]), TRUE);
+  EXPECT_EQ(BTreeMapSize(&map), n);
+
+  // Only an empty tree can be loaded.
+  EXPECT_EQ(BTreeMapBulkLoad(&map, keys.data(), values.data(), n), FALSE);
+}
+
+TEST_F(BTreeMapTest, BulkLoadRejectsUnsortedKeys) {
+  Init();
+  const uint64_t keys[] = {1, 3, 3, 4};
+  const uint64_t values[] = {0, 0, 0, 0};
+  EXPECT_EQ(BTreeMapBulkLoad(&map, keys, values, 4), FALSE);
+  EXPECT_EQ(BTreeMapSize(&map), 0u);
+  EXPECT_EQ(BTreeMapBulkLoad(&map, keys, values, 0), TRUE);
+  EXPECT_EQ(BTreeMapBulkLoad(&map, keys, values, 2), TRUE);
+  EXPECT_EQ(Keys(), (std::vector<uint64_t>{1, 3}));
+}
+
+TEST_F(BTreeMapTest, MatchesAReferenceUnderRandomOperations) {
+  Init(0);
+  std::mt19937 rng(5);
+  std::map<uint64_t, uint64_t> reference;
+  for (size_t step = 0; step < 50000; ++step) {
+    const uint64_t key = rng() % 2000;
+    if (rng() % 3 == 0) {
+      const bool present = reference.erase(key) != 0;
+      ASSERT_EQ(BTreeMapRemove(&map, &key), present ? TRUE : FALSE);
+    } else {
+      reference[key] = step;
+      Insert(key, step);
+    }
+  }
+
+  ASSERT_EQ(BTreeMapSize(&map), reference.size());
+  std::vector<uint64_t> expected;
+  for (const auto& item : reference) {
+    expected.push_back(item.first);
+    ASSERT_NE(Get(item.first), nullptr);
+    EXPECT_EQ(*Get(item.first), item.second);
+  }
+  EXPECT_EQ(Keys(), expected);
+
+  const uint64_t low = 500, high = 1500;
+  std::vector<uint64_t> in_range;
+  for (const uint64_t key : expected)
+    if (key >= low && key < high) in_range.push_back(key);
+  EXPECT_EQ(Range(&low, &high), in_range);
+}
+
+TEST_F(BTreeMapTest, NullArgs) {
+  BTreeMapInit(nullptr, 8, 8, CompareU64);
+  BTreeMapInit(&map, 0, 8, CompareU64);
+  EXPECT_EQ(map.root, nullptr);
+  BTreeMapInit(&map, 8, 8, nullptr);
+  EXPECT_EQ(map.root, nullptr);
+
+  Init();
+  BTreeMapInsert(&map, nullptr, nullptr);
+  const uint64_t key = 1;
+  BTreeMapInsert(&map, &key, nullptr);
+  BTreeMapTraverse(&map, nullptr);
+  EXPECT_EQ(BTreeMapGet(&map, nullptr), nullptr);
+  EXPECT_EQ(BTreeMapRemove(&map, nullptr), FALSE);
+  EXPECT_EQ(BTreeMapBulkLoad(&map, nullptr, nullptr, 1), FALSE);
+  EXPECT_EQ(BTreeMapSize(&map), 0u);
+  EXPECT_EQ(BTreeMapSize(nullptr), 0u);
+}
+
+#endif  // STLC_TESTS_BTREEMAP_TESTBTREEMAP_HH_
@@ -0,0 +1,220 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_TESTS_EXPIRINGMAP_TESTEXPIRINGMAP_HH_
+#define STLC_TESTS_EXPIRINGMAP_TESTEXPIRINGMAP_HH_
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bool.h"
+#include "expiringmap/expiringmap.h"
+#include "map/map.h"
+
+// An expired entry as reported to the expiry callback.
+struct ExpiredEntry {
+  std::string key;
+  uint64_t deadline;
+};
+
+static void RecordExpiry(const void* key, const size_t key_size,
+                         const void* value, const size_t value_size,
+                         const uint64_t deadline, void* context) {
+  (void)key_size;
+  (void)value;
+  (void)value_size;
+  ((std::vector<ExpiredEntry>*)context)
+      ->push_back({(const char*)key, deadline});
+}
+
+class ExpiringMapTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ExpiringMapConfig config;
+    ExpiringMapConfigInit(&config, Hash, KeyCmp);
+    config.on_expire = RecordExpiry;
+    config.expire_context = &expired;
+    ExpiringMapInitWithConfig(&map, &config);
+  }
+
+  void TearDown() override { ExpiringMapFree(&map); }
+
+  void Put(const char* key, const size_t value, const uint64_t deadline) {
+    ASSERT_EQ(ExpiringMapPut(&map, key, std::strlen(key) + 1, &value,
+                             sizeof(value), deadline),
+              TRUE);
+  }
+
+  const size_t* Get(const char* key, const uint64_t now) {
+    return (const size_t*)ExpiringMapGet(&map, key, std::strlen(key) + 1, now,
+                                         nullptr);
+  }
+
+  ExpiringMap map;
+  std::vector<ExpiredEntry> expired;
+};
+
+TEST_F(ExpiringMapTest, ExpiresEntriesAtTheirDeadline) {
+  Put("a", 1, 5);
+  Put("b", 2, 10);
+  Put("c", 3, 100);
+
+  EXPECT_EQ(ExpiringMapAdvance(&map, 4), 0u);
+  EXPECT_EQ(ExpiringMapAdvance(&map, 9), 1u);
+  ASSERT_EQ(expired.size(), 1u);
+  EXPECT_EQ(expired[0].key, "a");
+  EXPECT_EQ(expired[0].deadline, 5u);
+  EXPECT_EQ(ExpiringMapSize(&map), 2u);
+
+  EXPECT_EQ(ExpiringMapAdvance(&map, 100), 2u);
+  EXPECT_EQ(ExpiringMapSize(&map), 0u);
+  EXPECT_EQ(ExpiringMapAdvance(&map, 50), 0u);
+}
+
+TEST_F(ExpiringMapTest, HidesStaleEntriesBeforeTheyAreReleased) {
+  Put("session", 7, 20);
+  ASSERT_NE(Get("session", 19), nullptr);
+  EXPECT_EQ(*Get("session", 19), 7u);
+  EXPECT_EQ(Get("session", 20), nullptr);
+  EXPECT_EQ(Get("session", 1000), nullptr);
+  EXPECT_EQ(ExpiringMapSize(&map), 1u);
+  EXPECT_TRUE(expired.empty());
+}
+
+TEST_F(ExpiringMapTest, ExtendsAndOverwritesDeadlines) {
+  Put("a", 1, 10);
+  Put("b", 2, 10);
+  EXPECT_EQ(ExpiringMapExpireAt(&map, "a", 2, 5000), TRUE);
+  EXPECT_EQ(ExpiringMapExpireAt(&map, "missing", 8, 5000), FALSE);
+
+  const std::string grown(100, 'g');
+  ASSERT_EQ(ExpiringMapPut(&map, "b", 2, grown.c_str(), grown.size() + 1, 70),
+            TRUE);
+  size_t value_size = 0;
+  const void* value = ExpiringMapGet(&map, "b", 2, 60, &value_size);
+  ASSERT_NE(value, nullptr);
+  EXPECT_EQ(value_size, grown.size() + 1);
+  EXPECT_EQ(std::string((const char*)value), grown);
+
+  EXPECT_EQ(ExpiringMapAdvance(&map, 69), 0u);
+  EXPECT_EQ(ExpiringMapAdvance(&map, 4999), 1u);
+  EXPECT_EQ(ExpiringMapAdvance(&map, 5000), 1u);
+  ASSERT_EQ(expired.size(), 2u);
+  EXPECT_EQ(expired[0].key, "b");
+  EXPECT_EQ(expired[1].key, "a");
+}
+
+TEST_F(ExpiringMapTest, RemovesWithoutCallingTheCallback) {
+  Put("a", 1, 10);
+  EXPECT_EQ(ExpiringMapRemove(&map, "a", 2), TRUE);
+  EXPECT_EQ(ExpiringMapRemove(&map, "a", 2), FALSE);
+  EXPECT_EQ(ExpiringMapAdvance(&map, 100), 0u);
+  EXPECT_TRUE(expired.empty());
+}
+
+TEST_F(ExpiringMapTest, ExpiresPastDeadlinesOnTheNextAdvance) {
+  EXPECT_EQ(ExpiringMapAdvance(&map, 1000), 0u);
+  Put("late", 1, 10);
+  EXPECT_EQ(Get("late", 1000), nullptr);
+  EXPECT_EQ(ExpiringMapAdvance(&map, 1000), 0u);
+  EXPECT_EQ(ExpiringMapAdvance(&map, 1001), 1u);
+}
+
+TEST_F(ExpiringMapTest, SkipsLongIdleStretches) {
+  const uint64_t far = (uint64_t)1 << 40;
+  Put("far", 1, far);
+  Put("near", 2, 3);
+  EXPECT_EQ(ExpiringMapAdvance(&map, far - 1), 1u);
+  EXPECT_EQ(ExpiringMapSize(&map), 1u);
+  EXPECT_EQ(ExpiringMapAdvance(&map, far), 1u);
+  ASSERT_EQ(expired.size(), 2u);
+  EXPECT_EQ(expired[1].deadline, far);
+}
+
+static size_t expiring_traversed;
+
+static bool_t CountExpiringEntry(const void* key, const void* value) {
+  (void)key;
+  (void)value;
+  ++expiring_traversed;
+  return TRUE;
+}
+
+TEST_F(ExpiringMapTest, TraversesLiveEntriesOnly) {
+  Put("a", 1, 10);
+  Put("b", 2, 20);
+  Put("c", 3, 1 << 20);
+  expiring_traversed = 0;
+  ExpiringMapTraverse(&map, 15, CountExpiringEntry);
+  EXPECT_EQ(expiring_traversed, 2u);
+}
+
+TEST_F(ExpiringMapTest, MatchesAReferenceOverRandomDeadlines) {
+  std::mt19937_64 random(42);
+  std::multimap<uint64_t, std::string> reference;
+  char key[32];
+  uint64_t now = 0;
+  for (size_t i = 0; i < 4000; ++i) {
+    // Mix deadlines for every level of the wheel and beyond its span.
+    const uint64_t range = (uint64_t)1 << (random() % 34);
+    const uint64_t deadline = now + 1 + random() % range;
+    std::snprintf(key, sizeof(key), "key%zu", i);
+    Put(key, i, deadline);
+    reference.emplace(deadline, key);
+
+    if (i % 16 == 0) {
+      now += random() % ((uint64_t)1 << (random() % 32));
+      const size_t count = ExpiringMapAdvance(&map, now);
+      size_t reference_count = 0;
+      while (!reference.empty() && reference.begin()->first <= now) {
+        reference.erase(reference.begin());
+        ++reference_count;
+      }
+      ASSERT_EQ(count, reference_count) << "now " << now;
+    }
+  }
+  for (const ExpiredEntry& entry : expired) EXPECT_LE(entry.deadline, now);
+  EXPECT_EQ(ExpiringMapSize(&map), reference.size());
+
+  const size_t remaining = reference.size();
+  const uint64_t last = reference.rbegin()->first;
+  EXPECT_EQ(ExpiringMapAdvance(&map, last - 1),
+            remaining - reference.count(last));
+  EXPECT_EQ(ExpiringMapAdvance(&map, last), reference.count(last));
+  EXPECT_EQ(ExpiringMapSize(&map), 0u);
+}
+
+#endif  // STLC_TESTS_EXPIRINGMAP_TESTEXPIRINGMAP_HH_
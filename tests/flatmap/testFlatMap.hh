@@ -0,0 +1,188 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_TESTS_FLATMAP_TESTFLATMAP_HH_
+#define STLC_TESTS_FLATMAP_TESTFLATMAP_HH_
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+
+#include "bool.h"
+#include "flatmap/flatmap.h"
+#include "map/map.h"
+
+class FlatMapTest : public ::testing::Test {
+ protected:
+  void SetUp() override { FlatMapInit(&map, 0, Hash, KeyCmp); }
+
+  void TearDown() override { FlatMapFree(&map); }
+
+  void Insert(const char* key, const char* value) {
+    FlatMapInsert(&map, key, std::strlen(key) + 1, value,
+                  std::strlen(value) + 1);
+  }
+
+  // Checks that every occupied slot satisfies the Robin Hood invariant: its
+  // `psl` matches the distance from the entry's home slot.
+  void ExpectValidProbeLengths() {
+    const size_t mask = map.capacity - 1;
+    for (size_t i = 0; i < map.capacity; ++i) {
+      const FlatMapSlot& slot = map.slots[i];
+      if (slot.psl == 0) continue;
+      const size_t home = _FLATMAP_HOME_SLOT(&map, slot.hash);
+      EXPECT_EQ(slot.psl, ((i - home) & mask) + 1);
+    }
+  }
+
+ protected:
+  FlatMap map;
+};
+
+TEST_F(FlatMapTest, InitRoundsCapacityToPowerOfTwo) {
+  FlatMap other;
+  FlatMapInit(&other, 100, Hash, KeyCmp);
+  EXPECT_EQ(other.capacity, 128);
+  EXPECT_EQ(other.size, 0);
+  EXPECT_NE(other.slots, nullptr);
+  FlatMapFree(&other);
+
+  EXPECT_EQ(map.capacity, FLATMAP_MIN_CAPACITY);
+}
+
+TEST_F(FlatMapTest, InsertAndGet) {
+  Insert("key1", "value1");
+  Insert("key2", "value2");
+
+  EXPECT_EQ(map.size, 2);
+  EXPECT_STREQ((char*)FlatMapGet(&map, "key1"), "value1");
+  EXPECT_STREQ((char*)FlatMapGet(&map, "key2"), "value2");
+  EXPECT_EQ(FlatMapGet(&map, "key3"), nullptr);
+}
+
+TEST_F(FlatMapTest, InsertOverwritesExistingValue) {
+  Insert("key", "short");
+  Insert("key", "a much longer value than before");
+
+  EXPECT_EQ(map.size, 1);
+  EXPECT_STREQ((char*)FlatMapGet(&map, "key"),
+               "a much longer value than before");
+}
+
+TEST_F(FlatMapTest, AlignsValues) {
+  Insert("k", "value");
+  EXPECT_EQ((uintptr_t)FlatMapGet(&map, "k") % MAP_ENTRY_ALIGNMENT, 0u);
+  Insert("k", "a much longer value than before");
+  EXPECT_EQ((uintptr_t)FlatMapGet(&map, "k") % MAP_ENTRY_ALIGNMENT, 0u);
+  EXPECT_STREQ((char*)FlatMapGet(&map, "k"),
+               "a much longer value than before");
+}
+
+TEST_F(FlatMapTest, GrowsAndKeepsEntries) {
+  char key[32];
+  char value[32];
+  for (int i = 0; i < 1000; ++i) {
+    std::snprintf(key, sizeof(key), "key%d", i);
+    std::snprintf(value, sizeof(value), "value%d", i);
+    Insert(key, value);
+  }
+
+  EXPECT_EQ(map.size, 1000);
+  EXPECT_GE(map.capacity * FLATMAP_MAX_LOAD_NUMERATOR,
+            map.size * FLATMAP_MAX_LOAD_DENOMINATOR);
+  ExpectValidProbeLengths();
+  for (int i = 0; i < 1000; ++i) {
+    std::snprintf(key, sizeof(key), "key%d", i);
+    std::snprintf(value, sizeof(value), "value%d", i);
+    ASSERT_STREQ((char*)FlatMapGet(&map, key), value);
+  }
+}
+
+TEST_F(FlatMapTest, RemoveShiftsClusterBack) {
+  char key[32];
+  for (int i = 0; i < 500; ++i) {
+    std::snprintf(key, sizeof(key), "key%d", i);
+    Insert(key, "value");
+  }
+  for (int i = 0; i < 500; i += 2) {
+    std::snprintf(key, sizeof(key), "key%d", i);
+    FlatMapRemove(&map, key);
+  }
+
+  EXPECT_EQ(map.size, 250);
+  ExpectValidProbeLengths();
+  for (int i = 0; i < 500; ++i) {
+    std::snprintf(key, sizeof(key), "key%d", i);
+    if (i % 2 == 0) {
+      EXPECT_EQ(FlatMapGet(&map, key), nullptr);
+    } else {
+      EXPECT_STREQ((char*)FlatMapGet(&map, key), "value");
+    }
+  }
+}
+
+TEST_F(FlatMapTest, RemoveMissingKeyIsNoop) {
+  Insert("key1", "value1");
+  FlatMapRemove(&map, "key2");
+  EXPECT_EQ(map.size, 1);
+}
+
+TEST_F(FlatMapTest, ReallocRefusesCapacityBelowLoadFactor) {
+  char key[32];
+  for (int i = 0; i < 100; ++i) {
+    std::snprintf(key, sizeof(key), "key%d", i);
+    Insert(key, "value");
+  }
+  const size_t capacity = map.capacity;
+  FlatMapRealloc(&map, 16);
+  EXPECT_EQ(map.capacity, capacity);
+  EXPECT_EQ(map.size, 100);
+}
+
+static int kFlatMapCount = 0;
+bool_t FlatMapCountPredicate(const void* key, const void* value) {
+  (void)key;
+  (void)value;
+  ++kFlatMapCount;
+  return kFlatMapCount < 3 ? TRUE : FALSE;
+}
+
+TEST_F(FlatMapTest, TraverseStopsOnFalsePredicate) {
+  Insert("key1", "value1");
+  Insert("key2", "value2");
+  Insert("key3", "value3");
+  Insert("key4", "value4");
+
+  FlatMapTraverse(&map, FlatMapCountPredicate);
+
+  EXPECT_EQ(kFlatMapCount, 3);
+}
+
+#endif  // STLC_TESTS_FLATMAP_TESTFLATMAP_HH_
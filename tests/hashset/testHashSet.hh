@@ -0,0 +1,217 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_TESTS_HASHSET_TESTHASHSET_HH_
+#define STLC_TESTS_HASHSET_TESTHASHSET_HH_
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <string>
+
+#include "bool.h"
+#include "hashset/hashset.h"
+#include "map/hash.h"
+#include "map/map.h"
+
+class HashSetTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    HashSetInit(&set, MAP_MIN_CAPACITY, Hash, KeyCmp);
+    HashSetInit(&other, MAP_MIN_CAPACITY, Hash, KeyCmp);
+    HashSetInit(&out, MAP_MIN_CAPACITY, Hash, KeyCmp);
+  }
+
+  void TearDown() override {
+    HashSetFree(&set);
+    HashSetFree(&other);
+    HashSetFree(&out);
+  }
+
+  static bool_t Add(HashSet* const target, const char* key) {
+    return HashSetAdd(target, key, std::strlen(key) + 1);
+  }
+
+  static bool_t Contains(HashSet* const target, const char* key) {
+    return HashSetContains(target, key, std::strlen(key) + 1);
+  }
+
+  // Adds "key<i>" for every `i` in [`begin`, `end`).
+  static void AddRange(HashSet* const target, const int begin, const int end) {
+    char key[32];
+    for (int i = begin; i < end; ++i) {
+      std::snprintf(key, sizeof(key), "key%d", i);
+      Add(target, key);
+    }
+  }
+
+  // Checks that `target` holds exactly "key<i>" for every `i` in [`begin`,
+  // `end`).
+  static void ExpectRange(HashSet* const target, const int begin,
+                          const int end) {
+    char key[32];
+    EXPECT_EQ(HashSetSize(target), (size_t)(end - begin));
+    for (int i = begin; i < end; ++i) {
+      std::snprintf(key, sizeof(key), "key%d", i);
+      EXPECT_EQ(Contains(target, key), TRUE) << key;
+    }
+  }
+
+ protected:
+  HashSet set;
+  HashSet other;
+  HashSet out;
+};
+
+TEST_F(HashSetTest, AddContainsRemove) {
+  EXPECT_EQ(Add(&set, "apple"), TRUE);
+  EXPECT_EQ(Add(&set, "banana"), TRUE);
+  EXPECT_EQ(Add(&set, "apple"), FALSE);
+
+  EXPECT_EQ(HashSetSize(&set), 2);
+  EXPECT_EQ(Contains(&set, "apple"), TRUE);
+  EXPECT_EQ(Contains(&set, "cherry"), FALSE);
+
+  EXPECT_EQ(HashSetRemove(&set, "apple", 6), TRUE);
+  EXPECT_EQ(HashSetRemove(&set, "apple", 6), FALSE);
+  EXPECT_EQ(Contains(&set, "apple"), FALSE);
+  EXPECT_EQ(HashSetSize(&set), 1);
+}
+
+TEST_F(HashSetTest, MembersReserveNoValueBytes) {
+  Add(&set, "key");
+  const size_t bucket = _MAP_BUCKET_INDEX(Hash("key"), set.map.capacity);
+  const MapEntry* const entry = set.map.buckets[bucket];
+  ASSERT_NE(entry, nullptr);
+  EXPECT_EQ(entry->value_size, 0);
+  EXPECT_EQ(entry->value_capacity, 0);
+  EXPECT_STREQ((const char*)entry->key, "key");
+}
+
+TEST_F(HashSetTest, GrowsAndKeepsMembers) {
+  AddRange(&set, 0, 5000);
+  ExpectRange(&set, 0, 5000);
+  EXPECT_GT(set.map.capacity, MAP_MIN_CAPACITY);
+}
+
+static std::set<std::string> kHashSetKeys;
+bool_t HashSetCollectPredicate(const void* key) {
+  kHashSetKeys.insert((const char*)key);
+  return TRUE;
+}
+
+static int kHashSetCount = 0;
+bool_t HashSetCountPredicate(const void* key) {
+  (void)key;
+  ++kHashSetCount;
+  return kHashSetCount < 3 ? TRUE : FALSE;
+}
+
+TEST_F(HashSetTest, TraverseVisitsEveryKeyAndStops) {
+  Add(&set, "key1");
+  Add(&set, "key2");
+  Add(&set, "key3");
+  Add(&set, "key4");
+
+  HashSetTraverse(&set, HashSetCollectPredicate);
+  EXPECT_EQ(kHashSetKeys,
+            std::set<std::string>({"key1", "key2", "key3", "key4"}));
+
+  HashSetTraverse(&set, HashSetCountPredicate);
+  EXPECT_EQ(kHashSetCount, 3);
+}
+
+TEST_F(HashSetTest, Union) {
+  AddRange(&set, 0, 300);
+  AddRange(&other, 200, 1000);
+
+  EXPECT_EQ(HashSetUnion(&out, &set, &other), 1000);
+  ExpectRange(&out, 0, 1000);
+  EXPECT_EQ(HashSetUnion(&out, &set, &set), 0);
+}
+
+TEST_F(HashSetTest, IntersectionProbesTheLargerSet) {
+  AddRange(&set, 0, 1000);
+  AddRange(&other, 900, 1100);
+
+  EXPECT_EQ(HashSetIntersection(&out, &set, &other), 100);
+  ExpectRange(&out, 900, 1000);
+
+  HashSet empty;
+  HashSetInit(&empty, MAP_MIN_CAPACITY, Hash, KeyCmp);
+  EXPECT_EQ(HashSetIntersection(&empty, &other, &set), 100);
+  ExpectRange(&empty, 900, 1000);
+  HashSetFree(&empty);
+}
+
+TEST_F(HashSetTest, Difference) {
+  AddRange(&set, 0, 1000);
+  AddRange(&other, 100, 1100);
+
+  EXPECT_EQ(HashSetDifference(&out, &set, &other), 100);
+  ExpectRange(&out, 0, 100);
+
+  HashSet empty;
+  HashSetInit(&empty, MAP_MIN_CAPACITY, Hash, KeyCmp);
+  EXPECT_EQ(HashSetDifference(&empty, &other, &out), 1000);
+  ExpectRange(&empty, 100, 1100);
+  HashSetFree(&empty);
+}
+
+TEST_F(HashSetTest, AlgebraRehashesKeysForDifferentHashing) {
+  HashSet seeded;
+  MapConfig config;
+  MapConfigInit(&config, MAP_MIN_CAPACITY, NULL, NULL);
+  config.hash_seeded_func = HashBytes;
+  config.key_eq_n_func = KeyCmpN;
+  config.seed = 0x5EED;
+  HashSetInitWithConfig(&seeded, &config);
+  AddRange(&seeded, 50, 150);
+  AddRange(&set, 0, 100);
+
+  EXPECT_EQ(HashSetIntersection(&out, &set, &seeded), 50);
+  ExpectRange(&out, 50, 100);
+  EXPECT_EQ(HashSetDifference(&other, &seeded, &set), 50);
+  ExpectRange(&other, 100, 150);
+  HashSetFree(&seeded);
+}
+
+TEST_F(HashSetTest, AlgebraRejectsAliasedOutput) {
+  AddRange(&set, 0, 10);
+  AddRange(&other, 5, 15);
+
+  EXPECT_EQ(HashSetUnion(&set, &set, &other), 0);
+  EXPECT_EQ(HashSetIntersection(&other, &set, &other), 0);
+  EXPECT_EQ(HashSetSize(&set), 10);
+  EXPECT_EQ(HashSetSize(&other), 10);
+}
+
+#endif  // STLC_TESTS_HASHSET_TESTHASHSET_HH_
@@ -0,0 +1,237 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_TESTS_INTMAP_TESTINTMAP_HH_
+#define STLC_TESTS_INTMAP_TESTINTMAP_HH_
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "bool.h"
+#include "intmap/intmap.h"
+
+class IntMapTest : public ::testing::Test {
+ protected:
+  void SetUp() override { IntMapInit(&map, 0); }
+
+  void TearDown() override { IntMapFree(&map); }
+
+  // Checks that every occupied slot is reachable from its home slot without
+  // crossing an empty slot.
+  void ExpectReachableFromHome() {
+    const size_t mask = map.capacity - 1;
+    for (size_t i = 0; i < map.capacity; ++i) {
+      if (map.slots[i].key == INTMAP_EMPTY_KEY) continue;
+      for (size_t j = _INTMAP_HOME_SLOT(&map, map.slots[i].key); j != i;
+           j = (j + 1) & mask) {
+        ASSERT_NE(map.slots[j].key, INTMAP_EMPTY_KEY);
+      }
+    }
+  }
+
+ protected:
+  IntMap map;
+};
+
+TEST_F(IntMapTest, InitRoundsCapacityToPowerOfTwo) {
+  IntMap other;
+  IntMapInit(&other, 100);
+  EXPECT_EQ(other.capacity, 128);
+  EXPECT_EQ(other.size, 0);
+  EXPECT_NE(other.slots, nullptr);
+  for (size_t i = 0; i < other.capacity; ++i)
+    EXPECT_EQ(other.slots[i].key, INTMAP_EMPTY_KEY);
+  IntMapFree(&other);
+
+  EXPECT_EQ(map.capacity, INTMAP_MIN_CAPACITY);
+}
+
+TEST_F(IntMapTest, InsertGetAndOverwrite) {
+  uint64_t value = 0;
+  IntMapInsert(&map, 1, 100);
+  IntMapInsert(&map, 2, 200);
+  IntMapInsert(&map, 1, 101);
+
+  EXPECT_EQ(map.size, 2);
+  EXPECT_EQ(IntMapGet(&map, 1, &value), TRUE);
+  EXPECT_EQ(value, 101);
+  EXPECT_EQ(IntMapGet(&map, 2, &value), TRUE);
+  EXPECT_EQ(value, 200);
+  EXPECT_EQ(IntMapGet(&map, 3, &value), FALSE);
+  EXPECT_EQ(IntMapGet(&map, 2, nullptr), TRUE);
+}
+
+TEST_F(IntMapTest, EmptyKeyIsStoredOutOfBand) {
+  uint64_t value = 0;
+  EXPECT_EQ(IntMapGet(&map, INTMAP_EMPTY_KEY, &value), FALSE);
+
+  IntMapInsert(&map, INTMAP_EMPTY_KEY, 7);
+  EXPECT_EQ(map.size, 1);
+  EXPECT_EQ(map.has_empty_key, TRUE);
+  EXPECT_EQ(IntMapGet(&map, INTMAP_EMPTY_KEY, &value), TRUE);
+  EXPECT_EQ(value, 7);
+  for (size_t i = 0; i < map.capacity; ++i)
+    EXPECT_EQ(map.slots[i].key, INTMAP_EMPTY_KEY);
+
+  IntMapRemove(&map, INTMAP_EMPTY_KEY);
+  EXPECT_EQ(map.size, 0);
+  EXPECT_EQ(IntMapGet(&map, INTMAP_EMPTY_KEY, &value), FALSE);
+}
+
+TEST_F(IntMapTest, GrowsAndKeepsEntries) {
+  for (uint64_t i = 0; i < 10000; ++i) IntMapInsert(&map, i * 4096, i);
+
+  EXPECT_EQ(map.size, 10000);
+  EXPECT_GE(map.capacity * INTMAP_MAX_LOAD_NUMERATOR,
+            map.size * INTMAP_MAX_LOAD_DENOMINATOR);
+  ExpectReachableFromHome();
+  uint64_t value = 0;
+  for (uint64_t i = 0; i < 10000; ++i) {
+    ASSERT_EQ(IntMapGet(&map, i * 4096, &value), TRUE);
+    ASSERT_EQ(value, i);
+  }
+}
+
+TEST_F(IntMapTest, RemoveShiftsClusterBack) {
+  for (uint64_t i = 0; i < 2000; ++i) IntMapInsert(&map, i, i + 1);
+  for (uint64_t i = 0; i < 2000; i += 2) IntMapRemove(&map, i);
+  IntMapRemove(&map, 5000);
+
+  EXPECT_EQ(map.size, 1000);
+  ExpectReachableFromHome();
+  for (uint64_t i = 0; i < 2000; ++i) {
+    uint64_t value = 0;
+    if (i % 2 == 0) {
+      EXPECT_EQ(IntMapGet(&map, i, &value), FALSE);
+    } else {
+      EXPECT_EQ(IntMapGet(&map, i, &value), TRUE);
+      EXPECT_EQ(value, i + 1);
+    }
+  }
+}
+
+TEST_F(IntMapTest, ReserveAndRealloc) {
+  IntMapReserve(&map, 1000);
+  EXPECT_EQ(map.capacity, 2048);
+  const IntMapSlot* const slots = map.slots;
+  for (uint64_t i = 0; i < 1000; ++i) IntMapInsert(&map, i, i);
+  EXPECT_EQ(map.slots, slots);
+
+  IntMapRealloc(&map, 16);
+  EXPECT_EQ(map.capacity, 2048);
+  IntMapRealloc(&map, 4096);
+  EXPECT_EQ(map.capacity, 4096);
+  EXPECT_EQ(map.size, 1000);
+  ExpectReachableFromHome();
+}
+
+TEST_F(IntMapTest, GetOrInsertAndUpsert) {
+  bool_t inserted = FALSE;
+  uint64_t* value = IntMapGetOrInsert(&map, 42, 1, &inserted);
+  ASSERT_NE(value, nullptr);
+  EXPECT_EQ(inserted, TRUE);
+  *value += 10;
+  value = IntMapGetOrInsert(&map, 42, 1, &inserted);
+  EXPECT_EQ(inserted, FALSE);
+  EXPECT_EQ(*value, 11);
+
+  const intmap_merge_f add = [](const uint64_t value, const uint64_t update) {
+    return value + update;
+  };
+  EXPECT_EQ(IntMapUpsert(&map, 42, 5, add), 16);
+  EXPECT_EQ(IntMapUpsert(&map, 43, 5, add), 5);
+  EXPECT_EQ(IntMapUpsert(&map, 43, 9, nullptr), 9);
+  EXPECT_EQ(IntMapUpsert(&map, INTMAP_EMPTY_KEY, 3, add), 3);
+  EXPECT_EQ(IntMapUpsert(&map, INTMAP_EMPTY_KEY, 3, add), 6);
+  EXPECT_EQ(map.size, 3);
+}
+
+TEST_F(IntMapTest, InsertManyAndGetMany) {
+  const size_t kCount = INTMAP_BATCH_WIDTH * 3 + 5;
+  std::vector<uint64_t> keys;
+  std::vector<uint64_t> values;
+  for (size_t i = 0; i < kCount; ++i) {
+    keys.push_back(i * 2);
+    values.push_back(i * 10);
+  }
+  keys.push_back(INTMAP_EMPTY_KEY);
+  values.push_back(99);
+  keys.push_back(0);
+  values.push_back(1);
+
+  EXPECT_EQ(IntMapInsertMany(&map, keys.data(), values.data(), keys.size()),
+            kCount + 1);
+  EXPECT_EQ(map.size, kCount + 1);
+
+  std::vector<uint64_t> lookups;
+  for (size_t i = 0; i < kCount * 2; ++i) lookups.push_back(i);
+  lookups.push_back(INTMAP_EMPTY_KEY);
+  std::vector<uint64_t> out(lookups.size(), 12345);
+  bool_t found[kCount * 2 + 1];
+  EXPECT_EQ(IntMapGetMany(&map, lookups.data(), lookups.size(), out.data(),
+                          found),
+            kCount + 1);
+  for (size_t i = 0; i < kCount * 2; ++i) {
+    EXPECT_EQ(found[i], i % 2 == 0 ? TRUE : FALSE);
+    if (i == 0) {
+      EXPECT_EQ(out[i], 1);
+    } else {
+      EXPECT_EQ(out[i], i % 2 == 0 ? i * 5 : 12345);
+    }
+  }
+  EXPECT_EQ(found[kCount * 2], TRUE);
+  EXPECT_EQ(out[kCount * 2], 99);
+  EXPECT_EQ(IntMapContainsMany(&map, lookups.data(), lookups.size(), nullptr),
+            kCount + 1);
+}
+
+static uint64_t kIntMapKeySum = 0;
+static int kIntMapCount = 0;
+bool_t IntMapCountPredicate(const uint64_t key, const uint64_t value) {
+  (void)value;
+  kIntMapKeySum += key;
+  ++kIntMapCount;
+  return kIntMapCount < 3 ? TRUE : FALSE;
+}
+
+TEST_F(IntMapTest, TraverseStopsOnFalsePredicate) {
+  IntMapInsert(&map, 1, 1);
+  IntMapInsert(&map, 2, 2);
+  IntMapInsert(&map, 3, 3);
+  IntMapInsert(&map, 4, 4);
+
+  IntMapTraverse(&map, IntMapCountPredicate);
+
+  EXPECT_EQ(kIntMapCount, 3);
+  EXPECT_GE(kIntMapKeySum, 6);
+}
+
+#endif  // STLC_TESTS_INTMAP_TESTINTMAP_HH_
@@ -0,0 +1,285 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_TESTS_LRUCACHE_TESTLRUCACHE_HH_
+#define STLC_TESTS_LRUCACHE_TESTLRUCACHE_HH_
+
+#include <gtest/gtest.h>
+#include <pthread.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "bool.h"
+#include "lrucache/lrucache.h"
+#include "map/map.h"
+
+class LruCacheTest : public ::testing::Test {
+ protected:
+  void TearDown() override { LruCacheFree(&cache); }
+
+  void Put(const char* key, const size_t value) {
+    ASSERT_EQ(LruCachePut(&cache, key, std::strlen(key) + 1, &value,
+                          sizeof(value)),
+              TRUE);
+  }
+
+  const size_t* Get(const char* key) {
+    return (const size_t*)LruCacheGet(&cache, key, std::strlen(key) + 1,
+                                      nullptr);
+  }
+
+  bool_t Contains(const char* key) {
+    return LruCacheContains(&cache, key, std::strlen(key) + 1);
+  }
+
+  LruCache cache;
+};
+
+TEST_F(LruCacheTest, EvictsTheLeastRecentlyUsedEntry) {
+  LruCacheInit(&cache, 3, Hash, KeyCmp);
+  Put("a", 1);
+  Put("b", 2);
+  Put("c", 3);
+  ASSERT_NE(Get("a"), nullptr);
+  Put("d", 4);
+
+  EXPECT_EQ(LruCacheSize(&cache), 3u);
+  EXPECT_EQ(Contains("b"), FALSE);
+  EXPECT_EQ(*Get("a"), 1u);
+  EXPECT_EQ(*Get("c"), 3u);
+  EXPECT_EQ(*Get("d"), 4u);
+  EXPECT_EQ(Get("b"), nullptr);
+
+  LruCacheStats stats;
+  LruCacheGetStats(&cache, &stats);
+  EXPECT_EQ(stats.size, 3u);
+  EXPECT_EQ(stats.charge, 3u);
+  EXPECT_EQ(stats.hits, 4u);
+  EXPECT_EQ(stats.misses, 1u);
+  EXPECT_EQ(stats.evictions, 1u);
+}
+
+static std::vector<std::string> evicted_keys;
+
+static void RecordEviction(const void* key, const size_t key_size,
+                           const void* value, const size_t value_size,
+                           void* context) {
+  (void)key_size;
+  EXPECT_EQ(value_size, sizeof(size_t));
+  evicted_keys.push_back((const char*)key);
+  *(size_t*)context += *(const size_t*)value;
+}
+
+TEST_F(LruCacheTest, CallsTheEvictionCallbackOnEvictionOnly) {
+  size_t evicted_sum = 0;
+  LruCacheConfig config;
+  LruCacheConfigInit(&config, 2, Hash, KeyCmp);
+  config.on_evict = RecordEviction;
+  config.evict_context = &evicted_sum;
+  LruCacheInitWithConfig(&cache, &config);
+  evicted_keys.clear();
+
+  Put("a", 10);
+  Put("b", 20);
+  Put("a", 11);
+  Put("c", 30);
+  EXPECT_EQ(LruCacheRemove(&cache, "a", 2), TRUE);
+  EXPECT_EQ(LruCacheRemove(&cache, "a", 2), FALSE);
+
+  ASSERT_EQ(evicted_keys.size(), 1u);
+  EXPECT_EQ(evicted_keys[0], "b");
+  EXPECT_EQ(evicted_sum, 20u);
+  EXPECT_EQ(LruCacheSize(&cache), 1u);
+}
+
+TEST_F(LruCacheTest, LimitsTheBytesOfKeysAndValues) {
+  LruCacheConfig config;
+  LruCacheConfigInit(&config, 64, Hash, KeyCmp);
+  config.limit = LRUCACHE_LIMIT_BYTES;
+  LruCacheInitWithConfig(&cache, &config);
+
+  const std::string big(40, 'x');
+  ASSERT_EQ(LruCachePut(&cache, "k1", 3, big.data(), big.size()), TRUE);
+  ASSERT_EQ(LruCachePut(&cache, "k2", 3, "small", 6), TRUE);
+  LruCacheStats stats;
+  LruCacheGetStats(&cache, &stats);
+  EXPECT_EQ(stats.charge, 3u + 40u + 3u + 6u);
+
+  // Another big value does not fit next to the first one.
+  ASSERT_EQ(LruCachePut(&cache, "k3", 3, big.data(), big.size()), TRUE);
+  EXPECT_EQ(Contains("k1"), FALSE);
+  EXPECT_EQ(Contains("k2"), TRUE);
+  LruCacheGetStats(&cache, &stats);
+  EXPECT_EQ(stats.charge, 3u + 6u + 3u + 40u);
+
+  const std::string huge(64, 'y');
+  EXPECT_EQ(LruCachePut(&cache, "k4", 3, huge.data(), huge.size()), FALSE);
+  EXPECT_EQ(LruCacheSize(&cache), 2u);
+}
+
+TEST_F(LruCacheTest, OverwritesAndGrowsValues) {
+  LruCacheConfig config;
+  LruCacheConfigInit(&config, 1024, Hash, KeyCmp);
+  config.limit = LRUCACHE_LIMIT_BYTES;
+  LruCacheInitWithConfig(&cache, &config);
+
+  ASSERT_EQ(LruCachePut(&cache, "key", 4, "abc", 4), TRUE);
+  ASSERT_EQ(LruCachePut(&cache, "other", 6, "x", 2), TRUE);
+  ASSERT_EQ(LruCachePut(&cache, "key", 4, "ab", 3), TRUE);
+  size_t value_size = 0;
+  const void* value = LruCacheGet(&cache, "key", 4, &value_size);
+  ASSERT_NE(value, nullptr);
+  EXPECT_EQ(value_size, 3u);
+  EXPECT_STREQ((const char*)value, "ab");
+
+  const std::string grown(200, 'g');
+  ASSERT_EQ(
+      LruCachePut(&cache, "key", 4, grown.c_str(), grown.size() + 1), TRUE);
+  char out[256];
+  ASSERT_EQ(LruCacheGetCopy(&cache, "key", 4, out, sizeof(out), &value_size),
+            TRUE);
+  EXPECT_EQ(value_size, grown.size() + 1);
+  EXPECT_EQ(std::string(out), grown);
+  EXPECT_EQ((uintptr_t)LruCacheGet(&cache, "key", 4, nullptr) %
+                MAP_ENTRY_ALIGNMENT,
+            0u);
+
+  LruCacheStats stats;
+  LruCacheGetStats(&cache, &stats);
+  EXPECT_EQ(stats.size, 2u);
+  EXPECT_EQ(stats.charge, 4u + grown.size() + 1 + 6u + 2u);
+}
+
+TEST_F(LruCacheTest, ClockGivesHitEntriesASecondChance) {
+  LruCacheConfig config;
+  LruCacheConfigInit(&config, 3, Hash, KeyCmp);
+  config.policy = LRUCACHE_POLICY_CLOCK;
+  LruCacheInitWithConfig(&cache, &config);
+
+  Put("a", 1);
+  Put("b", 2);
+  Put("c", 3);
+  ASSERT_NE(Get("a"), nullptr);
+  Put("d", 4);
+  EXPECT_EQ(Contains("a"), TRUE);
+  EXPECT_EQ(Contains("b"), FALSE);
+
+  Put("e", 5);
+  EXPECT_EQ(Contains("a"), TRUE);
+  EXPECT_EQ(Contains("c"), FALSE);
+
+  // Without a hit since it was given its second chance, "a" goes next.
+  Put("f", 6);
+  EXPECT_EQ(Contains("a"), FALSE);
+  EXPECT_EQ(Contains("d"), TRUE);
+}
+
+static std::vector<size_t> traversed_values;
+
+static bool_t CollectLruCacheValue(const void* key, const void* value) {
+  (void)key;
+  traversed_values.push_back(*(const size_t*)value);
+  return TRUE;
+}
+
+TEST_F(LruCacheTest, TraversesFromMostToLeastRecentlyUsed) {
+  LruCacheInit(&cache, 8, Hash, KeyCmp);
+  Put("a", 1);
+  Put("b", 2);
+  Put("c", 3);
+  ASSERT_NE(Get("b"), nullptr);
+  EXPECT_EQ(Contains("a"), TRUE);
+
+  traversed_values.clear();
+  LruCacheTraverse(&cache, CollectLruCacheValue);
+  EXPECT_EQ(traversed_values, (std::vector<size_t>{2, 3, 1}));
+}
+
+TEST_F(LruCacheTest, ShrinksToANewCapacity) {
+  LruCacheInit(&cache, 100, Hash, KeyCmp);
+  char key[32];
+  for (size_t i = 0; i < 100; ++i) {
+    std::snprintf(key, sizeof(key), "key%zu", i);
+    Put(key, i);
+  }
+  LruCacheSetCapacity(&cache, 10);
+  EXPECT_EQ(LruCacheSize(&cache), 10u);
+  for (size_t i = 90; i < 100; ++i) {
+    std::snprintf(key, sizeof(key), "key%zu", i);
+    EXPECT_EQ(Contains(key), TRUE) << key;
+  }
+  LruCacheStats stats;
+  LruCacheGetStats(&cache, &stats);
+  EXPECT_EQ(stats.evictions, 90u);
+}
+
+static void* HitClockCache(void* arg) {
+  LruCache* const cache = (LruCache*)arg;
+  char key[32];
+  for (size_t round = 0; round < 200; ++round) {
+    for (size_t i = 0; i < 64; ++i) {
+      std::snprintf(key, sizeof(key), "key%zu", i);
+      size_t value = 0;
+      if (LruCacheGetCopy(cache, key, std::strlen(key) + 1, &value,
+                          sizeof(value), nullptr) == TRUE &&
+          value != i)
+        return arg;
+    }
+  }
+  return nullptr;
+}
+
+TEST_F(LruCacheTest, ClockServesConcurrentHitsAndPuts) {
+  LruCacheConfig config;
+  LruCacheConfigInit(&config, 32, Hash, KeyCmp);
+  config.policy = LRUCACHE_POLICY_CLOCK;
+  LruCacheInitWithConfig(&cache, &config);
+
+  pthread_t readers[4];
+  for (pthread_t& reader : readers)
+    ASSERT_EQ(pthread_create(&reader, nullptr, HitClockCache, &cache), 0);
+  char key[32];
+  for (size_t round = 0; round < 50; ++round) {
+    for (size_t i = 0; i < 64; ++i) {
+      std::snprintf(key, sizeof(key), "key%zu", i);
+      Put(key, i);
+    }
+  }
+  for (pthread_t& reader : readers) {
+    void* result;
+    ASSERT_EQ(pthread_join(reader, &result), 0);
+    EXPECT_EQ(result, nullptr);
+  }
+  EXPECT_EQ(LruCacheSize(&cache), 32u);
+}
+
+#endif  // STLC_TESTS_LRUCACHE_TESTLRUCACHE_HH_
@@ -0,0 +1,171 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_TESTS_MAP_TESTHASH_HH_
+#define STLC_TESTS_MAP_TESTHASH_HH_
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "bool.h"
+#include "map/hash.h"
+#include "map/map.h"
+#include "map/ops.h"
+
+// Returns the 2^`bits` keys made of `bits` blocks that are each either "az" or
+// "bY".  Both blocks contribute the same value to djb2, so every key shares the
+// same `Hash`.
+static std::vector<std::string> DjbCollidingKeys(const size_t bits) {
+  std::vector<std::string> keys;
+  for (size_t i = 0; i < ((size_t)1 << bits); ++i) {
+    std::string key;
+    for (size_t bit = 0; bit < bits; ++bit) key += (i >> bit) & 1 ? "bY" : "az";
+    keys.push_back(key);
+  }
+  return keys;
+}
+
+static std::vector<unsigned char> HashTestBuffer(const size_t size) {
+  std::vector<unsigned char> buffer(size);
+  unsigned long long state = 0x9E3779B97F4A7C15ULL;
+  for (size_t i = 0; i < size; ++i) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    buffer[i] = (unsigned char)(state >> 56);
+  }
+  return buffer;
+}
+
+TEST(HashBytesTest, IsDeterministicPerSeed) {
+  const std::vector<unsigned char> buffer = HashTestBuffer(0x1000);
+  for (size_t len : {0, 1, 3, 4, 8, 16, 17, 48, 49, 255, 256, 257, 4096}) {
+    EXPECT_EQ(HashBytes(buffer.data(), len, 42),
+              HashBytes(buffer.data(), len, 42));
+    EXPECT_NE(HashBytes(buffer.data(), len, 42),
+              HashBytes(buffer.data(), len, 43));
+  }
+}
+
+TEST(HashBytesTest, EveryPrefixLengthHashesDifferently) {
+  const std::vector<unsigned char> buffer = HashTestBuffer(0x800);
+  std::set<hash_t> hashes;
+  for (size_t len = 0; len <= buffer.size(); ++len) {
+    hashes.insert(HashBytes(buffer.data(), len, 0));
+  }
+  EXPECT_EQ(hashes.size(), buffer.size() + 1);
+}
+
+TEST(HashBytesTest, EveryBitFlipChangesTheHash) {
+  for (size_t len : {5, 16, 40, 100, 300, 1500}) {
+    std::vector<unsigned char> buffer = HashTestBuffer(len);
+    std::set<hash_t> hashes;
+    hashes.insert(HashBytes(buffer.data(), len, 7));
+    for (size_t bit = 0; bit < len * 8; ++bit) {
+      buffer[bit / 8] ^= (unsigned char)(1 << (bit % 8));
+      hashes.insert(HashBytes(buffer.data(), len, 7));
+      buffer[bit / 8] ^= (unsigned char)(1 << (bit % 8));
+    }
+    EXPECT_EQ(hashes.size(), len * 8 + 1) << "len: " << len;
+  }
+}
+
+TEST(HashBytesTest, IgnoresBytesOutsideTheKey) {
+  std::vector<unsigned char> buffer = HashTestBuffer(0x200);
+  const hash_t hash = HashBytes(buffer.data(), 300, 1);
+  buffer[300] ^= 0xFF;
+  EXPECT_EQ(HashBytes(buffer.data(), 300, 1), hash);
+}
+
+TEST(HashBytesTest, SeparatesKeysThatCollideUnderHash) {
+  const std::vector<std::string> keys = DjbCollidingKeys(10);
+  std::set<hash_t> djb;
+  std::set<hash_t> seeded;
+  for (const std::string& key : keys) {
+    djb.insert(Hash(key.c_str()));
+    seeded.insert(HashBytes(key.data(), key.size(), 0));
+  }
+  EXPECT_EQ(djb.size(), 1);
+  EXPECT_EQ(seeded.size(), keys.size());
+}
+
+TEST(HashRandomSeedTest, DrawsDifferentSeeds) {
+  EXPECT_NE(HashRandomSeed(), HashRandomSeed());
+}
+
+TEST(MapSeededTest, KeepsCollidingKeysInShortChains) {
+  Map map;
+  MapInitSeeded(&map, MAP_MIN_CAPACITY, HashBytes, KeyCmpN);
+  const std::vector<std::string> keys = DjbCollidingKeys(12);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    MapInsertN(&map, keys[i].data(), keys[i].size(), &i, sizeof(i));
+  }
+
+  size_t longest = 0;
+  for (size_t i = 0; i < map.capacity; ++i) {
+    size_t length = 0;
+    for (MapEntry* entry = map.buckets[i]; entry != NULL; entry = entry->next)
+      ++length;
+    if (length > longest) longest = length;
+  }
+  EXPECT_EQ(map.size, keys.size());
+  EXPECT_LT(longest, 16);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    size_t* value = (size_t*)MapGetN(&map, keys[i].data(), keys[i].size());
+    ASSERT_NE(value, nullptr);
+    ASSERT_EQ(*value, i);
+  }
+
+  MapFree(&map);
+}
+
+TEST(MapSeededTest, HonoursConfiguredSeed) {
+  Map map;
+  MapConfig config;
+  MapConfigInit(&config, MAP_MIN_CAPACITY, NULL, NULL);
+  config.hash_seeded_func = HashBytes;
+  config.key_eq_n_func = KeyCmpN;
+  config.seed = 0x1234;
+  MapInitWithConfig(&map, &config);
+
+  EXPECT_EQ(map.seed, 0x1234);
+  MapInsert(&map, "key", std::strlen("key"), "value", 6);
+  EXPECT_EQ(map.buckets[_MAP_BUCKET_INDEX(HashBytes("key", 3, 0x1234),
+                                          map.capacity)]
+                ->hash,
+            HashBytes("key", 3, 0x1234));
+  EXPECT_STREQ((char*)MapGet(&map, "key"), "value");
+
+  MapFree(&map);
+}
+
+#endif  // STLC_TESTS_MAP_TESTHASH_HH_
@@ -32,10 +32,15 @@
 
 #include <gtest/gtest.h>
 
+#include <cstdio>
 #include <cstring>
+#include <map>
+#include <string>
 
 #include "bool.h"
+#include "map/iterators.h"
 #include "map/map.h"
+#include "map/ops.h"
 
 class MapTraverseTest : public ::testing::Test {
   void SetUp() override { MapInit(&map, 40, Hash, KeyCmp); }
@@ -82,4 +87,203 @@ TEST_F(MapTraverseTest, StopsTraversalOnFalsePredicate) {
   EXPECT_EQ(kCount2, 2);
 }
 
+static Map* kEntriesMap = nullptr;
+static int kEntriesCount = 0;
+bool_t EntriesPredicate(const MapEntry* entry) {
+  ++(kEntriesCount);
+  EXPECT_EQ(entry->hash, MapHashKey(kEntriesMap, entry->key, entry->key_size));
+  EXPECT_EQ(entry->value_size, std::strlen("value") + 1);
+  return TRUE;
+}
+
+TEST_F(MapTraverseTest, TraverseEntriesExposesHashes) {
+  MapInsert(&map, "key1", std::strlen("key1") + 1, "value",
+            std::strlen("value") + 1);
+  MapInsert(&map, "key2", std::strlen("key2") + 1, "value",
+            std::strlen("value") + 1);
+
+  kEntriesMap = &map;
+  MapTraverseEntries(&map, EntriesPredicate);
+  EXPECT_EQ(kEntriesCount, 2);
+}
+
+class MapIteratorTest : public ::testing::Test {
+ protected:
+  void Init(const bool_t incremental) {
+    MapConfig config;
+    MapConfigInit(&config, MAP_MIN_CAPACITY, Hash, KeyCmp);
+    config.incremental_rehash = incremental;
+    config.min_load_factor = 0;
+    MapInitWithConfig(&map, &config);
+  }
+
+  void TearDown() override { MapFree(&map); }
+
+  void Insert(const int i) {
+    char key[32];
+    std::snprintf(key, sizeof(key), "key%d", i);
+    MapInsert(&map, key, std::strlen(key) + 1, &i, sizeof(i));
+  }
+
+  // Drains up to `limit` entries of `iterator` into `seen`.
+  void Drain(MapIterator* const iterator, const size_t limit) {
+    for (size_t i = 0; i < limit; ++i) {
+      const MapEntry* entry = MapIteratorNext(iterator);
+      if (entry == nullptr) return;
+      ++seen[(const char*)entry->key];
+    }
+  }
+
+  void ExpectSeen(const int count) {
+    for (int i = 0; i < count; ++i) {
+      char key[32];
+      std::snprintf(key, sizeof(key), "key%d", i);
+      EXPECT_GE(seen[key], 1) << key;
+    }
+  }
+
+ protected:
+  Map map;
+  std::map<std::string, int> seen;
+};
+
+TEST_F(MapIteratorTest, VisitsEveryEntryOnce) {
+  Init(FALSE);
+  for (int i = 0; i < 1000; ++i) Insert(i);
+
+  MapIterator* iterator = MapIteratorNew(&map, 0);
+  ASSERT_NE(iterator, nullptr);
+  Drain(iterator, SIZE_MAX);
+  EXPECT_EQ(MapIteratorNext(iterator), nullptr);
+  EXPECT_EQ(MapIteratorCursor(iterator), 0);
+  MapIteratorFree(iterator);
+
+  EXPECT_EQ(seen.size(), 1000);
+  for (const auto& key : seen) EXPECT_EQ(key.second, 1) << key.first;
+}
+
+TEST_F(MapIteratorTest, ResumesFromCursor) {
+  Init(FALSE);
+  for (int i = 0; i < 1000; ++i) Insert(i);
+
+  MapIterator* iterator = MapIteratorNew(&map, 0);
+  Drain(iterator, 300);
+  const size_t cursor = MapIteratorCursor(iterator);
+  MapIteratorFree(iterator);
+  EXPECT_NE(cursor, 0);
+
+  iterator = MapIteratorNew(&map, cursor);
+  Drain(iterator, SIZE_MAX);
+  MapIteratorFree(iterator);
+  ExpectSeen(1000);
+}
+
+TEST_F(MapIteratorTest, ToleratesGrowthAndShrinking) {
+  Init(FALSE);
+  for (int i = 0; i < 1000; ++i) Insert(i);
+
+  MapIterator* iterator = MapIteratorNew(&map, 0);
+  Drain(iterator, 300);
+  const size_t capacity = map.capacity;
+  for (int i = 1000; i < 5000; ++i) Insert(i);
+  EXPECT_GT(map.capacity, capacity);
+  Drain(iterator, 2000);
+  MapRealloc(&map, MAP_MIN_CAPACITY);
+  Drain(iterator, SIZE_MAX);
+  MapIteratorFree(iterator);
+  ExpectSeen(1000);
+}
+
+TEST_F(MapIteratorTest, ToleratesIncrementalResize) {
+  Init(TRUE);
+  for (int i = 0; i < 1000; ++i) Insert(i);
+
+  MapIterator* iterator = MapIteratorNew(&map, 0);
+  Drain(iterator, 100);
+  MapRealloc(&map, map.capacity << 2);
+  ASSERT_NE(map.old_buckets, nullptr);
+  Drain(iterator, 200);
+  Insert(1000);
+  Drain(iterator, 200);
+  MapRealloc(&map, MAP_MIN_CAPACITY << 1);
+  Drain(iterator, SIZE_MAX);
+  MapIteratorFree(iterator);
+  ExpectSeen(1000);
+}
+
+TEST_F(MapIteratorTest, SurvivesRemovalOfBufferedEntries) {
+  Init(FALSE);
+  for (int i = 0; i < 8; ++i) Insert(i);
+
+  MapIterator* iterator = MapIteratorNew(&map, 0);
+  const MapEntry* first = MapIteratorNext(iterator);
+  ASSERT_NE(first, nullptr);
+  const std::string first_key = (const char*)first->key;
+  for (int i = 0; i < 8; ++i) {
+    char key[32];
+    std::snprintf(key, sizeof(key), "key%d", i);
+    if (first_key != key) MapRemove(&map, key, std::strlen(key) + 1);
+  }
+  EXPECT_EQ(map.size, 1);
+
+  // The entries buffered along with the first one are returned intact.
+  size_t count = 1;
+  for (const MapEntry* entry = MapIteratorNext(iterator); entry != nullptr;
+       entry = MapIteratorNext(iterator), ++count) {
+    int value;
+    std::memcpy(&value, entry->value, sizeof(value));
+    EXPECT_EQ(std::string((const char*)entry->key),
+              "key" + std::to_string(value));
+    EXPECT_EQ(entry->value_size, sizeof(value));
+  }
+  MapIteratorFree(iterator);
+  EXPECT_EQ(count, 8);
+}
+
+static size_t kParallelCount = 0;
+static bool_t ParallelCountPredicate(const void* key, const void* value) {
+  (void)key;
+  (void)value;
+  __atomic_fetch_add(&kParallelCount, 1, __ATOMIC_RELAXED);
+  return TRUE;
+}
+
+static bool_t ParallelStopPredicate(const void* key, const void* value) {
+  (void)key;
+  (void)value;
+  __atomic_fetch_add(&kParallelCount, 1, __ATOMIC_RELAXED);
+  return FALSE;
+}
+
+TEST_F(MapIteratorTest, ParallelTraverseVisitsEveryEntry) {
+  Init(FALSE);
+  for (int i = 0; i < 50000; ++i) Insert(i);
+  ASSERT_GE(map.capacity, MAP_PARALLEL_MIN_BUCKETS * 4);
+
+  kParallelCount = 0;
+  MapParallelTraverse(&map, 4, ParallelCountPredicate);
+  EXPECT_EQ(kParallelCount, 50000);
+
+  kParallelCount = 0;
+  MapParallelTraverse(&map, 0, ParallelCountPredicate);
+  EXPECT_EQ(kParallelCount, 50000);
+
+  // Every worker stops after its first entry.
+  kParallelCount = 0;
+  MapParallelTraverse(&map, 4, ParallelStopPredicate);
+  EXPECT_GE(kParallelCount, 1);
+  EXPECT_LE(kParallelCount, 4);
+}
+
+TEST_F(MapIteratorTest, ParallelTraverseVisitsBothTables) {
+  Init(TRUE);
+  for (int i = 0; i < 50000; ++i) Insert(i);
+  MapRealloc(&map, map.capacity << 1);
+  ASSERT_NE(map.old_buckets, nullptr);
+
+  kParallelCount = 0;
+  MapParallelTraverse(&map, 4, ParallelCountPredicate);
+  EXPECT_EQ(kParallelCount, 50000);
+}
+
 #endif  // STLC_TESTS_MAP_TESTITERATORS_HH_
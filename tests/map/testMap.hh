@@ -33,9 +33,11 @@
 #include <assert.h>
 #include <gtest/gtest.h>
 
+#include <cstdio>
 #include <cstring>
 
 #include "bool.h"
+#include "map/hash.h"
 #include "map/map.h"
 #include "map/ops.h"
 
@@ -141,11 +143,68 @@ TEST_F(MapEntryInitTest, EmptyArgsTest) {
   free(entry.value);
 }
 
+TEST_F(MapEntryInitTest, MapEntryNewStoresKeyAndValueInline) {
+  MapEntry* entry =
+      MapEntryNew(key, key_size, value, value_size, hash, nullptr);
+  ASSERT_NE(entry, nullptr);
+
+  EXPECT_EQ(entry->key, (void*)entry->data);
+  EXPECT_GE((char*)entry->value, (char*)entry->key + key_size);
+  EXPECT_EQ((uintptr_t)entry->value % MAP_ENTRY_ALIGNMENT, 0U);
+  EXPECT_STREQ((char*)entry->key, key);
+  EXPECT_STREQ((char*)entry->value, value);
+  EXPECT_EQ(entry->key_size, key_size);
+  EXPECT_EQ(entry->value_size, value_size);
+  EXPECT_EQ(entry->hash, hash);
+  EXPECT_EQ(entry->next, nullptr);
+
+  free(entry);
+}
+
+TEST_F(MapEntryInitTest, MapEntryNewRejectsNullArgs) {
+  EXPECT_EQ(MapEntryNew(nullptr, key_size, value, value_size, hash, nullptr),
+            nullptr);
+  EXPECT_EQ(MapEntryNew(key, key_size, nullptr, value_size, hash, nullptr),
+            nullptr);
+}
+
+TEST(MapInsertTest, OverwritesSmallerValueInPlace) {
+  Map map;
+  MapInit(&map, 40, Hash, KeyCmp);
+
+  MapInsert(&map, "key", std::strlen("key") + 1, "value1",
+            std::strlen("value1") + 1);
+  void* value = MapGet(&map, "key");
+  MapInsert(&map, "key", std::strlen("key") + 1, "v2", std::strlen("v2") + 1);
+
+  EXPECT_EQ(MapGet(&map, "key"), value);
+  EXPECT_STREQ((char*)MapGet(&map, "key"), "v2");
+  EXPECT_EQ(map.size, 1);
+
+  MapFree(&map);
+}
+
+TEST(MapInsertTest, OverwritesLargerValue) {
+  Map map;
+  MapInit(&map, 40, Hash, KeyCmp);
+
+  MapInsert(&map, "key1", std::strlen("key1") + 1, "v1", std::strlen("v1") + 1);
+  MapInsert(&map, "key2", std::strlen("key2") + 1, "v2", std::strlen("v2") + 1);
+  MapInsert(&map, "key1", std::strlen("key1") + 1, "a much longer value",
+            std::strlen("a much longer value") + 1);
+
+  EXPECT_STREQ((char*)MapGet(&map, "key1"), "a much longer value");
+  EXPECT_STREQ((char*)MapGet(&map, "key2"), "v2");
+  EXPECT_EQ(map.size, 2);
+
+  MapFree(&map);
+}
+
 TEST(MapInitTest, InitWithExplicitValues) {
   Map map;
   MapInit(&map, 40, Hash, KeyCmp);
 
-  EXPECT_EQ(map.capacity, 40);
+  EXPECT_EQ(map.capacity, 64);
   EXPECT_EQ(map.size, 0);
   EXPECT_EQ(map.hash_func, Hash);
   EXPECT_EQ(map.key_eq_func, KeyCmp);
@@ -265,7 +324,8 @@ TEST(MapReallocTest, MapReallocWithSameCapacity) {
 
 TEST(MapReallocTest, MapReallocWithSmallerCapacity) {
   Map map;
-  MapInit(&map, 8, Hash, KeyCmp);
+  MapInit(&map, MAP_MIN_CAPACITY << 1, Hash, KeyCmp);
+  ASSERT_NE(map.buckets, nullptr);
 
   MapInsert(&map, "key1", std::strlen("key1"), "value1", std::strlen("value1"));
   MapInsert(&map, "key2", std::strlen("key2"), "value2", std::strlen("value2"));
@@ -276,12 +336,580 @@ TEST(MapReallocTest, MapReallocWithSmallerCapacity) {
   MapInsert(&map, "key7", std::strlen("key7"), "value7", std::strlen("value7"));
   MapInsert(&map, "key8", std::strlen("key8"), "value8", std::strlen("value8"));
 
-  MapRealloc(&map, 4);
+  MapRealloc(&map, MAP_MIN_CAPACITY);
 
-  EXPECT_EQ(map.capacity, 4);
-  EXPECT_EQ(map.size, 4);
+  EXPECT_EQ(map.capacity, MAP_MIN_CAPACITY);
+  EXPECT_EQ(map.size, 8);
 
   MapFree(&map);
 }
 
+class MapLoadFactorTest : public ::testing::Test {
+ protected:
+  void Init(const double max_load_factor, const double min_load_factor) {
+    MapConfig config;
+    MapConfigInit(&config, MAP_MIN_CAPACITY, Hash, KeyCmp);
+    config.max_load_factor = max_load_factor;
+    config.min_load_factor = min_load_factor;
+    MapInitWithConfig(&map, &config);
+  }
+
+  void TearDown() override { MapFree(&map); }
+
+  void Key(const int i, char* const key, const size_t size) {
+    std::snprintf(key, size, "key%d", i);
+  }
+
+  void Insert(const int i) {
+    char key[32];
+    Key(i, key, sizeof(key));
+    MapInsert(&map, key, std::strlen(key) + 1, &i, sizeof(i));
+  }
+
+  void Remove(const int i) {
+    char key[32];
+    Key(i, key, sizeof(key));
+    MapRemove(&map, key, std::strlen(key) + 1);
+  }
+
+  void ExpectPresent(const int i) {
+    char key[32];
+    Key(i, key, sizeof(key));
+    int* value = (int*)MapGet(&map, key);
+    ASSERT_NE(value, nullptr);
+    ASSERT_EQ(*value, i);
+  }
+
+ protected:
+  Map map;
+};
+
+TEST_F(MapLoadFactorTest, RoundsCapacityToPowerOfTwo) {
+  Init(MAP_DEFAULT_MAX_LOAD_FACTOR, MAP_DEFAULT_MIN_LOAD_FACTOR);
+  MapRealloc(&map, 1000);
+
+  EXPECT_EQ(map.capacity, 1024);
+}
+
+TEST_F(MapLoadFactorTest, DoublesAboveMaxLoadFactor) {
+  Init(MAP_DEFAULT_MAX_LOAD_FACTOR, MAP_DEFAULT_MIN_LOAD_FACTOR);
+  for (int i = 0; i < MAP_MIN_CAPACITY; ++i) Insert(i);
+  EXPECT_EQ(map.capacity, MAP_MIN_CAPACITY);
+
+  Insert(MAP_MIN_CAPACITY);
+  EXPECT_EQ(map.capacity, MAP_MIN_CAPACITY * 2);
+}
+
+TEST_F(MapLoadFactorTest, HonoursCustomMaxLoadFactor) {
+  Init(4.0, 0.5);
+  for (int i = 0; i < 4 * MAP_MIN_CAPACITY; ++i) Insert(i);
+  EXPECT_EQ(map.capacity, MAP_MIN_CAPACITY);
+
+  Insert(4 * MAP_MIN_CAPACITY);
+  EXPECT_EQ(map.capacity, MAP_MIN_CAPACITY * 2);
+  for (int i = 0; i <= 4 * MAP_MIN_CAPACITY; ++i) ExpectPresent(i);
+}
+
+TEST_F(MapLoadFactorTest, ShrinksBelowMinLoadFactor) {
+  Init(MAP_DEFAULT_MAX_LOAD_FACTOR, MAP_DEFAULT_MIN_LOAD_FACTOR);
+  for (int i = 0; i < 4096; ++i) Insert(i);
+  EXPECT_EQ(map.capacity, 4096);
+
+  for (int i = 0; i < 4000; ++i) Remove(i);
+  EXPECT_EQ(map.size, 96);
+  EXPECT_LT(map.capacity, 4096);
+  EXPECT_GE(map.capacity, 2 * map.size);
+  for (int i = 4000; i < 4096; ++i) ExpectPresent(i);
+
+  for (int i = 4000; i < 4096; ++i) Remove(i);
+  EXPECT_EQ(map.size, 0);
+  EXPECT_EQ(map.capacity, MAP_MIN_CAPACITY);
+}
+
+TEST_F(MapLoadFactorTest, DoesNotShrinkWhenDisabled) {
+  Init(MAP_DEFAULT_MAX_LOAD_FACTOR, 0);
+  for (int i = 0; i < 4096; ++i) Insert(i);
+  for (int i = 0; i < 4096; ++i) Remove(i);
+
+  EXPECT_EQ(map.size, 0);
+  EXPECT_EQ(map.capacity, 4096);
+}
+
+TEST(MapLoadFactorConfigTest, RejectsInvalidLoadFactors) {
+  Map map;
+  map.buckets = nullptr;
+  MapConfig config;
+  MapConfigInit(&config, MAP_MIN_CAPACITY, Hash, KeyCmp);
+  config.max_load_factor = 1.0;
+  config.min_load_factor = 0.5;
+  MapInitWithConfig(&map, &config);
+  EXPECT_EQ(map.buckets, nullptr);
+
+  config.max_load_factor = 0;
+  config.min_load_factor = 0;
+  MapInitWithConfig(&map, &config);
+  EXPECT_EQ(map.buckets, nullptr);
+}
+
+TEST(MapLoadFactorConfigTest, RejectsMaxCapacityBelowCapacity) {
+  Map map;
+  map.buckets = nullptr;
+  MapConfig config;
+  MapConfigInit(&config, 0x100, Hash, KeyCmp);
+  config.max_capacity = MAP_MIN_CAPACITY;
+  MapInitWithConfig(&map, &config);
+  EXPECT_EQ(map.buckets, nullptr);
+}
+
+TEST_F(MapLoadFactorTest, StopsGrowingAtMaxCapacity) {
+  MapConfig config;
+  MapConfigInit(&config, MAP_MIN_CAPACITY, Hash, KeyCmp);
+  config.max_capacity = 0x40;
+  MapInitWithConfig(&map, &config);
+  for (int i = 0; i < 0x400; ++i) Insert(i);
+
+  EXPECT_EQ(map.capacity, 0x40);
+  for (int i = 0; i < 0x400; ++i) ExpectPresent(i);
+}
+
+// Spreads keys over more than 2^32 buckets.  The bucket array is mapped with
+// `MAP_NORESERVE`, so only the pages holding used buckets are committed, and
+// the slab lets `MapFree()` skip walking the buckets.
+TEST(MapHugeCapacityTest, IndexesBeyondThirtyTwoBits) {
+  if (sizeof(size_t) < 8) GTEST_SKIP() << "needs a 64-bit build";
+
+  const size_t capacity = (size_t)1 << 33;
+  Map map;
+  MapConfig config;
+  MapConfigInit(&config, MAP_MIN_CAPACITY, Hash, KeyCmp);
+  config.use_slab = TRUE;
+  // Shrinking would rehash through every bucket of the huge array.
+  config.min_load_factor = 0;
+  MapInitWithConfig(&map, &config);
+  MapRealloc(&map, capacity);
+  if (map.capacity != capacity) {
+    MapFree(&map);
+    GTEST_SKIP() << "could not reserve " << capacity << " buckets";
+  }
+
+  const int count = 10000;
+  size_t high_buckets = 0;
+  for (int i = 0; i < count; ++i) {
+    char key[32];
+    std::snprintf(key, sizeof(key), "huge%d", i);
+    MapInsert(&map, key, std::strlen(key) + 1, &i, sizeof(i));
+    if (_MAP_BUCKET_INDEX(Hash(key), capacity) >> 32 != 0) ++high_buckets;
+  }
+  EXPECT_EQ(map.size, count);
+  EXPECT_EQ(map.capacity, capacity);
+  EXPECT_GT(high_buckets, 0);
+
+  for (int i = 0; i < count; ++i) {
+    char key[32];
+    std::snprintf(key, sizeof(key), "huge%d", i);
+    int* value = (int*)MapGet(&map, key);
+    ASSERT_NE(value, nullptr);
+    ASSERT_EQ(*value, i);
+  }
+  MapRemove(&map, "huge0", std::strlen("huge0") + 1);
+  EXPECT_EQ(MapGet(&map, "huge0"), nullptr);
+  EXPECT_EQ(map.size, count - 1);
+
+  MapFree(&map);
+}
+
+TEST(HashNTest, MatchesHashOfUnterminatedString) {
+  EXPECT_EQ(HashN("hello", 5), Hash("hello"));
+  EXPECT_NE(HashN("hello", 6), Hash("hello"));
+}
+
+TEST(KeyCmpNTest, ComparesLengthAndBytes) {
+  EXPECT_EQ(KeyCmpN("ab\0c", 4, "ab\0c", 4), TRUE);
+  EXPECT_EQ(KeyCmpN("ab\0c", 4, "ab\0d", 4), FALSE);
+  EXPECT_EQ(KeyCmpN("abc", 2, "abc", 3), FALSE);
+  EXPECT_EQ(KeyCmpN(nullptr, 0, nullptr, 0), TRUE);
+  EXPECT_EQ(KeyCmpN("a", 1, nullptr, 0), FALSE);
+}
+
+class MapSizedKeyTest : public ::testing::Test {
+ protected:
+  void SetUp() override { MapInitN(&map, MAP_MIN_CAPACITY, HashN, KeyCmpN); }
+
+  void TearDown() override { MapFree(&map); }
+
+ protected:
+  Map map;
+};
+
+TEST_F(MapSizedKeyTest, StoresBinaryKeys) {
+  struct Uuid {
+    unsigned char bytes[16];
+  };
+  Uuid first = {};
+  Uuid second = {};
+  second.bytes[15] = 1;
+  const int one = 1;
+  const int two = 2;
+
+  MapInsertN(&map, &first, sizeof(first), &one, sizeof(one));
+  MapInsertN(&map, &second, sizeof(second), &two, sizeof(two));
+
+  EXPECT_EQ(map.size, 2);
+  EXPECT_EQ(*(int*)MapGetN(&map, &first, sizeof(first)), 1);
+  EXPECT_EQ(*(int*)MapGetN(&map, &second, sizeof(second)), 2);
+
+  MapRemoveN(&map, &first, sizeof(first));
+  EXPECT_EQ(MapGetN(&map, &first, sizeof(first)), nullptr);
+  EXPECT_EQ(*(int*)MapGetN(&map, &second, sizeof(second)), 2);
+}
+
+TEST_F(MapSizedKeyTest, DistinguishesKeysByLength) {
+  MapInsertN(&map, "abc", 2, "two", 4);
+  MapInsertN(&map, "abc", 3, "three", 6);
+
+  EXPECT_EQ(map.size, 2);
+  EXPECT_STREQ((char*)MapGetN(&map, "ab", 2), "two");
+  EXPECT_STREQ((char*)MapGetN(&map, "abc", 3), "three");
+  EXPECT_EQ(MapGetN(&map, "abcd", 4), nullptr);
+}
+
+TEST_F(MapSizedKeyTest, LegacyCallsUseStringLength) {
+  MapInsert(&map, "key", std::strlen("key"), "value", 6);
+
+  EXPECT_STREQ((char*)MapGet(&map, "key"), "value");
+  MapRemove(&map, "key", std::strlen("key"));
+  EXPECT_EQ(MapGet(&map, "key"), nullptr);
+  EXPECT_EQ(map.size, 0);
+}
+
+class MapIncrementalRehashTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    MapConfig config;
+    MapConfigInit(&config, MAP_MIN_CAPACITY, Hash, KeyCmp);
+    config.incremental_rehash = TRUE;
+    // Keep the oversized tables below from shrinking back on the next write.
+    config.min_load_factor = 0;
+    MapInitWithConfig(&map, &config);
+  }
+
+  void TearDown() override { MapFree(&map); }
+
+  void Insert(const int i) {
+    char key[32];
+    char value[32];
+    std::snprintf(key, sizeof(key), "key%d", i);
+    std::snprintf(value, sizeof(value), "value%d", i);
+    MapInsert(&map, key, std::strlen(key) + 1, value, std::strlen(value) + 1);
+  }
+
+  void ExpectPresent(const int i) {
+    char key[32];
+    char value[32];
+    std::snprintf(key, sizeof(key), "key%d", i);
+    std::snprintf(value, sizeof(value), "value%d", i);
+    ASSERT_STREQ((char*)MapGet(&map, key), value);
+  }
+
+ protected:
+  Map map;
+};
+
+TEST_F(MapIncrementalRehashTest, ReallocKeepsBothTablesUntilMigrated) {
+  for (int i = 0; i < 20; ++i) Insert(i);
+  MapRealloc(&map, 0x400);
+
+  EXPECT_NE(map.old_buckets, nullptr);
+  EXPECT_EQ(map.old_capacity, MAP_MIN_CAPACITY);
+  EXPECT_EQ(map.capacity, 0x400);
+
+  // Lookups find every entry through either table without migrating any.
+  for (int i = 0; i < 20; ++i) ExpectPresent(i);
+  EXPECT_NE(map.old_buckets, nullptr);
+
+  // Every write migrates `MAP_REHASH_STEP` buckets.
+  Insert(20);
+  EXPECT_NE(map.old_buckets, nullptr);
+  Insert(21);
+  EXPECT_EQ(map.old_buckets, nullptr);
+  for (int i = 0; i < 22; ++i) ExpectPresent(i);
+  EXPECT_EQ(map.size, 22);
+}
+
+TEST_F(MapIncrementalRehashTest, RemoveAndOverwriteDuringMigration) {
+  for (int i = 0; i < 20; ++i) Insert(i);
+  MapRealloc(&map, 0x400);
+
+  MapRemove(&map, "key19", std::strlen("key19") + 1);
+  MapInsert(&map, "key18", std::strlen("key18") + 1, "changed",
+            std::strlen("changed") + 1);
+  Insert(20);
+
+  EXPECT_EQ(map.size, 20);
+  EXPECT_EQ(MapGet(&map, "key19"), nullptr);
+  EXPECT_STREQ((char*)MapGet(&map, "key18"), "changed");
+  for (int i = 0; i < 18; ++i) ExpectPresent(i);
+  ExpectPresent(20);
+}
+
+TEST_F(MapIncrementalRehashTest, GrowsThroughManyInserts) {
+  for (int i = 0; i < 20000; ++i) Insert(i);
+
+  EXPECT_EQ(map.size, 20000);
+  EXPECT_GE(map.capacity, 20000);
+  for (int i = 0; i < 20000; ++i) ExpectPresent(i);
+}
+
+static int kMapRehashCount = 0;
+bool_t MapRehashCountPredicate(const void* key, const void* value) {
+  (void)key;
+  (void)value;
+  ++kMapRehashCount;
+  return TRUE;
+}
+
+TEST_F(MapIncrementalRehashTest, TraverseVisitsBothTables) {
+  for (int i = 0; i < 30; ++i) Insert(i);
+  MapRealloc(&map, 0x400);
+  // Migrates half of the old buckets.
+  Insert(30);
+  ASSERT_NE(map.old_buckets, nullptr);
+
+  MapTraverse(&map, MapRehashCountPredicate);
+
+  EXPECT_EQ(kMapRehashCount, 31);
+}
+
+TEST_F(MapIncrementalRehashTest, GetManyLooksUpBothTables) {
+  for (int i = 0; i < 20; ++i) Insert(i);
+  MapRealloc(&map, 0x400);
+  ASSERT_NE(map.old_buckets, nullptr);
+
+  const void* keys[] = {"key0", "key19", "missing", "key7"};
+  const size_t key_sizes[] = {5, 6, 8, 5};
+  void* values[4];
+  MapGetMany(&map, keys, key_sizes, 4, values);
+  EXPECT_STREQ((char*)values[0], "value0");
+  EXPECT_STREQ((char*)values[1], "value19");
+  EXPECT_EQ(values[2], nullptr);
+  EXPECT_STREQ((char*)values[3], "value7");
+}
+
+class MapGetManyTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    MapInitN(&map, MAP_MIN_CAPACITY, HashN, KeyCmpN);
+    for (int i = 0; i < kKeys; ++i) {
+      std::snprintf(keys[i], sizeof(keys[i]), "key%d", i);
+      // Only the even keys are inserted.
+      if (i % 2 == 0) MapInsertN(&map, keys[i], std::strlen(keys[i]), &i, 4);
+      key_ptrs[i] = keys[i];
+      key_sizes[i] = std::strlen(keys[i]);
+    }
+  }
+
+  void TearDown() override { MapFree(&map); }
+
+ protected:
+  // Not a multiple of `MAP_BATCH_WIDTH` so the last batch is partial.
+  static const int kKeys = MAP_BATCH_WIDTH * 3 + 5;
+
+  Map map;
+  char keys[kKeys][16];
+  const void* key_ptrs[kKeys];
+  size_t key_sizes[kKeys];
+};
+
+TEST_F(MapGetManyTest, MatchesMapGetN) {
+  void* values[kKeys];
+  MapGetMany(&map, key_ptrs, key_sizes, kKeys, values);
+  for (int i = 0; i < kKeys; ++i) {
+    EXPECT_EQ(values[i], MapGetN(&map, keys[i], key_sizes[i]));
+    if (i % 2 == 0) {
+      ASSERT_NE(values[i], nullptr);
+      EXPECT_EQ(*(int*)values[i], i);
+    } else {
+      EXPECT_EQ(values[i], nullptr);
+    }
+  }
+}
+
+TEST_F(MapGetManyTest, NullKeySizesUseStringLength) {
+  void* values[kKeys];
+  MapGetMany(&map, key_ptrs, nullptr, kKeys, values);
+  for (int i = 0; i < kKeys; ++i) {
+    EXPECT_EQ(values[i], MapGetN(&map, keys[i], key_sizes[i]));
+  }
+}
+
+TEST_F(MapGetManyTest, ContainsManyCountsPresentKeys) {
+  bool_t found[kKeys];
+  EXPECT_EQ(MapContainsMany(&map, key_ptrs, key_sizes, kKeys, found),
+            (kKeys + 1) / 2);
+  for (int i = 0; i < kKeys; ++i) EXPECT_EQ(found[i], i % 2 == 0);
+
+  EXPECT_EQ(MapContainsMany(&map, key_ptrs, key_sizes, kKeys, nullptr),
+            (kKeys + 1) / 2);
+  EXPECT_EQ(MapContainsMany(&map, key_ptrs, key_sizes, 0, found), 0);
+}
+
+TEST_F(MapLoadFactorTest, ReserveSizesTableForCount) {
+  Init(0.75, MAP_DEFAULT_MIN_LOAD_FACTOR);
+  MapReserve(&map, 1000);
+  const size_t capacity = map.capacity;
+  EXPECT_GE(map.grow_at, 1000);
+  EXPECT_LT(capacity / 2 * map.max_load_factor, 1000);
+
+  for (int i = 0; i < 1000; ++i) Insert(i);
+  EXPECT_EQ(map.capacity, capacity);
+
+  // Reserving less than the current capacity never shrinks the table.
+  MapReserve(&map, 10);
+  EXPECT_EQ(map.capacity, capacity);
+}
+
+TEST_F(MapIncrementalRehashTest, ReserveCompletesMigration) {
+  for (int i = 0; i < 20; ++i) Insert(i);
+  MapRealloc(&map, 0x400);
+  ASSERT_NE(map.old_buckets, nullptr);
+
+  MapReserve(&map, 0x1000);
+  EXPECT_EQ(map.old_buckets, nullptr);
+  EXPECT_EQ(map.capacity, 0x1000);
+  for (int i = 0; i < 20; ++i) ExpectPresent(i);
+}
+
+TEST_F(MapGetManyTest, InsertManyAddsAndOverwrites) {
+  Map other;
+  MapInitN(&other, MAP_MIN_CAPACITY, HashN, KeyCmpN);
+  MapInsertN(&other, keys[0], key_sizes[0], "old", 4);
+
+  const void* values[kKeys];
+  size_t value_sizes[kKeys];
+  for (int i = 0; i < kKeys; ++i) {
+    values[i] = keys[i];
+    value_sizes[i] = key_sizes[i] + 1;
+  }
+  EXPECT_EQ(MapInsertMany(&other, key_ptrs, key_sizes, values, value_sizes,
+                          kKeys),
+            kKeys - 1);
+  EXPECT_EQ(other.size, (size_t)kKeys);
+  for (int i = 0; i < kKeys; ++i) {
+    EXPECT_STREQ((char*)MapGetN(&other, keys[i], key_sizes[i]), keys[i]);
+  }
+  MapFree(&other);
+}
+
+static void MapTestAddInts(void* value, const size_t value_size,
+                           const void* update, const size_t update_size) {
+  ASSERT_EQ(value_size, sizeof(int));
+  ASSERT_EQ(update_size, sizeof(int));
+  *(int*)value += *(const int*)update;
+}
+
+class MapSingleProbeTest : public ::testing::Test {
+ protected:
+  void SetUp() override { MapInitN(&map, MAP_MIN_CAPACITY, HashN, KeyCmpN); }
+
+  void TearDown() override { MapFree(&map); }
+
+ protected:
+  Map map;
+};
+
+TEST_F(MapSingleProbeTest, GetOrInsertReturnsWritableSlot) {
+  const int zero = 0;
+  bool_t inserted = FALSE;
+  int* count = (int*)MapGetOrInsert(&map, "word", 4, &zero, sizeof(zero),
+                                    &inserted);
+  ASSERT_NE(count, nullptr);
+  EXPECT_EQ(inserted, TRUE);
+  EXPECT_EQ(*count, 0);
+  ++*count;
+
+  const int ignored = 42;
+  int* again = (int*)MapGetOrInsert(&map, "word", 4, &ignored, sizeof(ignored),
+                                    &inserted);
+  EXPECT_EQ(inserted, FALSE);
+  EXPECT_EQ(again, count);
+  EXPECT_EQ(*again, 1);
+  EXPECT_EQ(map.size, 1);
+}
+
+TEST_F(MapSingleProbeTest, GetOrInsertSlotsSurviveGrowth) {
+  const int zero = 0;
+  int* first = (int*)MapGetOrInsert(&map, "key0", 4, &zero, sizeof(zero),
+                                    nullptr);
+  char key[16];
+  for (int i = 1; i < 1000; ++i) {
+    std::snprintf(key, sizeof(key), "key%d", i);
+    MapGetOrInsert(&map, key, std::strlen(key), &i, sizeof(i), nullptr);
+  }
+  EXPECT_GT(map.capacity, MAP_MIN_CAPACITY);
+  EXPECT_EQ(MapGetN(&map, "key0", 4), first);
+}
+
+TEST_F(MapSingleProbeTest, UpsertMergesInPlace) {
+  const int one = 1;
+  const int two = 2;
+  int* sum = (int*)MapUpsert(&map, "k", 1, &one, sizeof(one), MapTestAddInts);
+  ASSERT_NE(sum, nullptr);
+  EXPECT_EQ(*sum, 1);
+  EXPECT_EQ(MapUpsert(&map, "k", 1, &two, sizeof(two), MapTestAddInts), sum);
+  EXPECT_EQ(*sum, 3);
+  EXPECT_EQ(map.size, 1);
+
+  // Without a merge callback the value is overwritten.
+  EXPECT_STREQ((char*)MapUpsert(&map, "k", 1, "replaced", 9, nullptr),
+               "replaced");
+  EXPECT_STREQ((char*)MapGetN(&map, "k", 1), "replaced");
+}
+
+TEST_F(MapSingleProbeTest, EmplaceReturnsSlotOfRequestedSize) {
+  bool_t inserted = FALSE;
+  char* slot = (char*)MapEmplace(&map, "k", 1, 6, &inserted);
+  ASSERT_NE(slot, nullptr);
+  EXPECT_EQ(inserted, TRUE);
+  std::memcpy(slot, "hello", 6);
+  EXPECT_STREQ((char*)MapGetN(&map, "k", 1), "hello");
+
+  slot = (char*)MapEmplace(&map, "k", 1, 3, &inserted);
+  EXPECT_EQ(inserted, FALSE);
+  EXPECT_EQ(slot, MapGetN(&map, "k", 1));
+  EXPECT_EQ(std::strncmp(slot, "hel", 3), 0);
+
+  slot = (char*)MapEmplace(&map, "k", 1, 0x100, &inserted);
+  ASSERT_NE(slot, nullptr);
+  std::memset(slot, 'x', 0x100);
+  EXPECT_EQ(((char*)MapGetN(&map, "k", 1))[0xFF], 'x');
+  EXPECT_EQ(map.size, 1);
+}
+
+TEST(MapWithHashTest, SharesHashesBetweenMapsWithTheSameSeed) {
+  MapConfig config;
+  MapConfigInit(&config, MAP_MIN_CAPACITY, NULL, NULL);
+  config.hash_seeded_func = HashBytes;
+  config.key_eq_n_func = KeyCmpN;
+  config.seed = 0x5EED;
+  Map tenant;
+  Map store;
+  MapInitWithConfig(&tenant, &config);
+  MapInitWithConfig(&store, &config);
+
+  const hash_t hash = MapHashKey(&tenant, "user:42", 7);
+  EXPECT_EQ(hash, MapHashKey(&store, "user:42", 7));
+
+  MapInsertWithHash(&store, "user:42", 7, hash, "alice", 6);
+  EXPECT_EQ(MapGetWithHash(&tenant, "user:42", 7, hash), nullptr);
+  EXPECT_STREQ((char*)MapGetWithHash(&store, "user:42", 7, hash), "alice");
+  EXPECT_STREQ((char*)MapGetN(&store, "user:42", 7), "alice");
+
+  MapRemoveWithHash(&store, "user:42", 7, hash);
+  EXPECT_EQ(MapGetN(&store, "user:42", 7), nullptr);
+  EXPECT_EQ(store.size, 0);
+
+  MapFree(&tenant);
+  MapFree(&store);
+}
+
 #endif  // STLC_TESTS_MAP_TESTMAP_HH_
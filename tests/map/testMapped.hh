@@ -0,0 +1,215 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_TESTS_MAP_TESTMAPPED_HH_
+#define STLC_TESTS_MAP_TESTMAPPED_HH_
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "bool.h"
+#include "map/hash.h"
+#include "map/map.h"
+
+class MapMappedTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char path_template[] = "/tmp/stlc_map_XXXXXX";
+    const int fd = mkstemp(path_template);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    path = path_template;
+    std::memset(&mapped, 0, sizeof(mapped));
+  }
+
+  void TearDown() override {
+    MappedMapClose(&mapped);
+    std::remove(path.c_str());
+  }
+
+  std::string path;
+  MappedMap mapped;
+};
+
+TEST_F(MapMappedTest, LooksUpEverySavedKey) {
+  Map map;
+  MapInit(&map, MAP_MIN_CAPACITY, Hash, KeyCmp);
+  char key[32];
+  for (size_t i = 0; i < 1000; ++i) {
+    std::snprintf(key, sizeof(key), "key%zu", i);
+    MapInsert(&map, key, std::strlen(key) + 1, &i, sizeof(i));
+  }
+  ASSERT_EQ(MapSave(&map, path.c_str()), TRUE);
+  MapFree(&map);
+
+  ASSERT_EQ(MapOpenMapped(&mapped, path.c_str(), Hash, KeyCmp), TRUE);
+  EXPECT_EQ(MappedMapSize(&mapped), 1000u);
+  for (size_t i = 0; i < 1000; ++i) {
+    std::snprintf(key, sizeof(key), "key%zu", i);
+    const void* value = MappedMapGet(&mapped, key);
+    ASSERT_NE(value, nullptr) << key;
+    EXPECT_EQ(*(const size_t*)value, i);
+    EXPECT_EQ((uintptr_t)value % MAP_FILE_ALIGNMENT, 0u);
+  }
+  EXPECT_EQ(MappedMapGet(&mapped, "missing"), nullptr);
+}
+
+TEST_F(MapMappedTest, KeepsTheSizesOfSizedKeysAndValues) {
+  Map map;
+  MapInitN(&map, MAP_MIN_CAPACITY, HashN, KeyCmpN);
+  MapInsertN(&map, "ab\0c", 4, "first", 6);
+  MapInsertN(&map, "ab\0d", 4, "second value", 13);
+  MapInsertN(&map, "", 0, "empty", 6);
+  ASSERT_EQ(MapSave(&map, path.c_str()), TRUE);
+  MapFree(&map);
+
+  MapConfig config;
+  MapConfigInit(&config, MAP_MIN_CAPACITY, nullptr, nullptr);
+  config.hash_n_func = HashN;
+  config.key_eq_n_func = KeyCmpN;
+  ASSERT_EQ(MapOpenMappedWithConfig(&mapped, path.c_str(), &config), TRUE);
+
+  size_t value_size = 0;
+  const void* value = MappedMapGetN(&mapped, "ab\0d", 4, &value_size);
+  ASSERT_NE(value, nullptr);
+  EXPECT_EQ(value_size, 13u);
+  EXPECT_STREQ((const char*)value, "second value");
+  value = MappedMapGetN(&mapped, "ab\0c", 4, &value_size);
+  ASSERT_NE(value, nullptr);
+  EXPECT_STREQ((const char*)value, "first");
+  value = MappedMapGetN(&mapped, "", 0, &value_size);
+  ASSERT_NE(value, nullptr);
+  EXPECT_STREQ((const char*)value, "empty");
+  EXPECT_EQ(MappedMapGetN(&mapped, "ab", 2, nullptr), nullptr);
+}
+
+TEST_F(MapMappedTest, HashesWithTheSavedSeed) {
+  Map map;
+  MapInitSeeded(&map, MAP_MIN_CAPACITY, HashBytes, KeyCmpN);
+  for (size_t i = 0; i < 100; ++i) {
+    const std::string key = "seeded" + std::to_string(i);
+    MapInsertN(&map, key.data(), key.size(), &i, sizeof(i));
+  }
+  ASSERT_EQ(MapSave(&map, path.c_str()), TRUE);
+  MapFree(&map);
+
+  MapConfig config;
+  MapConfigInit(&config, MAP_MIN_CAPACITY, nullptr, nullptr);
+  config.hash_seeded_func = HashBytes;
+  config.key_eq_n_func = KeyCmpN;
+  ASSERT_EQ(MapOpenMappedWithConfig(&mapped, path.c_str(), &config), TRUE);
+  for (size_t i = 0; i < 100; ++i) {
+    const std::string key = "seeded" + std::to_string(i);
+    const void* value = MappedMapGetN(&mapped, key.data(), key.size(), nullptr);
+    ASSERT_NE(value, nullptr) << key;
+    EXPECT_EQ(*(const size_t*)value, i);
+  }
+}
+
+TEST_F(MapMappedTest, SavesAMapInTheMiddleOfAnIncrementalResize) {
+  MapConfig config;
+  MapConfigInit(&config, MAP_MIN_CAPACITY, Hash, KeyCmp);
+  config.incremental_rehash = TRUE;
+  Map map;
+  MapInitWithConfig(&map, &config);
+  char key[32];
+  for (size_t i = 0; i < 100; ++i) {
+    std::snprintf(key, sizeof(key), "key%zu", i);
+    MapInsert(&map, key, std::strlen(key) + 1, &i, sizeof(i));
+  }
+  ASSERT_EQ(MapSave(&map, path.c_str()), TRUE);
+  EXPECT_EQ(map.old_buckets, nullptr);
+  MapFree(&map);
+
+  ASSERT_EQ(MapOpenMapped(&mapped, path.c_str(), Hash, KeyCmp), TRUE);
+  EXPECT_EQ(MappedMapSize(&mapped), 100u);
+  for (size_t i = 0; i < 100; ++i) {
+    std::snprintf(key, sizeof(key), "key%zu", i);
+    const void* value = MappedMapGet(&mapped, key);
+    ASSERT_NE(value, nullptr) << key;
+    EXPECT_EQ(*(const size_t*)value, i);
+  }
+}
+
+static size_t mapped_traversed;
+
+static bool_t CountMappedEntry(const void* key, const void* value) {
+  (void)key;
+  (void)value;
+  ++mapped_traversed;
+  return TRUE;
+}
+
+TEST_F(MapMappedTest, TraversesEveryEntry) {
+  Map map;
+  MapInit(&map, MAP_MIN_CAPACITY, Hash, KeyCmp);
+  char key[32];
+  for (size_t i = 0; i < 50; ++i) {
+    std::snprintf(key, sizeof(key), "key%zu", i);
+    MapInsert(&map, key, std::strlen(key) + 1, &i, sizeof(i));
+  }
+  ASSERT_EQ(MapSave(&map, path.c_str()), TRUE);
+  MapFree(&map);
+
+  ASSERT_EQ(MapOpenMapped(&mapped, path.c_str(), Hash, KeyCmp), TRUE);
+  mapped_traversed = 0;
+  MappedMapTraverse(&mapped, CountMappedEntry);
+  EXPECT_EQ(mapped_traversed, 50u);
+}
+
+TEST_F(MapMappedTest, SavesAnEmptyMap) {
+  Map map;
+  MapInit(&map, MAP_MIN_CAPACITY, Hash, KeyCmp);
+  ASSERT_EQ(MapSave(&map, path.c_str()), TRUE);
+  MapFree(&map);
+
+  ASSERT_EQ(MapOpenMapped(&mapped, path.c_str(), Hash, KeyCmp), TRUE);
+  EXPECT_EQ(MappedMapSize(&mapped), 0u);
+  EXPECT_EQ(MappedMapGet(&mapped, "key"), nullptr);
+}
+
+TEST_F(MapMappedTest, RejectsFilesThatAreNotMapFiles) {
+  FILE* file = std::fopen(path.c_str(), "wb");
+  ASSERT_NE(file, nullptr);
+  const char garbage[128] = "definitely not a map file";
+  std::fwrite(garbage, 1, sizeof(garbage), file);
+  std::fclose(file);
+
+  EXPECT_EQ(MapOpenMapped(&mapped, path.c_str(), Hash, KeyCmp), FALSE);
+  EXPECT_EQ(MapOpenMapped(&mapped, "/nonexistent/stlc.map", Hash, KeyCmp),
+            FALSE);
+  EXPECT_EQ(MappedMapGet(&mapped, "key"), nullptr);
+}
+
+#endif  // STLC_TESTS_MAP_TESTMAPPED_HH_
@@ -0,0 +1,224 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_TESTS_MAP_TESTSLAB_HH_
+#define STLC_TESTS_MAP_TESTSLAB_HH_
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "bool.h"
+#include "map/map.h"
+#include "map/ops.h"
+#include "map/slab.h"
+
+class MapSlabTest : public ::testing::Test {
+ protected:
+  void SetUp() override { MapSlabInit(&slab); }
+
+  void TearDown() override { MapSlabRelease(&slab); }
+
+ protected:
+  MapSlab slab;
+};
+
+TEST_F(MapSlabTest, ChunkSizeRoundsUpToClass) {
+  EXPECT_EQ(MapSlabChunkSize(1), 0x40);
+  EXPECT_EQ(MapSlabChunkSize(0x40), 0x40);
+  EXPECT_EQ(MapSlabChunkSize(0x41), 0x60);
+  EXPECT_EQ(MapSlabChunkSize(0x10000), 0x10000);
+  EXPECT_EQ(MapSlabIsLarge(0x40), FALSE);
+  EXPECT_EQ(MapSlabIsLarge(0x10000), TRUE);
+}
+
+TEST_F(MapSlabTest, AllocatesAlignedDistinctChunks) {
+  void* first = MapSlabAlloc(&slab, 0x30);
+  void* second = MapSlabAlloc(&slab, 0x30);
+
+  ASSERT_NE(first, nullptr);
+  ASSERT_NE(second, nullptr);
+  EXPECT_NE(first, second);
+  EXPECT_EQ((uintptr_t)first % MAP_SLAB_ALIGNMENT, 0U);
+  EXPECT_EQ((uintptr_t)second % MAP_SLAB_ALIGNMENT, 0U);
+  EXPECT_EQ(slab.stats.pages, 1);
+  EXPECT_EQ(slab.stats.chunks_in_use, 2);
+}
+
+TEST_F(MapSlabTest, RecyclesFreedChunks) {
+  void* first = MapSlabAlloc(&slab, 0x30);
+  MapSlabFree(&slab, first, 0x30);
+  EXPECT_EQ(slab.stats.chunks_free, 1);
+
+  void* second = MapSlabAlloc(&slab, 0x40);
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(slab.stats.recycled, 1);
+  EXPECT_EQ(slab.stats.chunks_free, 0);
+}
+
+TEST_F(MapSlabTest, ServesLargeRequestsWithMalloc) {
+  void* large = MapSlabAlloc(&slab, 0x10000);
+  ASSERT_NE(large, nullptr);
+  EXPECT_EQ(slab.stats.large_in_use, 1);
+  EXPECT_EQ(slab.stats.pages, 0);
+
+  MapSlabFree(&slab, large, 0x10000);
+  EXPECT_EQ(slab.stats.large_in_use, 0);
+}
+
+TEST_F(MapSlabTest, ReserveAllocatesOnePageForAllChunks) {
+  const size_t count = MAP_SLAB_PAGE_SIZE / 0x40 * 3;
+  ASSERT_EQ(MapSlabReserve(&slab, 0x30, count), TRUE);
+  EXPECT_EQ(slab.stats.pages, 1);
+  EXPECT_GE(slab.stats.bytes_reserved, count * 0x40);
+
+  for (size_t i = 0; i < count; ++i) {
+    ASSERT_NE(MapSlabAlloc(&slab, 0x30), nullptr);
+  }
+  EXPECT_EQ(slab.stats.pages, 1);
+
+  // The current page already fits a small reservation.
+  ASSERT_EQ(MapSlabReserve(&slab, 0x60, 1), TRUE);
+  ASSERT_EQ(MapSlabReserve(&slab, 0x60, 1), TRUE);
+  EXPECT_EQ(slab.stats.pages, 2);
+  EXPECT_EQ(MapSlabReserve(&slab, 0x10000, 8), TRUE);
+  EXPECT_EQ(slab.stats.pages, 2);
+}
+
+class MapWithSlabTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    MapConfig config;
+    MapConfigInit(&config, 40, Hash, KeyCmp);
+    config.use_slab = TRUE;
+    MapInitWithConfig(&map, &config);
+  }
+
+  void TearDown() override { MapFree(&map); }
+
+ protected:
+  Map map;
+};
+
+TEST_F(MapWithSlabTest, InsertGetRemove) {
+  char key[32];
+  char value[32];
+  for (int i = 0; i < 2000; ++i) {
+    std::snprintf(key, sizeof(key), "key%d", i);
+    std::snprintf(value, sizeof(value), "value%d", i);
+    MapInsert(&map, key, std::strlen(key) + 1, value, std::strlen(value) + 1);
+  }
+  for (int i = 0; i < 2000; i += 2) {
+    std::snprintf(key, sizeof(key), "key%d", i);
+    MapRemove(&map, key, std::strlen(key) + 1);
+  }
+
+  EXPECT_EQ(map.size, 1000);
+  for (int i = 1; i < 2000; i += 2) {
+    std::snprintf(key, sizeof(key), "key%d", i);
+    std::snprintf(value, sizeof(value), "value%d", i);
+    ASSERT_STREQ((char*)MapGet(&map, key), value);
+  }
+
+  MapSlabStats stats;
+  ASSERT_EQ(MapGetSlabStats(&map, &stats), TRUE);
+  EXPECT_EQ(stats.chunks_in_use, 1000);
+  EXPECT_EQ(stats.chunks_free, 1000);
+}
+
+TEST_F(MapWithSlabTest, OverwriteUsesChunkSlack) {
+  MapInsert(&map, "key", std::strlen("key") + 1, "v", std::strlen("v") + 1);
+  void* value = MapGet(&map, "key");
+  MapInsert(&map, "key", std::strlen("key") + 1, "longer",
+            std::strlen("longer") + 1);
+
+  EXPECT_EQ(MapGet(&map, "key"), value);
+  EXPECT_STREQ((char*)MapGet(&map, "key"), "longer");
+}
+
+TEST_F(MapWithSlabTest, OverwriteMovesToLargerClass) {
+  const std::string big(0x200, 'x');
+  MapInsert(&map, "key", std::strlen("key") + 1, "v", std::strlen("v") + 1);
+  MapInsert(&map, "key", std::strlen("key") + 1, big.c_str(), big.size() + 1);
+
+  EXPECT_STREQ((char*)MapGet(&map, "key"), big.c_str());
+  MapSlabStats stats;
+  ASSERT_EQ(MapGetSlabStats(&map, &stats), TRUE);
+  EXPECT_EQ(stats.chunks_in_use, 1);
+  EXPECT_EQ(stats.chunks_free, 1);
+}
+
+TEST_F(MapWithSlabTest, FreesLargeEntries) {
+  const std::string big(0x1000, 'x');
+  MapInsert(&map, "key", std::strlen("key") + 1, big.c_str(), big.size() + 1);
+
+  MapSlabStats stats;
+  ASSERT_EQ(MapGetSlabStats(&map, &stats), TRUE);
+  EXPECT_EQ(stats.large_in_use, 1);
+  EXPECT_STREQ((char*)MapGet(&map, "key"), big.c_str());
+}
+
+TEST_F(MapWithSlabTest, InsertManyCarvesEntriesFromOnePage) {
+  const size_t count = 0x4000;
+  std::vector<std::string> keys(count);
+  std::vector<const void*> key_ptrs(count);
+  std::vector<size_t> sizes(count);
+  for (size_t i = 0; i < count; ++i) {
+    char key[32];
+    std::snprintf(key, sizeof(key), "key%05zu", i);
+    keys[i] = key;
+    key_ptrs[i] = keys[i].c_str();
+    sizes[i] = keys[i].size() + 1;
+  }
+
+  EXPECT_EQ(MapInsertMany(&map, key_ptrs.data(), sizes.data(), key_ptrs.data(),
+                          sizes.data(), count),
+            count);
+  MapSlabStats stats;
+  ASSERT_EQ(MapGetSlabStats(&map, &stats), TRUE);
+  EXPECT_EQ(stats.pages, 1);
+  EXPECT_EQ(stats.chunks_in_use, count);
+  for (size_t i = 0; i < count; ++i) {
+    ASSERT_STREQ((char*)MapGet(&map, keys[i].c_str()), keys[i].c_str());
+  }
+}
+
+TEST(MapGetSlabStatsTest, FailsWithoutSlab) {
+  Map map;
+  MapInit(&map, 40, Hash, KeyCmp);
+  MapSlabStats stats;
+  EXPECT_EQ(MapGetSlabStats(&map, &stats), FALSE);
+  MapFree(&map);
+}
+
+#endif  // STLC_TESTS_MAP_TESTSLAB_HH_
@@ -0,0 +1,287 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_TESTS_ORDEREDMAP_TESTORDEREDMAP_HH_
+#define STLC_TESTS_ORDEREDMAP_TESTORDEREDMAP_HH_
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bool.h"
+#include "map/map.h"
+#include "orderedmap/orderedmap.h"
+
+class OrderedMapTest : public ::testing::Test {
+ protected:
+  void TearDown() override { OrderedMapFree(&map); }
+
+  void Insert(const char* key, const size_t value) {
+    OrderedMapInsert(&map, key, std::strlen(key) + 1, &value, sizeof(value));
+  }
+
+  const size_t* Get(const char* key) {
+    return (const size_t*)OrderedMapGet(&map, key, std::strlen(key) + 1,
+                                        nullptr);
+  }
+
+  bool_t Remove(const char* key) {
+    return OrderedMapRemove(&map, key, std::strlen(key) + 1);
+  }
+
+  static bool_t CollectKey(const void* key, const void* value) {
+    (void)value;
+    keys.push_back((const char*)key);
+    return TRUE;
+  }
+
+  std::vector<std::string> Keys() {
+    keys.clear();
+    OrderedMapTraverse(&map, CollectKey);
+    return keys;
+  }
+
+  static std::vector<std::string> keys;
+  OrderedMap map;
+};
+
+std::vector<std::string> OrderedMapTest::keys;
+
+TEST_F(OrderedMapTest, TraversesInInsertionOrder) {
+  OrderedMapInit(&map, 0, Hash, KeyCmp);
+  Insert("delta", 4);
+  Insert("alpha", 1);
+  Insert("charlie", 3);
+  Insert("bravo", 2);
+
+  EXPECT_EQ(OrderedMapSize(&map), 4u);
+  EXPECT_EQ(Keys(), (std::vector<std::string>{"delta", "alpha", "charlie",
+                                              "bravo"}));
+  EXPECT_EQ(*Get("alpha"), 1u);
+  EXPECT_EQ(*Get("delta"), 4u);
+  EXPECT_EQ(Get("echo"), nullptr);
+}
+
+TEST_F(OrderedMapTest, OverwriteKeepsThePosition) {
+  OrderedMapInit(&map, 0, Hash, KeyCmp);
+  Insert("a", 1);
+  Insert("b", 2);
+  Insert("c", 3);
+  Insert("a", 10);
+
+  // A larger value moves to a new block but keeps its place in the order.
+  const std::string big(100, 'x');
+  OrderedMapInsert(&map, "b", 2, big.c_str(), big.size() + 1);
+
+  EXPECT_EQ(OrderedMapSize(&map), 3u);
+  EXPECT_EQ(Keys(), (std::vector<std::string>{"a", "b", "c"}));
+  EXPECT_EQ(*Get("a"), 10u);
+  size_t value_size = 0;
+  EXPECT_STREQ((const char*)OrderedMapGet(&map, "b", 2, &value_size),
+               big.c_str());
+  EXPECT_EQ(value_size, big.size() + 1);
+}
+
+TEST_F(OrderedMapTest, ReinsertedKeyMovesToTheEnd) {
+  OrderedMapInit(&map, 0, Hash, KeyCmp);
+  Insert("a", 1);
+  Insert("b", 2);
+  Insert("c", 3);
+
+  EXPECT_EQ(Remove("a"), TRUE);
+  EXPECT_EQ(Remove("a"), FALSE);
+  EXPECT_EQ(Get("a"), nullptr);
+  EXPECT_EQ(Keys(), (std::vector<std::string>{"b", "c"}));
+
+  Insert("a", 4);
+  EXPECT_EQ(OrderedMapSize(&map), 3u);
+  EXPECT_EQ(Keys(), (std::vector<std::string>{"b", "c", "a"}));
+  EXPECT_EQ(*Get("a"), 4u);
+}
+
+TEST_F(OrderedMapTest, RebuildsKeepTheOrder) {
+  OrderedMapInit(&map, 0, Hash, KeyCmp);
+  std::vector<std::string> expected;
+  char key[32];
+  for (size_t i = 0; i < 1000; ++i) {
+    std::snprintf(key, sizeof(key), "key-%zu", i);
+    Insert(key, i);
+  }
+  // Removing most keys leaves holes that the next rebuild compacts away.
+  for (size_t i = 0; i < 1000; ++i) {
+    std::snprintf(key, sizeof(key), "key-%zu", i);
+    if (i % 10 != 0) {
+      ASSERT_EQ(Remove(key), TRUE);
+    } else {
+      expected.push_back(key);
+    }
+  }
+  for (size_t i = 1000; i < 1100; ++i) {
+    std::snprintf(key, sizeof(key), "key-%zu", i);
+    Insert(key, i);
+    expected.push_back(key);
+  }
+
+  EXPECT_EQ(OrderedMapSize(&map), 200u);
+  EXPECT_LE(map.entries_used, 2 * map.size);
+  EXPECT_EQ(Keys(), expected);
+  for (size_t i = 0; i < 1100; ++i) {
+    std::snprintf(key, sizeof(key), "key-%zu", i);
+    if (i < 1000 && i % 10 != 0) {
+      EXPECT_EQ(Get(key), nullptr);
+    } else {
+      ASSERT_NE(Get(key), nullptr);
+      EXPECT_EQ(*Get(key), i);
+    }
+  }
+}
+
+TEST_F(OrderedMapTest, FindsKeysInsertedAfterARebuildInPlace) {
+  char key[32];
+  for (size_t round = 0; round < 64; ++round) {
+    if (round != 0) OrderedMapFree(&map);
+    OrderedMapInitN(&map, 0, HashN, KeyCmpN);
+    for (size_t i = 0; i < 5; ++i) {
+      std::snprintf(key, sizeof(key), "%zu-%zu", round, i);
+      Insert(key, i);
+    }
+    // The key kept may have been displaced along its probe sequence, so its
+    // slot moves when the index table is rebuilt.
+    for (size_t i = 0; i < 4; ++i) {
+      std::snprintf(key, sizeof(key), "%zu-%zu", round, i);
+      ASSERT_EQ(Remove(key), TRUE);
+    }
+    // Dropping the tombstones rebuilds the index table at the same capacity.
+    const size_t capacity = map.capacity;
+    std::snprintf(key, sizeof(key), "%zu-new", round);
+    Insert(key, 5);
+    EXPECT_EQ(map.capacity, capacity);
+
+    EXPECT_EQ(OrderedMapSize(&map), 2u);
+    ASSERT_NE(Get(key), nullptr) << key;
+    EXPECT_EQ(*Get(key), 5u);
+    std::snprintf(key, sizeof(key), "%zu-4", round);
+    ASSERT_NE(Get(key), nullptr) << key;
+    EXPECT_EQ(*Get(key), 4u);
+  }
+}
+
+TEST_F(OrderedMapTest, GrowsTheIndexWidth) {
+  OrderedMapInit(&map, 0, Hash, KeyCmp);
+  EXPECT_EQ(map.index_width, 1u);
+
+  char key[32];
+  for (size_t i = 0; i < 70000; ++i) {
+    std::snprintf(key, sizeof(key), "%zu", i);
+    Insert(key, i);
+  }
+  EXPECT_EQ(map.index_width, 4u);
+  EXPECT_EQ(OrderedMapSize(&map), 70000u);
+  for (size_t i = 0; i < 70000; i += 7) {
+    std::snprintf(key, sizeof(key), "%zu", i);
+    ASSERT_NE(Get(key), nullptr);
+    EXPECT_EQ(*Get(key), i);
+  }
+}
+
+TEST_F(OrderedMapTest, ReserveAvoidsRebuilds) {
+  OrderedMapInit(&map, 0, Hash, KeyCmp);
+  OrderedMapReserve(&map, 500);
+  const size_t capacity = map.capacity;
+  EXPECT_GE(map.entries_capacity, 500u);
+
+  char key[32];
+  for (size_t i = 0; i < 500; ++i) {
+    std::snprintf(key, sizeof(key), "%zu", i);
+    Insert(key, i);
+  }
+  EXPECT_EQ(map.capacity, capacity);
+  EXPECT_EQ(OrderedMapSize(&map), 500u);
+}
+
+TEST_F(OrderedMapTest, SupportsSizedKeys) {
+  OrderedMapInitN(&map, 0, HashN, KeyCmpN);
+  const char bytes[] = {'a', '\0', 'b', '\0', 'c'};
+  const size_t first = 1, second = 2;
+  OrderedMapInsert(&map, bytes, 3, &first, sizeof(first));
+  OrderedMapInsert(&map, bytes, 5, &second, sizeof(second));
+
+  EXPECT_EQ(OrderedMapSize(&map), 2u);
+  EXPECT_EQ(*(const size_t*)OrderedMapGet(&map, bytes, 3, nullptr), 1u);
+  EXPECT_EQ(*(const size_t*)OrderedMapGet(&map, bytes, 5, nullptr), 2u);
+  EXPECT_EQ(OrderedMapGet(&map, bytes, 1, nullptr), nullptr);
+  EXPECT_EQ(OrderedMapRemove(&map, bytes, 3), TRUE);
+  EXPECT_EQ(OrderedMapGet(&map, bytes, 3, nullptr), nullptr);
+  EXPECT_EQ(*(const size_t*)OrderedMapGet(&map, bytes, 5, nullptr), 2u);
+}
+
+TEST_F(OrderedMapTest, MatchesAReferenceUnderRandomOperations) {
+  OrderedMapInit(&map, 0, Hash, KeyCmp);
+  std::mt19937 rng(42);
+  std::map<std::string, size_t> reference;
+  std::vector<std::string> order;
+  char key[32];
+  for (size_t step = 0; step < 20000; ++step) {
+    std::snprintf(key, sizeof(key), "k%u", (unsigned)(rng() % 512));
+    if (rng() % 3 == 0) {
+      const bool present = reference.erase(key) != 0;
+      ASSERT_EQ(Remove(key), present ? TRUE : FALSE);
+      if (present) order.erase(std::find(order.begin(), order.end(), key));
+    } else {
+      if (reference.find(key) == reference.end()) order.push_back(key);
+      reference[key] = step;
+      Insert(key, step);
+    }
+  }
+
+  ASSERT_EQ(OrderedMapSize(&map), reference.size());
+  EXPECT_EQ(Keys(), order);
+  for (const auto& item : reference) {
+    ASSERT_NE(Get(item.first.c_str()), nullptr);
+    EXPECT_EQ(*Get(item.first.c_str()), item.second);
+  }
+}
+
+TEST_F(OrderedMapTest, NullArgs) {
+  OrderedMapInit(nullptr, 0, Hash, KeyCmp);
+  OrderedMapInit(&map, 0, Hash, KeyCmp);
+  OrderedMapInsert(&map, nullptr, 0, nullptr, 0);
+  OrderedMapTraverse(&map, nullptr);
+  EXPECT_EQ(OrderedMapGet(&map, nullptr, 0, nullptr), nullptr);
+  EXPECT_EQ(OrderedMapRemove(&map, nullptr, 0), FALSE);
+  EXPECT_EQ(OrderedMapSize(&map), 0u);
+}
+
+#endif  // STLC_TESTS_ORDEREDMAP_TESTORDEREDMAP_HH_
@@ -0,0 +1,191 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_TESTS_SHARDEDMAP_TESTSHARDEDMAP_HH_
+#define STLC_TESTS_SHARDEDMAP_TESTSHARDEDMAP_HH_
+
+#include <gtest/gtest.h>
+#include <pthread.h>
+
+#include <cstdio>
+#include <cstring>
+
+#include "bool.h"
+#include "map/hash.h"
+#include "map/map.h"
+#include "shardedmap/iterators.h"
+#include "shardedmap/ops.h"
+#include "shardedmap/shardedmap.h"
+
+class ShardedMapTest : public ::testing::Test {
+ protected:
+  void SetUp() override { ShardedMapInit(&map, 8, 64, Hash, KeyCmp); }
+
+  void TearDown() override { ShardedMapFree(&map); }
+
+  void Insert(const char* key, const char* value) {
+    ShardedMapInsert(&map, key, std::strlen(key) + 1, value,
+                     std::strlen(value) + 1);
+  }
+
+  const char* Get(const char* key) {
+    return (const char*)ShardedMapGet(&map, key, std::strlen(key) + 1);
+  }
+
+ protected:
+  ShardedMap map;
+};
+
+TEST_F(ShardedMapTest, InitRoundsShardCountToPowerOfTwo) {
+  EXPECT_EQ(map.shard_count, 8);
+  EXPECT_EQ(map.shard_bits, 3);
+  EXPECT_EQ(ShardedMapSize(&map), 0);
+  for (size_t i = 0; i < map.shard_count; ++i) {
+    EXPECT_EQ(map.shards[i].map.capacity, MAP_MIN_CAPACITY);
+    EXPECT_EQ((size_t)&map.shards[i] % SHARDEDMAP_SHARD_ALIGNMENT, 0);
+  }
+
+  ShardedMap other;
+  ShardedMapInit(&other, 5, 1024, Hash, KeyCmp);
+  EXPECT_EQ(other.shard_count, 8);
+  EXPECT_EQ(other.shards[0].map.capacity, 128);
+  ShardedMapFree(&other);
+}
+
+TEST_F(ShardedMapTest, InitRejectsInvalidShardCount) {
+  ShardedMap other;
+  ShardedMapInit(&other, 0, 64, Hash, KeyCmp);
+  EXPECT_EQ(other.shards, nullptr);
+  ShardedMapInit(&other, SHARDEDMAP_MAX_SHARDS + 1, 64, Hash, KeyCmp);
+  EXPECT_EQ(other.shards, nullptr);
+  ShardedMapFree(&other);
+}
+
+TEST_F(ShardedMapTest, InsertGetOverwriteAndRemove) {
+  Insert("key1", "value1");
+  Insert("key2", "value2");
+  Insert("key1", "a much longer value than before");
+  EXPECT_EQ(ShardedMapSize(&map), 2);
+  EXPECT_STREQ(Get("key1"), "a much longer value than before");
+  EXPECT_STREQ(Get("key2"), "value2");
+  EXPECT_EQ(Get("key3"), nullptr);
+
+  ShardedMapRemove(&map, "key1", 5);
+  ShardedMapRemove(&map, "key3", 5);
+  EXPECT_EQ(ShardedMapSize(&map), 1);
+  EXPECT_EQ(Get("key1"), nullptr);
+  EXPECT_STREQ(Get("key2"), "value2");
+}
+
+TEST_F(ShardedMapTest, SpreadsKeysOverShards) {
+  char key[16];
+  for (int i = 0; i < 1000; ++i) {
+    std::snprintf(key, sizeof(key), "key%d", i);
+    Insert(key, key);
+  }
+  EXPECT_EQ(ShardedMapSize(&map), 1000);
+
+  size_t total = 0;
+  for (size_t i = 0; i < map.shard_count; ++i) {
+    EXPECT_GT(map.shards[i].map.size, 0);
+    total += map.shards[i].map.size;
+  }
+  EXPECT_EQ(total, 1000);
+  for (int i = 0; i < 1000; ++i) {
+    std::snprintf(key, sizeof(key), "key%d", i);
+    EXPECT_STREQ(Get(key), key);
+  }
+}
+
+static size_t sharded_map_visited;
+
+static bool_t ShardedMapCountThree(const void* key, const void* value) {
+  (void)key;
+  (void)value;
+  return ++sharded_map_visited < 3 ? TRUE : FALSE;
+}
+
+TEST_F(ShardedMapTest, TraverseStopsOnFalsePredicate) {
+  char key[16];
+  for (int i = 0; i < 100; ++i) {
+    std::snprintf(key, sizeof(key), "key%d", i);
+    Insert(key, key);
+  }
+  sharded_map_visited = 0;
+  ShardedMapTraverse(&map, ShardedMapCountThree);
+  EXPECT_EQ(sharded_map_visited, 3);
+}
+
+TEST(ShardedMapSeedTest, ShardsShareOneSeed) {
+  MapConfig config;
+  MapConfigInit(&config, 64, NULL, NULL);
+  config.hash_seeded_func = HashBytes;
+  config.key_eq_n_func = KeyCmpN;
+
+  ShardedMap map;
+  ShardedMapInitWithConfig(&map, 4, &config);
+  ASSERT_NE(map.shards, nullptr);
+  EXPECT_NE(map.shards[0].map.seed, 0);
+  for (size_t i = 1; i < map.shard_count; ++i) {
+    EXPECT_EQ(map.shards[i].map.seed, map.shards[0].map.seed);
+  }
+
+  ShardedMapInsert(&map, "abc", 3, "1", 2);
+  EXPECT_STREQ((const char*)ShardedMapGet(&map, "abc", 3), "1");
+  ShardedMapFree(&map);
+}
+
+static void* ShardedMapThreadFunc(void* arg) {
+  ShardedMap* const map = (ShardedMap*)arg;
+  char key[32];
+  for (int i = 0; i < 1000; ++i) {
+    std::snprintf(key, sizeof(key), "%p-%d", (void*)pthread_self(), i);
+    ShardedMapInsert(map, key, std::strlen(key) + 1, &i, sizeof(i));
+    if (i % 2 == 0) ShardedMapRemove(map, key, std::strlen(key) + 1);
+  }
+  return NULL;
+}
+
+TEST_F(ShardedMapTest, ConcurrentWritersKeepSizeConsistent) {
+  const int num_threads = 8;
+  pthread_t threads[num_threads];
+  for (int i = 0; i < num_threads; ++i) {
+    pthread_create(&threads[i], NULL, ShardedMapThreadFunc, &map);
+  }
+  for (int i = 0; i < num_threads; ++i) pthread_join(threads[i], NULL);
+
+  size_t total = 0;
+  for (size_t i = 0; i < map.shard_count; ++i) {
+    total += map.shards[i].map.size;
+  }
+  EXPECT_EQ(ShardedMapSize(&map), num_threads * 500);
+  EXPECT_EQ(total, num_threads * 500);
+}
+
+#endif  // STLC_TESTS_SHARDEDMAP_TESTSHARDEDMAP_HH_
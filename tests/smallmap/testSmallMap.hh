@@ -0,0 +1,204 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_TESTS_SMALLMAP_TESTSMALLMAP_HH_
+#define STLC_TESTS_SMALLMAP_TESTSMALLMAP_HH_
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+
+#include "bool.h"
+#include "map/map.h"
+#include "smallmap/smallmap.h"
+
+class SmallMapTest : public ::testing::Test {
+ protected:
+  void SetUp() override { SmallMapInit(&map, Hash, KeyCmp); }
+  void TearDown() override { SmallMapFree(&map); }
+
+  void Insert(const char* key, const size_t value) {
+    SmallMapInsert(&map, key, std::strlen(key) + 1, &value, sizeof(value));
+  }
+
+  const size_t* Get(const char* key) {
+    return (const size_t*)SmallMapGet(&map, key, std::strlen(key) + 1);
+  }
+
+  bool_t Remove(const char* key) {
+    return SmallMapRemove(&map, key, std::strlen(key) + 1);
+  }
+
+  static bool_t CollectKey(const void* key, const void* value) {
+    (void)value;
+    keys.insert((const char*)key);
+    return TRUE;
+  }
+
+  std::set<std::string> Keys() {
+    keys.clear();
+    SmallMapTraverse(&map, CollectKey);
+    return keys;
+  }
+
+  static std::set<std::string> keys;
+  SmallMap map;
+};
+
+std::set<std::string> SmallMapTest::keys;
+
+TEST_F(SmallMapTest, IsSmallerThanAMap) {
+  EXPECT_LE(sizeof(SmallMap), 0x60u);
+  EXPECT_LT(sizeof(SmallMap), sizeof(Map));
+}
+
+TEST_F(SmallMapTest, KeepsFewEntriesInline) {
+  Insert("a", 1);
+  Insert("b", 2);
+  Insert("c", 3);
+  Insert("b", 20);
+
+  EXPECT_EQ(SmallMapIsPromoted(&map), FALSE);
+  EXPECT_EQ(SmallMapSize(&map), 3u);
+  EXPECT_EQ(*Get("a"), 1u);
+  EXPECT_EQ(*Get("b"), 20u);
+  EXPECT_EQ(*Get("c"), 3u);
+  EXPECT_EQ(Get("d"), nullptr);
+  EXPECT_EQ(Keys(), (std::set<std::string>{"a", "b", "c"}));
+
+  EXPECT_EQ(Remove("a"), TRUE);
+  EXPECT_EQ(Remove("a"), FALSE);
+  EXPECT_EQ(Get("a"), nullptr);
+  EXPECT_EQ(*Get("c"), 3u);
+  EXPECT_EQ(SmallMapSize(&map), 2u);
+}
+
+TEST_F(SmallMapTest, OverwritesWithALargerValue) {
+  Insert("a", 1);
+  const std::string big(100, 'x');
+  SmallMapInsert(&map, "a", 2, big.c_str(), big.size() + 1);
+  EXPECT_STREQ((const char*)SmallMapGet(&map, "a", 2), big.c_str());
+  EXPECT_EQ(SmallMapSize(&map), 1u);
+}
+
+TEST_F(SmallMapTest, PromotesPastTheInlineCapacity) {
+  char key[32];
+  std::set<std::string> expected;
+  for (size_t i = 0; i < SMALLMAP_INLINE_CAPACITY; ++i) {
+    std::snprintf(key, sizeof(key), "key-%zu", i);
+    Insert(key, i);
+    expected.insert(key);
+  }
+  EXPECT_EQ(SmallMapIsPromoted(&map), FALSE);
+
+  for (size_t i = SMALLMAP_INLINE_CAPACITY; i < 100; ++i) {
+    std::snprintf(key, sizeof(key), "key-%zu", i);
+    Insert(key, i);
+    expected.insert(key);
+  }
+  EXPECT_EQ(SmallMapIsPromoted(&map), TRUE);
+  EXPECT_EQ(SmallMapSize(&map), 100u);
+  EXPECT_EQ(Keys(), expected);
+  for (size_t i = 0; i < 100; ++i) {
+    std::snprintf(key, sizeof(key), "key-%zu", i);
+    ASSERT_NE(Get(key), nullptr);
+    EXPECT_EQ(*Get(key), i);
+  }
+  EXPECT_EQ(Remove("key-0"), TRUE);
+  EXPECT_EQ(Remove("key-0"), FALSE);
+  EXPECT_EQ(SmallMapSize(&map), 99u);
+
+  // A freed map starts over inline.
+  SmallMapFree(&map);
+  EXPECT_EQ(SmallMapIsPromoted(&map), FALSE);
+  EXPECT_EQ(SmallMapSize(&map), 0u);
+  Insert("a", 1);
+  EXPECT_EQ(*Get("a"), 1u);
+}
+
+TEST_F(SmallMapTest, SupportsSizedKeys) {
+  SmallMapInitN(&map, HashN, KeyCmpN);
+  const char bytes[] = {'a', '\0', 'b', '\0', 'c'};
+  const size_t first = 1, second = 2;
+  SmallMapInsert(&map, bytes, 3, &first, sizeof(first));
+  SmallMapInsert(&map, bytes, 5, &second, sizeof(second));
+
+  EXPECT_EQ(SmallMapSize(&map), 2u);
+  EXPECT_EQ(*(const size_t*)SmallMapGet(&map, bytes, 3), 1u);
+  EXPECT_EQ(*(const size_t*)SmallMapGet(&map, bytes, 5), 2u);
+  EXPECT_EQ(SmallMapGet(&map, bytes, 1), nullptr);
+
+  // Sized keys keep working once promoted.
+  for (size_t i = 0; i < SMALLMAP_INLINE_CAPACITY; ++i) {
+    SmallMapInsert(&map, &i, sizeof(i), &i, sizeof(i));
+  }
+  EXPECT_EQ(SmallMapIsPromoted(&map), TRUE);
+  EXPECT_EQ(*(const size_t*)SmallMapGet(&map, bytes, 3), 1u);
+  EXPECT_EQ(*(const size_t*)SmallMapGet(&map, bytes, 5), 2u);
+}
+
+TEST_F(SmallMapTest, MatchesAReferenceUnderRandomOperations) {
+  std::mt19937 rng(7);
+  std::map<std::string, size_t> reference;
+  char key[32];
+  for (size_t step = 0; step < 5000; ++step) {
+    // Few distinct keys keep the map around the promotion threshold.
+    std::snprintf(key, sizeof(key), "k%u",
+                  (unsigned)(rng() % (SMALLMAP_INLINE_CAPACITY + 2)));
+    if (rng() % 3 == 0) {
+      const bool present = reference.erase(key) != 0;
+      ASSERT_EQ(Remove(key), present ? TRUE : FALSE);
+    } else {
+      reference[key] = step;
+      Insert(key, step);
+    }
+    ASSERT_EQ(SmallMapSize(&map), reference.size());
+  }
+  for (const auto& item : reference) {
+    ASSERT_NE(Get(item.first.c_str()), nullptr);
+    EXPECT_EQ(*Get(item.first.c_str()), item.second);
+  }
+}
+
+TEST_F(SmallMapTest, NullArgs) {
+  SmallMapInit(nullptr, Hash, KeyCmp);
+  SmallMapInsert(&map, nullptr, 0, nullptr, 0);
+  SmallMapTraverse(&map, nullptr);
+  EXPECT_EQ(SmallMapGet(&map, nullptr, 0), nullptr);
+  EXPECT_EQ(SmallMapRemove(&map, nullptr, 0), FALSE);
+  EXPECT_EQ(SmallMapSize(nullptr), 0u);
+  EXPECT_EQ(SmallMapSize(&map), 0u);
+}
+
+#endif  // STLC_TESTS_SMALLMAP_TESTSMALLMAP_HH_
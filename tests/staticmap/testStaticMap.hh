@@ -0,0 +1,184 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_TESTS_STATICMAP_TESTSTATICMAP_HH_
+#define STLC_TESTS_STATICMAP_TESTSTATICMAP_HH_
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "bool.h"
+#include "map/map.h"
+#include "staticmap/staticmap.h"
+
+class StaticMapTest : public ::testing::Test {
+ protected:
+  void TearDown() override { StaticMapFree(&map); }
+
+  // Builds `map` from "key<i>" -> `i` for every `i` in [0, `count`).
+  void BuildRange(const size_t count) {
+    char key[32];
+    for (size_t i = 0; i < count; ++i) {
+      std::snprintf(key, sizeof(key), "key%zu", i);
+      keys.push_back(key);
+      values.push_back(i);
+    }
+    std::vector<const void*> key_ptrs;
+    std::vector<size_t> key_sizes;
+    std::vector<const void*> value_ptrs;
+    std::vector<size_t> value_sizes;
+    for (size_t i = 0; i < count; ++i) {
+      key_ptrs.push_back(keys[i].c_str());
+      key_sizes.push_back(keys[i].size());
+      value_ptrs.push_back(&values[i]);
+      value_sizes.push_back(sizeof(size_t));
+    }
+    ASSERT_EQ(StaticMapBuild(&map, key_ptrs.data(), key_sizes.data(),
+                             value_ptrs.data(), value_sizes.data(), count),
+              TRUE);
+  }
+
+  // Checks that every key of the range maps to its value and that keys outside
+  // of it are missing.
+  void ExpectRange(const StaticMap* const target, const size_t count) {
+    EXPECT_EQ(StaticMapSize(target), count);
+    for (size_t i = 0; i < count; ++i) {
+      size_t value_size = 0;
+      const void* value =
+          StaticMapGet(target, keys[i].c_str(), keys[i].size(), &value_size);
+      ASSERT_NE(value, nullptr) << keys[i];
+      EXPECT_EQ(value_size, sizeof(size_t));
+      EXPECT_EQ(*(const size_t*)value, i);
+      EXPECT_EQ((uintptr_t)value % STATICMAP_ALIGNMENT, 0);
+    }
+    char key[32];
+    for (size_t i = count; i < count * 2; ++i) {
+      std::snprintf(key, sizeof(key), "key%zu", i);
+      EXPECT_EQ(StaticMapContains(target, key, std::strlen(key)), FALSE);
+    }
+    // A prefix of a present key is a different key.
+    if (count > 10) {
+      EXPECT_EQ(StaticMapContains(target, "key1", 3), FALSE);
+    }
+  }
+
+ protected:
+  StaticMap map;
+  std::vector<std::string> keys;
+  std::vector<size_t> values;
+};
+
+TEST_F(StaticMapTest, BuildAndGet) {
+  BuildRange(20000);
+  ExpectRange(&map, 20000);
+}
+
+TEST_F(StaticMapTest, UsesFewBitsOfMetadataPerKey) {
+  BuildRange(60000);
+  const double bits = (double)map.header->bucket_count * 16 / 60000;
+  EXPECT_LE(bits, 3.0);
+  EXPECT_GE(map.header->slot_count, map.header->count);
+  EXPECT_LE(map.header->slot_count * STATICMAP_LOAD_NUMERATOR,
+            map.header->count * STATICMAP_LOAD_DENOMINATOR +
+                STATICMAP_LOAD_NUMERATOR);
+}
+
+TEST_F(StaticMapTest, EmptyMap) {
+  BuildRange(0);
+  EXPECT_EQ(StaticMapSize(&map), 0);
+  EXPECT_EQ(StaticMapGet(&map, "key", 3, nullptr), nullptr);
+}
+
+TEST_F(StaticMapTest, RejectsDuplicateKeys) {
+  const void* key_ptrs[] = {"a", "b", "a"};
+  const size_t key_sizes[] = {1, 1, 1};
+  const int value = 0;
+  const void* value_ptrs[] = {&value, &value, &value};
+  const size_t value_sizes[] = {sizeof(int), sizeof(int), sizeof(int)};
+  EXPECT_EQ(StaticMapBuild(&map, key_ptrs, key_sizes, value_ptrs, value_sizes,
+                           3),
+            FALSE);
+  EXPECT_EQ(map.data, nullptr);
+}
+
+TEST_F(StaticMapTest, BuildFromMap) {
+  Map source;
+  MapInit(&source, MAP_MIN_CAPACITY, Hash, KeyCmp);
+  MapInsert(&source, "one", 4, "1", 2);
+  MapInsert(&source, "two", 4, "22", 3);
+  MapInsert(&source, "three", 6, "333", 4);
+
+  ASSERT_EQ(StaticMapBuildFromMap(&map, &source), TRUE);
+  MapFree(&source);
+
+  size_t value_size = 0;
+  EXPECT_EQ(StaticMapSize(&map), 3);
+  EXPECT_STREQ((const char*)StaticMapGet(&map, "two", 4, &value_size), "22");
+  EXPECT_EQ(value_size, 3);
+  EXPECT_STREQ((const char*)StaticMapGet(&map, "three", 6, nullptr), "333");
+  EXPECT_EQ(StaticMapGet(&map, "four", 5, nullptr), nullptr);
+}
+
+TEST_F(StaticMapTest, OpensACopyOfTheBuffer) {
+  BuildRange(1000);
+  void* copy = std::aligned_alloc(STATICMAP_ALIGNMENT,
+                                  _STATICMAP_ALIGN(map.size));
+  std::memcpy(copy, map.data, map.size);
+
+  StaticMap opened;
+  ASSERT_EQ(StaticMapOpen(&opened, copy, map.size), TRUE);
+  ExpectRange(&opened, 1000);
+  StaticMapFree(&opened);
+
+  EXPECT_EQ(StaticMapOpen(&opened, copy, map.size - 1), FALSE);
+  ((StaticMapHeader*)copy)->magic = 0;
+  EXPECT_EQ(StaticMapOpen(&opened, copy, map.size), FALSE);
+  std::free(copy);
+}
+
+static size_t kStaticMapCount = 0;
+bool_t StaticMapCountPredicate(const void* key, const void* value) {
+  (void)key;
+  (void)value;
+  ++kStaticMapCount;
+  return TRUE;
+}
+
+TEST_F(StaticMapTest, TraverseVisitsEveryEntry) {
+  BuildRange(500);
+  StaticMapTraverse(&map, StaticMapCountPredicate);
+  EXPECT_EQ(kStaticMapCount, 500);
+}
+
+#endif  // STLC_TESTS_STATICMAP_TESTSTATICMAP_HH_
@@ -0,0 +1,187 @@
+// Copyright 2021, The stlc authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of The stlc authors. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STLC_TESTS_SWISSMAP_TESTSWISSMAP_HH_
+#define STLC_TESTS_SWISSMAP_TESTSWISSMAP_HH_
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "bool.h"
+#include "map/map.h"
+#include "swissmap/swissmap.h"
+
+TEST(SwissMapMatchTest, MatchesFingerprintsAndFreeSlots) {
+  int8_t ctrl[SWISSMAP_GROUP_WIDTH];
+  std::memset(ctrl, SWISSMAP_CTRL_EMPTY, sizeof(ctrl));
+  ctrl[1] = 0x2A;
+  ctrl[7] = 0x2A;
+  ctrl[9] = 0x11;
+  ctrl[15] = SWISSMAP_CTRL_DELETED;
+
+  EXPECT_EQ(_SwissMapMatch(ctrl, 0x2A), (1U << 1) | (1U << 7));
+  EXPECT_EQ(_SwissMapMatch(ctrl, 0x11), 1U << 9);
+  EXPECT_EQ(_SwissMapMatch(ctrl, 0x00), 0U);
+  EXPECT_EQ(_SwissMapMatchEmpty(ctrl),
+            0xFFFFU & ~((1U << 1) | (1U << 7) | (1U << 9) | (1U << 15)));
+  EXPECT_EQ(_SwissMapMatchEmptyOrDeleted(ctrl),
+            0xFFFFU & ~((1U << 1) | (1U << 7) | (1U << 9)));
+}
+
+class SwissMapTest : public ::testing::Test {
+ protected:
+  void SetUp() override { SwissMapInit(&map, 0, Hash, KeyCmp); }
+
+  void TearDown() override { SwissMapFree(&map); }
+
+  void Insert(const char* key, const char* value) {
+    SwissMapInsert(&map, key, std::strlen(key) + 1, value,
+                   std::strlen(value) + 1);
+  }
+
+ protected:
+  SwissMap map;
+};
+
+TEST_F(SwissMapTest, InitRoundsCapacityToPowerOfTwo) {
+  SwissMap other;
+  SwissMapInit(&other, 100, Hash, KeyCmp);
+  EXPECT_EQ(other.capacity, 128);
+  EXPECT_EQ(other.size, 0);
+  EXPECT_NE(other.ctrl, nullptr);
+  EXPECT_NE(other.slots, nullptr);
+  SwissMapFree(&other);
+
+  EXPECT_EQ(map.capacity, SWISSMAP_GROUP_WIDTH);
+}
+
+TEST_F(SwissMapTest, InsertGetAndOverwrite) {
+  Insert("key1", "value1");
+  Insert("key2", "value2");
+  Insert("key1", "a much longer value than before");
+
+  EXPECT_EQ(map.size, 2);
+  EXPECT_STREQ((char*)SwissMapGet(&map, "key1"),
+               "a much longer value than before");
+  EXPECT_STREQ((char*)SwissMapGet(&map, "key2"), "value2");
+  EXPECT_EQ(SwissMapGet(&map, "key3"), nullptr);
+}
+
+TEST_F(SwissMapTest, AlignsValues) {
+  Insert("k", "value");
+  EXPECT_EQ((uintptr_t)SwissMapGet(&map, "k") % MAP_ENTRY_ALIGNMENT, 0u);
+  Insert("k", "a much longer value than before");
+  EXPECT_EQ((uintptr_t)SwissMapGet(&map, "k") % MAP_ENTRY_ALIGNMENT, 0u);
+  EXPECT_STREQ((char*)SwissMapGet(&map, "k"),
+               "a much longer value than before");
+}
+
+TEST_F(SwissMapTest, GrowsAndKeepsEntries) {
+  char key[32];
+  char value[32];
+  for (int i = 0; i < 5000; ++i) {
+    std::snprintf(key, sizeof(key), "key%d", i);
+    std::snprintf(value, sizeof(value), "value%d", i);
+    Insert(key, value);
+  }
+
+  EXPECT_EQ(map.size, 5000);
+  EXPECT_GE(map.capacity * SWISSMAP_MAX_LOAD_NUMERATOR,
+            map.size * SWISSMAP_MAX_LOAD_DENOMINATOR);
+  for (int i = 0; i < 5000; ++i) {
+    std::snprintf(key, sizeof(key), "key%d", i);
+    std::snprintf(value, sizeof(value), "value%d", i);
+    ASSERT_STREQ((char*)SwissMapGet(&map, key), value);
+  }
+}
+
+TEST_F(SwissMapTest, RemoveAndReinsertReusesSlots) {
+  char key[32];
+  for (int round = 0; round < 20; ++round) {
+    for (int i = 0; i < 200; ++i) {
+      std::snprintf(key, sizeof(key), "key%d-%d", round, i);
+      Insert(key, "value");
+    }
+    for (int i = 0; i < 200; ++i) {
+      std::snprintf(key, sizeof(key), "key%d-%d", round, i);
+      SwissMapRemove(&map, key);
+    }
+  }
+
+  EXPECT_EQ(map.size, 0);
+  // Churn must be absorbed by in-place rebuilds rather than growth.
+  EXPECT_LE(map.capacity, 512);
+  std::snprintf(key, sizeof(key), "key%d-%d", 0, 0);
+  EXPECT_EQ(SwissMapGet(&map, key), nullptr);
+}
+
+TEST_F(SwissMapTest, RemoveKeepsOtherEntriesReachable) {
+  char key[32];
+  for (int i = 0; i < 1000; ++i) {
+    std::snprintf(key, sizeof(key), "key%d", i);
+    Insert(key, "value");
+  }
+  for (int i = 0; i < 1000; i += 3) {
+    std::snprintf(key, sizeof(key), "key%d", i);
+    SwissMapRemove(&map, key);
+  }
+
+  for (int i = 0; i < 1000; ++i) {
+    std::snprintf(key, sizeof(key), "key%d", i);
+    if (i % 3 == 0) {
+      EXPECT_EQ(SwissMapGet(&map, key), nullptr);
+    } else {
+      EXPECT_STREQ((char*)SwissMapGet(&map, key), "value");
+    }
+  }
+}
+
+static int kSwissMapCount = 0;
+bool_t SwissMapCountPredicate(const void* key, const void* value) {
+  (void)key;
+  (void)value;
+  ++kSwissMapCount;
+  return TRUE;
+}
+
+TEST_F(SwissMapTest, TraverseVisitsEveryEntry) {
+  Insert("key1", "value1");
+  Insert("key2", "value2");
+  Insert("key3", "value3");
+  SwissMapRemove(&map, "key2");
+
+  SwissMapTraverse(&map, SwissMapCountPredicate);
+
+  EXPECT_EQ(kSwissMapCount, 2);
+}
+
+#endif  // STLC_TESTS_SWISSMAP_TESTSWISSMAP_HH_
@@ -33,9 +33,39 @@
 #include "testFs.hh"
 #include "testString.hh"
 
+/* Header files including tests for `btreemap` API. */
+#include "btreemap/testBTreeMap.hh"
+
+/* Header files including tests for `expiringmap` API. */
+#include "expiringmap/testExpiringMap.hh"
+
+/* Header files including tests for `flatmap` API. */
+#include "flatmap/testFlatMap.hh"
+
+/* Header files including tests for `hashset` API. */
+#include "hashset/testHashSet.hh"
+
+/* Header files including tests for `intmap` API. */
+#include "intmap/testIntMap.hh"
+
+/* Header files including tests for `lrucache` API. */
+#include "lrucache/testLruCache.hh"
+
 /* Header files including tests for `map` API. */
+#include "map/testHash.hh"
 #include "map/testIterators.hh"
 #include "map/testMap.hh"
+#include "map/testMapped.hh"
+#include "map/testSlab.hh"
+
+/* Header files including tests for `orderedmap` API. */
+#include "orderedmap/testOrderedMap.hh"
+
+/* Header files including tests for `shardedmap` API. */
+#include "shardedmap/testShardedMap.hh"
+
+/* Header files including tests for `smallmap` API. */
+#include "smallmap/testSmallMap.hh"
 
 /* Header files including tests for `sstream` API. */
 #include "sstream/testAccessors.hh"
@@ -45,6 +75,12 @@
 #include "sstream/testPrinters.hh"
 #include "sstream/testSstream.hh"
 
+/* Header files including tests for `staticmap` API. */
+#include "staticmap/testStaticMap.hh"
+
+/* Header files including tests for `swissmap` API. */
+#include "swissmap/testSwissMap.hh"
+
 /* Header files including tests for `vector` API. */
 #include "vector/testAccessors.hh"
 #include "vector/testModifiers.hh"